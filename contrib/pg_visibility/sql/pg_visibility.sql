@@ -170,6 +170,17 @@ commit;
 select * from pg_visibility_map('copyfreeze');
 select * from pg_check_frozen('copyfreeze');
 
+-- A plain VACUUM of a freshly loaded table freezes its pages as they become
+-- all-visible, and counts them in relallfrozen.
+create table eager_freeze (a int, b text);
+insert into eager_freeze select g, repeat('x', 100) from generate_series(1, 1000) g;
+vacuum eager_freeze;
+select relpages > 1 as multiple_pages, relallfrozen = relpages as all_frozen
+  from pg_class where relname = 'eager_freeze';
+select count(*) = (select relpages from pg_class where relname = 'eager_freeze')
+  from pg_visibility_map('eager_freeze') where all_visible and all_frozen;
+select * from pg_check_frozen('eager_freeze');
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -180,3 +191,4 @@ drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
 drop table copyfreeze;
+drop table eager_freeze;
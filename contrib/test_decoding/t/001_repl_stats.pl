@@ -88,8 +88,8 @@ regression_slot3|t|t),
 # Test to remove one of the replication slots and adjust
 # max_replication_slots accordingly to the number of slots. This leads
 # to a mismatch between the number of slots present in the stats file and the
-# number of stats present in the shared memory, simulating the scenario for
-# drop slot message lost by the statistics collector process. We verify
+# number of stats present in the shared memory, simulating the scenario of
+# a slot removed without its statistics being dropped. We verify
 # replication statistics data is fine after restart.
 
 $node->stop;
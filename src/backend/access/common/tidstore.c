@@ -0,0 +1,764 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact storage for a set of TIDs, in local memory or a DSA area.
+ *
+ * The store is organized as a directory with one slot for each run of
+ * TIDSTORE_BLOCKS_PER_SEGMENT consecutive heap blocks.  A slot is either
+ * empty, or points to a "segment": a single allocation holding a sorted
+ * array of per-block entries that grows forwards from the start of the
+ * allocation, and the offset data of those entries, which grows backwards
+ * from its end.  When the two meet, the segment is reallocated larger.
+ *
+ * Each block's offsets are kept in whichever of these forms is smallest:
+ *
+ *	- up to TIDSTORE_INLINE_OFFSETS offsets are stored inside the entry
+ *	  itself, so a block with one or two TIDs costs just one entry;
+ *	- otherwise, a sorted array of OffsetNumbers; or
+ *	- a bitmap of offsets, truncated after the highest offset present.
+ *
+ * A lookup is therefore an array index into the directory, a binary search
+ * over at most TIDSTORE_BLOCKS_PER_SEGMENT entries, and a bit test (or a
+ * short search of an offset array).  The directory is sized for the number
+ * of blocks the caller says the relation has when the store is created, and
+ * TIDs beyond that are rejected.
+ *
+ * A store that is only used by the backend that creates it lives in a memory
+ * context of its own.  Otherwise everything is allocated in a DSA area
+ * supplied by the caller, so the store can be handed to other processes by
+ * passing TidStoreGetHandle() along with the area.  TidStoreSetBlockOffsets()
+ * may then be called concurrently by several processes, and serializes
+ * itself with an LWLock; all other operations must not run concurrently with
+ * insertions.  Each block can only be set once between resets.
+ *
+ * Memory usage, as reported and checked against the caller's limit, counts
+ * the segments only.  The directory costs one pointer per segment regardless
+ * of how many TIDs are stored.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tidstore.h"
+#include "port/pg_bitutils.h"
+#include "storage/lwlock.h"
+#include "utils/memutils.h"
+
+/* Number of heap blocks covered by one directory slot */
+#define TIDSTORE_BLOCKS_PER_SEGMENT		1024
+
+/* Initial allocation for a segment, and the most we grow one by at once */
+#define TIDSTORE_SEGMENT_INIT_SIZE		64
+#define TIDSTORE_SEGMENT_GROW_MAX		8192
+
+/* Number of offsets that can be stored inside an entry */
+#define TIDSTORE_INLINE_OFFSETS			2
+
+/*
+ * Per-block entry.  The low bits of "info" hold the number of offsets, or
+ * for a bitmap the number of bitmap bytes; the high bit says which.
+ */
+typedef struct TidStoreEntry
+{
+	uint16		blkoff;			/* block number within the segment */
+	uint16		info;			/* encoding and length, see above */
+	union
+	{
+		uint32		dataoff;	/* offset of data from start of segment */
+		OffsetNumber offsets[TIDSTORE_INLINE_OFFSETS];
+	}			u;
+} TidStoreEntry;
+
+#define TIDSTORE_ENTRY_BITMAP		0x8000
+#define TIDSTORE_ENTRY_LENGTH_MASK	0x7FFF
+
+#define EntryIsBitmap(entry)	(((entry)->info & TIDSTORE_ENTRY_BITMAP) != 0)
+#define EntryLength(entry)		((entry)->info & TIDSTORE_ENTRY_LENGTH_MASK)
+#define EntryIsInline(entry) \
+	(!EntryIsBitmap(entry) && EntryLength(entry) <= TIDSTORE_INLINE_OFFSETS)
+
+typedef struct TidStoreSegment
+{
+	uint32		size;			/* size of the allocation */
+	uint32		nentries;		/* number of entries */
+	uint32		data_start;		/* offset of lowest byte of data in use */
+	TidStoreEntry entries[FLEXIBLE_ARRAY_MEMBER];	/* sorted by blkoff */
+} TidStoreSegment;
+
+#define SegmentEntriesEnd(seg) \
+	(offsetof(TidStoreSegment, entries) + \
+	 (seg)->nentries * sizeof(TidStoreEntry))
+#define SegmentFreeSpace(seg) \
+	((seg)->data_start - SegmentEntriesEnd(seg))
+#define EntryData(seg, entry)	((char *) (seg) + (entry)->u.dataoff)
+
+/* Shared state, in the DSA area if there is one */
+typedef struct TidStoreControl
+{
+	LWLock		lock;			/* serializes insertions */
+	size_t		max_bytes;		/* memory limit, see TidStoreIsFull */
+	size_t		mem_used;		/* total size of all segments */
+	int64		num_tids;		/* number of TIDs stored */
+	BlockNumber nblocks;		/* blocks the directory covers */
+	uint32		nsegments;		/* number of directory slots */
+	dsa_pointer segments[FLEXIBLE_ARRAY_MEMBER];	/* the directory, if in a
+													 * DSA area */
+} TidStoreControl;
+
+/* Per-backend state */
+struct TidStore
+{
+	dsa_area   *area;			/* NULL if the store is local */
+	dsa_pointer handle;
+	TidStoreControl *control;
+
+	/* For a local store, its memory context and the directory */
+	MemoryContext context;
+	TidStoreSegment **local_segments;
+};
+
+struct TidStoreIter
+{
+	TidStore   *ts;
+	uint32		segno;			/* current directory slot */
+	uint32		entryno;		/* next entry to return within it */
+	BlockNumber end;			/* stop before this block */
+	TidStoreIterResult result;
+};
+
+static TidStoreSegment *tidstore_get_segment(TidStore *ts, uint32 segno);
+static TidStoreSegment *tidstore_alloc_segment(TidStore *ts, uint32 size,
+											   dsa_pointer *dp);
+static void tidstore_set_segment(TidStore *ts, uint32 segno,
+								 TidStoreSegment *seg, dsa_pointer dp);
+static bool tidstore_search(TidStoreSegment *seg, uint16 blkoff, int *pos);
+static TidStoreSegment *tidstore_grow_segment(TidStore *ts, uint32 segno,
+											  uint32 needed);
+static bool tidstore_entry_has_offset(TidStoreSegment *seg,
+									  TidStoreEntry *entry, OffsetNumber off);
+static int	tidstore_entry_get_offsets(TidStoreSegment *seg,
+									   TidStoreEntry *entry,
+									   OffsetNumber *offsets);
+
+
+/*
+ * Create a TidStore able to hold TIDs for blocks [0, nblocks), in the given
+ * DSA area, or in local memory if area is NULL.  A local store lives in a
+ * child of CurrentMemoryContext.
+ *
+ * max_bytes is the memory budget; see TidStoreIsFull.  tranche_id is used for
+ * the lock serializing insertions into a shared store.
+ */
+TidStore *
+TidStoreCreate(dsa_area *area, BlockNumber nblocks, size_t max_bytes,
+			   int tranche_id)
+{
+	TidStore   *ts;
+	TidStoreControl *control;
+	dsa_pointer handle;
+	uint32		nsegments;
+
+	/* careful to not overflow near MaxBlockNumber */
+	nsegments = nblocks / TIDSTORE_BLOCKS_PER_SEGMENT +
+		(nblocks % TIDSTORE_BLOCKS_PER_SEGMENT != 0);
+
+	ts = (TidStore *) palloc(sizeof(TidStore));
+	ts->area = area;
+
+	if (area == NULL)
+	{
+		ts->context = AllocSetContextCreate(CurrentMemoryContext,
+											"TID store",
+											ALLOCSET_DEFAULT_SIZES);
+		handle = InvalidDsaPointer;
+		control = (TidStoreControl *)
+			MemoryContextAlloc(ts->context,
+							   offsetof(TidStoreControl, segments));
+		ts->local_segments = (TidStoreSegment **)
+			MemoryContextAllocZero(ts->context,
+								   nsegments * sizeof(TidStoreSegment *));
+	}
+	else
+	{
+		/* Zeroing the directory marks every slot as InvalidDsaPointer */
+		handle = dsa_allocate_extended(area,
+									   offsetof(TidStoreControl, segments) +
+									   nsegments * sizeof(dsa_pointer),
+									   DSA_ALLOC_ZERO);
+		control = (TidStoreControl *) dsa_get_address(area, handle);
+		ts->context = NULL;
+		ts->local_segments = NULL;
+	}
+
+	LWLockInitialize(&control->lock, tranche_id);
+	control->max_bytes = max_bytes;
+	control->mem_used = 0;
+	control->num_tids = 0;
+	control->nblocks = nblocks;
+	control->nsegments = nsegments;
+
+	ts->handle = handle;
+	ts->control = control;
+
+	return ts;
+}
+
+/*
+ * Attach to a TidStore created by another process.
+ */
+TidStore *
+TidStoreAttach(dsa_area *area, dsa_pointer handle)
+{
+	TidStore   *ts;
+
+	Assert(DsaPointerIsValid(handle));
+
+	ts = (TidStore *) palloc(sizeof(TidStore));
+	ts->area = area;
+	ts->handle = handle;
+	ts->control = (TidStoreControl *) dsa_get_address(area, handle);
+	ts->context = NULL;
+	ts->local_segments = NULL;
+
+	return ts;
+}
+
+/*
+ * Detach from a shared TidStore, leaving its contents in place for other
+ * processes.
+ */
+void
+TidStoreDetach(TidStore *ts)
+{
+	Assert(ts->area != NULL);
+	pfree(ts);
+}
+
+/*
+ * Free all memory used by a TidStore.  No other process may be using it.
+ */
+void
+TidStoreDestroy(TidStore *ts)
+{
+	if (ts->area == NULL)
+		MemoryContextDelete(ts->context);
+	else
+	{
+		TidStoreReset(ts);
+		dsa_free(ts->area, ts->handle);
+	}
+	pfree(ts);
+}
+
+/*
+ * Get a handle that other processes can pass to TidStoreAttach.
+ */
+dsa_pointer
+TidStoreGetHandle(TidStore *ts)
+{
+	Assert(ts->area != NULL);
+	return ts->handle;
+}
+
+/*
+ * Record the given offsets, which must be sorted and free of duplicates, as
+ * the TIDs of block blkno.
+ */
+void
+TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno,
+						OffsetNumber *offsets, int num_offsets)
+{
+	TidStoreControl *control = ts->control;
+	uint32		segno = blkno / TIDSTORE_BLOCKS_PER_SEGMENT;
+	TidStoreSegment *seg;
+	TidStoreEntry entry;
+	uint32		datalen;
+	int			pos;
+
+	Assert(num_offsets > 0 && num_offsets <= MaxOffsetNumber);
+#ifdef USE_ASSERT_CHECKING
+	for (int i = 0; i < num_offsets; i++)
+	{
+		Assert(OffsetNumberIsValid(offsets[i]));
+		Assert(i == 0 || offsets[i] > offsets[i - 1]);
+	}
+#endif
+
+	if (blkno >= control->nblocks)
+		elog(ERROR, "block %u is out of range for TID store of %u blocks",
+			 blkno, control->nblocks);
+
+	/* Work out the most compact representation of the offsets */
+	entry.blkoff = blkno % TIDSTORE_BLOCKS_PER_SEGMENT;
+	if (num_offsets <= TIDSTORE_INLINE_OFFSETS)
+	{
+		entry.info = num_offsets;
+		memset(entry.u.offsets, 0, sizeof(entry.u.offsets));
+		memcpy(entry.u.offsets, offsets, num_offsets * sizeof(OffsetNumber));
+		datalen = 0;
+	}
+	else
+	{
+		uint32		bitmaplen = (offsets[num_offsets - 1] + 7) / 8;
+
+		if (bitmaplen < num_offsets * sizeof(OffsetNumber))
+		{
+			entry.info = TIDSTORE_ENTRY_BITMAP | bitmaplen;
+			datalen = bitmaplen;
+		}
+		else
+		{
+			entry.info = num_offsets;
+			datalen = num_offsets * sizeof(OffsetNumber);
+		}
+	}
+	/* keep offset arrays aligned */
+	datalen = TYPEALIGN(sizeof(OffsetNumber), datalen);
+
+	if (ts->area != NULL)
+		LWLockAcquire(&control->lock, LW_EXCLUSIVE);
+
+	seg = tidstore_get_segment(ts, segno);
+	if (seg == NULL)
+	{
+		uint32		size;
+		dsa_pointer dp;
+
+		size = Max(TIDSTORE_SEGMENT_INIT_SIZE,
+				   offsetof(TidStoreSegment, entries) +
+				   sizeof(TidStoreEntry) + datalen);
+		seg = tidstore_alloc_segment(ts, size, &dp);
+		seg->size = size;
+		seg->nentries = 0;
+		seg->data_start = size;
+		tidstore_set_segment(ts, segno, seg, dp);
+		control->mem_used += size;
+	}
+
+	if (tidstore_search(seg, entry.blkoff, &pos))
+		elog(ERROR, "block %u is already present in TID store", blkno);
+
+	if (SegmentFreeSpace(seg) < sizeof(TidStoreEntry) + datalen)
+		seg = tidstore_grow_segment(ts, segno, sizeof(TidStoreEntry) + datalen);
+
+	/* Store the data, if it doesn't fit in the entry */
+	if (datalen > 0)
+	{
+		seg->data_start -= datalen;
+		entry.u.dataoff = seg->data_start;
+
+		if (EntryIsBitmap(&entry))
+		{
+			uint8	   *bitmap = (uint8 *) EntryData(seg, &entry);
+
+			memset(bitmap, 0, datalen);
+			for (int i = 0; i < num_offsets; i++)
+			{
+				int			bitno = offsets[i] - 1;
+
+				bitmap[bitno / 8] |= (1 << (bitno % 8));
+			}
+		}
+		else
+			memcpy(EntryData(seg, &entry), offsets,
+				   num_offsets * sizeof(OffsetNumber));
+	}
+
+	/* And insert the entry in its sorted position */
+	if (pos < seg->nentries)
+		memmove(&seg->entries[pos + 1], &seg->entries[pos],
+				(seg->nentries - pos) * sizeof(TidStoreEntry));
+	seg->entries[pos] = entry;
+	seg->nentries++;
+
+	control->num_tids += num_offsets;
+
+	if (ts->area != NULL)
+		LWLockRelease(&control->lock);
+}
+
+/*
+ * Is the given TID in the store?
+ */
+bool
+TidStoreIsMember(TidStore *ts, ItemPointer tid)
+{
+	TidStoreControl *control = ts->control;
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	uint32		segno = blkno / TIDSTORE_BLOCKS_PER_SEGMENT;
+	TidStoreSegment *seg;
+	int			pos;
+
+	if (segno >= control->nsegments)
+		return false;
+	seg = tidstore_get_segment(ts, segno);
+	if (seg == NULL)
+		return false;
+
+	if (!tidstore_search(seg, blkno % TIDSTORE_BLOCKS_PER_SEGMENT, &pos))
+		return false;
+
+	return tidstore_entry_has_offset(seg, &seg->entries[pos], off);
+}
+
+/*
+ * Forget all TIDs, keeping the store itself.
+ */
+void
+TidStoreReset(TidStore *ts)
+{
+	TidStoreControl *control = ts->control;
+
+	for (uint32 segno = 0; segno < control->nsegments; segno++)
+		tidstore_set_segment(ts, segno, NULL, InvalidDsaPointer);
+
+	control->mem_used = 0;
+	control->num_tids = 0;
+}
+
+int64
+TidStoreNumTids(TidStore *ts)
+{
+	return ts->control->num_tids;
+}
+
+size_t
+TidStoreMemoryUsage(TidStore *ts)
+{
+	return ts->control->mem_used;
+}
+
+size_t
+TidStoreMaxMemory(TidStore *ts)
+{
+	return ts->control->max_bytes;
+}
+
+/*
+ * Would recording the TIDs of one more block possibly take the store over its
+ * memory budget?
+ *
+ * A single TidStoreSetBlockOffsets call never grows memory usage by more than
+ * TIDSTORE_SEGMENT_GROW_MAX, so that's the headroom we require.
+ */
+bool
+TidStoreIsFull(TidStore *ts)
+{
+	TidStoreControl *control = ts->control;
+
+	return control->mem_used + TIDSTORE_SEGMENT_GROW_MAX > control->max_bytes;
+}
+
+/*
+ * Prepare to iterate over the store's contents, in block number order.
+ *
+ * The store must not be modified until TidStoreEndIterate is called.
+ */
+TidStoreIter *
+TidStoreBeginIterate(TidStore *ts)
+{
+	return TidStoreBeginIterateRange(ts, 0, ts->control->nblocks);
+}
+
+/*
+ * Like TidStoreBeginIterate, but only return blocks in [start, end).
+ *
+ * Several processes can iterate over disjoint ranges of the same store at
+ * once, which is how a parallel operation divides up the work of visiting
+ * the stored TIDs.
+ */
+TidStoreIter *
+TidStoreBeginIterateRange(TidStore *ts, BlockNumber start, BlockNumber end)
+{
+	TidStoreControl *control = ts->control;
+	TidStoreIter *iter;
+
+	iter = (TidStoreIter *) palloc(sizeof(TidStoreIter));
+	iter->ts = ts;
+	iter->segno = start / TIDSTORE_BLOCKS_PER_SEGMENT;
+	iter->entryno = 0;
+	iter->end = Min(end, control->nblocks);
+
+	/* Position on the first entry at or after start */
+	if (iter->segno < control->nsegments)
+	{
+		TidStoreSegment *seg = tidstore_get_segment(ts, iter->segno);
+		int			pos;
+
+		if (seg != NULL)
+		{
+			(void) tidstore_search(seg, start % TIDSTORE_BLOCKS_PER_SEGMENT,
+								   &pos);
+			iter->entryno = pos;
+		}
+	}
+
+	return iter;
+}
+
+/*
+ * Return the next block and its offsets, or NULL when there are no more.
+ *
+ * The result is overwritten by the next call.
+ */
+TidStoreIterResult *
+TidStoreIterateNext(TidStoreIter *iter)
+{
+	TidStore   *ts = iter->ts;
+	TidStoreControl *control = ts->control;
+
+	while (iter->segno < control->nsegments &&
+		   iter->segno * TIDSTORE_BLOCKS_PER_SEGMENT < iter->end)
+	{
+		TidStoreSegment *seg = tidstore_get_segment(ts, iter->segno);
+
+		if (seg != NULL)
+		{
+			if (iter->entryno < seg->nentries)
+			{
+				TidStoreEntry *entry = &seg->entries[iter->entryno++];
+
+				iter->result.blkno = iter->segno * TIDSTORE_BLOCKS_PER_SEGMENT +
+					entry->blkoff;
+				if (iter->result.blkno >= iter->end)
+					break;
+				iter->result.num_offsets =
+					tidstore_entry_get_offsets(seg, entry,
+											   iter->result.offsets);
+				return &iter->result;
+			}
+		}
+
+		iter->segno++;
+		iter->entryno = 0;
+	}
+
+	return NULL;
+}
+
+void
+TidStoreEndIterate(TidStoreIter *iter)
+{
+	pfree(iter);
+}
+
+/*
+ * Get the segment in the given directory slot, or NULL if it's empty.
+ */
+static TidStoreSegment *
+tidstore_get_segment(TidStore *ts, uint32 segno)
+{
+	dsa_pointer dp;
+
+	if (ts->area == NULL)
+		return ts->local_segments[segno];
+
+	dp = ts->control->segments[segno];
+	if (!DsaPointerIsValid(dp))
+		return NULL;
+	return (TidStoreSegment *) dsa_get_address(ts->area, dp);
+}
+
+/*
+ * Allocate memory for a segment.  For a shared store, *dp is set to its
+ * dsa_pointer, to be passed to tidstore_set_segment.
+ */
+static TidStoreSegment *
+tidstore_alloc_segment(TidStore *ts, uint32 size, dsa_pointer *dp)
+{
+	if (ts->area == NULL)
+	{
+		*dp = InvalidDsaPointer;
+		return (TidStoreSegment *) MemoryContextAlloc(ts->context, size);
+	}
+
+	*dp = dsa_allocate(ts->area, size);
+	return (TidStoreSegment *) dsa_get_address(ts->area, *dp);
+}
+
+/*
+ * Put a segment, or NULL, in a directory slot, freeing whatever was there.
+ */
+static void
+tidstore_set_segment(TidStore *ts, uint32 segno, TidStoreSegment *seg,
+					 dsa_pointer dp)
+{
+	if (ts->area == NULL)
+	{
+		if (ts->local_segments[segno] != NULL)
+			pfree(ts->local_segments[segno]);
+		ts->local_segments[segno] = seg;
+	}
+	else
+	{
+		if (DsaPointerIsValid(ts->control->segments[segno]))
+			dsa_free(ts->area, ts->control->segments[segno]);
+		ts->control->segments[segno] = dp;
+	}
+}
+
+/*
+ * Binary search a segment for the entry of the given block.
+ *
+ * Returns true if found.  *pos is set to the entry's index, or if not found
+ * to the index at which it would have to be inserted.
+ */
+static bool
+tidstore_search(TidStoreSegment *seg, uint16 blkoff, int *pos)
+{
+	int			low = 0;
+	int			high = seg->nentries;
+
+	while (low < high)
+	{
+		int			mid = low + (high - low) / 2;
+
+		if (seg->entries[mid].blkoff < blkoff)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	*pos = low;
+	return low < seg->nentries && seg->entries[low].blkoff == blkoff;
+}
+
+/*
+ * Reallocate a segment with at least "needed" more bytes of free space.
+ *
+ * Entries stay at the front of the allocation and data moves to its end, so
+ * the data offsets of all non-inline entries shift by the size increase.
+ * Caller must hold the lock.
+ */
+static TidStoreSegment *
+tidstore_grow_segment(TidStore *ts, uint32 segno, uint32 needed)
+{
+	TidStoreControl *control = ts->control;
+	dsa_pointer newp;
+	TidStoreSegment *oldseg;
+	TidStoreSegment *newseg;
+	uint32		oldsize;
+	uint32		shift;
+
+	Assert(needed <= TIDSTORE_SEGMENT_GROW_MAX);
+
+	oldseg = tidstore_get_segment(ts, segno);
+	oldsize = oldseg->size;
+	shift = Max(needed, Min(oldsize, TIDSTORE_SEGMENT_GROW_MAX));
+
+	newseg = tidstore_alloc_segment(ts, oldsize + shift, &newp);
+
+	memcpy(newseg, oldseg, SegmentEntriesEnd(oldseg));
+	memcpy((char *) newseg + oldseg->data_start + shift,
+		   (char *) oldseg + oldseg->data_start,
+		   oldsize - oldseg->data_start);
+	newseg->size = oldsize + shift;
+	newseg->data_start += shift;
+
+	for (uint32 i = 0; i < newseg->nentries; i++)
+	{
+		if (!EntryIsInline(&newseg->entries[i]))
+			newseg->entries[i].u.dataoff += shift;
+	}
+
+	tidstore_set_segment(ts, segno, newseg, newp);
+	control->mem_used += shift;
+
+	return newseg;
+}
+
+/*
+ * Does a block's entry include the given offset?
+ */
+static bool
+tidstore_entry_has_offset(TidStoreSegment *seg, TidStoreEntry *entry,
+						  OffsetNumber off)
+{
+	int			len = EntryLength(entry);
+
+	if (!OffsetNumberIsValid(off))
+		return false;
+
+	if (EntryIsBitmap(entry))
+	{
+		uint8	   *bitmap = (uint8 *) EntryData(seg, entry);
+		int			bitno = off - 1;
+
+		if (bitno / 8 >= len)
+			return false;
+		return (bitmap[bitno / 8] & (1 << (bitno % 8))) != 0;
+	}
+	else if (EntryIsInline(entry))
+	{
+		for (int i = 0; i < len; i++)
+		{
+			if (entry->u.offsets[i] == off)
+				return true;
+		}
+		return false;
+	}
+	else
+	{
+		OffsetNumber *array = (OffsetNumber *) EntryData(seg, entry);
+		int			low = 0;
+		int			high = len;
+
+		while (low < high)
+		{
+			int			mid = low + (high - low) / 2;
+
+			if (array[mid] < off)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		return low < len && array[low] == off;
+	}
+}
+
+/*
+ * Decode a block's entry into a sorted array of offsets, returning how many
+ * there are.
+ */
+static int
+tidstore_entry_get_offsets(TidStoreSegment *seg, TidStoreEntry *entry,
+						   OffsetNumber *offsets)
+{
+	int			len = EntryLength(entry);
+	int			n = 0;
+
+	if (EntryIsBitmap(entry))
+	{
+		uint8	   *bitmap = (uint8 *) EntryData(seg, entry);
+
+		for (int i = 0; i < len; i++)
+		{
+			uint32		w = bitmap[i];
+
+			while (w != 0)
+			{
+				offsets[n++] = i * 8 + pg_rightmost_one_pos32(w) + 1;
+				w &= w - 1;
+			}
+		}
+	}
+	else if (EntryIsInline(entry))
+	{
+		memcpy(offsets, entry->u.offsets, len * sizeof(OffsetNumber));
+		n = len;
+	}
+	else
+	{
+		memcpy(offsets, EntryData(seg, entry), len * sizeof(OffsetNumber));
+		n = len;
+	}
+
+	return n;
+}
@@ -74,6 +74,8 @@ CreateTemplateTupleDesc(int natts)
 	desc->tdtypeid = RECORDOID;
 	desc->tdtypmod = -1;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tdfixedatts = -1;
+	desc->tddatumatts = 0;
 
 	return desc;
 }
@@ -293,6 +295,7 @@ TupleDescCopyEntry(TupleDesc dst, AttrNumber dstAttno,
 	 */
 	dstAtt->attnum = dstAttno;
 	dstAtt->attcacheoff = -1;
+	dst->tdfixedatts = -1;
 
 	/* since we're not copying constraints or defaults, clear these */
 	dstAtt->attnotnull = false;
@@ -618,6 +621,7 @@ TupleDescInitEntry(TupleDesc desc,
 	att->attstattarget = -1;
 	att->attcacheoff = -1;
 	att->atttypmod = typmod;
+	desc->tdfixedatts = -1;
 
 	att->attnum = attributeNumber;
 	att->attndims = attdim;
@@ -679,6 +683,7 @@ TupleDescInitBuiltinEntry(TupleDesc desc,
 	att->attstattarget = -1;
 	att->attcacheoff = -1;
 	att->atttypmod = typmod;
+	desc->tdfixedatts = -1;
 
 	att->attnum = attributeNumber;
 	att->attndims = attdim;
@@ -61,6 +61,7 @@
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/read_stream.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "storage/standby.h"
@@ -72,6 +73,7 @@
 #include "utils/spccache.h"
 
 
+static void heap_prepare_pagescan(HeapScanDesc scan);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -320,6 +322,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_prefetch_block = InvalidBlockNumber;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -371,14 +374,6 @@ void
 heapgetpage(TableScanDesc sscan, BlockNumber page)
 {
 	HeapScanDesc scan = (HeapScanDesc) sscan;
-	Buffer		buffer;
-	Snapshot	snapshot;
-	Page		dp;
-	int			lines;
-	int			ntup;
-	OffsetNumber lineoff;
-	ItemId		lpp;
-	bool		all_visible;
 
 	Assert(page < scan->rs_nblocks);
 
@@ -401,8 +396,260 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 									   RBM_NORMAL, scan->rs_strategy);
 	scan->rs_cblock = page;
 
-	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
-		return;
+	if (scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE)
+		heap_prepare_pagescan(scan);
+}
+
+/*
+ * heapgettup_initial_block - determine the first page of a forward scan
+ *
+ * Returns InvalidBlockNumber if there is nothing to scan, which can happen
+ * in a parallel scan if other processes have already finished it.
+ */
+static BlockNumber
+heapgettup_initial_block(HeapScanDesc scan)
+{
+	if (scan->rs_base.rs_parallel != NULL)
+	{
+		ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		ParallelBlockTableScanWorker pbscanwork =
+		scan->rs_parallelworkerdata;
+
+		table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
+												 pbscanwork, pbscan);
+
+		return table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+												 pbscanwork, pbscan);
+	}
+
+	return scan->rs_startblock;
+}
+
+/*
+ * heapgettup_advance_block - determine the page after "page" in a forward scan
+ *
+ * The scan is taken to be moving to that page: a parallel scan claims it, and
+ * otherwise rs_numblocks is counted down and the new position is reported for
+ * synchronized scans.  Returns InvalidBlockNumber if we've exhausted all the
+ * pages.
+ */
+static BlockNumber
+heapgettup_advance_block(HeapScanDesc scan, BlockNumber page)
+{
+	bool		finished;
+
+	if (scan->rs_base.rs_parallel != NULL)
+	{
+		ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		ParallelBlockTableScanWorker pbscanwork =
+		scan->rs_parallelworkerdata;
+
+		return table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+												 pbscanwork, pbscan);
+	}
+
+	page++;
+	if (page >= scan->rs_nblocks)
+		page = 0;
+	finished = (page == scan->rs_startblock) ||
+		(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
+
+	/*
+	 * Report our new scan position for synchronization purposes. We don't do
+	 * that when moving backwards, however. That would just mess up any other
+	 * forward-moving scanners.
+	 *
+	 * Note: we do this before checking for end of scan so that the final
+	 * state of the position hint is back at the start of the rel.  That's not
+	 * strictly necessary, but otherwise when you run the same query multiple
+	 * times the starting position would shift a little bit backwards on every
+	 * invocation, which is confusing. We don't guarantee any specific
+	 * ordering in general, though.
+	 */
+	if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
+		ss_report_location(scan->rs_base.rs_rd, page);
+
+	return finished ? InvalidBlockNumber : page;
+}
+
+/*
+ * heapgettup_lookahead_block - determine the page after "page" in a forward
+ * scan, without moving the scan
+ *
+ * This is heapgettup_advance_block() for the read stream, which may be any
+ * number of pages ahead of the scan.  It leaves rs_numblocks and the
+ * synchronized scan position alone; heapgetnextpage() updates those as the
+ * scan actually reaches each page.  The page limit set by
+ * heap_setscanlimits() is therefore checked against the distance from the
+ * scan's current page, which the remaining rs_numblocks is relative to.
+ *
+ * Returns InvalidBlockNumber if "page" is the last page of the scan.
+ */
+static BlockNumber
+heapgettup_lookahead_block(HeapScanDesc scan, BlockNumber page)
+{
+	Assert(scan->rs_base.rs_parallel == NULL);
+
+	page++;
+	if (page >= scan->rs_nblocks)
+		page = 0;
+	if (page == scan->rs_startblock)
+		return InvalidBlockNumber;
+
+	if (scan->rs_numblocks != InvalidBlockNumber)
+	{
+		BlockNumber base;
+		BlockNumber distance;
+
+		base = scan->rs_inited ? scan->rs_cblock : scan->rs_startblock;
+		if (page >= base)
+			distance = page - base;
+		else
+			distance = page + (scan->rs_nblocks - base);
+		if (distance >= scan->rs_numblocks)
+			return InvalidBlockNumber;
+	}
+
+	return page;
+}
+
+/*
+ * heap_scan_stream_read_next - read stream callback for forward scans
+ *
+ * The stream runs ahead of heapgettup(), so it keeps its own position in
+ * rs_prefetch_block.  When that is invalid, the stream has been reset and
+ * continues after the scan's current page (or from the start, if the scan
+ * hasn't started yet).
+ *
+ * A parallel scan claims its pages here, as the stream asks for them; that
+ * has to happen before they can be read.  Anything else that tracks the
+ * scan's progress is left to heapgetnextpage().
+ */
+static BlockNumber
+heap_scan_stream_read_next(ReadStream *stream, void *callback_private_data)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_private_data;
+
+	if (!BlockNumberIsValid(scan->rs_prefetch_block) && !scan->rs_inited)
+		scan->rs_prefetch_block = heapgettup_initial_block(scan);
+	else if (scan->rs_base.rs_parallel != NULL)
+		scan->rs_prefetch_block =
+			heapgettup_advance_block(scan, InvalidBlockNumber);
+	else if (BlockNumberIsValid(scan->rs_prefetch_block))
+		scan->rs_prefetch_block =
+			heapgettup_lookahead_block(scan, scan->rs_prefetch_block);
+	else
+		scan->rs_prefetch_block =
+			heapgettup_lookahead_block(scan, scan->rs_cblock);
+
+	return scan->rs_prefetch_block;
+}
+
+/*
+ * heap_scan_stream_discard - forget about pages read ahead of the scan
+ *
+ * Must be called whenever the scan moves anywhere other than forward, so
+ * that the read stream resumes after whatever page the scan is on when it
+ * next moves forward.
+ */
+static inline void
+heap_scan_stream_discard(HeapScanDesc scan)
+{
+	if (scan->rs_read_stream != NULL)
+	{
+		read_stream_reset(scan->rs_read_stream);
+		scan->rs_prefetch_block = InvalidBlockNumber;
+	}
+}
+
+/*
+ * heapgetnextpage - read the next page of a forward scan
+ *
+ * Like heapgetpage(), except that the scan determines which page comes next,
+ * taking it from the read stream if it has one.  Returns false if we've
+ * exhausted all the pages; no page is pinned in that case.
+ */
+static bool
+heapgetnextpage(HeapScanDesc scan)
+{
+	BlockNumber page;
+
+	if (scan->rs_read_stream == NULL)
+	{
+		if (!scan->rs_inited)
+			page = heapgettup_initial_block(scan);
+		else
+			page = heapgettup_advance_block(scan, scan->rs_cblock);
+
+		if (!BlockNumberIsValid(page))
+			return false;
+
+		heapgetpage((TableScanDesc) scan, page);
+		return true;
+	}
+
+	/* release previous scan buffer, if any */
+	if (BufferIsValid(scan->rs_cbuf))
+	{
+		ReleaseBuffer(scan->rs_cbuf);
+		scan->rs_cbuf = InvalidBuffer;
+	}
+
+	/* See comments in heapgetpage() */
+	CHECK_FOR_INTERRUPTS();
+
+	/* (Re)starting the scan means starting the stream over, too */
+	if (!scan->rs_inited)
+		heap_scan_stream_discard(scan);
+
+	scan->rs_cbuf = read_stream_next_buffer(scan->rs_read_stream);
+
+	/*
+	 * The stream has already chosen the page, but the scan only moves now.
+	 * For a non-parallel scan, that's when rs_numblocks counts down and the
+	 * synchronized scan position is reported, exactly as without a stream.
+	 */
+	if (scan->rs_inited && scan->rs_base.rs_parallel == NULL)
+	{
+		page = heapgettup_advance_block(scan, scan->rs_cblock);
+		Assert(BufferIsValid(scan->rs_cbuf) ?
+			   page == BufferGetBlockNumber(scan->rs_cbuf) :
+			   !BlockNumberIsValid(page));
+	}
+
+	if (!BufferIsValid(scan->rs_cbuf))
+	{
+		scan->rs_cblock = InvalidBlockNumber;
+		return false;
+	}
+	scan->rs_cblock = BufferGetBlockNumber(scan->rs_cbuf);
+
+	if (scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE)
+		heap_prepare_pagescan(scan);
+
+	return true;
+}
+
+/*
+ * heap_prepare_pagescan - subroutine for heapgetpage()
+ *
+ * In page-at-a-time mode, determine which tuples on the current page are
+ * visible, and save their offsets in rs_vistuples[].
+ */
+static void
+heap_prepare_pagescan(HeapScanDesc scan)
+{
+	BlockNumber page = scan->rs_cblock;
+	Buffer		buffer;
+	Snapshot	snapshot;
+	Page		dp;
+	int			lines;
+	int			ntup;
+	OffsetNumber lineoff;
+	ItemId		lpp;
+	bool		all_visible;
 
 	buffer = scan->rs_cbuf;
 	snapshot = scan->rs_base.rs_snapshot;
@@ -535,30 +782,15 @@ heapgettup(HeapScanDesc scan,
 				tuple->t_data = NULL;
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
+			/* read the first page */
+			if (!heapgetnextpage(scan))
 			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
 				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
+				Assert(!BufferIsValid(scan->rs_cbuf));
+				tuple->t_data = NULL;
+				return;
 			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock;
 			lineoff = FirstOffsetNumber;	/* first offnum */
 			scan->rs_inited = true;
 		}
@@ -584,6 +816,9 @@ heapgettup(HeapScanDesc scan,
 		/* backward parallel scan not supported */
 		Assert(scan->rs_base.rs_parallel == NULL);
 
+		/* pages read ahead for a forward scan are no use to us */
+		heap_scan_stream_discard(scan);
+
 		if (!scan->rs_inited)
 		{
 			/*
@@ -663,7 +898,10 @@ heapgettup(HeapScanDesc scan,
 
 		page = ItemPointerGetBlockNumber(&(tuple->t_self));
 		if (page != scan->rs_cblock)
+		{
+			heap_scan_stream_discard(scan);
 			heapgetpage((TableScanDesc) scan, page);
+		}
 
 		/* Since the tuple was previously fetched, needn't lock page here */
 		dp = BufferGetPage(scan->rs_cbuf);
@@ -756,40 +994,14 @@ heapgettup(HeapScanDesc scan,
 			if (page == 0)
 				page = scan->rs_nblocks;
 			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
-		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
+
+			if (!finished)
+				heapgetpage((TableScanDesc) scan, page);
 		}
 		else
 		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
+			finished = !heapgetnextpage(scan);
+			page = scan->rs_cblock;
 		}
 
 		/*
@@ -806,8 +1018,6 @@ heapgettup(HeapScanDesc scan,
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
-
 		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
 
 		dp = BufferGetPage(scan->rs_cbuf);
@@ -873,30 +1083,15 @@ heapgettup_pagemode(HeapScanDesc scan,
 				tuple->t_data = NULL;
 				return;
 			}
-			if (scan->rs_base.rs_parallel != NULL)
+			/* read the first page */
+			if (!heapgetnextpage(scan))
 			{
-				ParallelBlockTableScanDesc pbscan =
-				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-				ParallelBlockTableScanWorker pbscanwork =
-				scan->rs_parallelworkerdata;
-
-				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
-				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-														 pbscanwork, pbscan);
-
 				/* Other processes might have already finished the scan. */
-				if (page == InvalidBlockNumber)
-				{
-					Assert(!BufferIsValid(scan->rs_cbuf));
-					tuple->t_data = NULL;
-					return;
-				}
+				Assert(!BufferIsValid(scan->rs_cbuf));
+				tuple->t_data = NULL;
+				return;
 			}
-			else
-				page = scan->rs_startblock; /* first page */
-			heapgetpage((TableScanDesc) scan, page);
+			page = scan->rs_cblock;
 			lineindex = 0;
 			scan->rs_inited = true;
 		}
@@ -919,6 +1114,9 @@ heapgettup_pagemode(HeapScanDesc scan,
 		/* backward parallel scan not supported */
 		Assert(scan->rs_base.rs_parallel == NULL);
 
+		/* pages read ahead for a forward scan are no use to us */
+		heap_scan_stream_discard(scan);
+
 		if (!scan->rs_inited)
 		{
 			/*
@@ -988,7 +1186,10 @@ heapgettup_pagemode(HeapScanDesc scan,
 
 		page = ItemPointerGetBlockNumber(&(tuple->t_self));
 		if (page != scan->rs_cblock)
+		{
+			heap_scan_stream_discard(scan);
 			heapgetpage((TableScanDesc) scan, page);
+		}
 
 		/* Since the tuple was previously fetched, needn't lock page here */
 		dp = BufferGetPage(scan->rs_cbuf);
@@ -1065,40 +1266,14 @@ heapgettup_pagemode(HeapScanDesc scan,
 			if (page == 0)
 				page = scan->rs_nblocks;
 			page--;
-		}
-		else if (scan->rs_base.rs_parallel != NULL)
-		{
-			ParallelBlockTableScanDesc pbscan =
-			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
-			ParallelBlockTableScanWorker pbscanwork =
-			scan->rs_parallelworkerdata;
-
-			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
-													 pbscanwork, pbscan);
-			finished = (page == InvalidBlockNumber);
+
+			if (!finished)
+				heapgetpage((TableScanDesc) scan, page);
 		}
 		else
 		{
-			page++;
-			if (page >= scan->rs_nblocks)
-				page = 0;
-			finished = (page == scan->rs_startblock) ||
-				(scan->rs_numblocks != InvalidBlockNumber ? --scan->rs_numblocks == 0 : false);
-
-			/*
-			 * Report our new scan position for synchronization purposes. We
-			 * don't do that when moving backwards, however. That would just
-			 * mess up any other forward-moving scanners.
-			 *
-			 * Note: we do this before checking for end of scan so that the
-			 * final state of the position hint is back at the start of the
-			 * rel.  That's not strictly necessary, but otherwise when you run
-			 * the same query multiple times the starting position would shift
-			 * a little bit backwards on every invocation, which is confusing.
-			 * We don't guarantee any specific ordering in general, though.
-			 */
-			if (scan->rs_base.rs_flags & SO_ALLOW_SYNC)
-				ss_report_location(scan->rs_base.rs_rd, page);
+			finished = !heapgetnextpage(scan);
+			page = scan->rs_cblock;
 		}
 
 		/*
@@ -1115,8 +1290,6 @@ heapgettup_pagemode(HeapScanDesc scan,
 			return;
 		}
 
-		heapgetpage((TableScanDesc) scan, page);
-
 		dp = BufferGetPage(scan->rs_cbuf);
 		TestForOldSnapshot(scan->rs_base.rs_snapshot, scan->rs_base.rs_rd, dp);
 		lines = scan->rs_ntuples;
@@ -1263,6 +1436,21 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 
 	initscan(scan, key, false);
 
+	/*
+	 * Sequential scans read their pages through a read stream, so that
+	 * reads can be issued ahead of time and combined.  Other kinds of scans
+	 * either jump around or can be restricted to a range of blocks and run
+	 * backwards, so they just read pages as they go.
+	 */
+	if (scan->rs_base.rs_flags & SO_TYPE_SEQSCAN)
+		scan->rs_read_stream = read_stream_begin_relation(scan->rs_strategy,
+														  relation,
+														  MAIN_FORKNUM,
+														  heap_scan_stream_read_next,
+														  scan);
+	else
+		scan->rs_read_stream = NULL;
+
 	return (TableScanDesc) scan;
 }
 
@@ -1271,6 +1459,7 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 			bool allow_strat, bool allow_sync, bool allow_pagemode)
 {
 	HeapScanDesc scan = (HeapScanDesc) sscan;
+	BufferAccessStrategy old_strategy;
 
 	if (set_params)
 	{
@@ -1297,10 +1486,25 @@ heap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	if (scan->rs_read_stream != NULL)
+		read_stream_reset(scan->rs_read_stream);
+
 	/*
 	 * reinitialize scan descriptor
 	 */
+	old_strategy = scan->rs_strategy;
 	initscan(scan, key, true);
+
+	/* The stream must use the same access strategy as the scan */
+	if (scan->rs_read_stream != NULL && scan->rs_strategy != old_strategy)
+	{
+		read_stream_end(scan->rs_read_stream);
+		scan->rs_read_stream = read_stream_begin_relation(scan->rs_strategy,
+														  scan->rs_base.rs_rd,
+														  MAIN_FORKNUM,
+														  heap_scan_stream_read_next,
+														  scan);
+	}
 }
 
 void
@@ -1316,6 +1520,9 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	if (scan->rs_read_stream != NULL)
+		read_stream_end(scan->rs_read_stream);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -2253,8 +2460,10 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * performed in workers. We have the infrastructure to allow parallel
 	 * inserts in general except for the cases where inserts generate a new
 	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * Parallel COPY FROM rules those cases out before starting its workers,
+	 * and its workers say so by setting ParallelWorkerInsertsAllowed.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !ParallelWorkerInsertsAllowed)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -91,11 +91,8 @@ heapam_index_fetch_reset(IndexFetchTableData *scan)
 {
 	IndexFetchHeapData *hscan = (IndexFetchHeapData *) scan;
 
-	if (BufferIsValid(hscan->xs_cbuf))
-	{
-		ReleaseBuffer(hscan->xs_cbuf);
-		hscan->xs_cbuf = InvalidBuffer;
-	}
+	ReleaseBufferPinCache(&hscan->xs_pincache);
+	hscan->xs_cbuf = InvalidBuffer;
 }
 
 static void
@@ -124,18 +121,29 @@ heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 	/* We can skip the buffer-switching logic if we're in mid-HOT chain. */
 	if (!*call_again)
 	{
-		/* Switch to correct buffer if we don't have it already */
-		Buffer		prev_buf = hscan->xs_cbuf;
-
-		hscan->xs_cbuf = ReleaseAndReadBuffer(hscan->xs_cbuf,
-											  hscan->xs_base.rel,
-											  ItemPointerGetBlockNumber(tid));
+		BlockNumber blkno = ItemPointerGetBlockNumber(tid);
 
 		/*
-		 * Prune page, but only if we weren't already on this page
+		 * Switch to correct buffer if we don't have it already.  Index scans
+		 * tend to revisit the same few heap pages, so keep those pinned
+		 * rather than dropping the pin whenever we move to another page.
 		 */
-		if (prev_buf != hscan->xs_cbuf)
-			heap_page_prune_opt(hscan->xs_base.rel, hscan->xs_cbuf);
+		if (!BufferIsValid(hscan->xs_cbuf) ||
+			BufferGetBlockNumber(hscan->xs_cbuf) != blkno)
+		{
+			bool		newly_pinned;
+
+			hscan->xs_cbuf = ReadBufferCached(&hscan->xs_pincache,
+											  hscan->xs_base.rel,
+											  blkno,
+											  &newly_pinned);
+
+			/*
+			 * Prune page, but only if we haven't visited it already
+			 */
+			if (newly_pinned)
+				heap_page_prune_opt(hscan->xs_base.rel, hscan->xs_cbuf);
+		}
 	}
 
 	/* Obtain share-lock on the buffer so we can examine visibility */
@@ -1089,7 +1097,7 @@ heapam_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin,
 				 * our own.  In this case we should count and sample the row,
 				 * to accommodate users who load a table and analyze it in one
 				 * transaction.  (pgstat_report_analyze has to adjust the
-				 * numbers we send to the stats collector to make this come
+				 * numbers we send to the stats system to make this come
 				 * out right.)
 				 */
 				if (TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(targtuple->t_data)))
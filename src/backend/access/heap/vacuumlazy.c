@@ -4,37 +4,40 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
- * finite memory space usage.  To do that, we set upper bounds on the number of
- * tuples we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
+ * finite memory space usage.  To do that, we keep the TIDs in a TidStore
+ * (see access/common/tidstore.c), which stores each heap page's dead item
+ * offsets as a bitmap or a short array, and we bound the memory it may use.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
- * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * autovacuum_work_mem) memory space to keep track of dead tuples.  The store
+ * allocates memory as TIDs are added, so vacuuming a small table doesn't use
+ * a large amount uselessly.  If the store threatens to exceed its budget, we
+ * suspend the heap scan phase and perform a pass of index cleanup and page
+ * compaction, then resume the heap scan with an empty store.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
- * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * of index scans performed.  So nothing is ever added to the store, and the
+ * dead items of each page are passed straight to lazy_vacuum_heap_page.
  *
  * Lazy vacuum supports parallel execution with parallel worker processes.  In
  * a parallel vacuum, we perform both index vacuum and index cleanup with
  * parallel worker processes.  Individual indexes are processed by one vacuum
- * process.  At the beginning of a lazy vacuum (at lazy_scan_heap) we prepare
- * the parallel context and initialize the DSM segment that contains shared
- * information as well as the memory space for storing dead tuples.  When
- * starting either index vacuum or index cleanup, we launch parallel worker
- * processes.  Once all indexes are processed the parallel worker processes
- * exit.  After that, the leader process re-initializes the parallel context
- * so that it can use the same DSM for multiple passes of index vacuum and
- * for performing index cleanup.  For updating the index statistics, we need
- * to update the system table and since updates are not allowed during
- * parallel mode we update the index statistics after exiting from the
+ * process.  If the table is large enough, the two passes over the heap are
+ * performed in parallel too: the leader and the workers claim chunks of
+ * consecutive heap blocks from a shared counter, and all of them add the
+ * dead items they find to the shared dead tuple store.  At the beginning of
+ * a lazy vacuum (at lazy_scan_heap) we prepare the parallel context and
+ * initialize the DSM segment that contains shared information as well as the
+ * DSA area holding the dead tuple store.  When starting each heap pass, index
+ * vacuum or index cleanup, we launch parallel worker processes.  Once the
+ * work of the phase is done the parallel worker processes exit.  After that,
+ * the leader process re-initializes the parallel context so that it can use
+ * the same DSM for the following phases.  For updating the index statistics,
+ * we need to update the system table and since updates are not allowed
+ * during parallel mode we update the index statistics after exiting from the
  * parallel mode.
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
@@ -57,6 +60,7 @@
 #include "access/htup_details.h"
 #include "access/multixact.h"
 #include "access/parallel.h"
+#include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
 #include "access/xact.h"
@@ -75,6 +79,9 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -124,13 +131,6 @@
 #define VACUUM_FSM_EVERY_PAGES \
 	((BlockNumber) (((uint64) 8 * 1024 * 1024 * 1024) / BLCKSZ))
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
@@ -143,13 +143,30 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * A non-aggressive VACUUM visits up to this fraction of the pages that are
+ * all-visible but not all-frozen according to pg_class, only to freeze them.
+ * That way such pages get frozen over the course of several VACUUMs, instead
+ * of all at once by the next aggressive one.
+ */
+#define EAGER_FREEZE_SCAN_FRACTION	0.1
+
+/*
+ * Range of the number of heap blocks that a parallel vacuum participant
+ * claims at a time during the heap passes.  We use smaller chunks for small
+ * tables so that all participants get some work, but never so small that a
+ * chunk can't contain a run of SKIP_PAGES_THRESHOLD skippable pages.
+ */
+#define PARALLEL_VACUUM_MIN_CHUNK_SIZE	SKIP_PAGES_THRESHOLD
+#define PARALLEL_VACUUM_MAX_CHUNK_SIZE	((BlockNumber) 256)
+
 /*
  * DSM keys for parallel vacuum.  Unlike other parallel execution code, since
  * we don't need to worry about DSM keys conflicting with plan_node_id we can
  * use small integers.
  */
 #define PARALLEL_VACUUM_KEY_SHARED			1
-#define PARALLEL_VACUUM_KEY_DEAD_TUPLES		2
+#define PARALLEL_VACUUM_KEY_DSA				2
 #define PARALLEL_VACUUM_KEY_QUERY_TEXT		3
 #define PARALLEL_VACUUM_KEY_BUFFER_USAGE	4
 #define PARALLEL_VACUUM_KEY_WAL_USAGE		5
@@ -160,6 +177,12 @@
  */
 #define ParallelVacuumIsActive(vacrel) ((vacrel)->lps != NULL)
 
+/*
+ * Macro to check if the heap passes are divided among the participants of a
+ * parallel vacuum.  Also true in parallel vacuum workers doing heap work.
+ */
+#define ParallelHeapVacuumIsActive(vacrel) ((vacrel)->lvshared != NULL)
+
 /* Phases of vacuum during which we report error context. */
 typedef enum
 {
@@ -171,27 +194,39 @@ typedef enum
 	VACUUM_ERRCB_PHASE_TRUNCATE
 } VacErrPhase;
 
+/* Kinds of work that the leader can ask parallel vacuum workers to do */
+typedef enum
+{
+	PARALLEL_VACUUM_WORK_INDEXES,	/* index vacuum or cleanup */
+	PARALLEL_VACUUM_WORK_SCAN_HEAP, /* first heap pass */
+	PARALLEL_VACUUM_WORK_VACUUM_HEAP	/* second heap pass */
+} LVParallelWork;
+
 /*
- * LVDeadTuples stores the dead tuple TIDs collected during the heap scan.
- * This is allocated in the DSM segment in parallel mode and in local memory
- * in non-parallel mode.
+ * Results of parallel vacuum workers' heap passes.  Each worker adds its
+ * counts in here when it's done, and the leader adds the totals to its own
+ * LVRelState once all workers have finished.
  */
-typedef struct LVDeadTuples
+typedef struct LVSharedHeapCounts
 {
-	int			max_tuples;		/* # slots allocated in array */
-	int			num_tuples;		/* current # of entries */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	ItemPointerData itemptrs[FLEXIBLE_ARRAY_MEMBER];	/* array of
-														 * ItemPointerData */
-} LVDeadTuples;
-
-/* The dead tuple space consists of LVDeadTuples and dead tuple TIDs */
-#define SizeOfDeadTuples(cnt) \
-	add_size(offsetof(LVDeadTuples, itemptrs), \
-			 mul_size(sizeof(ItemPointerData), cnt))
-#define MAXDEADTUPLES(max_size) \
-		(((max_size) - offsetof(LVDeadTuples, itemptrs)) / sizeof(ItemPointerData))
+	/* Counters of the first heap pass, see LVRelState */
+	BlockNumber scanned_pages;
+	BlockNumber pinskipped_pages;
+	BlockNumber frozenskipped_pages;
+	BlockNumber tupcount_pages;
+	BlockNumber lpdead_item_pages;
+	BlockNumber eager_frozen_pages;
+	BlockNumber nonempty_pages; /* the highest among the workers */
+	int64		tuples_deleted;
+	int64		lpdead_items;
+	int64		new_dead_tuples;
+	int64		num_tuples;
+	int64		live_tuples;
+
+	/* Counters of the second heap pass */
+	int64		vacuumed_tuples;
+	BlockNumber vacuumed_pages;
+} LVSharedHeapCounts;
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -206,6 +241,9 @@ typedef struct LVShared
 	Oid			relid;
 	int			elevel;
 
+	/* What the workers are launched to do */
+	LVParallelWork work;
+
 	/*
 	 * An indication for vacuum workers to perform either index vacuum or
 	 * index cleanup.  first_time is true only if for_cleanup is true and
@@ -227,6 +265,12 @@ typedef struct LVShared
 	double		reltuples;
 	bool		estimated_count;
 
+	/*
+	 * The dead tuple store, in the DSA area that is set up in place in the
+	 * DSM segment (PARALLEL_VACUUM_KEY_DSA).
+	 */
+	dsa_pointer dead_tuples_handle;
+
 	/*
 	 * In single process lazy vacuum we could consume more memory during index
 	 * vacuuming or cleanup apart from the memory for heap scanning.  In
@@ -251,6 +295,42 @@ typedef struct LVShared
 	 */
 	pg_atomic_uint32 active_nworkers;
 
+	/*
+	 * Fields for the heap passes.
+	 *
+	 * The leader's cutoffs and options are copied here before workers are
+	 * launched for a heap pass.  The heap is divided into nchunks chunks of
+	 * chunk_size blocks; next_scan_chunk and next_vacuum_chunk hand them out
+	 * in order during the first and the second heap pass respectively.
+	 * next_scan_chunk carries over from one round of the first heap pass to
+	 * the next, when the dead tuple store fills up in between.
+	 * heap_blks_scanned counts the blocks of chunks finished during the first
+	 * heap pass, for progress reporting.  eager_scan_remaining is the budget
+	 * of all-visible pages to visit for freezing, see
+	 * lazy_scan_claim_eager_page().
+	 */
+	BlockNumber rel_pages;
+	TransactionId relfrozenxid;
+	MultiXactId relminmxid;
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	MultiXactId MultiXactCutoff;
+	bool		aggressive;
+	bool		skipwithvm;
+	bool		failsafe_active;
+	bool		do_index_vacuuming;
+	bool		do_rel_truncate;
+	BlockNumber chunk_size;
+	uint32		nchunks;
+	pg_atomic_uint32 next_scan_chunk;
+	pg_atomic_uint32 next_vacuum_chunk;
+	pg_atomic_uint32 heap_blks_scanned;
+	pg_atomic_uint32 eager_scan_remaining;
+
+	/* Workers' heap pass results, protected by mutex */
+	slock_t		mutex;
+	LVSharedHeapCounts heap_counts;
+
 	/*
 	 * Variables to control parallel vacuum.  We have a bitmap to indicate
 	 * which index has stats in shared memory.  The set bit in the map
@@ -293,6 +373,15 @@ typedef struct LVParallelState
 	/* Points to WAL usage area in DSM */
 	WalUsage   *wal_usage;
 
+	/* Have workers been launched, so we must reinitialize the DSM? */
+	bool		workers_launched;
+
+	/*
+	 * The number of workers to use for the heap passes, or 0 if the table is
+	 * too small to divide up the heap passes.
+	 */
+	int			nworkers_heap;
+
 	/*
 	 * The number of indexes that support parallel index bulk-deletion and
 	 * parallel index cleanup respectively.
@@ -319,17 +408,25 @@ typedef struct LVRelState
 	bool		do_index_cleanup;
 	bool		do_rel_truncate;
 
+	/* Aggressive VACUUM (must scan all unfrozen pages)? */
+	bool		aggressive;
+	/* Use visibility map to skip pages? (disabled by DISABLE_PAGE_SKIPPING) */
+	bool		skipwithvm;
+
 	/* Buffer access strategy and parallel state */
 	BufferAccessStrategy bstrategy;
 	LVParallelState *lps;
+	/* Shared state, if the heap passes are performed in parallel */
+	LVShared   *lvshared;
 
 	/* rel's initial relfrozenxid and relminmxid */
 	TransactionId relfrozenxid;
 	MultiXactId relminmxid;
 	double		old_live_tuples;	/* previous value of pg_class.reltuples */
 
-	/* VACUUM operation's cutoff for pruning */
+	/* VACUUM operation's cutoff for pruning, and the matching horizon */
 	TransactionId OldestXmin;
+	GlobalVisState *vistest;
 	/* VACUUM operation's cutoff for freezing XIDs and MultiXactIds */
 	TransactionId FreezeLimit;
 	MultiXactId MultiXactCutoff;
@@ -345,7 +442,9 @@ typedef struct LVRelState
 	/*
 	 * State managed by lazy_scan_heap() follows
 	 */
-	LVDeadTuples *dead_tuples;	/* items to vacuum from indexes */
+	dsa_area   *dead_tuples_area;	/* DSA area containing dead_tuples, if
+									 * parallel */
+	TidStore   *dead_tuples;	/* items to vacuum from indexes */
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* number of pages we examined */
 	BlockNumber pinskipped_pages;	/* # of pages skipped due to a pin */
@@ -353,7 +452,12 @@ typedef struct LVRelState
 	BlockNumber tupcount_pages; /* pages whose tuples we counted */
 	BlockNumber pages_removed;	/* pages remove by truncation */
 	BlockNumber lpdead_item_pages;	/* # pages with LP_DEAD items */
+	BlockNumber eager_frozen_pages; /* # pages frozen ahead of FreezeLimit */
+	BlockNumber eager_scan_remaining;	/* # all-visible pages we may still
+										 * visit just to freeze them */
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
+	BlockNumber next_failsafe_block;	/* when to check the failsafe again */
+	BlockNumber next_fsm_block_to_vacuum;	/* where FSM vacuuming is up to */
 
 	/* Statistics output by us, for table */
 	double		new_rel_tuples; /* new estimated total # of tuples */
@@ -387,6 +491,10 @@ typedef struct LVPagePruneState
 	bool		all_visible;	/* Every item visible to all? */
 	bool		all_frozen;		/* provided all_visible is also true */
 	TransactionId visibility_cutoff_xid;	/* For recovery conflicts */
+
+	/* LP_DEAD items left on the page, for vacuuming in one-pass strategy */
+	int			lpdead_items;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
 } LVPagePruneState;
 
 /* Struct for saving and restoring vacuum error information. */
@@ -404,21 +512,48 @@ static int	elevel = -1;
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel, VacuumParams *params,
 						   bool aggressive);
+static void lazy_scan_heap_range(LVRelState *vacrel, BlockNumber start,
+								 BlockNumber end, Buffer *vmbuffer);
+static bool lazy_scan_claim_eager_page(LVRelState *vacrel);
+static void lazy_scan_heap_page(LVRelState *vacrel, BlockNumber blkno,
+								bool all_visible_according_to_vm,
+								bool eager_scanned, Buffer *vmbuffer);
+static void lazy_scan_heap_chunks(LVRelState *vacrel, Buffer *vmbuffer);
 static void lazy_scan_prune(LVRelState *vacrel, Buffer buf,
 							BlockNumber blkno, Page page,
-							GlobalVisState *vistest,
+							GlobalVisState *vistest, bool eager_scanned,
 							LVPagePruneState *prunestate);
+static int	lazy_prepare_freeze_page(LVRelState *vacrel, Page page,
+									 xl_heap_freeze_tuple *frozen);
 static void lazy_vacuum(LVRelState *vacrel);
 static bool lazy_vacuum_all_indexes(LVRelState *vacrel);
 static void lazy_vacuum_heap_rel(LVRelState *vacrel);
-static int	lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno,
-								  Buffer buffer, int tupindex, Buffer *vmbuffer);
+static void lazy_vacuum_heap_range(LVRelState *vacrel, BlockNumber start,
+								   BlockNumber end, Buffer *vmbuffer,
+								   int64 *vacuumed_tuples,
+								   BlockNumber *vacuumed_pages);
+static void lazy_vacuum_heap_chunks(LVRelState *vacrel, Buffer *vmbuffer,
+									int64 *vacuumed_tuples,
+									BlockNumber *vacuumed_pages);
+static void lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno,
+								  Buffer buffer, OffsetNumber *deadoffsets,
+								  int num_offsets, Buffer *vmbuffer);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup,
 									LVRelState *vacrel);
 static bool lazy_check_wraparound_failsafe(LVRelState *vacrel);
 static void do_parallel_lazy_vacuum_all_indexes(LVRelState *vacrel);
 static void do_parallel_lazy_cleanup_all_indexes(LVRelState *vacrel);
 static void do_parallel_vacuum_or_cleanup(LVRelState *vacrel, int nworkers);
+static void do_parallel_lazy_heap_pass(LVRelState *vacrel,
+									   LVParallelWork work,
+									   int64 *vacuumed_tuples,
+									   BlockNumber *vacuumed_pages);
+static void parallel_vacuum_launch_workers(LVRelState *vacrel, int nworkers);
+static void parallel_vacuum_finish_workers(LVRelState *vacrel, int nworkers);
+static void parallel_heap_report_counts(LVRelState *vacrel,
+										int64 vacuumed_tuples,
+										BlockNumber vacuumed_pages);
+static void parallel_vacuum_scan_heap(LVRelState *vacrel, Buffer *vmbuffer);
 static void do_parallel_processing(LVRelState *vacrel,
 								   LVShared *lvshared);
 static void do_serial_processing_for_unsafe_indexes(LVRelState *vacrel,
@@ -442,17 +577,18 @@ static bool should_attempt_truncation(LVRelState *vacrel);
 static void lazy_truncate_heap(LVRelState *vacrel);
 static BlockNumber count_nondeletable_pages(LVRelState *vacrel,
 											bool *lock_waiter_detected);
-static long compute_max_dead_tuples(BlockNumber relblocks, bool hasindex);
+static size_t compute_max_dead_tuples_bytes(void);
 static void lazy_space_alloc(LVRelState *vacrel, int nworkers,
 							 BlockNumber relblocks);
 static void lazy_space_free(LVRelState *vacrel);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(LVRelState *vacrel, Buffer buf,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 static int	compute_parallel_vacuum_workers(LVRelState *vacrel,
 											int nrequested,
-											bool *can_parallel_vacuum);
+											BlockNumber nblocks,
+											bool *can_parallel_vacuum,
+											int *nworkers_heap);
 static void update_index_statistics(LVRelState *vacrel);
 static LVParallelState *begin_parallel_vacuum(LVRelState *vacrel,
 											  BlockNumber nblocks,
@@ -498,6 +634,7 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	MultiXactId mxactFullScanLimit;
 	BlockNumber new_rel_pages;
 	BlockNumber new_rel_allvisible;
+	BlockNumber new_rel_allfrozen;
 	double		new_live_tuples;
 	TransactionId new_frozen_xid;
 	MultiXactId new_min_multi;
@@ -685,7 +822,7 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	 * nonempty.
 	 *
 	 * For safety, clamp relallvisible to be not more than what we're setting
-	 * relpages to.
+	 * relpages to, and relallfrozen to be not more than relallvisible.
 	 *
 	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages,
 	 * since then we don't know for certain that all tuples have a newer xmin.
@@ -693,9 +830,11 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	new_rel_pages = vacrel->rel_pages;
 	new_live_tuples = vacrel->new_live_tuples;
 
-	visibilitymap_count(rel, &new_rel_allvisible, NULL);
+	visibilitymap_count(rel, &new_rel_allvisible, &new_rel_allfrozen);
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
+	if (new_rel_allfrozen > new_rel_allvisible)
+		new_rel_allfrozen = new_rel_allvisible;
 
 	new_frozen_xid = scanned_all_unfrozen ? FreezeLimit : InvalidTransactionId;
 	new_min_multi = scanned_all_unfrozen ? MultiXactCutoff : InvalidMultiXactId;
@@ -704,15 +843,16 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 						new_rel_pages,
 						new_live_tuples,
 						new_rel_allvisible,
+						new_rel_allfrozen,
 						vacrel->nindexes > 0,
 						new_frozen_xid,
 						new_min_multi,
 						false);
 
 	/*
-	 * Report results to the stats collector, too.
+	 * Report results to the stats system, too.
 	 *
-	 * Deliberately avoid telling the stats collector about LP_DEAD items that
+	 * Deliberately avoid telling the stats system about LP_DEAD items that
 	 * remain in the table due to VACUUM bypassing index and heap vacuuming.
 	 * ANALYZE will consider the remaining LP_DEAD items to be dead tuples. It
 	 * seems like a good idea to err on the side of not vacuuming again too
@@ -783,11 +923,12 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 							 vacrel->relnamespace,
 							 vacrel->relname,
 							 vacrel->num_index_scans);
-			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen\n"),
+			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen, %u frozen eagerly\n"),
 							 vacrel->pages_removed,
 							 vacrel->rel_pages,
 							 vacrel->pinskipped_pages,
-							 vacrel->frozenskipped_pages);
+							 vacrel->frozenskipped_pages,
+							 vacrel->eager_frozen_pages);
 			appendStringInfo(&buf,
 							 _("tuples: %lld removed, %lld remain, %lld are dead but not yet removable, oldest xmin: %u\n"),
 							 (long long) vacrel->tuples_deleted,
@@ -886,17 +1027,19 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
  *		for dead-tuple TIDs, invoke lazy_vacuum to vacuum indexes and vacuum
  *		heap relation during its own second pass over the heap.
  *
- *		If the table has at least two indexes, we execute both index vacuum
- *		and index cleanup with parallel workers unless parallel vacuum is
- *		disabled.  In a parallel vacuum, we enter parallel mode and then
- *		create both the parallel context and the DSM segment before starting
- *		heap scan so that we can record dead tuples to the DSM segment.  All
- *		parallel workers are launched at beginning of index vacuuming and
- *		index cleanup and they exit once done with all indexes.  At the end of
- *		this function we exit from parallel mode.  Index bulk-deletion results
- *		are stored in the DSM segment and we update index statistics for all
- *		the indexes after exiting from parallel mode since writes are not
- *		allowed during parallel mode.
+ *		If the table has at least two indexes, or is large enough to divide
+ *		the heap passes among several processes, we execute the heap passes,
+ *		index vacuum and index cleanup with parallel workers unless parallel
+ *		vacuum is disabled.  In a parallel vacuum, we enter parallel mode and
+ *		then create both the parallel context and the DSM segment before
+ *		starting heap scan so that we can record dead tuples to the DSM
+ *		segment.  All parallel workers are launched at beginning of each heap
+ *		pass, index vacuuming and index cleanup and they exit once done with
+ *		their share of the work.  At the end of this function we exit from
+ *		parallel mode.  Index bulk-deletion results are stored in the DSM
+ *		segment and we update index statistics for all the indexes after
+ *		exiting from parallel mode since writes are not allowed during
+ *		parallel mode.
  *
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
@@ -905,23 +1048,17 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 static void
 lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 {
-	LVDeadTuples *dead_tuples;
-	BlockNumber nblocks,
-				blkno,
-				next_unskippable_block,
-				next_failsafe_block,
-				next_fsm_block_to_vacuum;
+	TidStore   *dead_tuples;
+	BlockNumber nblocks;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
-	bool		skipping_blocks;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
 		PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
-		PROGRESS_VACUUM_MAX_DEAD_TUPLES
+		PROGRESS_VACUUM_MAX_DEAD_TUPLE_BYTES
 	};
 	int64		initprog_val[3];
-	GlobalVisState *vistest;
 
 	pg_rusage_init(&ru0);
 
@@ -937,9 +1074,8 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 						vacrel->relname)));
 
 	nblocks = RelationGetNumberOfBlocks(vacrel->rel);
-	next_unskippable_block = 0;
-	next_failsafe_block = 0;
-	next_fsm_block_to_vacuum = 0;
+	vacrel->aggressive = aggressive;
+	vacrel->skipwithvm = (params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0;
 	vacrel->rel_pages = nblocks;
 	vacrel->scanned_pages = 0;
 	vacrel->pinskipped_pages = 0;
@@ -947,7 +1083,21 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	vacrel->tupcount_pages = 0;
 	vacrel->pages_removed = 0;
 	vacrel->lpdead_item_pages = 0;
+	vacrel->eager_frozen_pages = 0;
 	vacrel->nonempty_pages = 0;
+	vacrel->next_failsafe_block = 0;
+	vacrel->next_fsm_block_to_vacuum = 0;
+
+	/*
+	 * Set the budget of all-visible pages that a non-aggressive VACUUM visits
+	 * in order to freeze them, based on the counts in pg_class.
+	 */
+	vacrel->eager_scan_remaining = 0;
+	if (!aggressive && vacrel->skipwithvm &&
+		vacrel->rel->rd_rel->relallvisible > vacrel->rel->rd_rel->relallfrozen)
+		vacrel->eager_scan_remaining = (BlockNumber)
+			((vacrel->rel->rd_rel->relallvisible -
+			  vacrel->rel->rd_rel->relallfrozen) * EAGER_FREEZE_SCAN_FRACTION);
 
 	/* Initialize instrumentation counters */
 	vacrel->num_index_scans = 0;
@@ -957,7 +1107,7 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	vacrel->num_tuples = 0;
 	vacrel->live_tuples = 0;
 
-	vistest = GlobalVisTestFor(vacrel->rel);
+	vacrel->vistest = GlobalVisTestFor(vacrel->rel);
 
 	vacrel->indstats = (IndexBulkDeleteResult **)
 		palloc0(vacrel->nindexes * sizeof(IndexBulkDeleteResult *));
@@ -979,9 +1129,189 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = dead_tuples->max_tuples;
+	initprog_val[2] = TidStoreMaxMemory(dead_tuples);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	if (!ParallelHeapVacuumIsActive(vacrel))
+		lazy_scan_heap_range(vacrel, 0, nblocks, &vmbuffer);
+	else
+	{
+		LVShared   *lvshared = vacrel->lvshared;
+
+		/*
+		 * Scan the heap together with parallel workers.  Each round ends
+		 * either when the whole heap has been scanned, or when the dead tuple
+		 * store is full; in the latter case, we do a cycle of vacuuming before
+		 * the next round picks up where this one stopped.
+		 */
+		for (;;)
+		{
+			uint32		nchunks_done;
+			BlockNumber scanned_upto;
+
+			do_parallel_lazy_heap_pass(vacrel, PARALLEL_VACUUM_WORK_SCAN_HEAP,
+									   NULL, NULL);
+
+			/* Every chunk handed out so far has been scanned by now */
+			nchunks_done = Min(pg_atomic_read_u32(&lvshared->next_scan_chunk),
+							   lvshared->nchunks);
+			scanned_upto = (BlockNumber)
+				Min((uint64) nchunks_done * lvshared->chunk_size, nblocks);
+			if (scanned_upto >= nblocks)
+				break;
+
+			/* Remove the collected garbage tuples from table and indexes */
+			vacrel->consider_bypass_optimization = false;
+			lazy_vacuum(vacrel);
+
+			/*
+			 * Vacuum the Free Space Map to make newly-freed space visible on
+			 * upper-level FSM pages.
+			 */
+			FreeSpaceMapVacuumRange(vacrel->rel,
+									vacrel->next_fsm_block_to_vacuum,
+									scanned_upto);
+			vacrel->next_fsm_block_to_vacuum = scanned_upto;
+
+			/* Report that we are once again scanning the heap */
+			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+		}
+	}
+
+	/* report that everything is now scanned */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, nblocks);
+
+	/* Clear the block number information */
+	vacrel->blkno = InvalidBlockNumber;
+
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrel->new_live_tuples = vac_estimate_reltuples(vacrel->rel, nblocks,
+													 vacrel->tupcount_pages,
+													 vacrel->live_tuples);
+
+	/*
+	 * Also compute the total number of surviving heap entries.  In the
+	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 */
+	vacrel->new_rel_tuples =
+		Max(vacrel->new_live_tuples, 0) + vacrel->new_dead_tuples;
+
+	/*
+	 * Release any remaining pin on visibility map page.
+	 */
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
+
+	/* If any tuples need to be deleted, perform final vacuum cycle */
+	if (TidStoreNumTids(dead_tuples) > 0)
+		lazy_vacuum(vacrel);
+
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes, and whether or not we bypassed index vacuuming.
+	 */
+	if (nblocks > vacrel->next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(vacrel->rel, vacrel->next_fsm_block_to_vacuum,
+								nblocks);
+
+	/* report all blocks vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, nblocks);
+
+	/* Do post-vacuum cleanup */
+	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
+		lazy_cleanup_all_indexes(vacrel);
+
+	/*
+	 * Free resources managed by lazy_space_alloc().  (We must end parallel
+	 * mode/free shared memory before updating index statistics.  We cannot
+	 * write while in parallel mode.)
+	 */
+	lazy_space_free(vacrel);
+
+	/* Update index statistics */
+	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
+		update_index_statistics(vacrel);
+
+	/*
+	 * When the table has no indexes (i.e. in the one-pass strategy case),
+	 * make log report that lazy_vacuum_heap_rel would've made had there been
+	 * indexes.  (As in the two-pass strategy case, only make this report when
+	 * there were LP_DEAD line pointers vacuumed in lazy_vacuum_heap_page.)
+	 */
+	if (vacrel->nindexes == 0 && vacrel->lpdead_item_pages > 0)
+		ereport(elevel,
+				(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
+						vacrel->relname, (long long) vacrel->lpdead_items,
+						vacrel->lpdead_item_pages)));
+
+	/*
+	 * Make a log report summarizing pruning and freezing.
+	 *
+	 * The autovacuum specific logging in heap_vacuum_rel summarizes an entire
+	 * VACUUM operation, whereas each VACUUM VERBOSE log report generally
+	 * summarizes a single round of index/heap vacuuming (or rel truncation).
+	 * It wouldn't make sense to report on pruning or freezing while following
+	 * that convention, though.  You can think of this log report as a summary
+	 * of our first pass over the heap.
+	 */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 _("%lld dead row versions cannot be removed yet, oldest xmin: %u\n"),
+					 (long long) vacrel->new_dead_tuples, vacrel->OldestXmin);
+	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
+									"Skipped %u pages due to buffer pins, ",
+									vacrel->pinskipped_pages),
+					 vacrel->pinskipped_pages);
+	appendStringInfo(&buf, ngettext("%u frozen page.\n",
+									"%u frozen pages.\n",
+									vacrel->frozenskipped_pages),
+					 vacrel->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("Froze %u page eagerly.\n",
+									"Froze %u pages eagerly.\n",
+									vacrel->eager_frozen_pages),
+					 vacrel->eager_frozen_pages);
+	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+
+	ereport(elevel,
+			(errmsg("table \"%s.%s\": found %lld removable, %lld nonremovable row versions in %u out of %u pages",
+					vacrel->relnamespace,
+					vacrel->relname,
+					(long long) vacrel->tuples_deleted,
+					(long long) vacrel->num_tuples, vacrel->scanned_pages,
+					nblocks),
+			 errdetail_internal("%s", buf.data)));
+	pfree(buf.data);
+}
+
+/*
+ * Must we scan blkno even though the visibility map says we could skip it,
+ * or we couldn't get a cleanup lock on it?  See lazy_scan_heap_range() about
+ * forcing scanning of the last page.
+ */
+#define FORCE_CHECK_PAGE(vacrel, blkno) \
+	((blkno) == (vacrel)->rel_pages - 1 && should_attempt_truncation(vacrel))
+
+/*
+ *	lazy_scan_heap_range() -- lazy_scan_heap() for blocks [start, end)
+ *
+ * A serial VACUUM scans the whole heap in one call, and does a cycle of index
+ * and heap vacuuming whenever the dead tuple store fills up on the way.  The
+ * participants of a parallel VACUUM call us for one chunk of the heap at a
+ * time instead, and check the store between chunks; see
+ * lazy_scan_heap_chunks().
+ */
+static void
+lazy_scan_heap_range(LVRelState *vacrel, BlockNumber start, BlockNumber end,
+					 Buffer *vmbuffer)
+{
+	BlockNumber blkno,
+				next_unskippable_block;
+	bool		skipping_blocks;
+
 	/*
 	 * Except when aggressive is set, we want to skip pages that are
 	 * all-visible according to the visibility map, but only when we can skip
@@ -990,19 +1320,24 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	 * gain in skipping a page now and then; that's likely to disable
 	 * readahead and so be counterproductive. Also, skipping even a single
 	 * page means that we can't update relfrozenxid, so we only want to do it
-	 * if we can skip a goodly number of pages.
+	 * if we can skip a goodly number of pages.  (Runs of skippable pages are
+	 * cut short at the boundaries of the chunks scanned by parallel VACUUM,
+	 * which is why chunks are never smaller than SKIP_PAGES_THRESHOLD.)
 	 *
 	 * When aggressive is set, we can't skip pages just because they are
 	 * all-visible, but we can still skip pages that are all-frozen, since
 	 * such pages do not need freezing and do not affect the value that we can
-	 * safely set for relfrozenxid or relminmxid.
+	 * safely set for relfrozenxid or relminmxid.  When it's not set, we still
+	 * treat some all-visible pages that are not all-frozen as unskippable, in
+	 * order to freeze them ahead of the next aggressive vacuum; see
+	 * lazy_scan_claim_eager_page().
 	 *
 	 * Before entering the main loop, establish the invariant that
 	 * next_unskippable_block is the next block number >= blkno that we can't
 	 * skip based on the visibility map, either all-visible for a regular scan
-	 * or all-frozen for an aggressive scan.  We set it to nblocks if there's
-	 * no such block.  We also set up the skipping_blocks flag correctly at
-	 * this stage.
+	 * or all-frozen for an aggressive scan.  We set it to end if there's no
+	 * such block.  We also set up the skipping_blocks flag correctly at this
+	 * stage.
 	 *
 	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
@@ -1026,16 +1361,17 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 	 * the last page.  This is worth avoiding mainly because such a lock must
 	 * be replayed on any hot standby, where it can be disruptive.
 	 */
-	if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+	next_unskippable_block = start;
+	if (vacrel->skipwithvm)
 	{
-		while (next_unskippable_block < nblocks)
+		while (next_unskippable_block < end)
 		{
 			uint8		vmstatus;
 
 			vmstatus = visibilitymap_get_status(vacrel->rel,
 												next_unskippable_block,
-												&vmbuffer);
-			if (aggressive)
+												vmbuffer);
+			if (vacrel->aggressive)
 			{
 				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
 					break;
@@ -1044,32 +1380,29 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 			{
 				if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
 					break;
+				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0 &&
+					lazy_scan_claim_eager_page(vacrel))
+					break;
 			}
 			vacuum_delay_point();
 			next_unskippable_block++;
 		}
 	}
 
-	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
+	if (next_unskippable_block - start >= SKIP_PAGES_THRESHOLD)
 		skipping_blocks = true;
 	else
 		skipping_blocks = false;
 
-	for (blkno = 0; blkno < nblocks; blkno++)
+	for (blkno = start; blkno < end; blkno++)
 	{
-		Buffer		buf;
-		Page		page;
 		bool		all_visible_according_to_vm = false;
-		LVPagePruneState prunestate;
+		bool		eager_scanned = false;
 
-		/*
-		 * Consider need to skip blocks.  See note above about forcing
-		 * scanning of last page.
-		 */
-#define FORCE_CHECK_PAGE() \
-		(blkno == nblocks - 1 && should_attempt_truncation(vacrel))
-
-		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+		/* A parallel VACUUM reports progress one chunk at a time */
+		if (!ParallelHeapVacuumIsActive(vacrel))
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 blkno);
 
 		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
 								 blkno, InvalidOffsetNumber);
@@ -1078,16 +1411,16 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 		{
 			/* Time to advance next_unskippable_block */
 			next_unskippable_block++;
-			if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+			if (vacrel->skipwithvm)
 			{
-				while (next_unskippable_block < nblocks)
+				while (next_unskippable_block < end)
 				{
 					uint8		vmskipflags;
 
 					vmskipflags = visibilitymap_get_status(vacrel->rel,
 														   next_unskippable_block,
-														   &vmbuffer);
-					if (aggressive)
+														   vmbuffer);
+					if (vacrel->aggressive)
 					{
 						if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
 							break;
@@ -1096,6 +1429,9 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 					{
 						if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
 							break;
+						if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0 &&
+							lazy_scan_claim_eager_page(vacrel))
+							break;
 					}
 					vacuum_delay_point();
 					next_unskippable_block++;
@@ -1114,10 +1450,15 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 			/*
 			 * Normally, the fact that we can't skip this block must mean that
 			 * it's not all-visible.  But in an aggressive vacuum we know only
-			 * that it's not all-frozen, so it might still be all-visible.
+			 * that it's not all-frozen, so it might still be all-visible; and
+			 * a non-aggressive vacuum might visit an all-visible page in
+			 * order to freeze it.
 			 */
-			if (aggressive && VM_ALL_VISIBLE(vacrel->rel, blkno, &vmbuffer))
+			if (VM_ALL_VISIBLE(vacrel->rel, blkno, vmbuffer))
+			{
 				all_visible_according_to_vm = true;
+				eager_scanned = !vacrel->aggressive;
+			}
 		}
 		else
 		{
@@ -1128,7 +1469,7 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 			 * Otherwise, the page must be at least all-visible if not
 			 * all-frozen, so we can set all_visible_according_to_vm = true.
 			 */
-			if (skipping_blocks && !FORCE_CHECK_PAGE())
+			if (skipping_blocks && !FORCE_CHECK_PAGE(vacrel, blkno))
 			{
 				/*
 				 * Tricky, tricky.  If this is in aggressive vacuum, the page
@@ -1140,7 +1481,8 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 				 * know whether it was all-frozen, so we have to recheck; but
 				 * in this case an approximate answer is OK.
 				 */
-				if (aggressive || VM_ALL_FROZEN(vacrel->rel, blkno, &vmbuffer))
+				if (vacrel->aggressive ||
+					VM_ALL_FROZEN(vacrel->rel, blkno, vmbuffer))
 					vacrel->frozenskipped_pages++;
 				continue;
 			}
@@ -1156,22 +1498,24 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 		 * relfrozenxid might start to look dangerously old before we reach
 		 * that point.  This check also provides failsafe coverage for the
 		 * one-pass strategy, and the two-pass strategy with the index_cleanup
-		 * param set to 'off'.
+		 * param set to 'off'.  Parallel workers leave this to the leader.
 		 */
-		if (blkno - next_failsafe_block >= FAILSAFE_EVERY_PAGES)
+		if (!IsParallelWorker() &&
+			blkno - vacrel->next_failsafe_block >= FAILSAFE_EVERY_PAGES)
 		{
 			lazy_check_wraparound_failsafe(vacrel);
-			next_failsafe_block = blkno;
+			vacrel->next_failsafe_block = blkno;
 		}
 
 		/*
 		 * Consider if we definitely have enough space to process TIDs on page
-		 * already.  If we are close to overrunning the available space for
+		 * already.  If we are close to overrunning the memory budget for
 		 * dead-tuple TIDs, pause and do a cycle of vacuuming before we tackle
-		 * this page.
+		 * this page.  (A parallel VACUUM checks this between chunks.)
 		 */
-		if ((dead_tuples->max_tuples - dead_tuples->num_tuples) < MaxHeapTuplesPerPage &&
-			dead_tuples->num_tuples > 0)
+		if (!ParallelHeapVacuumIsActive(vacrel) &&
+			TidStoreIsFull(vacrel->dead_tuples) &&
+			TidStoreNumTids(vacrel->dead_tuples) > 0)
 		{
 			/*
 			 * Before beginning index vacuuming, we release any pin we may
@@ -1179,10 +1523,10 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 			 * correctness, but we do it anyway to avoid holding the pin
 			 * across a lengthy, unrelated operation.
 			 */
-			if (BufferIsValid(vmbuffer))
+			if (BufferIsValid(*vmbuffer))
 			{
-				ReleaseBuffer(vmbuffer);
-				vmbuffer = InvalidBuffer;
+				ReleaseBuffer(*vmbuffer);
+				*vmbuffer = InvalidBuffer;
 			}
 
 			/* Remove the collected garbage tuples from table and indexes */
@@ -1193,484 +1537,487 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
 			 * Vacuum the Free Space Map to make newly-freed space visible on
 			 * upper-level FSM pages.  Note we have not yet processed blkno.
 			 */
-			FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
-									blkno);
-			next_fsm_block_to_vacuum = blkno;
+			FreeSpaceMapVacuumRange(vacrel->rel,
+									vacrel->next_fsm_block_to_vacuum, blkno);
+			vacrel->next_fsm_block_to_vacuum = blkno;
 
 			/* Report that we are once again scanning the heap */
 			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 		}
 
-		/*
-		 * Set up visibility map page as needed.
-		 *
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_unskippable_block is covered by a different
-		 * VM page than the current block or (b) we released our pin and did a
-		 * cycle of index vacuuming.
-		 */
-		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
+		lazy_scan_heap_page(vacrel, blkno, all_visible_according_to_vm,
+							eager_scanned, vmbuffer);
+	}
+}
+
+/*
+ *	lazy_scan_claim_eager_page() -- may we visit another all-visible page
+ *									just to freeze it?
+ *
+ * The budget is set up by lazy_scan_heap(), and shared by all participants
+ * of a parallel VACUUM.
+ */
+static bool
+lazy_scan_claim_eager_page(LVRelState *vacrel)
+{
+	if (ParallelHeapVacuumIsActive(vacrel))
+	{
+		pg_atomic_uint32 *remaining = &vacrel->lvshared->eager_scan_remaining;
+		uint32		oldval = pg_atomic_read_u32(remaining);
+
+		while (oldval > 0)
+		{
+			if (pg_atomic_compare_exchange_u32(remaining, &oldval, oldval - 1))
+				return true;
+		}
+		return false;
+	}
+
+	if (vacrel->eager_scan_remaining == 0)
+		return false;
+	vacrel->eager_scan_remaining--;
+	return true;
+}
+
+/*
+ *	lazy_scan_heap_page() -- lazy_scan_heap() processing of a single page
+ *
+ * By the time we're called, the caller has decided that blkno can't be
+ * skipped, and has made sure that the dead tuple store has room for the TIDs
+ * of the page's LP_DEAD items.  eager_scanned says that a non-aggressive
+ * VACUUM visits this all-visible page only to freeze it.
+ */
+static void
+lazy_scan_heap_page(LVRelState *vacrel, BlockNumber blkno,
+					bool all_visible_according_to_vm, bool eager_scanned,
+					Buffer *vmbuffer)
+{
+	Buffer		buf;
+	Page		page;
+	LVPagePruneState prunestate;
+
+	/*
+	 * Set up visibility map page as needed.
+	 *
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.  However, it's possible
+	 * that (a) next_unskippable_block is covered by a different VM page than
+	 * the current block or (b) we released our pin and did a cycle of index
+	 * vacuuming.
+	 */
+	visibilitymap_pin(vacrel->rel, blkno, vmbuffer);
 
-		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vacrel->bstrategy);
+	buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
+							 RBM_NORMAL, vacrel->bstrategy);
+
+	/*
+	 * We need buffer cleanup lock so that we can prune HOT chains and
+	 * defragment the page.
+	 */
+	if (!ConditionalLockBufferForCleanup(buf))
+	{
+		bool		hastup;
 
 		/*
-		 * We need buffer cleanup lock so that we can prune HOT chains and
-		 * defragment the page.
+		 * If we're not performing an aggressive scan to guard against XID
+		 * wraparound, and we don't want to forcibly check the page, then it's
+		 * OK to skip vacuuming pages we get a lock conflict on. They will be
+		 * dealt with in some future vacuum.
 		 */
-		if (!ConditionalLockBufferForCleanup(buf))
+		if (!vacrel->aggressive && !FORCE_CHECK_PAGE(vacrel, blkno))
 		{
-			bool		hastup;
-
-			/*
-			 * If we're not performing an aggressive scan to guard against XID
-			 * wraparound, and we don't want to forcibly check the page, then
-			 * it's OK to skip vacuuming pages we get a lock conflict on. They
-			 * will be dealt with in some future vacuum.
-			 */
-			if (!aggressive && !FORCE_CHECK_PAGE())
-			{
-				ReleaseBuffer(buf);
-				vacrel->pinskipped_pages++;
-				continue;
-			}
-
-			/*
-			 * Read the page with share lock to see if any xids on it need to
-			 * be frozen.  If not we just skip the page, after updating our
-			 * scan statistics.  If there are some, we wait for cleanup lock.
-			 *
-			 * We could defer the lock request further by remembering the page
-			 * and coming back to it later, or we could even register
-			 * ourselves for multiple buffers and then service whichever one
-			 * is received first.  For now, this seems good enough.
-			 *
-			 * If we get here with aggressive false, then we're just forcibly
-			 * checking the page, and so we don't want to insist on getting
-			 * the lock; we only need to know if the page contains tuples, so
-			 * that we can update nonempty_pages correctly.  It's convenient
-			 * to use lazy_check_needs_freeze() for both situations, though.
-			 */
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-			if (!lazy_check_needs_freeze(buf, &hastup, vacrel))
-			{
-				UnlockReleaseBuffer(buf);
-				vacrel->scanned_pages++;
-				vacrel->pinskipped_pages++;
-				if (hastup)
-					vacrel->nonempty_pages = blkno + 1;
-				continue;
-			}
-			if (!aggressive)
-			{
-				/*
-				 * Here, we must not advance scanned_pages; that would amount
-				 * to claiming that the page contains no freezable tuples.
-				 */
-				UnlockReleaseBuffer(buf);
-				vacrel->pinskipped_pages++;
-				if (hastup)
-					vacrel->nonempty_pages = blkno + 1;
-				continue;
-			}
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			/* drop through to normal processing */
+			ReleaseBuffer(buf);
+			vacrel->pinskipped_pages++;
+			return;
 		}
 
 		/*
-		 * By here we definitely have enough dead_tuples space for whatever
-		 * LP_DEAD tids are on this page, we have the visibility map page set
-		 * up in case we need to set this page's all_visible/all_frozen bit,
-		 * and we have a super-exclusive lock.  Any tuples on this page are
-		 * now sure to be "counted" by this VACUUM.
+		 * Read the page with share lock to see if any xids on it need to be
+		 * frozen.  If not we just skip the page, after updating our scan
+		 * statistics.  If there are some, we wait for cleanup lock.
+		 *
+		 * We could defer the lock request further by remembering the page and
+		 * coming back to it later, or we could even register ourselves for
+		 * multiple buffers and then service whichever one is received first.
+		 * For now, this seems good enough.
 		 *
-		 * One last piece of preamble needs to take place before we can prune:
-		 * we need to consider new and empty pages.
+		 * If we get here with aggressive false, then we're just forcibly
+		 * checking the page, and so we don't want to insist on getting the
+		 * lock; we only need to know if the page contains tuples, so that we
+		 * can update nonempty_pages correctly.  It's convenient to use
+		 * lazy_check_needs_freeze() for both situations, though.
 		 */
-		vacrel->scanned_pages++;
-		vacrel->tupcount_pages++;
-
-		page = BufferGetPage(buf);
-
-		if (PageIsNew(page))
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		if (!lazy_check_needs_freeze(buf, &hastup, vacrel))
+		{
+			UnlockReleaseBuffer(buf);
+			vacrel->scanned_pages++;
+			vacrel->pinskipped_pages++;
+			if (hastup)
+				vacrel->nonempty_pages = blkno + 1;
+			return;
+		}
+		if (!vacrel->aggressive)
 		{
 			/*
-			 * All-zeroes pages can be left over if either a backend extends
-			 * the relation by a single page, but crashes before the newly
-			 * initialized page has been written out, or when bulk-extending
-			 * the relation (which creates a number of empty pages at the tail
-			 * end of the relation, but enters them into the FSM).
-			 *
-			 * Note we do not enter the page into the visibilitymap. That has
-			 * the downside that we repeatedly visit this page in subsequent
-			 * vacuums, but otherwise we'll never not discover the space on a
-			 * promoted standby. The harm of repeated checking ought to
-			 * normally not be too bad - the space usually should be used at
-			 * some point, otherwise there wouldn't be any regular vacuums.
-			 *
-			 * Make sure these pages are in the FSM, to ensure they can be
-			 * reused. Do that by testing if there's any space recorded for
-			 * the page. If not, enter it. We do so after releasing the lock
-			 * on the heap page, the FSM is approximate, after all.
+			 * Here, we must not advance scanned_pages; that would amount to
+			 * claiming that the page contains no freezable tuples.
 			 */
 			UnlockReleaseBuffer(buf);
-
-			if (GetRecordedFreeSpace(vacrel->rel, blkno) == 0)
-			{
-				Size		freespace = BLCKSZ - SizeOfPageHeaderData;
-
-				RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
-			}
-			continue;
+			vacrel->pinskipped_pages++;
+			if (hastup)
+				vacrel->nonempty_pages = blkno + 1;
+			return;
 		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		/* drop through to normal processing */
+	}
 
-		if (PageIsEmpty(page))
-		{
-			Size		freespace = PageGetHeapFreeSpace(page);
-
-			/*
-			 * Empty pages are always all-visible and all-frozen (note that
-			 * the same is currently not true for new pages, see above).
-			 */
-			if (!PageIsAllVisible(page))
-			{
-				START_CRIT_SECTION();
-
-				/* mark buffer dirty before writing a WAL record */
-				MarkBufferDirty(buf);
+	/*
+	 * By here we definitely have enough dead_tuples space for whatever
+	 * LP_DEAD tids are on this page, we have the visibility map page set up
+	 * in case we need to set this page's all_visible/all_frozen bit, and we
+	 * have a super-exclusive lock.  Any tuples on this page are now sure to
+	 * be "counted" by this VACUUM.
+	 *
+	 * One last piece of preamble needs to take place before we can prune: we
+	 * need to consider new and empty pages.
+	 */
+	vacrel->scanned_pages++;
+	vacrel->tupcount_pages++;
 
-				/*
-				 * It's possible that another backend has extended the heap,
-				 * initialized the page, and then failed to WAL-log the page
-				 * due to an ERROR.  Since heap extension is not WAL-logged,
-				 * recovery might try to replay our record setting the page
-				 * all-visible and find that the page isn't initialized, which
-				 * will cause a PANIC.  To prevent that, check whether the
-				 * page has been previously WAL-logged, and if not, do that
-				 * now.
-				 */
-				if (RelationNeedsWAL(vacrel->rel) &&
-					PageGetLSN(page) == InvalidXLogRecPtr)
-					log_newpage_buffer(buf, true);
-
-				PageSetAllVisible(page);
-				visibilitymap_set(vacrel->rel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId,
-								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
-				END_CRIT_SECTION();
-			}
-
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
-			continue;
-		}
+	page = BufferGetPage(buf);
 
+	if (PageIsNew(page))
+	{
 		/*
-		 * Prune and freeze tuples.
+		 * All-zeroes pages can be left over if either a backend extends the
+		 * relation by a single page, but crashes before the newly initialized
+		 * page has been written out, or when bulk-extending the relation
+		 * (which creates a number of empty pages at the tail end of the
+		 * relation, but enters them into the FSM).
 		 *
-		 * Accumulates details of remaining LP_DEAD line pointers on page in
-		 * dead tuple list.  This includes LP_DEAD line pointers that we
-		 * pruned ourselves, as well as existing LP_DEAD line pointers that
-		 * were pruned some time earlier.  Also considers freezing XIDs in the
-		 * tuple headers of remaining items with storage.
+		 * Note we do not enter the page into the visibilitymap. That has the
+		 * downside that we repeatedly visit this page in subsequent vacuums,
+		 * but otherwise we'll never not discover the space on a promoted
+		 * standby. The harm of repeated checking ought to normally not be too
+		 * bad - the space usually should be used at some point, otherwise
+		 * there wouldn't be any regular vacuums.
+		 *
+		 * Make sure these pages are in the FSM, to ensure they can be reused.
+		 * Do that by testing if there's any space recorded for the page. If
+		 * not, enter it. We do so after releasing the lock on the heap page,
+		 * the FSM is approximate, after all.
 		 */
-		lazy_scan_prune(vacrel, buf, blkno, page, vistest, &prunestate);
-
-		Assert(!prunestate.all_visible || !prunestate.has_lpdead_items);
-
-		/* Remember the location of the last page with nonremovable tuples */
-		if (prunestate.hastup)
-			vacrel->nonempty_pages = blkno + 1;
+		UnlockReleaseBuffer(buf);
 
-		if (vacrel->nindexes == 0)
+		if (GetRecordedFreeSpace(vacrel->rel, blkno) == 0)
 		{
-			/*
-			 * Consider the need to do page-at-a-time heap vacuuming when
-			 * using the one-pass strategy now.
-			 *
-			 * The one-pass strategy will never call lazy_vacuum().  The steps
-			 * performed here can be thought of as the one-pass equivalent of
-			 * a call to lazy_vacuum().
-			 */
-			if (prunestate.has_lpdead_items)
-			{
-				Size		freespace;
-
-				lazy_vacuum_heap_page(vacrel, blkno, buf, 0, &vmbuffer);
-
-				/* Forget the now-vacuumed tuples */
-				dead_tuples->num_tuples = 0;
+			Size		freespace = BLCKSZ - SizeOfPageHeaderData;
 
-				/*
-				 * Periodically perform FSM vacuuming to make newly-freed
-				 * space visible on upper FSM pages.  Note we have not yet
-				 * performed FSM processing for blkno.
-				 */
-				if (blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
-				{
-					FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
-											blkno);
-					next_fsm_block_to_vacuum = blkno;
-				}
-
-				/*
-				 * Now perform FSM processing for blkno, and move on to next
-				 * page.
-				 *
-				 * Our call to lazy_vacuum_heap_page() will have considered if
-				 * it's possible to set all_visible/all_frozen independently
-				 * of lazy_scan_prune().  Note that prunestate was invalidated
-				 * by lazy_vacuum_heap_page() call.
-				 */
-				freespace = PageGetHeapFreeSpace(page);
-
-				UnlockReleaseBuffer(buf);
-				RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
-				continue;
-			}
-
-			/*
-			 * There was no call to lazy_vacuum_heap_page() because pruning
-			 * didn't encounter/create any LP_DEAD items that needed to be
-			 * vacuumed.  Prune state has not been invalidated, so proceed
-			 * with prunestate-driven visibility map and FSM steps (just like
-			 * the two-pass strategy).
-			 */
-			Assert(dead_tuples->num_tuples == 0);
+			RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
 		}
+		return;
+	}
+
+	if (PageIsEmpty(page))
+	{
+		Size		freespace = PageGetHeapFreeSpace(page);
 
 		/*
-		 * Handle setting visibility map bit based on what the VM said about
-		 * the page before pruning started, and using prunestate
+		 * Empty pages are always all-visible and all-frozen (note that the
+		 * same is currently not true for new pages, see above).
 		 */
-		if (!all_visible_according_to_vm && prunestate.all_visible)
+		if (!PageIsAllVisible(page))
 		{
-			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+			START_CRIT_SECTION();
 
-			if (prunestate.all_frozen)
-				flags |= VISIBILITYMAP_ALL_FROZEN;
+			/* mark buffer dirty before writing a WAL record */
+			MarkBufferDirty(buf);
 
 			/*
-			 * It should never be the case that the visibility map page is set
-			 * while the page-level bit is clear, but the reverse is allowed
-			 * (if checksums are not enabled).  Regardless, set both bits so
-			 * that we get back in sync.
-			 *
-			 * NB: If the heap page is all-visible but the VM bit is not set,
-			 * we don't need to dirty the heap page.  However, if checksums
-			 * are enabled, we do need to make sure that the heap page is
-			 * dirtied before passing it to visibilitymap_set(), because it
-			 * may be logged.  Given that this situation should only happen in
-			 * rare cases after a crash, it is not worth optimizing.
+			 * It's possible that another backend has extended the heap,
+			 * initialized the page, and then failed to WAL-log the page due
+			 * to an ERROR.  Since heap extension is not WAL-logged, recovery
+			 * might try to replay our record setting the page all-visible and
+			 * find that the page isn't initialized, which will cause a PANIC.
+			 * To prevent that, check whether the page has been previously
+			 * WAL-logged, and if not, do that now.
 			 */
+			if (RelationNeedsWAL(vacrel->rel) &&
+				PageGetLSN(page) == InvalidXLogRecPtr)
+				log_newpage_buffer(buf, true);
+
 			PageSetAllVisible(page);
-			MarkBufferDirty(buf);
 			visibilitymap_set(vacrel->rel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, prunestate.visibility_cutoff_xid,
-							  flags);
+							  *vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+			END_CRIT_SECTION();
 		}
 
-		/*
-		 * As of PostgreSQL 9.2, the visibility map bit should never be set if
-		 * the page-level bit is clear.  However, it's possible that the bit
-		 * got cleared after we checked it and before we took the buffer
-		 * content lock, so we must recheck before jumping to the conclusion
-		 * that something bad has happened.
-		 */
-		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && VM_ALL_VISIBLE(vacrel->rel, blkno, &vmbuffer))
-		{
-			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
-				 vacrel->relname, blkno);
-			visibilitymap_clear(vacrel->rel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
-		}
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+		return;
+	}
+
+	/*
+	 * Prune and freeze tuples.
+	 *
+	 * Accumulates details of remaining LP_DEAD line pointers on page in dead
+	 * tuple list.  This includes LP_DEAD line pointers that we pruned
+	 * ourselves, as well as existing LP_DEAD line pointers that were pruned
+	 * some time earlier.  Also considers freezing XIDs in the tuple headers
+	 * of remaining items with storage.
+	 */
+	lazy_scan_prune(vacrel, buf, blkno, page, vacrel->vistest, eager_scanned,
+					&prunestate);
+
+	Assert(!prunestate.all_visible || !prunestate.has_lpdead_items);
 
+	/* Remember the location of the last page with nonremovable tuples */
+	if (prunestate.hastup)
+		vacrel->nonempty_pages = blkno + 1;
+
+	if (vacrel->nindexes == 0)
+	{
 		/*
-		 * It's possible for the value returned by
-		 * GetOldestNonRemovableTransactionId() to move backwards, so it's not
-		 * wrong for us to see tuples that appear to not be visible to
-		 * everyone yet, while PD_ALL_VISIBLE is already set. The real safe
-		 * xmin value never moves backwards, but
-		 * GetOldestNonRemovableTransactionId() is conservative and sometimes
-		 * returns a value that's unnecessarily small, so if we see that
-		 * contradiction it just means that the tuples that we think are not
-		 * visible to everyone yet actually are, and the PD_ALL_VISIBLE flag
-		 * is correct.
+		 * Consider the need to do page-at-a-time heap vacuuming when using
+		 * the one-pass strategy now.
 		 *
-		 * There should never be dead tuples on a page with PD_ALL_VISIBLE
-		 * set, however.
+		 * The one-pass strategy will never call lazy_vacuum().  The steps
+		 * performed here can be thought of as the one-pass equivalent of a
+		 * call to lazy_vacuum().
 		 */
-		else if (prunestate.has_lpdead_items && PageIsAllVisible(page))
-		{
-			elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
-				 vacrel->relname, blkno);
-			PageClearAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_clear(vacrel->rel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
-		}
+		Assert(!ParallelHeapVacuumIsActive(vacrel));
 
-		/*
-		 * If the all-visible page is all-frozen but not marked as such yet,
-		 * mark it as all-frozen.  Note that all_frozen is only valid if
-		 * all_visible is true, so we must check both.
-		 */
-		else if (all_visible_according_to_vm && prunestate.all_visible &&
-				 prunestate.all_frozen &&
-				 !VM_ALL_FROZEN(vacrel->rel, blkno, &vmbuffer))
+		if (prunestate.has_lpdead_items)
 		{
+			Size		freespace;
+
+			lazy_vacuum_heap_page(vacrel, blkno, buf,
+								  prunestate.deadoffsets,
+								  prunestate.lpdead_items, vmbuffer);
+
 			/*
-			 * We can pass InvalidTransactionId as the cutoff XID here,
-			 * because setting the all-frozen bit doesn't cause recovery
-			 * conflicts.
+			 * Periodically perform FSM vacuuming to make newly-freed space
+			 * visible on upper FSM pages.  Note we have not yet performed FSM
+			 * processing for blkno.
 			 */
-			visibilitymap_set(vacrel->rel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, InvalidTransactionId,
-							  VISIBILITYMAP_ALL_FROZEN);
-		}
+			if (blkno - vacrel->next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
+			{
+				FreeSpaceMapVacuumRange(vacrel->rel,
+										vacrel->next_fsm_block_to_vacuum,
+										blkno);
+				vacrel->next_fsm_block_to_vacuum = blkno;
+			}
 
-		/*
-		 * Final steps for block: drop super-exclusive lock, record free space
-		 * in the FSM
-		 */
-		if (prunestate.has_lpdead_items && vacrel->do_index_vacuuming)
-		{
 			/*
-			 * Wait until lazy_vacuum_heap_rel() to save free space.  This
-			 * doesn't just save us some cycles; it also allows us to record
-			 * any additional free space that lazy_vacuum_heap_page() will
-			 * make available in cases where it's possible to truncate the
-			 * page's line pointer array.
-			 *
-			 * Note: It's not in fact 100% certain that we really will call
-			 * lazy_vacuum_heap_rel() -- lazy_vacuum() might yet opt to skip
-			 * index vacuuming (and so must skip heap vacuuming).  This is
-			 * deemed okay because it only happens in emergencies, or when
-			 * there is very little free space anyway. (Besides, we start
-			 * recording free space in the FSM once index vacuuming has been
-			 * abandoned.)
+			 * Now perform FSM processing for blkno, and move on to next page.
 			 *
-			 * Note: The one-pass (no indexes) case is only supposed to make
-			 * it this far when there were no LP_DEAD items during pruning.
+			 * Our call to lazy_vacuum_heap_page() will have considered if
+			 * it's possible to set all_visible/all_frozen independently of
+			 * lazy_scan_prune().  Note that prunestate was invalidated by
+			 * lazy_vacuum_heap_page() call.
 			 */
-			Assert(vacrel->nindexes > 0);
-			UnlockReleaseBuffer(buf);
-		}
-		else
-		{
-			Size		freespace = PageGetHeapFreeSpace(page);
+			freespace = PageGetHeapFreeSpace(page);
 
 			UnlockReleaseBuffer(buf);
 			RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+			return;
 		}
+
+		/*
+		 * There was no call to lazy_vacuum_heap_page() because pruning didn't
+		 * encounter/create any LP_DEAD items that needed to be vacuumed.
+		 * Prune state has not been invalidated, so proceed with
+		 * prunestate-driven visibility map and FSM steps (just like the
+		 * two-pass strategy).
+		 */
+		Assert(TidStoreNumTids(vacrel->dead_tuples) == 0);
 	}
 
-	/* report that everything is now scanned */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+	/*
+	 * Handle setting visibility map bit based on what the VM said about the
+	 * page before pruning started, and using prunestate
+	 */
+	if (!all_visible_according_to_vm && prunestate.all_visible)
+	{
+		uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
 
-	/* Clear the block number information */
-	vacrel->blkno = InvalidBlockNumber;
+		if (prunestate.all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
 
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrel->new_live_tuples = vac_estimate_reltuples(vacrel->rel, nblocks,
-													 vacrel->tupcount_pages,
-													 vacrel->live_tuples);
+		/*
+		 * It should never be the case that the visibility map page is set
+		 * while the page-level bit is clear, but the reverse is allowed (if
+		 * checksums are not enabled).  Regardless, set both bits so that we
+		 * get back in sync.
+		 *
+		 * NB: If the heap page is all-visible but the VM bit is not set, we
+		 * don't need to dirty the heap page.  However, if checksums are
+		 * enabled, we do need to make sure that the heap page is dirtied
+		 * before passing it to visibilitymap_set(), because it may be logged.
+		 * Given that this situation should only happen in rare cases after a
+		 * crash, it is not worth optimizing.
+		 */
+		PageSetAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_set(vacrel->rel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, prunestate.visibility_cutoff_xid,
+						  flags);
+	}
 
 	/*
-	 * Also compute the total number of surviving heap entries.  In the
-	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 * As of PostgreSQL 9.2, the visibility map bit should never be set if the
+	 * page-level bit is clear.  However, it's possible that the bit got
+	 * cleared after we checked it and before we took the buffer content lock,
+	 * so we must recheck before jumping to the conclusion that something bad
+	 * has happened.
 	 */
-	vacrel->new_rel_tuples =
-		Max(vacrel->new_live_tuples, 0) + vacrel->new_dead_tuples;
+	else if (all_visible_according_to_vm && !PageIsAllVisible(page)
+			 && VM_ALL_VISIBLE(vacrel->rel, blkno, vmbuffer))
+	{
+		elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
+			 vacrel->relname, blkno);
+		visibilitymap_clear(vacrel->rel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
 
 	/*
-	 * Release any remaining pin on visibility map page.
+	 * It's possible for the value returned by
+	 * GetOldestNonRemovableTransactionId() to move backwards, so it's not
+	 * wrong for us to see tuples that appear to not be visible to everyone
+	 * yet, while PD_ALL_VISIBLE is already set. The real safe xmin value
+	 * never moves backwards, but GetOldestNonRemovableTransactionId() is
+	 * conservative and sometimes returns a value that's unnecessarily small,
+	 * so if we see that contradiction it just means that the tuples that we
+	 * think are not visible to everyone yet actually are, and the
+	 * PD_ALL_VISIBLE flag is correct.
+	 *
+	 * There should never be dead tuples on a page with PD_ALL_VISIBLE set,
+	 * however.
 	 */
-	if (BufferIsValid(vmbuffer))
+	else if (prunestate.has_lpdead_items && PageIsAllVisible(page))
 	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
+		elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
+			 vacrel->relname, blkno);
+		PageClearAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_clear(vacrel->rel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
 	}
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	if (dead_tuples->num_tuples > 0)
-		lazy_vacuum(vacrel);
+	/*
+	 * If the all-visible page is all-frozen but not marked as such yet, mark
+	 * it as all-frozen.  Note that all_frozen is only valid if all_visible is
+	 * true, so we must check both.
+	 */
+	else if (all_visible_according_to_vm && prunestate.all_visible &&
+			 prunestate.all_frozen &&
+			 !VM_ALL_FROZEN(vacrel->rel, blkno, vmbuffer))
+	{
+		/*
+		 * We can pass InvalidTransactionId as the cutoff XID here, because
+		 * setting the all-frozen bit doesn't cause recovery conflicts.
+		 */
+		visibilitymap_set(vacrel->rel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, InvalidTransactionId,
+						  VISIBILITYMAP_ALL_FROZEN);
+	}
 
 	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes, and whether or not we bypassed index vacuuming.
+	 * Final steps for block: drop super-exclusive lock, record free space in
+	 * the FSM
 	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum, blkno);
+	if (prunestate.has_lpdead_items && vacrel->do_index_vacuuming)
+	{
+		/*
+		 * Wait until lazy_vacuum_heap_rel() to save free space.  This doesn't
+		 * just save us some cycles; it also allows us to record any
+		 * additional free space that lazy_vacuum_heap_page() will make
+		 * available in cases where it's possible to truncate the page's line
+		 * pointer array.
+		 *
+		 * Note: It's not in fact 100% certain that we really will call
+		 * lazy_vacuum_heap_rel() -- lazy_vacuum() might yet opt to skip index
+		 * vacuuming (and so must skip heap vacuuming).  This is deemed okay
+		 * because it only happens in emergencies, or when there is very
+		 * little free space anyway. (Besides, we start recording free space
+		 * in the FSM once index vacuuming has been abandoned.)
+		 *
+		 * Note: The one-pass (no indexes) case is only supposed to make it
+		 * this far when there were no LP_DEAD items during pruning.
+		 */
+		Assert(vacrel->nindexes > 0);
+		UnlockReleaseBuffer(buf);
+	}
+	else
+	{
+		Size		freespace = PageGetHeapFreeSpace(page);
 
-	/* report all blocks vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+	}
+}
 
-	/* Do post-vacuum cleanup */
-	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
-		lazy_cleanup_all_indexes(vacrel);
+/*
+ *	lazy_scan_heap_chunks() -- first heap pass of a parallel vacuum participant
+ *
+ * Claims chunks of the heap from the shared counter and scans them, until
+ * all chunks have been handed out or the dead tuple store is full.  This is
+ * used by both the leader and the workers.
+ *
+ * As the other participants finish the chunks they have already claimed when
+ * the store fills up, the store can exceed its memory budget by up to about
+ * one chunk's worth of dead item TIDs per participant.
+ */
+static void
+lazy_scan_heap_chunks(LVRelState *vacrel, Buffer *vmbuffer)
+{
+	LVShared   *lvshared = vacrel->lvshared;
+	TidStore   *dead_tuples = vacrel->dead_tuples;
 
 	/*
-	 * Free resources managed by lazy_space_alloc().  (We must end parallel
-	 * mode/free shared memory before updating index statistics.  We cannot
-	 * write while in parallel mode.)
+	 * Increment the active worker count if we are able to launch any worker.
 	 */
-	lazy_space_free(vacrel);
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
 
-	/* Update index statistics */
-	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
-		update_index_statistics(vacrel);
+	for (;;)
+	{
+		uint32		chunk;
+		uint32		blks_scanned;
+		BlockNumber start,
+					end;
 
-	/*
-	 * When the table has no indexes (i.e. in the one-pass strategy case),
-	 * make log report that lazy_vacuum_heap_rel would've made had there been
-	 * indexes.  (As in the two-pass strategy case, only make this report when
-	 * there were LP_DEAD line pointers vacuumed in lazy_vacuum_heap_page.)
-	 */
-	if (vacrel->nindexes == 0 && vacrel->lpdead_item_pages > 0)
-		ereport(elevel,
-				(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
-						vacrel->relname, (long long) vacrel->lpdead_items,
-						vacrel->lpdead_item_pages)));
+		/* Leave the rest of the heap for the next round if we're full */
+		if (TidStoreIsFull(dead_tuples) && TidStoreNumTids(dead_tuples) > 0)
+			break;
 
-	/*
-	 * Make a log report summarizing pruning and freezing.
-	 *
-	 * The autovacuum specific logging in heap_vacuum_rel summarizes an entire
-	 * VACUUM operation, whereas each VACUUM VERBOSE log report generally
-	 * summarizes a single round of index/heap vacuuming (or rel truncation).
-	 * It wouldn't make sense to report on pruning or freezing while following
-	 * that convention, though.  You can think of this log report as a summary
-	 * of our first pass over the heap.
-	 */
-	initStringInfo(&buf);
-	appendStringInfo(&buf,
-					 _("%lld dead row versions cannot be removed yet, oldest xmin: %u\n"),
-					 (long long) vacrel->new_dead_tuples, vacrel->OldestXmin);
-	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
-									"Skipped %u pages due to buffer pins, ",
-									vacrel->pinskipped_pages),
-					 vacrel->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
-									vacrel->frozenskipped_pages),
-					 vacrel->frozenskipped_pages);
-	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+		/* Get a chunk to scan */
+		chunk = pg_atomic_fetch_add_u32(&lvshared->next_scan_chunk, 1);
+		if (chunk >= lvshared->nchunks)
+			break;
 
-	ereport(elevel,
-			(errmsg("table \"%s.%s\": found %lld removable, %lld nonremovable row versions in %u out of %u pages",
-					vacrel->relnamespace,
-					vacrel->relname,
-					(long long) vacrel->tuples_deleted,
-					(long long) vacrel->num_tuples, vacrel->scanned_pages,
-					nblocks),
-			 errdetail_internal("%s", buf.data)));
-	pfree(buf.data);
+		start = chunk * lvshared->chunk_size;
+		end = start + Min(lvshared->chunk_size, vacrel->rel_pages - start);
+
+		lazy_scan_heap_range(vacrel, start, end, vmbuffer);
+
+		/* Report the blocks of all participants' finished chunks */
+		blks_scanned = pg_atomic_add_fetch_u32(&lvshared->heap_blks_scanned,
+											   end - start);
+		if (!IsParallelWorker())
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 blks_scanned);
+	}
+
+	/* We have completed our share of the heap scan */
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
 }
 
 /*
@@ -1689,7 +2036,7 @@ lazy_scan_heap(LVRelState *vacrel, VacuumParams *params, bool aggressive)
  * The approach we take now is to restart pruning when the race condition is
  * detected.  This allows heap_page_prune() to prune the tuples inserted by
  * the now-aborted transaction.  This is a little crude, but it guarantees
- * that any items that make it into the dead_tuples array are simple LP_DEAD
+ * that any items that make it into the dead tuple store are simple LP_DEAD
  * line pointers, and that every remaining item with tuple storage is
  * considered as a candidate for freezing.
  */
@@ -1699,6 +2046,7 @@ lazy_scan_prune(LVRelState *vacrel,
 				BlockNumber blkno,
 				Page page,
 				GlobalVisState *vistest,
+				bool eager_scanned,
 				LVPagePruneState *prunestate)
 {
 	Relation	rel = vacrel->rel;
@@ -1713,7 +2061,8 @@ lazy_scan_prune(LVRelState *vacrel,
 				num_tuples,
 				live_tuples;
 	int			nfrozen;
-	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	TransactionId freeze_cutoff = vacrel->FreezeLimit;
+	OffsetNumber *deadoffsets = prunestate->deadoffsets;
 	xl_heap_freeze_tuple frozen[MaxHeapTuplesPerPage];
 
 	maxoff = PageGetMaxOffsetNumber(page);
@@ -1831,7 +2180,7 @@ retry:
 		 * them as dead_tuples at all (we only consider new_dead_tuples).  The
 		 * outcome is no different because we assume that any LP_DEAD items we
 		 * encounter here will become LP_UNUSED inside lazy_vacuum_heap_page()
-		 * before we report anything to the stats collector. (Cases where we
+		 * before we report anything to the stats system. (Cases where we
 		 * bypass index vacuuming will violate our assumption, but the overall
 		 * impact of that should be negligible.)
 		 */
@@ -1952,6 +2301,48 @@ retry:
 	 */
 	vacrel->offnum = InvalidOffsetNumber;
 
+	/*
+	 * If the page is about to become all-visible but not all-frozen, consider
+	 * freezing all of its tuples now, using OldestXmin as the cutoff rather
+	 * than FreezeLimit.  We only do that when it adds little to the cost of
+	 * this VACUUM: when we need to freeze some tuples or to set the page
+	 * all-visible anyway, when pruning has already dirtied the page, or when
+	 * the page is being visited in order to freeze it (all pages of an
+	 * aggressive VACUUM, some of a non-aggressive one).  Otherwise the tuples
+	 * would stay unfrozen until FreezeLimit catches up with them, at which
+	 * point an aggressive VACUUM has to rewrite every such page at once.
+	 */
+	if (prunestate->all_visible && !prunestate->all_frozen &&
+		(nfrozen > 0 || tuples_deleted > 0 || !PageIsAllVisible(page) ||
+		 vacrel->aggressive || eager_scanned))
+	{
+		xl_heap_freeze_tuple eager_frozen[MaxHeapTuplesPerPage];
+		int			neager;
+
+		neager = lazy_prepare_freeze_page(vacrel, page, eager_frozen);
+		if (neager > 0)
+		{
+			memcpy(frozen, eager_frozen, sizeof(xl_heap_freeze_tuple) * neager);
+			nfrozen = neager;
+
+			/*
+			 * The newest xmin we freeze is visibility_cutoff_xid, which can
+			 * be well before OldestXmin.  Only standby queries that might
+			 * not see it need to conflict with the freeze record; redo
+			 * treats the cutoff as exclusive, hence the advance.  (If there
+			 * is no normal xmin on the page, we're only freezing xmax or
+			 * xvac, and FreezeLimit will do as for regular freezing.)
+			 */
+			if (TransactionIdIsNormal(prunestate->visibility_cutoff_xid))
+			{
+				freeze_cutoff = prunestate->visibility_cutoff_xid;
+				TransactionIdAdvance(freeze_cutoff);
+			}
+			prunestate->all_frozen = true;
+			vacrel->eager_frozen_pages++;
+		}
+	}
+
 	/*
 	 * Consider the need to freeze any items with tuple storage from the page
 	 * first (arbitrary)
@@ -1988,7 +2379,7 @@ retry:
 		{
 			XLogRecPtr	recptr;
 
-			recptr = log_heap_freeze(vacrel->rel, buf, vacrel->FreezeLimit,
+			recptr = log_heap_freeze(vacrel->rel, buf, freeze_cutoff,
 									 frozen, nfrozen);
 			PageSetLSN(page, recptr);
 		}
@@ -2034,30 +2425,38 @@ retry:
 #endif
 
 	/*
-	 * Now save details of the LP_DEAD items from the page in the dead_tuples
-	 * array
+	 * Now save details of the LP_DEAD items from the page in the dead tuple
+	 * store.  With the one-pass strategy, our caller vacuums the page right
+	 * away using prunestate->deadoffsets instead.
 	 */
+	prunestate->lpdead_items = lpdead_items;
 	if (lpdead_items > 0)
 	{
-		LVDeadTuples *dead_tuples = vacrel->dead_tuples;
-		ItemPointerData tmp;
-
 		Assert(!prunestate->all_visible);
 		Assert(prunestate->has_lpdead_items);
 
 		vacrel->lpdead_item_pages++;
 
-		ItemPointerSetBlockNumber(&tmp, blkno);
-
-		for (int i = 0; i < lpdead_items; i++)
+		if (vacrel->nindexes > 0)
 		{
-			ItemPointerSetOffsetNumber(&tmp, deadoffsets[i]);
-			dead_tuples->itemptrs[dead_tuples->num_tuples++] = tmp;
+			TidStore   *dead_tuples = vacrel->dead_tuples;
+			const int	prog_index[2] = {
+				PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+				PROGRESS_VACUUM_DEAD_TUPLE_BYTES
+			};
+			int64		prog_val[2];
+
+			TidStoreSetBlockOffsets(dead_tuples, blkno, deadoffsets,
+									lpdead_items);
+
+			/* The store is shared, so the leader reports for everyone */
+			if (!IsParallelWorker())
+			{
+				prog_val[0] = TidStoreNumTids(dead_tuples);
+				prog_val[1] = TidStoreMemoryUsage(dead_tuples);
+				pgstat_progress_update_multi_param(2, prog_index, prog_val);
+			}
 		}
-
-		Assert(dead_tuples->num_tuples <= dead_tuples->max_tuples);
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 dead_tuples->num_tuples);
 	}
 
 	/* Finally, add page-local counts to whole-VACUUM counts */
@@ -2068,6 +2467,65 @@ retry:
 	vacrel->live_tuples += live_tuples;
 }
 
+/*
+ *	lazy_prepare_freeze_page() -- plan freezing all tuples on a page.
+ *
+ * Prepares freeze plans for the tuples of a page that lazy_scan_prune() has
+ * found to be all-visible, using OldestXmin as the freeze cutoff, and returns
+ * their number.  Returns 0 if that wouldn't leave every tuple on the page
+ * frozen, in which case we leave the page to FreezeLimit-driven freezing.
+ *
+ * Tuples with a MultiXactId xmax are not considered, because freezing them
+ * eagerly could require creating a new MultiXactId.
+ */
+static int
+lazy_prepare_freeze_page(LVRelState *vacrel, Page page,
+						 xl_heap_freeze_tuple *frozen)
+{
+	OffsetNumber offnum,
+				maxoff;
+	int			nfrozen = 0;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		bool		tuple_totally_frozen;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		if (htup->t_infomask & HEAP_XMAX_IS_MULTI)
+		{
+			nfrozen = 0;
+			break;
+		}
+
+		vacrel->offnum = offnum;
+		if (heap_prepare_freeze_tuple(htup,
+									  vacrel->relfrozenxid,
+									  vacrel->relminmxid,
+									  vacrel->OldestXmin,
+									  vacrel->MultiXactCutoff,
+									  &frozen[nfrozen],
+									  &tuple_totally_frozen))
+			frozen[nfrozen++].offset = offnum;
+
+		if (!tuple_totally_frozen)
+		{
+			nfrozen = 0;
+			break;
+		}
+	}
+	vacrel->offnum = InvalidOffsetNumber;
+
+	return nfrozen;
+}
+
 /*
  * Remove the collected garbage tuples from the table and its indexes.
  *
@@ -2079,6 +2537,11 @@ static void
 lazy_vacuum(LVRelState *vacrel)
 {
 	bool		bypass;
+	const int	prog_index[2] = {
+		PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+		PROGRESS_VACUUM_DEAD_TUPLE_BYTES
+	};
+	const int64 prog_val[2] = {0, 0};
 
 	/* Should not end up here with no indexes */
 	Assert(vacrel->nindexes > 0);
@@ -2088,7 +2551,8 @@ lazy_vacuum(LVRelState *vacrel)
 	if (!vacrel->do_index_vacuuming)
 	{
 		Assert(!vacrel->do_index_cleanup);
-		vacrel->dead_tuples->num_tuples = 0;
+		TidStoreReset(vacrel->dead_tuples);
+		pgstat_progress_update_multi_param(2, prog_index, prog_val);
 		return;
 	}
 
@@ -2117,7 +2581,7 @@ lazy_vacuum(LVRelState *vacrel)
 		BlockNumber threshold;
 
 		Assert(vacrel->num_index_scans == 0);
-		Assert(vacrel->lpdead_items == vacrel->dead_tuples->num_tuples);
+		Assert(vacrel->lpdead_items == TidStoreNumTids(vacrel->dead_tuples));
 		Assert(vacrel->do_index_vacuuming);
 		Assert(vacrel->do_index_cleanup);
 
@@ -2133,19 +2597,19 @@ lazy_vacuum(LVRelState *vacrel)
 		 * to store the TIDs (TIDs that now all point to LP_DEAD items) must
 		 * not exceed 32MB.  This limits the risk that we will bypass index
 		 * vacuuming again and again until eventually there is a VACUUM whose
-		 * dead_tuples space is not CPU cache resident.
+		 * dead tuple store is not CPU cache resident.
 		 *
 		 * We don't take any special steps to remember the LP_DEAD items (such
-		 * as counting them in new_dead_tuples report to the stats collector)
+		 * as counting them in new_dead_tuples report to the stats system)
 		 * when the optimization is applied.  Though the accounting used in
 		 * analyze.c's acquire_sample_rows() will recognize the same LP_DEAD
-		 * items as dead rows in its own stats collector report, that's okay.
+		 * items as dead rows in its own stats report, that's okay.
 		 * The discrepancy should be negligible.  If this optimization is ever
 		 * expanded to cover more cases then this may need to be reconsidered.
 		 */
 		threshold = (double) vacrel->rel_pages * BYPASS_THRESHOLD_PAGES;
 		bypass = (vacrel->lpdead_item_pages < threshold &&
-				  vacrel->lpdead_items < MAXDEADTUPLES(32L * 1024L * 1024L));
+				  TidStoreMemoryUsage(vacrel->dead_tuples) < 32L * 1024L * 1024L);
 	}
 
 	if (bypass)
@@ -2195,7 +2659,8 @@ lazy_vacuum(LVRelState *vacrel)
 	 * Forget the LP_DEAD items that we just vacuumed (or just decided to not
 	 * vacuum)
 	 */
-	vacrel->dead_tuples->num_tuples = 0;
+	TidStoreReset(vacrel->dead_tuples);
+	pgstat_progress_update_multi_param(2, prog_index, prog_val);
 }
 
 /*
@@ -2269,7 +2734,7 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 	 * place).
 	 */
 	Assert(vacrel->num_index_scans > 0 ||
-		   vacrel->dead_tuples->num_tuples == vacrel->lpdead_items);
+		   TidStoreNumTids(vacrel->dead_tuples) == vacrel->lpdead_items);
 	Assert(allindexes || vacrel->failsafe_active);
 
 	/*
@@ -2288,7 +2753,7 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 /*
  *	lazy_vacuum_heap_rel() -- second pass over the heap for two pass strategy
  *
- * This routine marks LP_DEAD items in vacrel->dead_tuples array as LP_UNUSED.
+ * This routine marks LP_DEAD items in vacrel->dead_tuples as LP_UNUSED.
  * Pages that never had lazy_scan_prune record LP_DEAD items are not visited
  * at all.
  *
@@ -2306,30 +2771,84 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 static void
 lazy_vacuum_heap_rel(LVRelState *vacrel)
 {
-	int			tupindex;
+	int64		vacuumed_tuples;
 	BlockNumber vacuumed_pages;
 	PGRUsage	ru0;
-	Buffer		vmbuffer = InvalidBuffer;
 	LVSavedErrInfo saved_err_info;
 
-	Assert(vacrel->do_index_vacuuming);
-	Assert(vacrel->do_index_cleanup);
-	Assert(vacrel->num_index_scans > 0);
+	Assert(vacrel->do_index_vacuuming);
+	Assert(vacrel->do_index_cleanup);
+	Assert(vacrel->num_index_scans > 0);
+
+	/* Report that we are now vacuuming the heap */
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
+
+	/* Update error traceback information */
+	update_vacuum_error_info(vacrel, &saved_err_info,
+							 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
+							 InvalidBlockNumber, InvalidOffsetNumber);
+
+	pg_rusage_init(&ru0);
+	vacuumed_tuples = 0;
+	vacuumed_pages = 0;
+
+	if (!ParallelHeapVacuumIsActive(vacrel))
+	{
+		Buffer		vmbuffer = InvalidBuffer;
+
+		lazy_vacuum_heap_range(vacrel, 0, vacrel->rel_pages, &vmbuffer,
+							   &vacuumed_tuples, &vacuumed_pages);
+
+		if (BufferIsValid(vmbuffer))
+		{
+			ReleaseBuffer(vmbuffer);
+			vmbuffer = InvalidBuffer;
+		}
+	}
+	else
+	{
+		/* Outsource everything to parallel variant */
+		do_parallel_lazy_heap_pass(vacrel, PARALLEL_VACUUM_WORK_VACUUM_HEAP,
+								   &vacuumed_tuples, &vacuumed_pages);
+	}
+
+	/*
+	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
+	 * the second heap pass.  No more, no less.
+	 */
+	Assert(vacuumed_tuples > 0);
+	Assert(vacrel->num_index_scans > 1 ||
+		   (vacuumed_tuples == vacrel->lpdead_items &&
+			vacuumed_pages == vacrel->lpdead_item_pages));
 
-	/* Report that we are now vacuuming the heap */
-	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-								 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
+	ereport(elevel,
+			(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
+					vacrel->relname, (long long) vacuumed_tuples,
+					vacuumed_pages),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 
-	/* Update error traceback information */
-	update_vacuum_error_info(vacrel, &saved_err_info,
-							 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
-							 InvalidBlockNumber, InvalidOffsetNumber);
+	/* Revert to the previous phase information for error traceback */
+	restore_vacuum_error_info(vacrel, &saved_err_info);
+}
 
-	pg_rusage_init(&ru0);
-	vacuumed_pages = 0;
+/*
+ *	lazy_vacuum_heap_range() -- lazy_vacuum_heap_rel() for blocks [start, end)
+ *
+ * Visits the pages in the range that have TIDs in vacrel->dead_tuples, adding
+ * the number of items set LP_UNUSED and pages visited to the caller's
+ * counters.
+ */
+static void
+lazy_vacuum_heap_range(LVRelState *vacrel, BlockNumber start, BlockNumber end,
+					   Buffer *vmbuffer, int64 *vacuumed_tuples,
+					   BlockNumber *vacuumed_pages)
+{
+	TidStoreIter *iter;
+	TidStoreIterResult *result;
 
-	tupindex = 0;
-	while (tupindex < vacrel->dead_tuples->num_tuples)
+	iter = TidStoreBeginIterateRange(vacrel->dead_tuples, start, end);
+	while ((result = TidStoreIterateNext(iter)) != NULL)
 	{
 		BlockNumber tblk;
 		Buffer		buf;
@@ -2338,13 +2857,14 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrel->dead_tuples->itemptrs[tupindex]);
+		tblk = result->blkno;
 		vacrel->blkno = tblk;
 		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vacrel->bstrategy);
 		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
-		tupindex = lazy_vacuum_heap_page(vacrel, tblk, buf, tupindex,
-										 &vmbuffer);
+		lazy_vacuum_heap_page(vacrel, tblk, buf, result->offsets,
+							  result->num_offsets, vmbuffer);
+		*vacuumed_tuples += result->num_offsets;
 
 		/* Now that we've vacuumed the page, record its available space */
 		page = BufferGetPage(buf);
@@ -2352,59 +2872,79 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 
 		UnlockReleaseBuffer(buf);
 		RecordPageWithFreeSpace(vacrel->rel, tblk, freespace);
-		vacuumed_pages++;
+		(*vacuumed_pages)++;
 	}
+	TidStoreEndIterate(iter);
 
 	/* Clear the block number information */
 	vacrel->blkno = InvalidBlockNumber;
+}
 
-	if (BufferIsValid(vmbuffer))
-	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
-	}
+/*
+ *	lazy_vacuum_heap_chunks() -- second heap pass of a parallel vacuum
+ *								 participant
+ *
+ * Claims chunks of the heap from the shared counter and vacuums the dead
+ * items recorded for them, until all chunks have been handed out.  This is
+ * used by both the leader and the workers.
+ */
+static void
+lazy_vacuum_heap_chunks(LVRelState *vacrel, Buffer *vmbuffer,
+						int64 *vacuumed_tuples, BlockNumber *vacuumed_pages)
+{
+	LVShared   *lvshared = vacrel->lvshared;
 
 	/*
-	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
-	 * the second heap pass.  No more, no less.
+	 * Increment the active worker count if we are able to launch any worker.
 	 */
-	Assert(tupindex > 0);
-	Assert(vacrel->num_index_scans > 1 ||
-		   (tupindex == vacrel->lpdead_items &&
-			vacuumed_pages == vacrel->lpdead_item_pages));
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
 
-	ereport(elevel,
-			(errmsg("table \"%s\": removed %lld dead item identifiers in %u pages",
-					vacrel->relname, (long long ) tupindex, vacuumed_pages),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+	for (;;)
+	{
+		uint32		chunk;
+		BlockNumber start,
+					end;
 
-	/* Revert to the previous phase information for error traceback */
-	restore_vacuum_error_info(vacrel, &saved_err_info);
+		/* Get a chunk to vacuum */
+		chunk = pg_atomic_fetch_add_u32(&lvshared->next_vacuum_chunk, 1);
+		if (chunk >= lvshared->nchunks)
+			break;
+
+		start = chunk * lvshared->chunk_size;
+		end = start + Min(lvshared->chunk_size, vacrel->rel_pages - start);
+
+		if (!IsParallelWorker())
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED,
+										 start);
+
+		lazy_vacuum_heap_range(vacrel, start, end, vmbuffer,
+							   vacuumed_tuples, vacuumed_pages);
+	}
+
+	/* We have completed our share of the heap vacuuming */
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
 }
 
 /*
- *	lazy_vacuum_heap_page() -- free page's LP_DEAD items listed in the
- *						  vacrel->dead_tuples array.
+ *	lazy_vacuum_heap_page() -- free page's LP_DEAD items at the given offsets.
  *
  * Caller must have an exclusive buffer lock on the buffer (though a
  * super-exclusive lock is also acceptable).
  *
- * tupindex is the index in vacrel->dead_tuples of the first dead tuple for
- * this page.  We assume the rest follow sequentially.  The return value is
- * the first tupindex after the tuples of this page.
- *
  * Prior to PostgreSQL 14 there were rare cases where this routine had to set
  * tuples with storage to unused.  These days it is strictly responsible for
  * marking LP_DEAD stub line pointers as unused.  This only happens for those
  * LP_DEAD items on the page that were determined to be LP_DEAD items back
  * when the same page was visited by lazy_scan_prune() (i.e. those whose TID
- * was recorded in the dead_tuples array).
+ * was recorded in the dead tuple store).
  */
-static int
+static void
 lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
-					  int tupindex, Buffer *vmbuffer)
+					  OffsetNumber *deadoffsets, int num_offsets,
+					  Buffer *vmbuffer)
 {
-	LVDeadTuples *dead_tuples = vacrel->dead_tuples;
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxHeapTuplesPerPage];
 	int			uncnt = 0;
@@ -2414,7 +2954,9 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	Assert(vacrel->nindexes == 0 || vacrel->do_index_vacuuming);
 
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+	/* A parallel VACUUM reports progress one chunk at a time */
+	if (!ParallelHeapVacuumIsActive(vacrel))
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
 	/* Update error traceback information */
 	update_vacuum_error_info(vacrel, &saved_err_info,
@@ -2423,16 +2965,11 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < dead_tuples->num_tuples; tupindex++)
+	for (int i = 0; i < num_offsets; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
+		OffsetNumber toff = deadoffsets[i];
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&dead_tuples->itemptrs[tupindex]);
 		itemid = PageGetItemId(page, toff);
 
 		Assert(ItemIdIsDead(itemid) && !ItemIdHasStorage(itemid));
@@ -2512,7 +3049,6 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	/* Revert to the previous phase information for error traceback */
 	restore_vacuum_error_info(vacrel, &saved_err_info);
-	return tupindex;
 }
 
 /*
@@ -2707,48 +3243,16 @@ do_parallel_vacuum_or_cleanup(LVRelState *vacrel, int nworkers)
 	 */
 	nworkers = Min(nworkers, lps->pcxt->nworkers);
 
+	/* Tell parallel workers to process indexes */
+	lps->lvshared->work = PARALLEL_VACUUM_WORK_INDEXES;
+
+	/* Reset the parallel index processing counter */
+	pg_atomic_write_u32(&(lps->lvshared->idx), 0);
+
 	/* Setup the shared cost-based vacuum delay and launch workers */
 	if (nworkers > 0)
 	{
-		if (vacrel->num_index_scans > 0)
-		{
-			/* Reset the parallel index processing counter */
-			pg_atomic_write_u32(&(lps->lvshared->idx), 0);
-
-			/* Reinitialize the parallel context to relaunch parallel workers */
-			ReinitializeParallelDSM(lps->pcxt);
-		}
-
-		/*
-		 * Set up shared cost balance and the number of active workers for
-		 * vacuum delay.  We need to do this before launching workers as
-		 * otherwise, they might not see the updated values for these
-		 * parameters.
-		 */
-		pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
-		pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
-
-		/*
-		 * The number of workers can vary between bulkdelete and cleanup
-		 * phase.
-		 */
-		ReinitializeParallelWorkers(lps->pcxt, nworkers);
-
-		LaunchParallelWorkers(lps->pcxt);
-
-		if (lps->pcxt->nworkers_launched > 0)
-		{
-			/*
-			 * Reset the local cost values for leader backend as we have
-			 * already accumulated the remaining balance of heap.
-			 */
-			VacuumCostBalance = 0;
-			VacuumCostBalanceLocal = 0;
-
-			/* Enable shared cost balance for leader backend */
-			VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
-			VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
-		}
+		parallel_vacuum_launch_workers(vacrel, nworkers);
 
 		if (lps->lvshared->for_cleanup)
 			ereport(elevel,
@@ -2773,6 +3277,169 @@ do_parallel_vacuum_or_cleanup(LVRelState *vacrel, int nworkers)
 	 */
 	do_parallel_processing(vacrel, lps->lvshared);
 
+	parallel_vacuum_finish_workers(vacrel, nworkers);
+}
+
+/*
+ * Perform one pass over the heap with parallel workers: either a round of the
+ * first heap pass (pruning and freezing, collecting dead item TIDs) or the
+ * second heap pass (marking the collected dead items LP_UNUSED).  This
+ * function must be used by the parallel vacuum leader process.
+ *
+ * The heap is divided into chunks of lvshared->chunk_size blocks which the
+ * leader and the workers claim one at a time, so that a participant that
+ * encounters pages that are expensive to process doesn't hold up the others.
+ * A round of the first pass stops early once the dead tuple store fills up,
+ * leaving the remaining chunks for the next round.
+ *
+ * The counters of the workers are added to those of the leader.  For the
+ * second pass, the totals are also returned in *vacuumed_tuples and
+ * *vacuumed_pages.
+ */
+static void
+do_parallel_lazy_heap_pass(LVRelState *vacrel, LVParallelWork work,
+						   int64 *vacuumed_tuples, BlockNumber *vacuumed_pages)
+{
+	LVParallelState *lps = vacrel->lps;
+	LVShared   *lvshared = lps->lvshared;
+	LVSharedHeapCounts *counts = &lvshared->heap_counts;
+	Buffer		vmbuffer = InvalidBuffer;
+	int			nworkers;
+
+	Assert(!IsParallelWorker());
+	Assert(ParallelHeapVacuumIsActive(vacrel));
+	Assert(work == PARALLEL_VACUUM_WORK_SCAN_HEAP ||
+		   work == PARALLEL_VACUUM_WORK_VACUUM_HEAP);
+
+	/* Tell parallel workers what to do, and how */
+	lvshared->work = work;
+	lvshared->failsafe_active = vacrel->failsafe_active;
+	lvshared->do_index_vacuuming = vacrel->do_index_vacuuming;
+	lvshared->do_rel_truncate = vacrel->do_rel_truncate;
+	MemSet(counts, 0, sizeof(LVSharedHeapCounts));
+
+	/* Every round of heap vacuuming covers the whole heap */
+	if (work == PARALLEL_VACUUM_WORK_VACUUM_HEAP)
+		pg_atomic_write_u32(&lvshared->next_vacuum_chunk, 0);
+
+	/* The leader process will participate */
+	nworkers = Min(lps->nworkers_heap, lps->pcxt->nworkers);
+
+	if (nworkers > 0)
+	{
+		parallel_vacuum_launch_workers(vacrel, nworkers);
+
+		if (work == PARALLEL_VACUUM_WORK_SCAN_HEAP)
+			ereport(elevel,
+					(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+									 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+									 lps->pcxt->nworkers_launched),
+							lps->pcxt->nworkers_launched, nworkers)));
+		else
+			ereport(elevel,
+					(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+									 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+									 lps->pcxt->nworkers_launched),
+							lps->pcxt->nworkers_launched, nworkers)));
+	}
+
+	/*
+	 * Join as a parallel worker.  The leader process alone processes the
+	 * whole heap in the case where no workers are launched.
+	 */
+	if (work == PARALLEL_VACUUM_WORK_SCAN_HEAP)
+		lazy_scan_heap_chunks(vacrel, &vmbuffer);
+	else
+		lazy_vacuum_heap_chunks(vacrel, &vmbuffer, vacuumed_tuples,
+								vacuumed_pages);
+
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
+
+	parallel_vacuum_finish_workers(vacrel, nworkers);
+
+	/* Workers have exited, so their counters can be read without the lock */
+	if (work == PARALLEL_VACUUM_WORK_SCAN_HEAP)
+	{
+		vacrel->scanned_pages += counts->scanned_pages;
+		vacrel->pinskipped_pages += counts->pinskipped_pages;
+		vacrel->frozenskipped_pages += counts->frozenskipped_pages;
+		vacrel->tupcount_pages += counts->tupcount_pages;
+		vacrel->lpdead_item_pages += counts->lpdead_item_pages;
+		vacrel->eager_frozen_pages += counts->eager_frozen_pages;
+		vacrel->nonempty_pages = Max(vacrel->nonempty_pages,
+									 counts->nonempty_pages);
+		vacrel->tuples_deleted += counts->tuples_deleted;
+		vacrel->lpdead_items += counts->lpdead_items;
+		vacrel->new_dead_tuples += counts->new_dead_tuples;
+		vacrel->num_tuples += counts->num_tuples;
+		vacrel->live_tuples += counts->live_tuples;
+	}
+	else
+	{
+		*vacuumed_tuples += counts->vacuumed_tuples;
+		*vacuumed_pages += counts->vacuumed_pages;
+	}
+}
+
+/*
+ * Launch nworkers parallel vacuum workers to do the work described in
+ * lps->lvshared, and set up the shared cost-based vacuum delay for them.
+ */
+static void
+parallel_vacuum_launch_workers(LVRelState *vacrel, int nworkers)
+{
+	LVParallelState *lps = vacrel->lps;
+
+	if (nworkers <= 0)
+		return;
+
+	/* Reinitialize the parallel context to relaunch parallel workers */
+	if (lps->workers_launched)
+		ReinitializeParallelDSM(lps->pcxt);
+
+	/*
+	 * Set up shared cost balance and the number of active workers for vacuum
+	 * delay.  We need to do this before launching workers as otherwise, they
+	 * might not see the updated values for these parameters.
+	 */
+	pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
+
+	/* The number of workers can vary between phases */
+	ReinitializeParallelWorkers(lps->pcxt, nworkers);
+
+	LaunchParallelWorkers(lps->pcxt);
+	lps->workers_launched = true;
+
+	if (lps->pcxt->nworkers_launched > 0)
+	{
+		/*
+		 * Reset the local cost values for leader backend as we have already
+		 * accumulated the remaining balance of heap.
+		 */
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+
+		/* Enable shared cost balance for leader backend */
+		VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
+		VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
+	}
+}
+
+/*
+ * Wait for the workers started by parallel_vacuum_launch_workers() to finish,
+ * accumulate their buffer and WAL usage, and go back to local cost-based
+ * vacuum delay.
+ */
+static void
+parallel_vacuum_finish_workers(LVRelState *vacrel, int nworkers)
+{
+	LVParallelState *lps = vacrel->lps;
+
 	/*
 	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
 	 * to finish, or we might get incomplete data.)
@@ -2797,6 +3464,35 @@ do_parallel_vacuum_or_cleanup(LVRelState *vacrel, int nworkers)
 	}
 }
 
+/*
+ * Add the counters a parallel vacuum worker accumulated during a heap pass to
+ * the shared totals, for the leader to pick up.
+ */
+static void
+parallel_heap_report_counts(LVRelState *vacrel, int64 vacuumed_tuples,
+							BlockNumber vacuumed_pages)
+{
+	LVSharedHeapCounts *counts = &vacrel->lvshared->heap_counts;
+
+	SpinLockAcquire(&vacrel->lvshared->mutex);
+	counts->scanned_pages += vacrel->scanned_pages;
+	counts->pinskipped_pages += vacrel->pinskipped_pages;
+	counts->frozenskipped_pages += vacrel->frozenskipped_pages;
+	counts->tupcount_pages += vacrel->tupcount_pages;
+	counts->lpdead_item_pages += vacrel->lpdead_item_pages;
+	counts->eager_frozen_pages += vacrel->eager_frozen_pages;
+	counts->nonempty_pages = Max(counts->nonempty_pages,
+								 vacrel->nonempty_pages);
+	counts->tuples_deleted += vacrel->tuples_deleted;
+	counts->lpdead_items += vacrel->lpdead_items;
+	counts->new_dead_tuples += vacrel->new_dead_tuples;
+	counts->num_tuples += vacrel->num_tuples;
+	counts->live_tuples += vacrel->live_tuples;
+	counts->vacuumed_tuples += vacuumed_tuples;
+	counts->vacuumed_pages += vacuumed_pages;
+	SpinLockRelease(&vacrel->lvshared->mutex);
+}
+
 /*
  * Index vacuum/cleanup routine used by the leader process and parallel
  * vacuum worker processes to process the indexes in parallel.
@@ -3004,8 +3700,8 @@ lazy_cleanup_all_indexes(LVRelState *vacrel)
 /*
  *	lazy_vacuum_one_index() -- vacuum index relation.
  *
- *		Delete all the index entries pointing to tuples listed in
- *		dead_tuples, and update running statistics.
+ *		Delete all the index entries pointing to tuples in dead_tuples, and
+ *		update running statistics.
  *
  *		reltuples is the number of heap tuples to be passed to the
  *		bulkdelete callback.  It's always assumed to be estimated.
@@ -3047,8 +3743,9 @@ lazy_vacuum_one_index(Relation indrel, IndexBulkDeleteResult *istat,
 							  (void *) vacrel->dead_tuples);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
-					vacrel->indname, vacrel->dead_tuples->num_tuples),
+			(errmsg("scanned index \"%s\" to remove %lld row versions",
+					vacrel->indname,
+					(long long) TidStoreNumTids(vacrel->dead_tuples)),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 
 	/* Revert to the previous phase information for error traceback */
@@ -3437,33 +4134,16 @@ count_nondeletable_pages(LVRelState *vacrel, bool *lock_waiter_detected)
 }
 
 /*
- * Return the maximum number of dead tuples we can record.
+ * Return the amount of memory the dead tuple store may use.
  */
-static long
-compute_max_dead_tuples(BlockNumber relblocks, bool hasindex)
+static size_t
+compute_max_dead_tuples_bytes(void)
 {
-	long		maxtuples;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
-	if (hasindex)
-	{
-		maxtuples = MAXDEADTUPLES(vac_work_mem * 1024L);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MAXDEADTUPLES(MaxAllocSize));
-
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
-
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
-	else
-		maxtuples = MaxHeapTuplesPerPage;
-
-	return maxtuples;
+	return (size_t) vac_work_mem * 1024;
 }
 
 /*
@@ -3474,15 +4154,14 @@ compute_max_dead_tuples(BlockNumber relblocks, bool hasindex)
 static void
 lazy_space_alloc(LVRelState *vacrel, int nworkers, BlockNumber nblocks)
 {
-	LVDeadTuples *dead_tuples;
-	long		maxtuples;
-
 	/*
-	 * Initialize state for a parallel vacuum.  As of now, only one worker can
-	 * be used for an index, so we invoke parallelism only if there are at
-	 * least two indexes on a table.
+	 * Initialize state for a parallel vacuum.  Only one worker can be used
+	 * for an index, but the heap passes can be divided among any number of
+	 * workers, so whether a parallel vacuum pays off is left to
+	 * compute_parallel_vacuum_workers().  A table without indexes is
+	 * vacuumed using the one-pass strategy, which we don't parallelize.
 	 */
-	if (nworkers >= 0 && vacrel->nindexes > 1 && vacrel->do_index_vacuuming)
+	if (nworkers >= 0 && vacrel->nindexes > 0 && vacrel->do_index_vacuuming)
 	{
 		/*
 		 * Since parallel workers cannot access data in temporary tables, we
@@ -3507,13 +4186,15 @@ lazy_space_alloc(LVRelState *vacrel, int nworkers, BlockNumber nblocks)
 			return;
 	}
 
-	maxtuples = compute_max_dead_tuples(nblocks, vacrel->nindexes > 0);
-
-	dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(maxtuples));
-	dead_tuples->num_tuples = 0;
-	dead_tuples->max_tuples = (int) maxtuples;
-
-	vacrel->dead_tuples = dead_tuples;
+	/*
+	 * Serial VACUUM keeps the store in local memory.  There's no one to
+	 * share it with, and we don't want to depend on being able to create DSM
+	 * segments.
+	 */
+	vacrel->dead_tuples_area = NULL;
+	vacrel->dead_tuples = TidStoreCreate(NULL, nblocks,
+										 compute_max_dead_tuples_bytes(),
+										 LWTRANCHE_SHARED_TIDSTORE);
 }
 
 /*
@@ -3523,7 +4204,20 @@ static void
 lazy_space_free(LVRelState *vacrel)
 {
 	if (!ParallelVacuumIsActive(vacrel))
+	{
+		TidStoreDestroy(vacrel->dead_tuples);
+		vacrel->dead_tuples = NULL;
 		return;
+	}
+
+	/*
+	 * Detaching from the dead tuple store's area must happen before the
+	 * parallel context's DSM segment goes away.
+	 */
+	TidStoreDetach(vacrel->dead_tuples);
+	vacrel->dead_tuples = NULL;
+	dsa_detach(vacrel->dead_tuples_area);
+	vacrel->dead_tuples_area = NULL;
 
 	/*
 	 * End parallel mode before updating index statistics as we cannot write
@@ -3536,68 +4230,13 @@ lazy_space_free(LVRelState *vacrel)
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
-	LVDeadTuples *dead_tuples = (LVDeadTuples *) state;
-	int64		litem,
-				ritem,
-				item;
-	ItemPointer res;
-
-	litem = itemptr_encode(&dead_tuples->itemptrs[0]);
-	ritem = itemptr_encode(&dead_tuples->itemptrs[dead_tuples->num_tuples - 1]);
-	item = itemptr_encode(itemptr);
-
-	/*
-	 * Doing a simple bound check before bsearch() is useful to avoid the
-	 * extra cost of bsearch(), especially if dead tuples on the heap are
-	 * concentrated in a certain range.  Since this function is called for
-	 * every index tuple, it pays to be really fast.
-	 */
-	if (item < litem || item > ritem)
-		return false;
-
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) dead_tuples->itemptrs,
-								dead_tuples->num_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
-
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
-
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+	TidStore   *dead_tuples = (TidStore *) state;
 
-	return 0;
+	return TidStoreIsMember(dead_tuples, itemptr);
 }
 
 /*
@@ -3721,27 +4360,34 @@ heap_page_is_all_visible(LVRelState *vacrel, Buffer buf,
 }
 
 /*
- * Compute the number of parallel worker processes to request.  Both index
- * vacuum and index cleanup can be executed with parallel workers.  The index
- * is eligible for parallel vacuum iff its size is greater than
- * min_parallel_index_scan_size as invoking workers for very small indexes
+ * Compute the number of parallel worker processes to request.  Both heap
+ * passes, index vacuum and index cleanup can be executed with parallel
+ * workers.  The index is eligible for parallel vacuum iff its size is greater
+ * than min_parallel_index_scan_size, and the heap iff its size is greater than
+ * min_parallel_table_scan_size, as invoking workers for very small relations
  * can hurt performance.
  *
  * nrequested is the number of parallel workers that user requested.  If
  * nrequested is 0, we compute the parallel degree based on nindexes, that is
- * the number of indexes that support parallel vacuum.  This function also
+ * the number of indexes that support parallel vacuum, and on the size of the
+ * heap the same way as for a parallel sequential scan.  This function also
  * sets can_parallel_vacuum to remember indexes that participate in parallel
- * vacuum.
+ * vacuum, and *nworkers_heap to the number of workers to use for the heap
+ * passes.
  */
 static int
 compute_parallel_vacuum_workers(LVRelState *vacrel, int nrequested,
-								bool *can_parallel_vacuum)
+								BlockNumber nblocks, bool *can_parallel_vacuum,
+								int *nworkers_heap)
 {
 	int			nindexes_parallel = 0;
 	int			nindexes_parallel_bulkdel = 0;
 	int			nindexes_parallel_cleanup = 0;
+	int			heap_parallel = 0;
 	int			parallel_workers;
 
+	*nworkers_heap = 0;
+
 	/*
 	 * We don't allow performing parallel operation in standalone backend or
 	 * when parallelism is disabled.
@@ -3776,17 +4422,52 @@ compute_parallel_vacuum_workers(LVRelState *vacrel, int nrequested,
 	/* The leader process takes one index */
 	nindexes_parallel--;
 
-	/* No index supports parallel vacuum */
-	if (nindexes_parallel <= 0)
+	/*
+	 * Compute the number of workers for the heap passes, in which the leader
+	 * participates too.  The parallel_workers reloption takes precedence over
+	 * the size-based degree, but not over an explicit request.
+	 */
+	if (nblocks >= (BlockNumber) min_parallel_table_scan_size)
+	{
+		if (nrequested > 0)
+			heap_parallel = nrequested;
+		else if (RelationGetParallelWorkers(vacrel->rel, -1) >= 0)
+			heap_parallel = RelationGetParallelWorkers(vacrel->rel, -1);
+		else
+		{
+			int			heap_parallel_threshold;
+
+			/*
+			 * Same as compute_parallel_worker(): one worker for a table of
+			 * min_parallel_table_scan_size, and one more each time the
+			 * table triples in size.
+			 */
+			heap_parallel_threshold = Max(min_parallel_table_scan_size, 1);
+			heap_parallel = 1;
+			while (nblocks >= (BlockNumber) heap_parallel_threshold * 3)
+			{
+				heap_parallel++;
+				heap_parallel_threshold *= 3;
+				if (heap_parallel_threshold > INT_MAX / 3)
+					break;		/* avoid overflow */
+			}
+		}
+	}
+
+	/* Neither the indexes nor the heap support parallel vacuum */
+	if (nindexes_parallel <= 0 && heap_parallel <= 0)
 		return 0;
 
 	/* Compute the parallel degree */
-	parallel_workers = (nrequested > 0) ?
-		Min(nrequested, nindexes_parallel) : nindexes_parallel;
+	parallel_workers = Max(nindexes_parallel, heap_parallel);
+	if (nrequested > 0)
+		parallel_workers = Min(nrequested, parallel_workers);
 
 	/* Cap by max_parallel_maintenance_workers */
 	parallel_workers = Min(parallel_workers, max_parallel_maintenance_workers);
 
+	*nworkers_heap = Min(heap_parallel, parallel_workers);
+
 	return parallel_workers;
 }
 
@@ -3814,7 +4495,7 @@ update_index_statistics(LVRelState *vacrel)
 		vac_update_relstats(indrel,
 							istat->num_pages,
 							istat->num_index_tuples,
-							0,
+							0, 0,
 							false,
 							InvalidTransactionId,
 							InvalidMultiXactId,
@@ -3836,15 +4517,15 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 	int			nindexes = vacrel->nindexes;
 	ParallelContext *pcxt;
 	LVShared   *shared;
-	LVDeadTuples *dead_tuples;
+	void	   *area_space;
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	bool	   *can_parallel_vacuum;
-	long		maxtuples;
 	Size		est_shared;
-	Size		est_deadtuples;
+	Size		dsa_minsize = dsa_minimum_size();
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
+	int			nworkers_heap;
 	int			querylen;
 
 	/*
@@ -3860,7 +4541,9 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 	can_parallel_vacuum = (bool *) palloc0(sizeof(bool) * nindexes);
 	parallel_workers = compute_parallel_vacuum_workers(vacrel,
 													   nrequested,
-													   can_parallel_vacuum);
+													   nblocks,
+													   can_parallel_vacuum,
+													   &nworkers_heap);
 
 	/* Can't perform vacuum in parallel */
 	if (parallel_workers <= 0)
@@ -3870,6 +4553,7 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 	}
 
 	lps = (LVParallelState *) palloc0(sizeof(LVParallelState));
+	lps->nworkers_heap = nworkers_heap;
 
 	EnterParallelMode();
 	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
@@ -3915,10 +4599,12 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
-	/* Estimate size for dead tuples -- PARALLEL_VACUUM_KEY_DEAD_TUPLES */
-	maxtuples = compute_max_dead_tuples(nblocks, true);
-	est_deadtuples = MAXALIGN(SizeOfDeadTuples(maxtuples));
-	shm_toc_estimate_chunk(&pcxt->estimator, est_deadtuples);
+	/*
+	 * Estimate space for the DSA area holding the dead tuple store --
+	 * PARALLEL_VACUUM_KEY_DSA.  The area starts out small and grows by
+	 * adding DSM segments as the store does.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator, dsa_minsize);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
 	/*
@@ -3948,6 +4634,20 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 
 	InitializeParallelDSM(pcxt);
 
+	/*
+	 * If no DSM segment could be created, no workers can be launched either.
+	 * Vacuum serially then, rather than putting the dead tuple store in a DSA
+	 * area that could only grow by creating more segments.
+	 */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		pfree(lps);
+		pfree(can_parallel_vacuum);
+		return NULL;
+	}
+
 	/* Prepare shared information */
 	shared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
 	MemSet(shared, 0, est_shared);
@@ -3963,6 +4663,32 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 	pg_atomic_init_u32(&(shared->idx), 0);
 	shared->offset = MAXALIGN(add_size(SizeOfLVShared, BITMAPLEN(nindexes)));
 
+	/*
+	 * Prepare for dividing the heap passes among the workers.  The heap is
+	 * handed out in chunks small enough to balance the load, aiming at about
+	 * four chunks per participant, but large enough to keep the I/O
+	 * sequential and to let runs of all-visible pages be skipped.
+	 */
+	shared->rel_pages = nblocks;
+	shared->relfrozenxid = vacrel->relfrozenxid;
+	shared->relminmxid = vacrel->relminmxid;
+	shared->OldestXmin = vacrel->OldestXmin;
+	shared->FreezeLimit = vacrel->FreezeLimit;
+	shared->MultiXactCutoff = vacrel->MultiXactCutoff;
+	shared->aggressive = vacrel->aggressive;
+	shared->skipwithvm = vacrel->skipwithvm;
+	shared->chunk_size = Min(PARALLEL_VACUUM_MAX_CHUNK_SIZE,
+							 Max(PARALLEL_VACUUM_MIN_CHUNK_SIZE,
+								 nblocks / ((nworkers_heap + 1) * 4)));
+	shared->nchunks = ((uint64) nblocks + shared->chunk_size - 1) /
+		shared->chunk_size;
+	pg_atomic_init_u32(&(shared->next_scan_chunk), 0);
+	pg_atomic_init_u32(&(shared->next_vacuum_chunk), 0);
+	pg_atomic_init_u32(&(shared->heap_blks_scanned), 0);
+	pg_atomic_init_u32(&(shared->eager_scan_remaining),
+					   vacrel->eager_scan_remaining);
+	SpinLockInit(&shared->mutex);
+
 	/*
 	 * Initialize variables for shared index statistics, set NULL bitmap and
 	 * the size of stats for each index.
@@ -3977,16 +4703,21 @@ begin_parallel_vacuum(LVRelState *vacrel, BlockNumber nblocks,
 		shared->bitmap[idx >> 3] |= 1 << (idx & 0x07);
 	}
 
+	/* Prepare the dead tuple store, in a DSA area shared with the workers */
+	area_space = shm_toc_allocate(pcxt->toc, dsa_minsize);
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DSA, area_space);
+	vacrel->dead_tuples_area = dsa_create_in_place(area_space, dsa_minsize,
+												   LWTRANCHE_VACUUM_DSA,
+												   pcxt->seg);
+	vacrel->dead_tuples = TidStoreCreate(vacrel->dead_tuples_area, nblocks,
+										 compute_max_dead_tuples_bytes(),
+										 LWTRANCHE_SHARED_TIDSTORE);
+	shared->dead_tuples_handle = TidStoreGetHandle(vacrel->dead_tuples);
+
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
 	lps->lvshared = shared;
-
-	/* Prepare the dead tuple space */
-	dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc, est_deadtuples);
-	dead_tuples->max_tuples = maxtuples;
-	dead_tuples->num_tuples = 0;
-	MemSet(dead_tuples->itemptrs, 0, sizeof(ItemPointerData) * maxtuples);
-	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, dead_tuples);
-	vacrel->dead_tuples = dead_tuples;
+	if (nworkers_heap > 0)
+		vacrel->lvshared = shared;
 
 	/*
 	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
@@ -4064,6 +4795,7 @@ end_parallel_vacuum(LVRelState *vacrel)
 	/* Deactivate parallel vacuum */
 	pfree(lps);
 	vacrel->lps = NULL;
+	vacrel->lvshared = NULL;
 }
 
 /*
@@ -4127,11 +4859,46 @@ parallel_processing_is_safe(Relation indrel, LVShared *lvshared)
 	return true;
 }
 
+/*
+ * Take part in a round of the first heap pass, in a parallel vacuum worker.
+ *
+ * Pruning must not remove any less than the leader's OldestXmin allows, or
+ * lazy_scan_prune() would retry forever on tuples that it considers DEAD but
+ * pruning keeps; and freezing with the leader's FreezeLimit relies on
+ * OldestXmin being no older than our own horizon.  So, like the leader, we
+ * make ourselves ignorable by other VACUUMs and compute the horizon for the
+ * relation, and if it is older than the leader's (which is possible, because
+ * the horizon can go backwards), we leave our share of the scan to the
+ * others.
+ */
+static void
+parallel_vacuum_scan_heap(LVRelState *vacrel, Buffer *vmbuffer)
+{
+	TransactionId horizon;
+
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyProc->statusFlags |= PROC_IN_VACUUM;
+	ProcGlobal->statusFlags[MyProc->pgxactoff] = MyProc->statusFlags;
+	LWLockRelease(ProcArrayLock);
+
+	horizon = GetOldestNonRemovableTransactionId(vacrel->rel);
+	if (TransactionIdPrecedes(horizon, vacrel->OldestXmin))
+	{
+		elog(DEBUG1, "parallel vacuum worker not scanning heap, as its horizon %u precedes %u",
+			 horizon, vacrel->OldestXmin);
+		return;
+	}
+	vacrel->vistest = GlobalVisTestFor(vacrel->rel);
+
+	lazy_scan_heap_chunks(vacrel, vmbuffer);
+}
+
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Parallel vacuum workers perform index vacuum, index cleanup, or their share
+ * of one of the heap passes.  The leader reports progress information on
+ * behalf of all participants, so workers don't need to.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -4139,7 +4906,8 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	Relation	rel;
 	Relation   *indrels;
 	LVShared   *lvshared;
-	LVDeadTuples *dead_tuples;
+	dsa_area   *area;
+	TidStore   *dead_tuples;
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	int			nindexes;
@@ -4151,7 +4919,11 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 										   false);
 	elevel = lvshared->elevel;
 
-	if (lvshared->for_cleanup)
+	if (lvshared->work == PARALLEL_VACUUM_WORK_SCAN_HEAP)
+		elog(DEBUG1, "starting parallel vacuum worker for heap scan");
+	else if (lvshared->work == PARALLEL_VACUUM_WORK_VACUUM_HEAP)
+		elog(DEBUG1, "starting parallel vacuum worker for heap vacuum");
+	else if (lvshared->for_cleanup)
 		elog(DEBUG1, "starting parallel vacuum worker for cleanup");
 	else
 		elog(DEBUG1, "starting parallel vacuum worker for bulk delete");
@@ -4175,13 +4947,14 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	vac_open_indexes(rel, RowExclusiveLock, &nindexes, &indrels);
 	Assert(nindexes > 0);
 
-	/* Set dead tuple space */
-	dead_tuples = (LVDeadTuples *) shm_toc_lookup(toc,
-												  PARALLEL_VACUUM_KEY_DEAD_TUPLES,
-												  false);
+	/* Attach to the dead tuple store */
+	area = dsa_attach_in_place(shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_DSA,
+											  false),
+							   seg);
+	dead_tuples = TidStoreAttach(area, lvshared->dead_tuples_handle);
 
-	/* Set cost-based vacuum delay */
-	VacuumCostActive = (VacuumCostDelay > 0);
+	/* Set cost-based vacuum delay, unless the leader gave it up */
+	VacuumCostActive = (VacuumCostDelay > 0 && !lvshared->failsafe_active);
 	VacuumCostBalance = 0;
 	VacuumPageHit = 0;
 	VacuumPageMiss = 0;
@@ -4190,6 +4963,7 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	VacuumSharedCostBalance = &(lvshared->cost_balance);
 	VacuumActiveNWorkers = &(lvshared->active_nworkers);
 
+	MemSet(&vacrel, 0, sizeof(LVRelState));
 	vacrel.rel = rel;
 	vacrel.indrels = indrels;
 	vacrel.nindexes = nindexes;
@@ -4208,8 +4982,25 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	vacrel.relname = pstrdup(RelationGetRelationName(rel));
 	vacrel.indname = NULL;
 	vacrel.phase = VACUUM_ERRCB_PHASE_UNKNOWN;	/* Not yet processing */
+	vacrel.blkno = InvalidBlockNumber;
+	vacrel.offnum = InvalidOffsetNumber;
+	vacrel.dead_tuples_area = area;
 	vacrel.dead_tuples = dead_tuples;
 
+	/* Copy the leader's cutoffs and options for the heap passes */
+	vacrel.lvshared = lvshared;
+	vacrel.rel_pages = lvshared->rel_pages;
+	vacrel.relfrozenxid = lvshared->relfrozenxid;
+	vacrel.relminmxid = lvshared->relminmxid;
+	vacrel.OldestXmin = lvshared->OldestXmin;
+	vacrel.FreezeLimit = lvshared->FreezeLimit;
+	vacrel.MultiXactCutoff = lvshared->MultiXactCutoff;
+	vacrel.aggressive = lvshared->aggressive;
+	vacrel.skipwithvm = lvshared->skipwithvm;
+	vacrel.failsafe_active = lvshared->failsafe_active;
+	vacrel.do_index_vacuuming = lvshared->do_index_vacuuming;
+	vacrel.do_rel_truncate = lvshared->do_rel_truncate;
+
 	/* Setup error traceback support for ereport() */
 	errcallback.callback = vacuum_error_callback;
 	errcallback.arg = &vacrel;
@@ -4219,8 +5010,33 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	do_parallel_processing(&vacrel, lvshared);
+	if (lvshared->work == PARALLEL_VACUUM_WORK_INDEXES)
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		do_parallel_processing(&vacrel, lvshared);
+	}
+	else
+	{
+		Buffer		vmbuffer = InvalidBuffer;
+		int64		vacuumed_tuples = 0;
+		BlockNumber vacuumed_pages = 0;
+
+		if (lvshared->work == PARALLEL_VACUUM_WORK_SCAN_HEAP)
+			parallel_vacuum_scan_heap(&vacrel, &vmbuffer);
+		else
+		{
+			update_vacuum_error_info(&vacrel, NULL,
+									 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
+									 InvalidBlockNumber, InvalidOffsetNumber);
+			lazy_vacuum_heap_chunks(&vacrel, &vmbuffer, &vacuumed_tuples,
+									&vacuumed_pages);
+		}
+
+		if (BufferIsValid(vmbuffer))
+			ReleaseBuffer(vmbuffer);
+
+		parallel_heap_report_counts(&vacrel, vacuumed_tuples, vacuumed_pages);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -4231,6 +5047,9 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Pop the error context stack */
 	error_context_stack = errcallback.previous;
 
+	TidStoreDetach(dead_tuples);
+	dsa_detach(area);
+
 	vac_close_indexes(nindexes, indrels, RowExclusiveLock);
 	table_close(rel, ShareUpdateExclusiveLock);
 	FreeAccessStrategy(vacrel.bstrategy);
@@ -25,6 +25,7 @@
 #include "catalog/pg_enum.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/copy.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -117,6 +118,9 @@ volatile bool ParallelMessagePending = false;
 /* Are we initializing a parallel worker? */
 bool		InitializingParallelWorker = false;
 
+/* May this parallel worker insert tuples?  See heap_prepare_insert(). */
+bool		ParallelWorkerInsertsAllowed = false;
+
 /* Pointer to our fixed parallel state. */
 static FixedParallelState *MyFixedParallelState;
 
@@ -145,6 +149,9 @@ static const struct
 	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
 	}
 };
 
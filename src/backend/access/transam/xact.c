@@ -768,9 +768,11 @@ GetCurrentCommandId(bool used)
 		 * Forbid setting currentCommandIdUsed in a parallel worker, because
 		 * we have no provision for communicating this back to the leader.  We
 		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * true at the start of the parallel operation.  Parallel COPY FROM
+		 * does that: its leader marks the command ID as used before launching
+		 * the workers, and the workers set ParallelWorkerInsertsAllowed.
 		 */
-		Assert(!IsParallelWorker());
+		Assert(!IsParallelWorker() || ParallelWorkerInsertsAllowed);
 		currentCommandIdUsed = true;
 	}
 	return currentCommandId;
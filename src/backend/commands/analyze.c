@@ -639,14 +639,16 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	if (!inh)
 	{
 		BlockNumber relallvisible;
+		BlockNumber relallfrozen;
 
-		visibilitymap_count(onerel, &relallvisible, NULL);
+		visibilitymap_count(onerel, &relallvisible, &relallfrozen);
 
 		/* Update pg_class for table relation */
 		vac_update_relstats(onerel,
 							relpages,
 							totalrows,
 							relallvisible,
+							relallfrozen,
 							hasindex,
 							InvalidTransactionId,
 							InvalidMultiXactId,
@@ -662,7 +664,7 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 			vac_update_relstats(Irel[ind],
 								RelationGetNumberOfBlocks(Irel[ind]),
 								totalindexrows,
-								0,
+								0, 0,
 								false,
 								InvalidTransactionId,
 								InvalidMultiXactId,
@@ -676,13 +678,13 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 		 * in their pg_class entries except for reltuples and relhasindex.
 		 */
 		vac_update_relstats(onerel, -1, totalrows,
-							0, hasindex, InvalidTransactionId,
+							0, 0, hasindex, InvalidTransactionId,
 							InvalidMultiXactId,
 							in_outer_xact);
 	}
 
 	/*
-	 * Now report ANALYZE to the stats collector.  For regular tables, we do
+	 * Now report ANALYZE to the stats system.  For regular tables, we do
 	 * it only if not doing inherited stats.  For partitioned tables, we only
 	 * do it for inherited stats. (We're never called for not-inherited stats
 	 * on partitioned tables anyway.)
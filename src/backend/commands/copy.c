@@ -33,6 +33,7 @@
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
+#include "postmaster/bgworker_internals.h"
 #include "rewrite/rewriteHandler.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -338,6 +339,8 @@ ProcessCopyOptions(ParseState *pstate,
 	bool		format_specified = false;
 	bool		freeze_specified = false;
 	bool		header_specified = false;
+	bool		parallel_specified = false;
+	bool		compression_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -364,6 +367,12 @@ ProcessCopyOptions(ParseState *pstate,
 				opts_out->csv_mode = true;
 			else if (strcmp(fmt, "binary") == 0)
 				opts_out->binary = true;
+			else if (strcmp(fmt, "arrow") == 0)
+			{
+				/* arrow output is binary data, with all that that implies */
+				opts_out->binary = true;
+				opts_out->arrow = true;
+			}
 			else
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -468,6 +477,48 @@ ProcessCopyOptions(ParseState *pstate,
 								defel->defname),
 						 parser_errposition(pstate, defel->location)));
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (parallel_specified)
+				errorConflictingDefElem(defel, pstate);
+			parallel_specified = true;
+			opts_out->nworkers = defGetInt32(defel);
+			if (opts_out->nworkers < 0 ||
+				opts_out->nworkers > MAX_PARALLEL_WORKER_LIMIT)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("parallel workers for COPY must be between 0 and %d",
+								MAX_PARALLEL_WORKER_LIMIT),
+						 parser_errposition(pstate, defel->location)));
+		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = defGetString(defel);
+
+			if (compression_specified)
+				errorConflictingDefElem(defel, pstate);
+			compression_specified = true;
+			if (pg_strcasecmp(method, "none") == 0)
+				opts_out->compression = COPY_COMPRESSION_NONE;
+			else if (pg_strcasecmp(method, "lz4") == 0)
+			{
+#ifndef USE_LZ4
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression method lz4 not supported"),
+						 errdetail("This functionality requires the server to be built with lz4 support."),
+						 errhint("You need to rebuild PostgreSQL using %s.", "--with-lz4"),
+						 parser_errposition(pstate, defel->location)));
+#endif
+				opts_out->compression = COPY_COMPRESSION_LZ4;
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("COPY compression method \"%s\" not recognized",
+								method),
+						 parser_errposition(pstate, defel->location)));
+		}
 		else if (strcmp(defel->defname, "encoding") == 0)
 		{
 			if (opts_out->file_encoding >= 0)
@@ -618,6 +669,23 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (opts_out->nworkers > 0 && !is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY PARALLEL only available using COPY FROM")));
+
+	/* Check arrow format and compression */
+	if (opts_out->arrow && is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY format \"%s\" only available using COPY TO",
+						"arrow")));
+	if (compression_specified && !opts_out->arrow)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY compression available only in arrow format")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(opts_out->null_print, opts_out->delim[0]) != NULL)
 		ereport(ERROR,
@@ -26,6 +26,7 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
@@ -583,6 +584,17 @@ CopyFrom(CopyFromState cstate)
 							RelationGetRelationName(cstate->rel))));
 	}
 
+	/*
+	 * If parallel workers were requested, let them do the work instead, if
+	 * it's safe.  Otherwise quietly fall back to doing it all ourselves.
+	 */
+	if (cstate->opts.nworkers > 0 && !IsParallelWorker() &&
+		CopyFromParallelOK(cstate))
+	{
+		FreeExecutorState(estate);
+		return ParallelCopyFrom(cstate);
+	}
+
 	/*
 	 * If the target file is new-in-transaction, we assume that checking FSM
 	 * for free space is a waste of time.  This could possibly be wrong, but
@@ -1340,6 +1352,10 @@ BeginCopyFrom(ParseState *pstate,
 
 	cstate->whereClause = whereClause;
 
+	/* Remember these for parallel COPY FROM workers */
+	cstate->attnamelist = attnamelist;
+	cstate->options = options;
+
 	MemoryContextSwitchTo(oldcontext);
 
 	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
@@ -0,0 +1,556 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyfromparallel.c
+ *		Parallel COPY FROM, with the workers parsing and inserting the data.
+ *
+ * The leader process reads the input and splits it into lines, which has to
+ * be done serially: whether a newline ends a line depends on quoting and
+ * escaping earlier in the input, and encoding conversion has to know where
+ * multibyte characters start.  Everything after that -- splitting the lines
+ * into fields, running the input functions, evaluating defaults, WHERE and
+ * constraints, and inserting the tuples and index entries -- is done by the
+ * parallel workers, each with its own CopyFromState.
+ *
+ * The leader hands out the lines in chunks of roughly PARALLEL_COPY_CHUNK_SIZE
+ * bytes, round-robin, through one shm_mq per worker.  Each line is sent as
+ * its line number (for error messages) and length, followed by the line's
+ * contents.  When the input is exhausted, the leader detaches from the
+ * queues, which the workers see as end of input.
+ *
+ * All participants insert with the leader's transaction ID and command ID,
+ * so the leader must have assigned both before starting the workers.
+ * CopyFromParallelOK() decides whether that's safe, which mostly comes down
+ * to not running any code that's not parallel safe in the workers.
+ *
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyfromparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/copy.h"
+#include "commands/copyfrom_internal.h"
+#include "commands/progress.h"
+#include "executor/instrument.h"
+#include "optimizer/clauses.h"
+#include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "rewrite/rewriteHandler.h"
+#include "storage/shm_mq.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_COPY_KEY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_COPY_KEY_WHERE_CLAUSE	UINT64CONST(0xC000000000000002)
+#define PARALLEL_COPY_KEY_ATTNAMELIST	UINT64CONST(0xC000000000000003)
+#define PARALLEL_COPY_KEY_OPTIONS		UINT64CONST(0xC000000000000004)
+#define PARALLEL_COPY_KEY_QUEUES		UINT64CONST(0xC000000000000005)
+#define PARALLEL_COPY_KEY_QUERY_TEXT	UINT64CONST(0xC000000000000006)
+#define PARALLEL_COPY_KEY_WAL_USAGE		UINT64CONST(0xC000000000000007)
+#define PARALLEL_COPY_KEY_BUFFER_USAGE	UINT64CONST(0xC000000000000008)
+
+/* Size of each worker's queue */
+#define PARALLEL_COPY_QUEUE_SIZE		(256 * 1024)
+
+/* Target amount of line data to send to a worker at a time */
+#define PARALLEL_COPY_CHUNK_SIZE		(64 * 1024)
+
+/*
+ * Shared state for parallel COPY FROM.
+ */
+typedef struct ParallelCopyShared
+{
+	/* Immutable state */
+	Oid			relid;			/* target relation */
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	uint64		processed;		/* tuples inserted by the workers */
+} ParallelCopyShared;
+
+/*
+ * Worker-local state: the queue we get our lines from, and the chunk of
+ * lines we're currently working through.
+ */
+typedef struct ParallelCopyWorker
+{
+	shm_mq_handle *mqh;
+	char	   *data;			/* current chunk, or NULL */
+	Size		len;			/* length of current chunk */
+	Size		pos;			/* next unread byte in current chunk */
+} ParallelCopyWorker;
+
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
+
+/*
+ * Can this COPY FROM be done by parallel workers?
+ *
+ * Anything the workers do on their own must be parallel safe: the input
+ * functions, default expressions, the WHERE clause, check constraints, and
+ * index expressions and predicates.  Triggers, which might do anything, are
+ * not allowed at all, and neither are targets that the workers can't insert
+ * into on their own, such as partitioned, foreign and temporary tables.
+ * Binary input and FREEZE are left to the single-process path too.
+ */
+bool
+CopyFromParallelOK(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	List	   *indexoidlist;
+	ListCell   *lc;
+	int			i;
+
+	/* Only text and CSV input can be split into lines up front */
+	if (cstate->opts.binary)
+		return false;
+
+	/* FREEZE depends on relcache state only the leader has */
+	if (cstate->opts.freeze)
+		return false;
+
+	/* Predicate locking is not parallel-aware for inserts */
+	if (IsInParallelMode() || IsolationIsSerializable())
+		return false;
+
+	/* Only plain heap tables, which the workers can reach */
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->rd_rel->relam != HEAP_TABLE_AM_OID ||
+		RelationUsesLocalBuffers(rel))
+		return false;
+
+	/* No triggers, including foreign key checks */
+	if (rel->trigdesc != NULL)
+		return false;
+
+	if (cstate->whereClause && !is_parallel_safe_expr(cstate->whereClause))
+		return false;
+
+	for (i = 0; i < cstate->num_defaults; i++)
+	{
+		if (!is_parallel_safe_expr((Node *) cstate->defexprs[i]->expr))
+			return false;
+	}
+
+	for (i = 0; i < tupDesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, i);
+		Oid			elemtype;
+
+		if (att->attisdropped)
+			continue;
+
+		/* Domain constraints are checked by the input functions */
+		if (get_typtype(att->atttypid) == TYPTYPE_DOMAIN)
+			return false;
+		elemtype = get_element_type(att->atttypid);
+		if (OidIsValid(elemtype) && get_typtype(elemtype) == TYPTYPE_DOMAIN)
+			return false;
+
+		if (func_parallel(cstate->in_functions[i].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+
+		if (att->attgenerated &&
+			!is_parallel_safe_expr(build_column_default(rel, i + 1)))
+			return false;
+	}
+
+	if (tupDesc->constr)
+	{
+		for (i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			Node	   *checkexpr;
+
+			checkexpr = stringToNode(tupDesc->constr->check[i].ccbin);
+			if (!is_parallel_safe_expr(checkexpr))
+				return false;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel;
+		bool		safe;
+
+		/* Same lock as ExecOpenIndices() will take */
+		indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+		safe = is_parallel_safe_expr((Node *) RelationGetIndexExpressions(indexRel)) &&
+			is_parallel_safe_expr((Node *) RelationGetIndexPredicate(indexRel));
+		index_close(indexRel, NoLock);
+
+		if (!safe)
+		{
+			list_free(indexoidlist);
+			return false;
+		}
+	}
+	list_free(indexoidlist);
+
+	return true;
+}
+
+/*
+ * Run a COPY FROM with parallel workers.
+ *
+ * The leader only reads and splits up the input; the workers do the rest.
+ * If no workers can be launched, we fall back to CopyFrom().
+ *
+ * Returns the number of tuples inserted.
+ */
+uint64
+ParallelCopyFrom(CopyFromState cstate)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *pcshared;
+	shm_mq_handle **mqh;
+	char	   *whereclausestr;
+	char	   *attnamestr;
+	char	   *optionsstr;
+	char	   *sharedstr;
+	char	   *queuespace;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	ErrorContextCallback errcallback;
+	StringInfoData buf;
+	int			querylen;
+	int			nworkers;
+	int			next_worker = 0;
+	uint64		processed;
+	bool		found;
+	int			i;
+
+	/*
+	 * The workers insert with our transaction ID and command ID, and can't
+	 * assign either themselves, so make sure both are set up before they're
+	 * passed on to the workers.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->opts.nworkers);
+
+	whereclausestr = nodeToString(cstate->whereClause);
+	attnamestr = nodeToString(cstate->attnamelist);
+	optionsstr = nodeToString(cstate->options);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(whereclausestr) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(attnamestr) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(optionsstr) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 5);
+
+	/* Estimate space for WalUsage and BufferUsage */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment or workers are available, do it all ourselves */
+	if (pcxt->seg == NULL || pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		cstate->opts.nworkers = 0;
+		return CopyFrom(cstate);
+	}
+
+	pcshared = (ParallelCopyShared *)
+		shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyShared));
+	pcshared->relid = RelationGetRelid(cstate->rel);
+	SpinLockInit(&pcshared->mutex);
+	pcshared->processed = 0;
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, pcshared);
+
+	sharedstr = shm_toc_allocate(pcxt->toc, strlen(whereclausestr) + 1);
+	strcpy(sharedstr, whereclausestr);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WHERE_CLAUSE, sharedstr);
+	sharedstr = shm_toc_allocate(pcxt->toc, strlen(attnamestr) + 1);
+	strcpy(sharedstr, attnamestr);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_ATTNAMELIST, sharedstr);
+	sharedstr = shm_toc_allocate(pcxt->toc, strlen(optionsstr) + 1);
+	strcpy(sharedstr, optionsstr);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_OPTIONS, sharedstr);
+
+	if (debug_query_string)
+	{
+		sharedstr = shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedstr, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, sharedstr);
+	}
+
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Create a queue for each worker, with us as the sender */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+	mqh = (shm_mq_handle **) palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	LaunchParallelWorkers(pcxt);
+	nworkers = pcxt->nworkers_launched;
+
+	if (nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		cstate->opts.nworkers = 0;
+		return CopyFrom(cstate);
+	}
+
+	/* Notice if a worker fails to start, rather than waiting for it */
+	for (i = 0; i < nworkers; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+
+	/*
+	 * Set up callback to identify error line number.  Errors reported by the
+	 * workers carry their own context, so only install it while reading.
+	 */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+
+	initStringInfo(&buf);
+	do
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+		found = NextCopyFromLine(cstate);
+		error_context_stack = errcallback.previous;
+
+		if (found)
+		{
+			uint32		len = cstate->line_buf.len;
+
+			appendBinaryStringInfo(&buf, (char *) &cstate->cur_lineno,
+								   sizeof(uint64));
+			appendBinaryStringInfo(&buf, (char *) &len, sizeof(uint32));
+			appendBinaryStringInfo(&buf, cstate->line_buf.data, len);
+		}
+
+		if (buf.len >= PARALLEL_COPY_CHUNK_SIZE || (!found && buf.len > 0))
+		{
+			shm_mq_result res;
+
+			res = shm_mq_send(mqh[next_worker], buf.len, buf.data,
+							  false, true);
+			if (res != SHM_MQ_SUCCESS)
+			{
+				/*
+				 * The worker has gone away.  If that's because of an error,
+				 * waiting for the workers will report it.
+				 */
+				for (i = 0; i < nworkers; i++)
+					shm_mq_detach(mqh[i]);
+				WaitForParallelWorkersToFinish(pcxt);
+				elog(ERROR, "could not send data to parallel COPY worker");
+			}
+			next_worker = (next_worker + 1) % nworkers;
+			resetStringInfo(&buf);
+		}
+	} while (found);
+
+	/* Let the workers know there's no more input, and wait for them */
+	for (i = 0; i < nworkers; i++)
+		shm_mq_detach(mqh[i]);
+	WaitForParallelWorkersToFinish(pcxt);
+
+	for (i = 0; i < nworkers; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	processed = pcshared->processed;
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processed);
+
+	pfree(buf.data);
+
+	return processed;
+}
+
+/*
+ * Get the next line from the leader into line_buf, in a parallel COPY FROM
+ * worker.  Returns false when there are no more lines.
+ */
+bool
+ParallelCopyNextLine(CopyFromState cstate)
+{
+	ParallelCopyWorker *pcworker = cstate->pcworker;
+	uint32		len;
+
+	if (pcworker->pos >= pcworker->len)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(pcworker->mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return false;
+		Assert(res == SHM_MQ_SUCCESS);
+
+		pcworker->data = data;
+		pcworker->len = nbytes;
+		pcworker->pos = 0;
+	}
+
+	memcpy(&cstate->cur_lineno, pcworker->data + pcworker->pos,
+		   sizeof(uint64));
+	pcworker->pos += sizeof(uint64);
+	memcpy(&len, pcworker->data + pcworker->pos, sizeof(uint32));
+	pcworker->pos += sizeof(uint32);
+	Assert(pcworker->pos + len <= pcworker->len);
+
+	resetStringInfo(&cstate->line_buf);
+	appendBinaryStringInfo(&cstate->line_buf, pcworker->data + pcworker->pos,
+						   len);
+	pcworker->pos += len;
+
+	/* Now it's safe to use the buffer in error messages */
+	cstate->line_buf_valid = true;
+
+	return true;
+}
+
+/*
+ * Data source callback for the workers' CopyFromStates.  The workers get
+ * whole lines from the leader, so they never read any input themselves.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "unexpected read in parallel COPY worker");
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *pcshared;
+	ParallelCopyWorker pcworker;
+	char	   *sharedquery;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	Relation	rel;
+	ParseState *pstate;
+	Node	   *whereClause;
+	List	   *attnamelist;
+	List	   *options;
+	CopyFromState cstate;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	uint64		processed;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	pcshared = shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED, false);
+
+	/* Attach to our queue */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace + ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	pcworker.mqh = shm_mq_attach(mq, seg, NULL);
+	pcworker.data = NULL;
+	pcworker.len = 0;
+	pcworker.pos = 0;
+
+	/*
+	 * We insert with the leader's command ID, which it marked as used before
+	 * launching us, and it has checked that nothing we run needs a new one.
+	 */
+	ParallelWorkerInsertsAllowed = true;
+
+	/* Open the relation with the same lock the leader holds */
+	rel = table_open(pcshared->relid, RowExclusiveLock);
+
+	pstate = make_parsestate(NULL);
+	(void) addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										 NULL, false, false);
+
+	whereClause = stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_WHERE_CLAUSE, false));
+	attnamelist = stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_ATTNAMELIST, false));
+	options = stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_OPTIONS, false));
+
+	cstate = BeginCopyFrom(pstate, rel, whereClause, NULL, false,
+						   ParallelCopyNoData, attnamelist, options);
+	cstate->pcworker = &pcworker;
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	processed = CopyFrom(cstate);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	EndCopyFrom(cstate);
+
+	SpinLockAcquire(&pcshared->mutex);
+	pcshared->processed += processed;
+	SpinLockRelease(&pcshared->mutex);
+
+	shm_mq_detach(pcworker.mqh);
+	free_parsestate(pstate);
+	table_close(rel, RowExclusiveLock);
+}
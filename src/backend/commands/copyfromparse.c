@@ -72,6 +72,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -143,6 +144,65 @@ if (1) \
 	goto not_end_of_copy; \
 } else ((void) 0)
 
+/*
+ * Return the number of bytes at the start of s[0 .. len - 1] that are none of
+ * c1 .. c4, which is how far the parsing loops below can skip ahead without
+ * looking at each byte.  Callers needing fewer than four special characters
+ * repeat one of them.
+ *
+ * This looks at a vector's worth of bytes at a time, which pays off for long
+ * text fields; once a vector contains a special character, we fall back to
+ * checking one byte at a time to find it.
+ */
+static inline int
+CopySkipOrdinaryChars(const char *s, int len, char c1, char c2, char c3, char c4)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	const Vector8 v1 = vector8_broadcast((uint8) c1);
+	const Vector8 v2 = vector8_broadcast((uint8) c2);
+	const Vector8 v3 = vector8_broadcast((uint8) c3);
+	const Vector8 v4 = vector8_broadcast((uint8) c4);
+
+	for (; i + (int) sizeof(Vector8) <= len; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+		Vector8		match;
+
+		vector8_load(&chunk, (const uint8 *) s + i);
+		match = vector8_or(vector8_or(vector8_eq(chunk, v1),
+									  vector8_eq(chunk, v2)),
+						   vector8_or(vector8_eq(chunk, v3),
+									  vector8_eq(chunk, v4)));
+		if (vector8_is_highbit_set(match))
+			break;
+	}
+#else
+	for (; i + (int) sizeof(Vector8) <= len; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) s + i);
+		if (vector8_has(chunk, (uint8) c1) ||
+			vector8_has(chunk, (uint8) c2) ||
+			vector8_has(chunk, (uint8) c3) ||
+			vector8_has(chunk, (uint8) c4))
+			break;
+	}
+#endif
+
+	for (; i < len; i++)
+	{
+		char		c = s[i];
+
+		if (c == c1 || c == c2 || c == c3 || c == c4)
+			break;
+	}
+
+	return i;
+}
+
 /* NOTE: there's a copy of this in copyto.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
@@ -739,25 +799,23 @@ CopyReadBinaryData(CopyFromState cstate, char *dest, int nbytes)
 }
 
 /*
- * Read raw fields in the next line for COPY FROM in text or csv mode.
+ * Read the next line for COPY FROM in text or csv mode into line_buf.
  * Return false if no more lines.
  *
- * An internal temporary buffer is returned via 'fields'. It is valid until
- * the next call of the function. Since the function returns all raw fields
- * in the input file, 'nfields' could be different from the number of columns
- * in the relation.
- *
- * NOTE: force_not_null option are not applied to the returned fields.
+ * This skips the header line, if any, and keeps cur_lineno up to date.  In a
+ * parallel COPY FROM worker, the lines come from the leader instead.
  */
 bool
-NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+NextCopyFromLine(CopyFromState cstate)
 {
-	int			fldct;
 	bool		done;
 
 	/* only available for text or csv input */
 	Assert(!cstate->opts.binary);
 
+	if (cstate->pcworker != NULL)
+		return ParallelCopyNextLine(cstate);
+
 	/* on input just throw the header line away */
 	if (cstate->cur_lineno == 0 && cstate->opts.header_line)
 	{
@@ -779,6 +837,28 @@ NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
 	if (done && cstate->line_buf.len == 0)
 		return false;
 
+	return true;
+}
+
+/*
+ * Read raw fields in the next line for COPY FROM in text or csv mode.
+ * Return false if no more lines.
+ *
+ * An internal temporary buffer is returned via 'fields'. It is valid until
+ * the next call of the function. Since the function returns all raw fields
+ * in the input file, 'nfields' could be different from the number of columns
+ * in the relation.
+ *
+ * NOTE: force_not_null option are not applied to the returned fields.
+ */
+bool
+NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+{
+	int			fldct;
+
+	if (!NextCopyFromLine(cstate))
+		return false;
+
 	/* Parse the line into de-escaped field values */
 	if (cstate->opts.csv_mode)
 		fldct = CopyReadAttributesCSV(cstate);
@@ -1155,6 +1235,35 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip over any run of characters that can't end the line or change
+		 * the CSV quoting state.  They all stay in the line, so this needs no
+		 * state changes except that an escape character can't be pending
+		 * anymore.  The first character of a line is left to the code below,
+		 * because it can start an end-of-copy marker.
+		 */
+		if (!first_char_in_line)
+		{
+			int			nskip;
+
+			if (cstate->opts.csv_mode)
+				nskip = CopySkipOrdinaryChars(copy_input_buf + input_buf_ptr,
+											  copy_buf_len - input_buf_ptr,
+											  '\n', '\r', quotec,
+											  escapec ? escapec : quotec);
+			else
+				nskip = CopySkipOrdinaryChars(copy_input_buf + input_buf_ptr,
+											  copy_buf_len - input_buf_ptr,
+											  '\n', '\r', '\\', '\\');
+			if (nskip > 0)
+			{
+				input_buf_ptr += nskip;
+				last_was_esc = false;
+				if (input_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1505,6 +1614,17 @@ CopyReadAttributesText(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			int			nskip;
+
+			/* Copy any run of characters needing no de-escaping in one go */
+			nskip = CopySkipOrdinaryChars(cur_ptr, line_end_ptr - cur_ptr,
+										  delimc, '\\', '\\', '\\');
+			if (nskip > 0)
+			{
+				memcpy(output_ptr, cur_ptr, nskip);
+				output_ptr += nskip;
+				cur_ptr += nskip;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -1735,6 +1855,18 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				int			nskip;
+
+				/* Copy any run of ordinary characters in one go */
+				nskip = CopySkipOrdinaryChars(cur_ptr, line_end_ptr - cur_ptr,
+											  delimc, quotec, quotec, quotec);
+				if (nskip > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nskip);
+					output_ptr += nskip;
+					cur_ptr += nskip;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -1758,6 +1890,18 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* In quote */
 			for (;;)
 			{
+				int			nskip;
+
+				/* Likewise, up to the next quote or escape character */
+				nskip = CopySkipOrdinaryChars(cur_ptr, line_end_ptr - cur_ptr,
+											  quotec, escapec, escapec, escapec);
+				if (nskip > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nskip);
+					output_ptr += nskip;
+					cur_ptr += nskip;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -24,6 +24,7 @@
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "commands/copy.h"
+#include "commands/copytoarrow.h"
 #include "commands/progress.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
@@ -95,6 +96,7 @@ typedef struct CopyToStateData
 	MemoryContext copycontext;	/* per-copy execution context */
 
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
+	ArrowWriter *arrow;			/* column batches, in arrow format */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 	uint64		bytes_processed;	/* number of bytes processed so far */
 
@@ -794,22 +796,32 @@ DoCopyTo(CopyToState cstate)
 
 	/* Get info about the columns we need to process. */
 	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
-	foreach(cur, cstate->attnumlist)
+	if (cstate->opts.arrow)
 	{
-		int			attnum = lfirst_int(cur);
-		Oid			out_func_oid;
-		bool		isvarlena;
-		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
-
-		if (cstate->opts.binary)
-			getTypeBinaryOutputInfo(attr->atttypid,
-									&out_func_oid,
-									&isvarlena);
-		else
-			getTypeOutputInfo(attr->atttypid,
-							  &out_func_oid,
-							  &isvarlena);
-		fmgr_info(out_func_oid, &cstate->out_functions[attnum - 1]);
+		/* the arrow writer looks after its own conversions */
+		cstate->arrow = ArrowWriterCreate(tupDesc, cstate->attnumlist,
+										  cstate->opts.compression ==
+										  COPY_COMPRESSION_LZ4);
+	}
+	else
+	{
+		foreach(cur, cstate->attnumlist)
+		{
+			int			attnum = lfirst_int(cur);
+			Oid			out_func_oid;
+			bool		isvarlena;
+			Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+
+			if (cstate->opts.binary)
+				getTypeBinaryOutputInfo(attr->atttypid,
+										&out_func_oid,
+										&isvarlena);
+			else
+				getTypeOutputInfo(attr->atttypid,
+								  &out_func_oid,
+								  &isvarlena);
+			fmgr_info(out_func_oid, &cstate->out_functions[attnum - 1]);
+		}
 	}
 
 	/*
@@ -822,7 +834,13 @@ DoCopyTo(CopyToState cstate)
 											   "COPY TO",
 											   ALLOCSET_DEFAULT_SIZES);
 
-	if (cstate->opts.binary)
+	if (cstate->opts.arrow)
+	{
+		/* Generate the schema message for an arrow copy */
+		ArrowWriteSchema(cstate->arrow, cstate->fe_msgbuf);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate header for a binary copy */
 		int32		tmp;
@@ -908,7 +926,13 @@ DoCopyTo(CopyToState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->opts.binary)
+	if (cstate->opts.arrow)
+	{
+		/* Write out the last batch, and the end-of-stream marker */
+		ArrowWriteEndOfStream(cstate->arrow, cstate->fe_msgbuf);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -939,6 +963,16 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 	MemoryContextReset(cstate->rowcontext);
 	oldcontext = MemoryContextSwitchTo(cstate->rowcontext);
 
+	if (cstate->opts.arrow)
+	{
+		/* Add the row to the current batch, and send any batch written */
+		slot_getallattrs(slot);
+		if (ArrowWriterAppend(cstate->arrow, slot, cstate->fe_msgbuf))
+			CopySendEndOfRow(cstate);
+		MemoryContextSwitchTo(oldcontext);
+		return;
+	}
+
 	if (cstate->opts.binary)
 	{
 		/* Binary per-tuple header */
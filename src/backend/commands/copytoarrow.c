@@ -0,0 +1,916 @@
+/*-------------------------------------------------------------------------
+ *
+ * copytoarrow.c
+ *		Write COPY TO output as an Apache Arrow IPC stream
+ *
+ * The Arrow IPC streaming format consists of a Schema message describing
+ * the columns, followed by any number of RecordBatch messages, followed by
+ * an end-of-stream marker.  Each RecordBatch carries a block of rows stored
+ * column by column: for each column a validity bitmap, and either a vector
+ * of fixed-width values or a vector of offsets into a data buffer.
+ *
+ * Values of the common fixed-width types are copied straight out of the
+ * deformed slot into the column vectors, without calling any output
+ * function.  Text-like and bytea values are copied as-is (after encoding
+ * conversion to UTF-8 for text); values of any other type are converted
+ * with the type's text output function and sent as UTF-8 strings.
+ *
+ * The message headers are FlatBuffers.  We only need to write a handful of
+ * fixed table shapes, so rather than depending on a FlatBuffers library we
+ * encode them by hand: unlike the usual back-to-front builder, we write each
+ * table's vtable just before the table and the objects it points to after
+ * it, which keeps every offset pointing forwards as the format requires.
+ *
+ * Optionally, each body buffer is compressed with LZ4 using Arrow's
+ * buffer-level compression (the LZ4_FRAME codec).
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copytoarrow.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "catalog/pg_type.h"
+#include "commands/copytoarrow.h"
+#include "common/int.h"
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "mb/pg_wchar.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/*
+ * A RecordBatch is emitted once it holds this many rows, or before adding a
+ * row would take the body of the batch, summed over all columns, past
+ * ARROW_BATCH_BODY_BYTES.  A single row larger than that gets a batch of its
+ * own, but we refuse rows above ARROW_MAX_ROW_BYTES, so that the body plus
+ * room for compressing it stays well within MaxAllocSize.
+ */
+#define ARROW_BATCH_ROWS		65536
+#define ARROW_BATCH_BODY_BYTES	(64 * 1024 * 1024)
+#define ARROW_MAX_ROW_BYTES		(MaxAllocSize / 4)
+
+/* Arrow metadata constants, from Schema.fbs and Message.fbs */
+#define ARROW_METADATA_V5			4
+#define ARROW_HEADER_SCHEMA			1
+#define ARROW_HEADER_RECORDBATCH	3
+
+#define ARROW_TYPE_INT				2
+#define ARROW_TYPE_FLOATINGPOINT	3
+#define ARROW_TYPE_BINARY			4
+#define ARROW_TYPE_UTF8				5
+#define ARROW_TYPE_BOOL				6
+#define ARROW_TYPE_DATE				8
+#define ARROW_TYPE_TIMESTAMP		10
+
+#define ARROW_PRECISION_SINGLE		1
+#define ARROW_PRECISION_DOUBLE		2
+#define ARROW_DATEUNIT_DAY			0
+#define ARROW_TIMEUNIT_MICROSECOND	2
+#define ARROW_COMPRESSION_LZ4_FRAME	0
+#define ARROW_COMPRESSION_BUFFER	0
+
+/* Marker that precedes the length of every encapsulated message */
+#define ARROW_CONTINUATION			0xFFFFFFFF
+
+/* Offset between the Unix epoch used by Arrow and the Postgres epoch */
+#define UNIX_EPOCH_DATE_OFFSET	(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE)
+#define UNIX_EPOCH_TS_OFFSET	((int64) UNIX_EPOCH_DATE_OFFSET * USECS_PER_DAY)
+
+/* How we store each column */
+typedef enum ArrowColumnKind
+{
+	ARROW_COL_BOOL,				/* bit-packed booleans */
+	ARROW_COL_INT,				/* int2, int4, int8 */
+	ARROW_COL_FLOAT,			/* float4, float8 */
+	ARROW_COL_DATE,				/* days since 1970-01-01 */
+	ARROW_COL_TIMESTAMP,		/* microseconds since 1970-01-01 */
+	ARROW_COL_TEXT,				/* text-like varlena, as UTF-8 */
+	ARROW_COL_NAME,				/* name, as UTF-8 */
+	ARROW_COL_BYTEA,			/* bytea, as binary */
+	ARROW_COL_OUTPUT			/* anything else, via its output function */
+} ArrowColumnKind;
+
+typedef struct ArrowColumn
+{
+	AttrNumber	attnum;			/* attribute number in the tuple */
+	char	   *name;			/* column name, in UTF-8 */
+	ArrowColumnKind kind;
+	int			width;			/* value width for fixed-width kinds */
+	bool		withtz;			/* for ARROW_COL_TIMESTAMP: timestamptz? */
+	FmgrInfo	outfunc;		/* for ARROW_COL_OUTPUT */
+
+	/* buffers for the batch being accumulated */
+	int64		null_count;
+	StringInfoData validity;	/* one bit per row, set if not null */
+	StringInfoData values;		/* fixed-width values, or int32 offsets */
+	StringInfoData data;		/* variable-length data */
+} ArrowColumn;
+
+struct ArrowWriter
+{
+	int			ncolumns;
+	ArrowColumn *columns;
+	bool		compress;		/* LZ4-compress the body buffers? */
+	int			nrows;			/* rows in the current batch */
+	int64		body_bytes;		/* estimated body size of the batch */
+	MemoryContext tmpcxt;		/* reset after writing each message */
+
+	/* workspace for ArrowWriterAppend: converted variable-length values */
+	char	  **rowstrs;
+	int		   *rowlens;
+};
+
+/* A field of a FlatBuffers table; size 0 means the field is absent */
+typedef struct FBField
+{
+	int			size;
+	uint64		value;
+} FBField;
+
+#define FB_MAX_FIELDS	8
+
+
+/*
+ * Append a little-endian integer of the given size.
+ */
+static void
+fb_put(StringInfo buf, uint64 value, int size)
+{
+	for (int i = 0; i < size; i++)
+		appendStringInfoCharMacro(buf, (char) ((value >> (8 * i)) & 0xFF));
+}
+
+/*
+ * Append zero bytes until the length is congruent to 'rem' modulo 'align'.
+ */
+static void
+fb_pad(StringInfo buf, int align, int rem)
+{
+	while (buf->len % align != rem)
+		appendStringInfoCharMacro(buf, '\0');
+}
+
+/*
+ * Overwrite a little-endian integer of the given size at position 'at'.
+ */
+static void
+fb_set(StringInfo buf, int at, uint64 value, int size)
+{
+	Assert(at + size <= buf->len);
+	for (int i = 0; i < size; i++)
+		buf->data[at + i] = (char) ((value >> (8 * i)) & 0xFF);
+}
+
+/*
+ * Make the offset field at position 'at' point to position 'target'.
+ */
+static void
+fb_patch_offset(StringInfo buf, int at, int target)
+{
+	Assert(target > at);
+	fb_set(buf, at, (uint32) (target - at), 4);
+}
+
+/*
+ * Append a table with the given fields, preceded by its vtable, and return
+ * the table's position.  The position of each present field is returned in
+ * fieldpos[], so that the caller can patch offset fields once it has written
+ * the objects they point to.
+ *
+ * The fields are laid out largest first, and the table start is chosen so
+ * that each field ends up naturally aligned.
+ */
+static int
+fb_table(StringInfo buf, int nfields, const FBField *fields, int *fieldpos)
+{
+	int			fieldoff[FB_MAX_FIELDS];
+	int			tblsize = 4;	/* the soffset to the vtable */
+	bool		has8 = false;
+	int			vtable;
+	int			table;
+
+	Assert(nfields <= FB_MAX_FIELDS);
+
+	for (int size = 8; size > 0; size /= 2)
+	{
+		for (int i = 0; i < nfields; i++)
+		{
+			if (fields[i].size != size)
+				continue;
+			fieldoff[i] = tblsize;
+			tblsize += size;
+			if (size == 8)
+				has8 = true;
+		}
+	}
+
+	/* the vtable */
+	fb_pad(buf, 2, 0);
+	vtable = buf->len;
+	fb_put(buf, 4 + 2 * nfields, 2);
+	fb_put(buf, tblsize, 2);
+	for (int i = 0; i < nfields; i++)
+		fb_put(buf, fields[i].size > 0 ? fieldoff[i] : 0, 2);
+
+	/* the table, positioned so that any 8-byte fields are aligned */
+	if (has8)
+		fb_pad(buf, 8, 4);
+	else
+		fb_pad(buf, 4, 0);
+	table = buf->len;
+	fb_put(buf, table - vtable, 4);
+	for (int size = 8; size > 0; size /= 2)
+	{
+		for (int i = 0; i < nfields; i++)
+		{
+			if (fields[i].size != size)
+				continue;
+			fieldpos[i] = buf->len;
+			fb_put(buf, fields[i].value, size);
+		}
+	}
+
+	return table;
+}
+
+/*
+ * Append a string and return its position.
+ */
+static int
+fb_string(StringInfo buf, const char *str)
+{
+	int			len = strlen(str);
+	int			pos;
+
+	fb_pad(buf, 4, 0);
+	pos = buf->len;
+	fb_put(buf, len, 4);
+	appendBinaryStringInfo(buf, str, len + 1);
+	return pos;
+}
+
+/*
+ * Append a vector of 'n' offsets, to be patched by the caller, and return
+ * its position.  Element i lives at position + 4 + 4 * i.
+ */
+static int
+fb_offset_vector(StringInfo buf, int n)
+{
+	int			pos;
+
+	fb_pad(buf, 4, 0);
+	pos = buf->len;
+	fb_put(buf, n, 4);
+	for (int i = 0; i < n; i++)
+		fb_put(buf, 0, 4);
+	return pos;
+}
+
+/*
+ * Append a vector of structs consisting of two int64s each (FieldNode and
+ * Buffer both look like that), and return its position.
+ */
+static int
+fb_pair_vector(StringInfo buf, int n, const int64 *pairs)
+{
+	int			pos;
+
+	/* the elements must be 8-aligned, and follow the 4-byte length */
+	fb_pad(buf, 8, 4);
+	pos = buf->len;
+	fb_put(buf, n, 4);
+	for (int i = 0; i < 2 * n; i++)
+		fb_put(buf, (uint64) pairs[i], 8);
+	return pos;
+}
+
+/*
+ * Start a Message header, and return the position of its 'header' field.
+ * The root offset of the buffer is filled in here too.
+ */
+static int
+fb_message(StringInfo buf, int header_type, int64 bodyLength)
+{
+	FBField		fields[4];
+	int			pos[4];
+	int			msg;
+
+	fb_put(buf, 0, 4);			/* root offset */
+
+	fields[0] = (FBField) {2, ARROW_METADATA_V5};	/* version */
+	fields[1] = (FBField) {1, header_type}; /* header_type */
+	fields[2] = (FBField) {4, 0};	/* header */
+	fields[3] = (FBField) {8, bodyLength};	/* bodyLength */
+	msg = fb_table(buf, 4, fields, pos);
+	fb_patch_offset(buf, 0, msg);
+
+	return pos[2];
+}
+
+/*
+ * Append an encapsulated message: a continuation marker, the length of the
+ * metadata, the metadata itself padded to a multiple of 8 bytes, and the
+ * body (which must already be padded).
+ */
+static void
+arrow_write_message(StringInfo out, StringInfo meta, StringInfo body)
+{
+	fb_pad(meta, 8, 0);
+	fb_put(out, ARROW_CONTINUATION, 4);
+	fb_put(out, meta->len, 4);
+	appendBinaryStringInfo(out, meta->data, meta->len);
+	if (body)
+	{
+		Assert(body->len % 8 == 0);
+		appendBinaryStringInfo(out, body->data, body->len);
+	}
+}
+
+/*
+ * Set up to write the given columns of tuples with the given descriptor.
+ * The writer is allocated in the current memory context.
+ */
+ArrowWriter *
+ArrowWriterCreate(TupleDesc tupDesc, List *attnumlist, bool compress)
+{
+	ArrowWriter *writer = palloc0(sizeof(ArrowWriter));
+	ListCell   *cur;
+	int			i = 0;
+
+	writer->ncolumns = list_length(attnumlist);
+	writer->columns = palloc0(writer->ncolumns * sizeof(ArrowColumn));
+	writer->compress = compress;
+	writer->rowstrs = palloc0(writer->ncolumns * sizeof(char *));
+	writer->rowlens = palloc0(writer->ncolumns * sizeof(int));
+	writer->tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+										   "COPY TO arrow",
+										   ALLOCSET_DEFAULT_SIZES);
+
+	foreach(cur, attnumlist)
+	{
+		ArrowColumn *col = &writer->columns[i++];
+		Form_pg_attribute attr;
+		char	   *name;
+
+		col->attnum = lfirst_int(cur);
+		attr = TupleDescAttr(tupDesc, col->attnum - 1);
+		name = NameStr(attr->attname);
+		col->name = pstrdup(pg_server_to_any(name, strlen(name), PG_UTF8));
+
+		switch (getBaseType(attr->atttypid))
+		{
+			case BOOLOID:
+				col->kind = ARROW_COL_BOOL;
+				break;
+			case INT2OID:
+				col->kind = ARROW_COL_INT;
+				col->width = sizeof(int16);
+				break;
+			case INT4OID:
+				col->kind = ARROW_COL_INT;
+				col->width = sizeof(int32);
+				break;
+			case INT8OID:
+				col->kind = ARROW_COL_INT;
+				col->width = sizeof(int64);
+				break;
+			case FLOAT4OID:
+				col->kind = ARROW_COL_FLOAT;
+				col->width = sizeof(float4);
+				break;
+			case FLOAT8OID:
+				col->kind = ARROW_COL_FLOAT;
+				col->width = sizeof(float8);
+				break;
+			case DATEOID:
+				col->kind = ARROW_COL_DATE;
+				col->width = sizeof(int32);
+				break;
+			case TIMESTAMPTZOID:
+				col->withtz = true;
+				/* FALLTHROUGH */
+			case TIMESTAMPOID:
+				col->kind = ARROW_COL_TIMESTAMP;
+				col->width = sizeof(int64);
+				break;
+			case TEXTOID:
+			case VARCHAROID:
+			case BPCHAROID:
+				col->kind = ARROW_COL_TEXT;
+				break;
+			case NAMEOID:
+				col->kind = ARROW_COL_NAME;
+				break;
+			case BYTEAOID:
+				col->kind = ARROW_COL_BYTEA;
+				break;
+			default:
+				{
+					Oid			out_func_oid;
+					bool		isvarlena;
+
+					col->kind = ARROW_COL_OUTPUT;
+					getTypeOutputInfo(attr->atttypid, &out_func_oid,
+									  &isvarlena);
+					fmgr_info(out_func_oid, &col->outfunc);
+				}
+				break;
+		}
+
+		initStringInfo(&col->validity);
+		initStringInfo(&col->values);
+		initStringInfo(&col->data);
+		if (col->width == 0 && col->kind != ARROW_COL_BOOL)
+		{
+			int32		zero = 0;
+
+			/* offsets vector starts with the start of the first value */
+			appendBinaryStringInfo(&col->values, (char *) &zero, sizeof(int32));
+		}
+	}
+
+	return writer;
+}
+
+/*
+ * Write the Schema message.
+ */
+void
+ArrowWriteSchema(ArrowWriter *writer, StringInfo out)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(writer->tmpcxt);
+	StringInfoData meta;
+	FBField		fields[6];
+	int			pos[6];
+	int			header;
+	int			schema;
+	int			vec;
+
+	initStringInfo(&meta);
+	header = fb_message(&meta, ARROW_HEADER_SCHEMA, 0);
+
+	/* Schema: endianness, fields */
+#ifdef WORDS_BIGENDIAN
+	fields[0] = (FBField) {2, 1};
+#else
+	fields[0] = (FBField) {2, 0};
+#endif
+	fields[1] = (FBField) {4, 0};
+	schema = fb_table(&meta, 2, fields, pos);
+	fb_patch_offset(&meta, header, schema);
+
+	vec = fb_offset_vector(&meta, writer->ncolumns);
+	fb_patch_offset(&meta, pos[1], vec);
+
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+		int			type_type;
+		int			nargs = 0;
+		FBField		args[2];
+		int			argpos[2];
+		int			field;
+		int			type;
+
+		switch (col->kind)
+		{
+			case ARROW_COL_BOOL:
+				type_type = ARROW_TYPE_BOOL;
+				break;
+			case ARROW_COL_INT:
+				type_type = ARROW_TYPE_INT;
+				args[0] = (FBField) {4, col->width * 8};	/* bitWidth */
+				args[1] = (FBField) {1, 1}; /* is_signed */
+				nargs = 2;
+				break;
+			case ARROW_COL_FLOAT:
+				type_type = ARROW_TYPE_FLOATINGPOINT;
+				args[0] = (FBField) {2, col->width == sizeof(float4) ?
+					ARROW_PRECISION_SINGLE : ARROW_PRECISION_DOUBLE};
+				nargs = 1;
+				break;
+			case ARROW_COL_DATE:
+				type_type = ARROW_TYPE_DATE;
+				args[0] = (FBField) {2, ARROW_DATEUNIT_DAY};
+				nargs = 1;
+				break;
+			case ARROW_COL_TIMESTAMP:
+				type_type = ARROW_TYPE_TIMESTAMP;
+				args[0] = (FBField) {2, ARROW_TIMEUNIT_MICROSECOND};
+				args[1] = (FBField) {col->withtz ? 4 : 0, 0};	/* timezone */
+				nargs = 2;
+				break;
+			case ARROW_COL_BYTEA:
+				type_type = ARROW_TYPE_BINARY;
+				break;
+			default:
+				type_type = ARROW_TYPE_UTF8;
+				break;
+		}
+
+		/* Field: name, nullable, type_type, type, dictionary, children */
+		fields[0] = (FBField) {4, 0};
+		fields[1] = (FBField) {1, 1};
+		fields[2] = (FBField) {1, type_type};
+		fields[3] = (FBField) {4, 0};
+		fields[4] = (FBField) {0, 0};
+		fields[5] = (FBField) {4, 0};
+		field = fb_table(&meta, 6, fields, pos);
+		fb_patch_offset(&meta, vec + 4 + 4 * i, field);
+
+		fb_patch_offset(&meta, pos[0], fb_string(&meta, col->name));
+
+		type = fb_table(&meta, nargs, args, argpos);
+		fb_patch_offset(&meta, pos[3], type);
+		if (col->kind == ARROW_COL_TIMESTAMP && col->withtz)
+			fb_patch_offset(&meta, argpos[1], fb_string(&meta, "UTC"));
+
+		/* we never have children, but readers insist on the vector */
+		fb_patch_offset(&meta, pos[5], fb_offset_vector(&meta, 0));
+	}
+
+	arrow_write_message(out, &meta, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(writer->tmpcxt);
+}
+
+/*
+ * Append one row to the current batch.  All the columns must already have
+ * been deformed into the slot.
+ *
+ * If the batch is full, or adding this row would make its body too large,
+ * the batch is written to 'out' with ArrowWriteBatch().  Returns true if
+ * that happened, so that the caller can send the message on.
+ *
+ * This is called in a short-lived memory context; anything that must
+ * survive is stored in the column buffers.
+ */
+bool
+ArrowWriterAppend(ArrowWriter *writer, TupleTableSlot *slot, StringInfo out)
+{
+	int64		row_bytes = 0;
+	bool		written = false;
+	int			row;
+
+	/*
+	 * First work out how much this row adds to the body.  That requires
+	 * converting the variable-length values, which we keep for the second
+	 * pass.  Each row costs at most one byte of validity bitmap per column.
+	 */
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+		Datum		value = slot->tts_values[col->attnum - 1];
+		bool		isnull = slot->tts_isnull[col->attnum - 1];
+		char	   *str;
+		int			len;
+
+		row_bytes += 1;
+		if (col->kind == ARROW_COL_BOOL)
+		{
+			row_bytes += 1;
+			continue;
+		}
+		if (col->width > 0)
+		{
+			row_bytes += col->width;
+			continue;
+		}
+
+		row_bytes += sizeof(int32);
+		writer->rowstrs[i] = NULL;
+		writer->rowlens[i] = 0;
+		if (isnull)
+			continue;
+
+		if (col->kind == ARROW_COL_NAME)
+		{
+			str = NameStr(*DatumGetName(value));
+			len = strlen(str);
+		}
+		else if (col->kind == ARROW_COL_OUTPUT)
+		{
+			str = OutputFunctionCall(&col->outfunc, value);
+			len = strlen(str);
+		}
+		else
+		{
+			struct varlena *v = PG_DETOAST_DATUM_PACKED(value);
+
+			str = VARDATA_ANY(v);
+			len = VARSIZE_ANY_EXHDR(v);
+		}
+
+		if (col->kind != ARROW_COL_BYTEA)
+		{
+			char	   *cvt = pg_server_to_any(str, len, PG_UTF8);
+
+			if (cvt != str)
+			{
+				str = cvt;
+				len = strlen(cvt);
+			}
+		}
+		writer->rowstrs[i] = str;
+		writer->rowlens[i] = len;
+		row_bytes += len;
+	}
+
+	if (row_bytes > ARROW_MAX_ROW_BYTES)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too large to be written in arrow format")));
+
+	/* Send what we have first, if this row would not fit with it */
+	if (writer->nrows > 0 &&
+		writer->body_bytes + row_bytes > ARROW_BATCH_BODY_BYTES)
+	{
+		ArrowWriteBatch(writer, out);
+		written = true;
+	}
+
+	row = writer->nrows;
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+		Datum		value = slot->tts_values[col->attnum - 1];
+		bool		isnull = slot->tts_isnull[col->attnum - 1];
+
+		if (row % 8 == 0)
+			appendStringInfoCharMacro(&col->validity, '\0');
+		if (isnull)
+			col->null_count++;
+		else
+			col->validity.data[row / 8] |= 1 << (row % 8);
+
+		switch (col->kind)
+		{
+			case ARROW_COL_BOOL:
+				if (row % 8 == 0)
+					appendStringInfoCharMacro(&col->values, '\0');
+				if (!isnull && DatumGetBool(value))
+					col->values.data[row / 8] |= 1 << (row % 8);
+				break;
+
+			case ARROW_COL_INT:
+			case ARROW_COL_FLOAT:
+			case ARROW_COL_DATE:
+			case ARROW_COL_TIMESTAMP:
+				{
+					union
+					{
+						int16		i16;
+						int32		i32;
+						int64		i64;
+						float4		f4;
+						float8		f8;
+					}			v;
+
+					memset(&v, 0, sizeof(v));
+					if (!isnull)
+					{
+						switch (col->kind)
+						{
+							case ARROW_COL_INT:
+								if (col->width == sizeof(int16))
+									v.i16 = DatumGetInt16(value);
+								else if (col->width == sizeof(int32))
+									v.i32 = DatumGetInt32(value);
+								else
+									v.i64 = DatumGetInt64(value);
+								break;
+							case ARROW_COL_FLOAT:
+								if (col->width == sizeof(float4))
+									v.f4 = DatumGetFloat4(value);
+								else
+									v.f8 = DatumGetFloat8(value);
+								break;
+							case ARROW_COL_DATE:
+								/* infinities are kept as the extreme values */
+								v.i32 = DatumGetDateADT(value);
+								if (!DATE_NOT_FINITE(v.i32))
+									v.i32 += UNIX_EPOCH_DATE_OFFSET;
+								break;
+							default:
+								v.i64 = DatumGetTimestamp(value);
+								if (!TIMESTAMP_NOT_FINITE(v.i64) &&
+									pg_add_s64_overflow(v.i64,
+														UNIX_EPOCH_TS_OFFSET,
+														&v.i64))
+									ereport(ERROR,
+											(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+											 errmsg("timestamp out of range")));
+								break;
+						}
+					}
+					appendBinaryStringInfo(&col->values, (char *) &v,
+										   col->width);
+				}
+				break;
+
+			default:
+				{
+					int32		end;
+
+					if (writer->rowstrs[i] != NULL)
+						appendBinaryStringInfo(&col->data, writer->rowstrs[i],
+											   writer->rowlens[i]);
+					end = col->data.len;
+					appendBinaryStringInfo(&col->values, (char *) &end,
+										   sizeof(int32));
+				}
+				break;
+		}
+	}
+
+	writer->nrows++;
+	writer->body_bytes += row_bytes;
+
+	if (writer->nrows >= ARROW_BATCH_ROWS)
+	{
+		ArrowWriteBatch(writer, out);
+		written = true;
+	}
+
+	return written;
+}
+
+/*
+ * Append one buffer to a batch's body, compressing it if requested, and
+ * remember where it went in 'buffers'.
+ */
+static void
+arrow_add_buffer(ArrowWriter *writer, StringInfo body, int64 *buffers,
+				 const char *data, int len)
+{
+	int			start;
+
+	fb_pad(body, 8, 0);
+	start = body->len;
+
+	if (len == 0)
+	{
+		/* nothing to store, compressed or not */
+	}
+	else if (writer->compress)
+	{
+#ifdef USE_LZ4
+		size_t		bound = LZ4F_compressFrameBound(len, NULL);
+		size_t		clen;
+
+		/* the prefix is the uncompressed length, or -1 if left as is */
+		fb_put(body, 0, sizeof(int64));
+		enlargeStringInfo(body, bound);
+		clen = LZ4F_compressFrame(body->data + body->len, bound,
+								  data, len, NULL);
+		if (LZ4F_isError(clen))
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg_internal("lz4 compression failed: %s",
+									 LZ4F_getErrorName(clen))));
+
+		if (clen < (size_t) len)
+		{
+			body->len += clen;
+			body->data[body->len] = '\0';
+		}
+		else
+		{
+			appendBinaryStringInfo(body, data, len);
+			len = -1;
+		}
+		fb_set(body, start, (uint64) (int64) len, sizeof(int64));
+#else
+		elog(ERROR, "compression method lz4 not supported");
+#endif
+	}
+	else
+		appendBinaryStringInfo(body, data, len);
+
+	buffers[0] = start;
+	buffers[1] = body->len - start;
+}
+
+/*
+ * Write out the rows accumulated so far as a RecordBatch message, and reset
+ * for the next batch.  Does nothing if there are no rows.
+ */
+void
+ArrowWriteBatch(ArrowWriter *writer, StringInfo out)
+{
+	MemoryContext oldcontext;
+	StringInfoData meta;
+	StringInfoData body;
+	int64	   *nodes;
+	int64	   *buffers;
+	int			nbuffers = 0;
+	FBField		fields[4];
+	int			pos[4];
+	int			header;
+	int			batch;
+
+	if (writer->nrows == 0)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(writer->tmpcxt);
+
+	nodes = palloc(writer->ncolumns * 2 * sizeof(int64));
+	buffers = palloc(writer->ncolumns * 3 * 2 * sizeof(int64));
+
+	/* Lay out the body, column by column */
+	initStringInfo(&body);
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+
+		nodes[2 * i] = writer->nrows;
+		nodes[2 * i + 1] = col->null_count;
+
+		/* the validity bitmap may be omitted if there are no nulls */
+		arrow_add_buffer(writer, &body, &buffers[2 * nbuffers++],
+						 col->validity.data,
+						 col->null_count > 0 ? col->validity.len : 0);
+		arrow_add_buffer(writer, &body, &buffers[2 * nbuffers++],
+						 col->values.data, col->values.len);
+		if (col->kind != ARROW_COL_BOOL && col->width == 0)
+			arrow_add_buffer(writer, &body, &buffers[2 * nbuffers++],
+							 col->data.data, col->data.len);
+	}
+	fb_pad(&body, 8, 0);
+
+	/* Now the header describing it */
+	initStringInfo(&meta);
+	header = fb_message(&meta, ARROW_HEADER_RECORDBATCH, body.len);
+
+	/* RecordBatch: length, nodes, buffers, compression */
+	fields[0] = (FBField) {8, writer->nrows};
+	fields[1] = (FBField) {4, 0};
+	fields[2] = (FBField) {4, 0};
+	fields[3] = (FBField) {writer->compress ? 4 : 0, 0};
+	batch = fb_table(&meta, 4, fields, pos);
+	fb_patch_offset(&meta, header, batch);
+
+	fb_patch_offset(&meta, pos[1],
+					fb_pair_vector(&meta, writer->ncolumns, nodes));
+	fb_patch_offset(&meta, pos[2],
+					fb_pair_vector(&meta, nbuffers, buffers));
+	if (writer->compress)
+	{
+		FBField		comp[2];
+		int			comppos[2];
+
+		/* BodyCompression: codec, method */
+		comp[0] = (FBField) {1, ARROW_COMPRESSION_LZ4_FRAME};
+		comp[1] = (FBField) {1, ARROW_COMPRESSION_BUFFER};
+		fb_patch_offset(&meta, pos[3], fb_table(&meta, 2, comp, comppos));
+	}
+
+	arrow_write_message(out, &meta, &body);
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(writer->tmpcxt);
+
+	/* Reset the column buffers for the next batch */
+	writer->nrows = 0;
+	writer->body_bytes = 0;
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+
+		col->null_count = 0;
+		resetStringInfo(&col->validity);
+		resetStringInfo(&col->values);
+		resetStringInfo(&col->data);
+		if (col->kind != ARROW_COL_BOOL && col->width == 0)
+		{
+			int32		zero = 0;
+
+			appendBinaryStringInfo(&col->values, (char *) &zero, sizeof(int32));
+		}
+	}
+}
+
+/*
+ * Write out any pending rows, followed by the end-of-stream marker.
+ */
+void
+ArrowWriteEndOfStream(ArrowWriter *writer, StringInfo out)
+{
+	ArrowWriteBatch(writer, out);
+
+	fb_put(out, ARROW_CONTINUATION, 4);
+	fb_put(out, 0, 4);
+}
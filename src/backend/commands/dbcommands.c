@@ -941,7 +941,7 @@ dropdb(const char *dbname, bool missing_ok, bool force)
 	DropDatabaseBuffers(db_id);
 
 	/*
-	 * Tell the stats collector to forget it immediately, too.
+	 * Forget its statistics immediately, too.
 	 */
 	pgstat_drop_database(db_id);
 
@@ -1791,6 +1791,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(planstate, SeqScanState) &&
+				((SeqScanState *) planstate)->runtime_filter)
+				show_instrumentation_count("Rows Removed by Runtime Filter", 2,
+										   planstate, es);
 			break;
 		case T_Gather:
 			{
@@ -1818,6 +1822,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 
 				if (gather->single_copy || es->format != EXPLAIN_FORMAT_TEXT)
 					ExplainPropertyBool("Single Copy", gather->single_copy, es);
+				if (gather->ordered)
+					ExplainPropertyBool("Ordered", gather->ordered, es);
 			}
 			break;
 		case T_GatherMerge:
@@ -1975,6 +1981,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_agg_keys(castNode(AggState, planstate), ancestors, es);
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
 			show_hashagg_info((AggState *) planstate, es);
+			if (((Agg *) plan)->batched)
+				ExplainPropertyBool("Batched", true, es);
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
@@ -3043,6 +3051,11 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 											  worker_hi->nbatch_original);
 			hinstrument.space_peak = Max(hinstrument.space_peak,
 										 worker_hi->space_peak);
+			hinstrument.nradix = Max(hinstrument.nradix,
+									 worker_hi->nradix);
+			hinstrument.radix_partition_peak =
+				Max(hinstrument.radix_partition_peak,
+					worker_hi->radix_partition_peak);
 		}
 	}
 
@@ -3084,6 +3097,26 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 							 spacePeakKb);
 		}
 	}
+
+	if (hinstrument.nradix > 1)
+	{
+		long		partitionPeakKb = (hinstrument.radix_partition_peak + 1023) / 1024;
+
+		if (es->format != EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainPropertyInteger("Radix Partitions", NULL,
+								   hinstrument.nradix, es);
+			ExplainPropertyInteger("Largest Radix Partition", "kB",
+								   partitionPeakKb, es);
+		}
+		else
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str,
+							 "Radix Partitions: %d  Largest Partition: %ldkB\n",
+							 hinstrument.nradix, partitionPeakKb);
+		}
+	}
 }
 
 /*
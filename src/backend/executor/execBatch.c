@@ -0,0 +1,379 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Column-oriented batches of tuples, for batch execution mode
+ *
+ * In batch execution mode, a sequential scan hands its parent node up to
+ * TUPLE_BATCH_SIZE rows at a time, stored as one vector of Datums per column
+ * rather than one TupleTableSlot per row.  The scan's quals are evaluated a
+ * whole column at a time, producing a selection vector of the rows that
+ * passed.  That replaces a trip through ExecProcNode(), ExecScan() and the
+ * expression interpreter for every row with a few tight loops per batch.
+ *
+ * Batch quals are limited to clauses of the form "column op constant" (or
+ * the commutation), where the column is of a pass-by-value type and the
+ * operator's function is strict.  The planner only chooses batch mode when
+ * every qual has that form; see batch_agg_supported() in createplan.c.  The
+ * most common integer comparisons are evaluated without any function call.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/execBatch.h"
+#include "executor/executor.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/fmgroids.h"
+
+/* Comparisons evaluated without calling the operator's function */
+typedef enum BatchCompare
+{
+	BATCH_CMP_NONE,				/* call the function */
+	BATCH_CMP_EQ,
+	BATCH_CMP_NE,
+	BATCH_CMP_LT,
+	BATCH_CMP_LE,
+	BATCH_CMP_GT,
+	BATCH_CMP_GE
+} BatchCompare;
+
+typedef struct BatchQualClause
+{
+	AttrNumber	attno;			/* column compared */
+	Datum		constval;		/* constant it is compared with */
+	bool		const_first;	/* is the constant the left argument? */
+	BatchCompare cmp;			/* fast path, if any */
+	bool		is_int8;		/* fast path operates on int8, not int4 */
+	FunctionCallInfo fcinfo;	/* for BATCH_CMP_NONE */
+} BatchQualClause;
+
+struct BatchQual
+{
+	int			nclauses;
+	BatchQualClause clauses[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * Build a TupleBatch with vectors for the given columns of a relation with
+ * natts attributes.  The scan's target list, which must consist of plain
+ * Vars, determines how ExecStoreBatchRow() forms output rows.
+ */
+TupleBatch *
+ExecInitTupleBatch(AttrNumber natts, Bitmapset *attnos, List *targetlist)
+{
+	TupleBatch *batch = palloc0(sizeof(TupleBatch));
+	ListCell   *lc;
+	int			attno;
+	int			i;
+
+	batch->natts = natts;
+	batch->values = palloc0(sizeof(Datum *) * natts);
+	batch->isnull = palloc0(sizeof(bool *) * natts);
+	batch->columns = palloc(sizeof(AttrNumber) * Max(bms_num_members(attnos), 1));
+	batch->selection = palloc(sizeof(uint16) * TUPLE_BATCH_SIZE);
+
+	attno = -1;
+	while ((attno = bms_next_member(attnos, attno)) >= 0)
+	{
+		Assert(attno > 0 && attno <= natts);
+		batch->values[attno - 1] = palloc(sizeof(Datum) * TUPLE_BATCH_SIZE);
+		batch->isnull[attno - 1] = palloc(sizeof(bool) * TUPLE_BATCH_SIZE);
+		batch->columns[batch->ncolumns++] = attno;
+		batch->maxattno = attno;
+	}
+
+	batch->noutcols = list_length(targetlist);
+	batch->outcols = palloc(sizeof(AttrNumber) * Max(batch->noutcols, 1));
+	i = 0;
+	foreach(lc, targetlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		Var		   *var = (Var *) tle->expr;
+
+		if (!IsA(var, Var) || var->varattno <= 0 ||
+			batch->values[var->varattno - 1] == NULL)
+			elog(ERROR, "unsupported target list entry in batch mode");
+		batch->outcols[i++] = var->varattno;
+	}
+
+	return batch;
+}
+
+/*
+ * Forget the contents of a batch, and that the scan was exhausted.
+ */
+void
+ExecResetTupleBatch(TupleBatch *batch)
+{
+	batch->nrows = 0;
+	batch->nselected = 0;
+	batch->next = 0;
+	batch->done = false;
+}
+
+/*
+ * Store one row of a batch in a virtual slot, in the layout of the scan's
+ * target list.
+ */
+void
+ExecStoreBatchRow(TupleBatch *batch, int row, TupleTableSlot *slot)
+{
+	Assert(row < batch->nrows);
+
+	ExecClearTuple(slot);
+	for (int i = 0; i < batch->noutcols; i++)
+	{
+		AttrNumber	attno = batch->outcols[i];
+
+		slot->tts_values[i] = batch->values[attno - 1][row];
+		slot->tts_isnull[i] = batch->isnull[attno - 1][row];
+	}
+	ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * Classify the function of a comparison operator for the fast paths.
+ */
+static BatchCompare
+batch_compare_kind(Oid funcid, bool *is_int8)
+{
+	*is_int8 = false;
+	switch (funcid)
+	{
+		case F_INT4EQ:
+			return BATCH_CMP_EQ;
+		case F_INT4NE:
+			return BATCH_CMP_NE;
+		case F_INT4LT:
+			return BATCH_CMP_LT;
+		case F_INT4LE:
+			return BATCH_CMP_LE;
+		case F_INT4GT:
+			return BATCH_CMP_GT;
+		case F_INT4GE:
+			return BATCH_CMP_GE;
+	}
+
+	*is_int8 = true;
+	switch (funcid)
+	{
+		case F_INT8EQ:
+			return BATCH_CMP_EQ;
+		case F_INT8NE:
+			return BATCH_CMP_NE;
+		case F_INT8LT:
+			return BATCH_CMP_LT;
+		case F_INT8LE:
+			return BATCH_CMP_LE;
+		case F_INT8GT:
+			return BATCH_CMP_GT;
+		case F_INT8GE:
+			return BATCH_CMP_GE;
+	}
+
+	*is_int8 = false;
+	return BATCH_CMP_NONE;
+}
+
+/*
+ * The comparison that gives the same result with its arguments swapped.
+ */
+static BatchCompare
+batch_compare_commute(BatchCompare cmp)
+{
+	switch (cmp)
+	{
+		case BATCH_CMP_LT:
+			return BATCH_CMP_GT;
+		case BATCH_CMP_LE:
+			return BATCH_CMP_GE;
+		case BATCH_CMP_GT:
+			return BATCH_CMP_LT;
+		case BATCH_CMP_GE:
+			return BATCH_CMP_LE;
+		default:
+			return cmp;
+	}
+}
+
+/*
+ * Prepare an implicitly-ANDed list of qual clauses for batch evaluation.
+ * The columns they reference are added to *attnos.
+ */
+BatchQual *
+ExecInitBatchQual(List *qual, Bitmapset **attnos)
+{
+	BatchQual  *bqual;
+	ListCell   *lc;
+	int			i = 0;
+
+	bqual = palloc0(offsetof(BatchQual, clauses) +
+					sizeof(BatchQualClause) * list_length(qual));
+	bqual->nclauses = list_length(qual);
+
+	foreach(lc, qual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		BatchQualClause *clause = &bqual->clauses[i++];
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			elog(ERROR, "unsupported qual clause in batch mode");
+		leftop = linitial(opexpr->args);
+		rightop = lsecond(opexpr->args);
+
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+			clause->const_first = false;
+		}
+		else if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+			clause->const_first = true;
+		}
+		else
+			elog(ERROR, "unsupported qual clause in batch mode");
+
+		if (var->varattno <= 0)
+			elog(ERROR, "unsupported qual clause in batch mode");
+		clause->attno = var->varattno;
+		*attnos = bms_add_member(*attnos, var->varattno);
+
+		/* A strict operator can never be satisfied by a null constant */
+		if (con->constisnull)
+		{
+			clause->cmp = BATCH_CMP_NONE;
+			clause->fcinfo = NULL;
+			continue;
+		}
+		clause->constval = con->constvalue;
+
+		set_opfuncid(opexpr);
+		clause->cmp = batch_compare_kind(opexpr->opfuncid, &clause->is_int8);
+		if (clause->const_first)
+			clause->cmp = batch_compare_commute(clause->cmp);
+
+		if (clause->cmp == BATCH_CMP_NONE)
+		{
+			FmgrInfo   *finfo = palloc0(sizeof(FmgrInfo));
+
+			clause->fcinfo = palloc0(SizeForFunctionCallInfo(2));
+			fmgr_info(opexpr->opfuncid, finfo);
+			fmgr_info_set_expr((Node *) opexpr, finfo);
+			if (!finfo->fn_strict)
+				elog(ERROR, "unsupported qual clause in batch mode");
+			InitFunctionCallInfoData(*clause->fcinfo, finfo, 2,
+									 opexpr->inputcollid, NULL, NULL);
+			clause->fcinfo->args[clause->const_first ? 0 : 1].value =
+				con->constvalue;
+			clause->fcinfo->args[clause->const_first ? 0 : 1].isnull = false;
+		}
+	}
+
+	return bqual;
+}
+
+/*
+ * Apply a fast-path comparison to the selected rows of a column, keeping
+ * only the rows that satisfy it.
+ */
+#define BATCH_FILTER(getdatum, op) \
+	do { \
+		for (int i = 0; i < nselected; i++) \
+		{ \
+			int			row = selection[i]; \
+			\
+			selection[nkept] = row; \
+			nkept += (!isnull[row] && getdatum(values[row]) op getdatum(constval)); \
+		} \
+	} while (0)
+
+#define BATCH_FILTER_ALL(getdatum) \
+	do { \
+		switch (clause->cmp) \
+		{ \
+			case BATCH_CMP_EQ: BATCH_FILTER(getdatum, ==); break; \
+			case BATCH_CMP_NE: BATCH_FILTER(getdatum, !=); break; \
+			case BATCH_CMP_LT: BATCH_FILTER(getdatum, <); break; \
+			case BATCH_CMP_LE: BATCH_FILTER(getdatum, <=); break; \
+			case BATCH_CMP_GT: BATCH_FILTER(getdatum, >); break; \
+			case BATCH_CMP_GE: BATCH_FILTER(getdatum, >=); break; \
+			case BATCH_CMP_NONE: Assert(false); break; \
+		} \
+	} while (0)
+
+/*
+ * Evaluate the quals over all rows of the batch, and fill in its selection
+ * vector with the rows that pass.  Function calls are made in the
+ * econtext's per-tuple memory, which the caller should reset between
+ * batches.
+ */
+void
+ExecBatchQual(BatchQual *bqual, TupleBatch *batch, ExprContext *econtext)
+{
+	uint16	   *selection = batch->selection;
+	int			nselected = batch->nrows;
+
+	for (int i = 0; i < nselected; i++)
+		selection[i] = i;
+
+	for (int c = 0; c < bqual->nclauses && nselected > 0; c++)
+	{
+		BatchQualClause *clause = &bqual->clauses[c];
+		Datum	   *values = batch->values[clause->attno - 1];
+		bool	   *isnull = batch->isnull[clause->attno - 1];
+		Datum		constval = clause->constval;
+		int			nkept = 0;
+
+		if (clause->cmp != BATCH_CMP_NONE)
+		{
+			if (clause->is_int8)
+				BATCH_FILTER_ALL(DatumGetInt64);
+			else
+				BATCH_FILTER_ALL(DatumGetInt32);
+		}
+		else if (clause->fcinfo != NULL)
+		{
+			FunctionCallInfo fcinfo = clause->fcinfo;
+			int			argno = clause->const_first ? 1 : 0;
+			MemoryContext oldContext;
+
+			oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+			for (int i = 0; i < nselected; i++)
+			{
+				int			row = selection[i];
+				Datum		result;
+
+				if (isnull[row])
+					continue;
+				fcinfo->args[argno].value = values[row];
+				fcinfo->args[argno].isnull = false;
+				fcinfo->isnull = false;
+				result = FunctionCallInvoke(fcinfo);
+				if (!fcinfo->isnull && DatumGetBool(result))
+					selection[nkept++] = row;
+			}
+			MemoryContextSwitchTo(oldContext);
+		}
+
+		/* otherwise the constant is null, and no row can pass */
+
+		nselected = nkept;
+	}
+
+	batch->nselected = nselected;
+	batch->next = 0;
+}
@@ -71,6 +71,7 @@
 
 static TupleDesc ExecTypeFromTLInternal(List *targetList,
 										bool skipjunk);
+static int	slot_compute_fixed_atts(TupleDesc tupleDesc);
 static pg_attribute_always_inline void slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 															  int natts);
 static inline void tts_buffer_heap_store_tuple(TupleTableSlot *slot,
@@ -907,6 +908,65 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 	}
 }
 
+/*
+ * slot_compute_fixed_atts
+ *		Compute tdfixedatts and tddatumatts for a tuple descriptor, and set
+ *		the attcacheoff of the attributes they cover.  Returns tdfixedatts.
+ *
+ * Attributes that are preceded only by fixed-width attributes are stored at
+ * the same offset in every tuple, as long as none of those is null.  We
+ * don't trust attnotnull for that: a slot may hold a tuple that has not yet
+ * been checked against the relation's constraints.  Instead the null bitmap
+ * is checked per tuple, which is cheap when done a byte at a time.
+ */
+static int
+slot_compute_fixed_atts(TupleDesc tupleDesc)
+{
+	uint32		off = 0;
+	int			datumatts = 0;
+	int			attnum;
+
+	for (attnum = 0; attnum < tupleDesc->natts; attnum++)
+	{
+		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
+
+		if (thisatt->attlen <= 0)
+			break;
+
+		off = att_align_nominal(off, thisatt->attalign);
+		thisatt->attcacheoff = off;
+
+		/* Datum-sized byval values stored back to back can be copied as is */
+		if (datumatts == attnum && thisatt->attbyval &&
+			thisatt->attlen == sizeof(Datum) &&
+			off == attnum * sizeof(Datum))
+			datumatts++;
+
+		off += thisatt->attlen;
+	}
+
+	tupleDesc->tddatumatts = datumatts;
+	tupleDesc->tdfixedatts = attnum;
+
+	return attnum;
+}
+
+/*
+ * Count the leading attributes, up to natts, whose null bit is not set.
+ */
+static inline int
+slot_count_leading_notnull(bits8 *bp, int natts)
+{
+	int			attnum = 0;
+
+	while (attnum + BITS_PER_BYTE <= natts && bp[attnum >> 3] == 0xFF)
+		attnum += BITS_PER_BYTE;
+	while (attnum < natts && !att_isnull(attnum, bp))
+		attnum++;
+
+	return attnum;
+}
+
 /*
  * slot_deform_heap_tuple
  *		Given a TupleTableSlot, extract data from the slot's physical tuple
@@ -935,6 +995,7 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 	uint32		off;			/* offset in tuple data */
 	bits8	   *bp = tup->t_bits;	/* ptr to null bitmap in tuple */
 	bool		slow;			/* can we use/set attcacheoff? */
+	int			fixedatts;		/* # of attrs at known offsets */
 
 	/* We can only fetch as many attributes as the tuple has. */
 	natts = Min(HeapTupleHeaderGetNatts(tuple->t_data), natts);
@@ -959,6 +1020,43 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 
 	tp = (char *) tup + tup->t_hoff;
 
+	/*
+	 * Leading fixed-width attributes that aren't null are at their cached
+	 * offsets, so fetch them without checking them one by one against the
+	 * null bitmap or computing alignment.  A leading run of Datum-sized
+	 * by-value attributes is just copied as a block.
+	 */
+	fixedatts = tupleDesc->tdfixedatts;
+	if (unlikely(fixedatts < 0))
+		fixedatts = slot_compute_fixed_atts(tupleDesc);
+	fixedatts = Min(fixedatts, natts);
+	if (hasnulls && attnum < fixedatts)
+		fixedatts = slot_count_leading_notnull(bp, fixedatts);
+
+	if (attnum < fixedatts)
+	{
+		int			datumatts = Min(tupleDesc->tddatumatts, fixedatts);
+		Form_pg_attribute thisatt;
+
+		if (attnum < datumatts)
+		{
+			memcpy(&values[attnum], tp + attnum * sizeof(Datum),
+				   (datumatts - attnum) * sizeof(Datum));
+			memset(&isnull[attnum], false, datumatts - attnum);
+			attnum = datumatts;
+		}
+
+		for (; attnum < fixedatts; attnum++)
+		{
+			thisatt = TupleDescAttr(tupleDesc, attnum);
+			values[attnum] = fetchatt(thisatt, tp + thisatt->attcacheoff);
+			isnull[attnum] = false;
+		}
+
+		thisatt = TupleDescAttr(tupleDesc, attnum - 1);
+		off = thisatt->attcacheoff + thisatt->attlen;
+	}
+
 	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
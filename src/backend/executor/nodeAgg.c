@@ -255,9 +255,12 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
+#include "common/int.h"
+#include "executor/execBatch.h"
 #include "executor/execExpr.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "executor/nodeSeqscan.h"
 #include "lib/hyperloglog.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -265,14 +268,19 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "pgstat.h"
+#include "port/pg_bitutils.h"
+#include "storage/barrier.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/dynahash.h"
 #include "utils/expandeddatum.h"
+#include "utils/fmgroids.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
 
@@ -314,6 +322,56 @@
  */
 #define HASHAGG_HLL_BIT_WIDTH 5
 
+/*
+ * A parallel-aware hash aggregate first has all participants partition their
+ * share of the input into a number of shared batches, by the high bits of the
+ * hash value, and then lets each participant claim whole batches and
+ * aggregate them alone.  Since all tuples of a group land in the same batch,
+ * every group is emitted by exactly one participant and no combine step is
+ * needed above the Gather.
+ *
+ * We want several batches per participant so that the work balances out
+ * even when some batches are bigger than others, and we want the batches
+ * small enough to be aggregated in memory.  The number of batches is
+ * always a power of two, so that the batch number is a prefix of the hash.
+ *
+ * While partitioning, each participant has a write buffer open for every
+ * batch: a SharedTuplestore chunk of four pages, plus the underlying
+ * BufFile's block.  As in hash_choose_num_partitions(), the batches are
+ * limited so that those buffers take no more than 1/4 of hash_mem.
+ */
+#define PARALLEL_HASHAGG_BATCHES_PER_PARTICIPANT 4
+#define PARALLEL_HASHAGG_MAX_BATCHES 256
+#define PARALLEL_HASHAGG_WRITE_BUFFER_SIZE (5 * BLCKSZ)
+
+/* Barrier phases of a parallel-aware hash aggregate */
+#define PHA_PHASE_PARTITION		0
+#define PHA_PHASE_AGGREGATE		1
+
+/* shm_toc key of the shared state; the plain plan_node_id is SharedAggInfo */
+#define PARALLEL_AGG_KEY(plan_node_id) \
+	(UINT64CONST(0xD000000000000000) | (plan_node_id))
+
+/*
+ * Shared state of a parallel-aware hash aggregate, in the DSM segment.
+ * The batches are an array of nbatches SharedTuplestores of sts_size bytes
+ * each.
+ */
+typedef struct ParallelAggState
+{
+	SharedFileSet fileset;		/* space for the batch files */
+	Barrier		barrier;		/* PHA_PHASE_* */
+	pg_atomic_uint32 next_batch;	/* next batch to be claimed */
+	int			nbatches;		/* number of batches, a power of two */
+	int			batch_bits;		/* log2(nbatches) */
+	int			nparticipants;	/* leader plus planned workers */
+	Size		sts_size;		/* size of each batch's SharedTuplestore */
+	char		batches[FLEXIBLE_ARRAY_MEMBER];
+} ParallelAggState;
+
+#define ParallelAggBatch(pstate, batchno) \
+	((SharedTuplestore *) ((pstate)->batches + (batchno) * (pstate)->sts_size))
+
 /*
  * Estimate chunk overhead as a constant 16 bytes. XXX: should this be
  * improved?
@@ -353,10 +411,25 @@ typedef struct HashAggBatch
 	int			setno;			/* grouping set */
 	int			used_bits;		/* number of bits of hash already used */
 	LogicalTape *input_tape;	/* input partition tape */
+	SharedTuplestoreAccessor *shared_input; /* or shared batch, if parallel */
 	int64		input_tuples;	/* number of tuples in this batch */
 	double		input_card;		/* estimated group cardinality */
 } HashAggBatch;
 
+/*
+ * Per-transition state for running a transition function directly over the
+ * column vectors of the input batches, in batch mode; see
+ * agg_advance_batch_plain().
+ */
+typedef struct AggBatchTransData
+{
+	bool		count_rows;		/* count(*): just add up the rows */
+	bool		count_nonnull;	/* count(x): add up the non-null inputs */
+	int			ninputs;		/* number of transition inputs */
+	Datum	  **values;			/* their vectors in the batch */
+	bool	  **isnull;
+} AggBatchTransData;
+
 /* used to find referenced colnos */
 typedef struct FindColsContext
 {
@@ -418,7 +491,11 @@ static void initialize_hash_entry(AggState *aggstate,
 								  TupleHashEntry entry);
 static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static void agg_init_batch_trans(AggState *aggstate);
+static void agg_advance_batch_plain(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static void agg_fill_shared_batches(AggState *aggstate);
+static HashAggBatch *agg_claim_shared_batch(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
@@ -435,10 +512,16 @@ static MinimalTuple hashagg_batch_read(HashAggBatch *batch, uint32 *hashp);
 static void hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *lts,
 							   int used_bits, double input_groups,
 							   double hashentrysize);
+static TupleTableSlot *hashagg_spill_slot(AggState *aggstate,
+										   TupleTableSlot *inputslot);
 static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 								TupleTableSlot *slot, uint32 hash);
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
 								 int setno);
+static int	parallel_hashagg_num_batches(AggState *aggstate,
+										 int nparticipants);
+static Size parallel_hashagg_state_size(int nbatches, int nparticipants);
+static void parallel_hashagg_init_batches(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 									  AggState *aggstate, EState *estate,
@@ -559,6 +642,17 @@ fetch_input_tuple(AggState *aggstate)
 			return NULL;
 		slot = aggstate->sort_slot;
 	}
+	else if (aggstate->batch)
+	{
+		TupleBatch *batch = aggstate->batch;
+
+		/* hand out the batch's selected rows one at a time */
+		if (batch->next >= batch->nselected &&
+			!ExecSeqScanBatch((SeqScanState *) outerPlanState(aggstate)))
+			return NULL;
+		slot = aggstate->batch_slot;
+		ExecStoreBatchRow(batch, batch->selection[batch->next++], slot);
+	}
 	else
 		slot = ExecProcNode(outerPlanState(aggstate));
 
@@ -1875,6 +1969,14 @@ hash_agg_enter_spill_mode(AggState *aggstate)
 
 		aggstate->hash_tapeset = LogicalTapeSetCreate(true, NULL, -1);
 
+		/*
+		 * A parallel-aware hash aggregate first runs out of memory while
+		 * aggregating a shared batch, not during the initial pass.
+		 * agg_refill_hash_table() sets up the spill for that batch itself.
+		 */
+		if (aggstate->table_filled)
+			return;
+
 		aggstate->hash_spills = palloc(sizeof(HashAggSpill) * aggstate->num_hashes);
 
 		for (int setno = 0; setno < aggstate->num_hashes; setno++)
@@ -2151,7 +2253,12 @@ ExecAgg(PlanState *pstate)
 		{
 			case AGG_HASHED:
 				if (!node->table_filled)
-					agg_fill_hash_table(node);
+				{
+					if (node->pagg_state != NULL)
+						agg_fill_shared_batches(node);
+					else
+						agg_fill_hash_table(node);
+				}
 				/* FALLTHROUGH */
 			case AGG_MIXED:
 				result = agg_retrieve_hash_table(node);
@@ -2435,6 +2542,18 @@ agg_retrieve_direct(AggState *aggstate)
 					/* Advance the aggregates (or combine functions) */
 					advance_aggregates(aggstate);
 
+					/*
+					 * In batch mode, we may be able to run the transition
+					 * functions over the rest of the input a batch at a
+					 * time.  That always consumes all of it.
+					 */
+					if (aggstate->batch_trans)
+					{
+						agg_advance_batch_plain(aggstate);
+						aggstate->agg_done = true;
+						break;
+					}
+
 					/* Reset per-input-tuple context after each tuple */
 					ResetExprContext(tmpcontext);
 
@@ -2515,6 +2634,189 @@ agg_retrieve_direct(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * Set up aggstate->batch_trans, if the transition functions of a plain
+ * aggregate can be run directly over the column vectors of the input
+ * batches.  That requires that every transition consumes just plain input
+ * columns, with no DISTINCT, ORDER BY or FILTER, and has a pass-by-value
+ * transition type.  Otherwise, batch rows are fed to the aggregates one at
+ * a time through fetch_input_tuple().
+ */
+static void
+agg_init_batch_trans(AggState *aggstate)
+{
+	TupleBatch *batch = aggstate->batch;
+	AggBatchTransData *batch_trans;
+
+	if (aggstate->aggstrategy != AGG_PLAIN || aggstate->maxsets > 1 ||
+		aggstate->numtrans == 0 || DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		return;
+
+	batch_trans = palloc0(sizeof(AggBatchTransData) * aggstate->numtrans);
+
+	for (int transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		AggBatchTransData *bt = &batch_trans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		ListCell   *lc;
+		int			argno;
+
+		if (aggref->aggkind != AGGKIND_NORMAL || aggref->aggfilter != NULL ||
+			pertrans->numSortCols > 0 || !pertrans->transtypeByVal ||
+			pertrans->numTransInputs != list_length(aggref->args))
+			return;
+
+		bt->ninputs = pertrans->numTransInputs;
+		bt->values = palloc(sizeof(Datum *) * Max(bt->ninputs, 1));
+		bt->isnull = palloc(sizeof(bool *) * Max(bt->ninputs, 1));
+
+		argno = 0;
+		foreach(lc, aggref->args)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+			Var		   *var = (Var *) tle->expr;
+			AttrNumber	attno;
+
+			if (!IsA(var, Var) || var->varattno <= 0 ||
+				var->varattno > batch->noutcols)
+				return;
+			attno = batch->outcols[var->varattno - 1];
+			bt->values[argno] = batch->values[attno - 1];
+			bt->isnull[argno] = batch->isnull[attno - 1];
+			argno++;
+		}
+
+		if (!pertrans->initValueIsNull)
+		{
+			if (pertrans->transfn_oid == F_INT8INC && bt->ninputs == 0)
+				bt->count_rows = true;
+			else if (pertrans->transfn_oid == F_INT8INC_ANY &&
+					 bt->ninputs == 1)
+				bt->count_nonnull = true;
+		}
+	}
+
+	aggstate->batch_trans = batch_trans;
+}
+
+/*
+ * Add "count" to a count() aggregate's transition value.
+ */
+static inline void
+agg_batch_count(AggStatePerGroup pergroup, int64 count)
+{
+	int64		result;
+
+	if (unlikely(pg_add_s64_overflow(DatumGetInt64(pergroup->transValue),
+									 count, &result)))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("bigint out of range")));
+	pergroup->transValue = Int64GetDatum(result);
+}
+
+/*
+ * Advance one transition over the given rows of the current batch.  This
+ * follows the same rules as the transition steps built by
+ * ExecBuildAggTrans(), for a pass-by-value transition type.
+ */
+static void
+agg_advance_batch_trans(AggState *aggstate, AggStatePerTrans pertrans,
+						AggBatchTransData *bt, AggStatePerGroup pergroup,
+						uint16 *selection, int nrows)
+{
+	FunctionCallInfo fcinfo = pertrans->transfn_fcinfo;
+	bool		strict = pertrans->transfn.fn_strict;
+	MemoryContext oldContext;
+
+	if (bt->count_rows && !pergroup->transValueIsNull)
+	{
+		agg_batch_count(pergroup, nrows);
+		return;
+	}
+	if (bt->count_nonnull && !pergroup->transValueIsNull)
+	{
+		bool	   *isnull = bt->isnull[0];
+		int64		count = 0;
+
+		for (int i = 0; i < nrows; i++)
+			count += !isnull[selection[i]];
+		agg_batch_count(pergroup, count);
+		return;
+	}
+
+	/* cf. ExecAggPlainTransByVal() */
+	aggstate->curaggcontext = aggstate->aggcontexts[0];
+	aggstate->current_set = 0;
+	aggstate->curpertrans = pertrans;
+
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	for (int i = 0; i < nrows; i++)
+	{
+		int			row = selection[i];
+		bool		anynull = false;
+
+		for (int argno = 0; argno < bt->ninputs; argno++)
+		{
+			fcinfo->args[argno + 1].value = bt->values[argno][row];
+			fcinfo->args[argno + 1].isnull = bt->isnull[argno][row];
+			anynull |= bt->isnull[argno][row];
+		}
+
+		if (strict)
+		{
+			if (anynull)
+				continue;
+			if (pergroup->noTransValue)
+			{
+				/* first non-null input becomes the transition value */
+				ExecAggInitGroup(aggstate, pertrans, pergroup,
+								 aggstate->curaggcontext);
+				continue;
+			}
+			if (pergroup->transValueIsNull)
+				continue;
+		}
+
+		fcinfo->args[0].value = pergroup->transValue;
+		fcinfo->args[0].isnull = pergroup->transValueIsNull;
+		fcinfo->isnull = false; /* just in case transfn doesn't set it */
+
+		pergroup->transValue = FunctionCallInvoke(fcinfo);
+		pergroup->transValueIsNull = fcinfo->isnull;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Advance all transitions of a plain aggregate over the rest of the input,
+ * a batch at a time, starting with what's left of the current batch.
+ */
+static void
+agg_advance_batch_plain(AggState *aggstate)
+{
+	TupleBatch *batch = aggstate->batch;
+	SeqScanState *scanstate = (SeqScanState *) outerPlanState(aggstate);
+	AggStatePerGroup pergroup = aggstate->pergroups[0];
+
+	do
+	{
+		uint16	   *selection = &batch->selection[batch->next];
+		int			nrows = batch->nselected - batch->next;
+
+		for (int transno = 0; transno < aggstate->numtrans; transno++)
+			agg_advance_batch_trans(aggstate, &aggstate->pertrans[transno],
+									&aggstate->batch_trans[transno],
+									&pergroup[transno], selection, nrows);
+		batch->next = batch->nselected;
+
+		ResetExprContext(aggstate->tmpcontext);
+	} while (ExecSeqScanBatch(scanstate));
+}
+
 /*
  * ExecAgg for hashed case: read input and build hash table
  */
@@ -2560,6 +2862,105 @@ agg_fill_hash_table(AggState *aggstate)
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * ExecAgg for parallel-aware hashed case: partition the input
+ *
+ * Rather than aggregating our share of the input, write each tuple to the
+ * shared batch selected by the high bits of its hash value, then wait for
+ * all other participants to do the same.  The hash tables stay empty; the
+ * batches are claimed and aggregated by agg_refill_hash_table().
+ *
+ * A participant that shows up after the partitioning is done only helps
+ * with aggregating the batches.
+ */
+static void
+agg_fill_shared_batches(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->pagg_state;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	TupleTableSlot *outerslot;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+
+	Assert(aggstate->num_hashes == 1);
+
+	aggstate->pagg_attached = true;
+	if (BarrierAttach(&pstate->barrier) == PHA_PHASE_PARTITION)
+	{
+		for (;;)
+		{
+			TupleTableSlot *spillslot;
+			MinimalTuple tuple;
+			bool		shouldFree;
+			uint32		hash;
+			int			batchno;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			prepare_hash_slot(perhash, outerslot, perhash->hashslot);
+			hash = TupleHashTableHash(perhash->hashtable, perhash->hashslot);
+			batchno = pstate->batch_bits == 0 ? 0 :
+				hash >> (32 - pstate->batch_bits);
+
+			spillslot = hashagg_spill_slot(aggstate, outerslot);
+			tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
+			sts_puttuple(aggstate->pagg_batches[batchno], &hash, tuple);
+			if (shouldFree)
+				pfree(tuple);
+
+			ResetExprContext(tmpcontext);
+		}
+
+		for (int i = 0; i < pstate->nbatches; i++)
+			sts_end_write(aggstate->pagg_batches[i]);
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASH_AGG_PARTITION);
+	}
+	Assert(BarrierPhase(&pstate->barrier) == PHA_PHASE_AGGREGATE);
+
+	aggstate->table_filled = true;
+	/* Walk the (empty) hash table, to get to the first batch */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+}
+
+/*
+ * Claim the next shared batch of a parallel-aware hash aggregate that no
+ * participant has aggregated yet, or return NULL if there are none left.
+ */
+static HashAggBatch *
+agg_claim_shared_batch(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->pagg_state;
+	Agg		   *aggnode = (Agg *) aggstate->ss.ps.plan;
+	SharedTuplestoreAccessor *accessor;
+	HashAggBatch *batch;
+	uint32		batchno;
+
+	if (pstate == NULL || !aggstate->pagg_attached)
+		return NULL;
+
+	batchno = pg_atomic_fetch_add_u32(&pstate->next_batch, 1);
+	if (batchno >= pstate->nbatches)
+	{
+		/* Nothing left for us to do */
+		BarrierDetach(&pstate->barrier);
+		aggstate->pagg_attached = false;
+		return NULL;
+	}
+
+	accessor = aggstate->pagg_batches[batchno];
+	sts_begin_parallel_scan(accessor);
+
+	batch = hashagg_batch_new(NULL, 0, 0, aggnode->numGroups / pstate->nbatches,
+							  pstate->batch_bits);
+	batch->shared_input = accessor;
+	aggstate->hash_batches_used++;
+
+	return batch;
+}
+
 /*
  * If any data was spilled during hash aggregation, reset the hash table and
  * reprocess one batch of spilled data. After reprocessing a batch, the hash
@@ -2578,15 +2979,20 @@ agg_refill_hash_table(AggState *aggstate)
 	HashAggBatch *batch;
 	AggStatePerHash perhash;
 	HashAggSpill spill;
-	LogicalTapeSet *tapeset = aggstate->hash_tapeset;
 	bool		spill_initialized = false;
 
-	if (aggstate->hash_batches == NIL)
+	/*
+	 * Our own spilled batches go first; in a parallel-aware hash aggregate,
+	 * they come from a shared batch that we've already claimed.
+	 */
+	if (aggstate->hash_batches != NIL)
+	{
+		batch = linitial(aggstate->hash_batches);
+		aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+	}
+	else if ((batch = agg_claim_shared_batch(aggstate)) == NULL)
 		return false;
 
-	batch = linitial(aggstate->hash_batches);
-	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
-
 	hash_agg_set_limits(aggstate->hashentrysize, batch->input_card,
 						batch->used_bits, &aggstate->hash_mem_limit,
 						&aggstate->hash_ngroups_limit, NULL);
@@ -2649,7 +3055,8 @@ agg_refill_hash_table(AggState *aggstate)
 		if (tuple == NULL)
 			break;
 
-		ExecStoreMinimalTuple(tuple, spillslot, true);
+		/* a shared batch's tuples live in the accessor's buffer */
+		ExecStoreMinimalTuple(tuple, spillslot, batch->shared_input == NULL);
 		aggstate->tmpcontext->ecxt_outertuple = spillslot;
 
 		prepare_hash_slot(perhash,
@@ -2674,7 +3081,8 @@ agg_refill_hash_table(AggState *aggstate)
 				 * that we don't assign tapes that will never be used.
 				 */
 				spill_initialized = true;
-				hashagg_spill_init(&spill, tapeset, batch->used_bits,
+				hashagg_spill_init(&spill, aggstate->hash_tapeset,
+								   batch->used_bits,
 								   batch->input_card, aggstate->hashentrysize);
 			}
 			/* no memory for a new group, spill */
@@ -2690,7 +3098,10 @@ agg_refill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
-	LogicalTapeClose(batch->input_tape);
+	if (batch->shared_input != NULL)
+		sts_end_parallel_scan(batch->shared_input);
+	else
+		LogicalTapeClose(batch->input_tape);
 
 	/* change back to phase 0 */
 	aggstate->current_phase = 0;
@@ -2897,25 +3308,16 @@ hashagg_spill_init(HashAggSpill *spill, LogicalTapeSet *tapeset, int used_bits,
 }
 
 /*
- * hashagg_spill_tuple
+ * hashagg_spill_slot
  *
- * No room for new groups in the hash table. Save for later in the appropriate
- * partition.
+ * Return a slot with just the attributes of inputslot that we actually need
+ * later, for writing out to a spill tape or shared batch.
  */
-static Size
-hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
-					TupleTableSlot *inputslot, uint32 hash)
+static TupleTableSlot *
+hashagg_spill_slot(AggState *aggstate, TupleTableSlot *inputslot)
 {
 	TupleTableSlot *spillslot;
-	int			partition;
-	MinimalTuple tuple;
-	LogicalTape *tape;
-	int			total_written = 0;
-	bool		shouldFree;
-
-	Assert(spill->partitions != NULL);
 
-	/* spill only attributes that we actually need */
 	if (!aggstate->all_cols_needed)
 	{
 		spillslot = aggstate->hash_spill_wslot;
@@ -2936,6 +3338,30 @@ hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 	else
 		spillslot = inputslot;
 
+	return spillslot;
+}
+
+/*
+ * hashagg_spill_tuple
+ *
+ * No room for new groups in the hash table. Save for later in the appropriate
+ * partition.
+ */
+static Size
+hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
+					TupleTableSlot *inputslot, uint32 hash)
+{
+	TupleTableSlot *spillslot;
+	int			partition;
+	MinimalTuple tuple;
+	LogicalTape *tape;
+	int			total_written = 0;
+	bool		shouldFree;
+
+	Assert(spill->partitions != NULL);
+
+	/* spill only attributes that we actually need */
+	spillslot = hashagg_spill_slot(aggstate, inputslot);
 	tuple = ExecFetchSlotMinimalTuple(spillslot, &shouldFree);
 
 	partition = (hash & spill->mask) >> spill->shift;
@@ -2986,6 +3412,9 @@ hashagg_batch_new(LogicalTape *input_tape, int setno,
 /*
  * read_spilled_tuple
  * 		read the next tuple from a batch's tape.  Return NULL if no more.
+ *
+ * The tuple read from a shared batch belongs to its accessor, and is only
+ * valid until the next call; otherwise it's palloc'd.
  */
 static MinimalTuple
 hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
@@ -2996,6 +3425,14 @@ hashagg_batch_read(HashAggBatch *batch, uint32 *hashp)
 	size_t		nread;
 	uint32		hash;
 
+	if (batch->shared_input != NULL)
+	{
+		tuple = sts_parallel_scan_next(batch->shared_input, &hash);
+		if (tuple != NULL && hashp != NULL)
+			*hashp = hash;
+		return tuple;
+	}
+
 	nread = LogicalTapeRead(tape, &hash, sizeof(uint32));
 	if (nread == 0)
 		return NULL;
@@ -3293,12 +3730,36 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	outerPlan = outerPlan(node);
 	outerPlanState(aggstate) = ExecInitNode(outerPlan, estate, eflags);
 
+	/*
+	 * If the planner chose batch mode, ask the child scan for batches.  The
+	 * rows we then feed the aggregates are virtual tuples formed from the
+	 * batches.  EvalPlanQual rechecks need the tuple-at-a-time path.
+	 */
+	if (node->batched && estate->es_epq_active == NULL &&
+		IsA(outerPlanState(aggstate), SeqScanState))
+	{
+		SeqScanState *scanstate = (SeqScanState *) outerPlanState(aggstate);
+
+		ExecSeqScanInitBatch(scanstate);
+		aggstate->batch = scanstate->batch;
+		aggstate->batch_slot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(&scanstate->ss.ps),
+								   &TTSOpsVirtual);
+	}
+
 	/*
 	 * initialize source tuple type.
 	 */
-	aggstate->ss.ps.outerops =
-		ExecGetResultSlotOps(outerPlanState(&aggstate->ss),
-							 &aggstate->ss.ps.outeropsfixed);
+	if (aggstate->batch)
+	{
+		aggstate->ss.ps.outerops = &TTSOpsVirtual;
+		aggstate->ss.ps.outeropsfixed = true;
+	}
+	else
+		aggstate->ss.ps.outerops =
+			ExecGetResultSlotOps(outerPlanState(&aggstate->ss),
+								 &aggstate->ss.ps.outeropsfixed);
 	aggstate->ss.ps.outeropsset = true;
 
 	ExecCreateScanSlotFromOuterPlan(estate, &aggstate->ss,
@@ -4009,6 +4470,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		phase->evaltrans_cache[0][0] = phase->evaltrans;
 	}
 
+	if (aggstate->batch)
+		agg_init_batch_trans(aggstate);
+
 	return aggstate;
 }
 
@@ -4375,6 +4839,7 @@ ExecReScanAgg(AggState *node)
 		 * again.
 		 */
 		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+			node->pagg_state == NULL &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4654,20 +5119,101 @@ AggRegisterCallback(FunctionCallInfo fcinfo,
 
 /* ----------------------------------------------------------------
  *						Parallel Query Support
+ *
+ *		A parallel-aware Agg is always a hashed aggregate with a single
+ *		grouping set, and needs the shared batches described at
+ *		ParallelAggState.  In addition, any Agg can report instrumentation
+ *		from the workers.
  * ----------------------------------------------------------------
  */
 
- /* ----------------------------------------------------------------
-  *		ExecAggEstimate
-  *
-  *		Estimate space required to propagate aggregate statistics.
-  * ----------------------------------------------------------------
-  */
+/*
+ * Choose the number of shared batches for a parallel-aware hash aggregate.
+ */
+static int
+parallel_hashagg_num_batches(AggState *aggstate, int nparticipants)
+{
+	Agg		   *aggnode = (Agg *) aggstate->ss.ps.plan;
+	Size		hash_mem_limit = get_hash_memory_limit();
+	double		mem_wanted;
+	double		dbatches;
+	double		batch_limit;
+	int			nbatches;
+
+	mem_wanted = HASHAGG_PARTITION_FACTOR * aggnode->numGroups *
+		aggstate->hashentrysize;
+	dbatches = Max(PARALLEL_HASHAGG_BATCHES_PER_PARTICIPANT * nparticipants,
+				   mem_wanted / hash_mem_limit);
+	dbatches = Min(dbatches, PARALLEL_HASHAGG_MAX_BATCHES);
+	nbatches = pg_nextpower2_32((uint32) dbatches);
+
+	/* keep the write buffers within 1/4 of hash_mem, rounding down */
+	batch_limit = hash_mem_limit * 0.25 / PARALLEL_HASHAGG_WRITE_BUFFER_SIZE;
+	if (nbatches > batch_limit)
+	{
+		if (batch_limit < 1)
+			nbatches = 1;
+		else
+			nbatches = 1 << pg_leftmost_one_pos32((uint32) batch_limit);
+	}
+
+	return nbatches;
+}
+
+static Size
+parallel_hashagg_state_size(int nbatches, int nparticipants)
+{
+	return add_size(offsetof(ParallelAggState, batches),
+					mul_size(nbatches, MAXALIGN(sts_estimate(nparticipants))));
+}
+
+/*
+ * (Re)initialize the shared batches, and attach the leader to them.
+ */
+static void
+parallel_hashagg_init_batches(AggState *aggstate)
+{
+	ParallelAggState *pstate = aggstate->pagg_state;
+
+	for (int i = 0; i < pstate->nbatches; i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "agg%d.%d",
+				 aggstate->ss.ps.plan->plan_node_id, i);
+		aggstate->pagg_batches[i] =
+			sts_initialize(ParallelAggBatch(pstate, i),
+						   pstate->nparticipants,
+						   ParallelWorkerNumber + 1,
+						   sizeof(uint32),
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset,
+						   name);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggEstimate
+ *
+ *		Estimate space required to propagate aggregate statistics, and
+ *		for the shared batches of a parallel-aware Agg.
+ * ----------------------------------------------------------------
+ */
 void
 ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		int			nparticipants = pcxt->nworkers + 1;
+		int			nbatches = parallel_hashagg_num_batches(node, nparticipants);
+
+		size = parallel_hashagg_state_size(nbatches, nparticipants);
+		shm_toc_estimate_chunk(&pcxt->estimator, size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4681,7 +5227,8 @@ ExecAggEstimate(AggState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecAggInitializeDSM
  *
- *		Initialize DSM space for aggregate statistics.
+ *		Initialize DSM space for aggregate statistics, and the shared
+ *		batches of a parallel-aware Agg.
  * ----------------------------------------------------------------
  */
 void
@@ -4689,6 +5236,35 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	/*
+	 * Without a DSM segment there won't be any workers either, and the
+	 * leader just aggregates the whole input the usual way.
+	 */
+	if (node->ss.ps.plan->parallel_aware && pcxt->seg != NULL)
+	{
+		ParallelAggState *pstate;
+		int			nparticipants = pcxt->nworkers + 1;
+		int			nbatches = parallel_hashagg_num_batches(node, nparticipants);
+
+		size = parallel_hashagg_state_size(nbatches, nparticipants);
+		pstate = shm_toc_allocate(pcxt->toc, size);
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->next_batch, 0);
+		pstate->nbatches = nbatches;
+		pstate->batch_bits = pg_ceil_log2_32(nbatches);
+		pstate->nparticipants = nparticipants;
+		pstate->sts_size = MAXALIGN(sts_estimate(nparticipants));
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_AGG_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->pagg_state = pstate;
+		node->pagg_batches = palloc(sizeof(SharedTuplestoreAccessor *) *
+									nbatches);
+		parallel_hashagg_init_batches(node);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -4703,15 +5279,59 @@ ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset the shared batches of a parallel-aware Agg for a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	ParallelAggState *pstate = node->pagg_state;
+
+	if (pstate == NULL)
+		return;
+
+	/*
+	 * The workers are gone by now, and the leader only ever stops between
+	 * batches, so nobody has any of the batch files open.
+	 */
+	node->pagg_attached = false;
+	SharedFileSetDeleteAll(&pstate->fileset);
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_batch, 0);
+	parallel_hashagg_init_batches(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecAggInitializeWorker
  *
- *		Attach worker to DSM space for aggregate statistics.
+ *		Attach worker to DSM space for aggregate statistics, and to the
+ *		shared batches of a parallel-aware Agg.
  * ----------------------------------------------------------------
  */
 void
 ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelAggState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_AGG_KEY(node->ss.ps.plan->plan_node_id),
+								false);
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->pagg_state = pstate;
+		node->pagg_batches = palloc(sizeof(SharedTuplestoreAccessor *) *
+									pstate->nbatches);
+		for (int i = 0; i < pstate->nbatches; i++)
+			node->pagg_batches[i] = sts_attach(ParallelAggBatch(pstate, i),
+											   ParallelWorkerNumber + 1,
+											   &pstate->fileset);
+	}
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 }
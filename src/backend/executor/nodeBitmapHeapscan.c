@@ -57,6 +57,11 @@ static inline void BitmapDoneInitializingSharedState(ParallelBitmapHeapState *ps
 static inline void BitmapAdjustPrefetchIterator(BitmapHeapScanState *node,
 												TBMIterateResult *tbmres);
 static inline void BitmapAdjustPrefetchTarget(BitmapHeapScanState *node);
+static inline void BitmapStartRead(BitmapHeapScanState *node,
+								   TableScanDesc scan, BlockNumber blockno);
+static inline void BitmapFinishRead(BitmapHeapScanState *node,
+									BlockNumber blockno);
+static void BitmapReleaseReads(BitmapHeapScanState *node);
 static inline void BitmapPrefetch(BitmapHeapScanState *node,
 								  TableScanDesc scan);
 static bool BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate);
@@ -232,10 +237,16 @@ BitmapHeapNext(BitmapHeapScanState *node)
 				 */
 				node->return_empty_tuples = tbmres->ntuples;
 			}
-			else if (!table_scan_bitmap_next_block(scan, tbmres))
+			else
 			{
-				/* AM doesn't think this block is valid, skip */
-				continue;
+				/* Complete the read of this page, if we started it earlier */
+				BitmapFinishRead(node, tbmres->blockno);
+
+				if (!table_scan_bitmap_next_block(scan, tbmres))
+				{
+					/* AM doesn't think this block is valid, skip */
+					continue;
+				}
 			}
 
 			if (tbmres->ntuples >= 0)
@@ -457,6 +468,92 @@ BitmapAdjustPrefetchTarget(BitmapHeapScanState *node)
 #endif							/* USE_PREFETCH */
 }
 
+/*
+ * BitmapStartRead - Pin a page we expect to need soon, and start reading it
+ *
+ * The pinned buffers are remembered in a small ring until the main iterator
+ * reaches their pages, so that by then the buffer has already been allocated
+ * and the kernel has been asked to read the page.  If the ring is full, we
+ * settle for an ordinary prefetch hint.
+ */
+static inline void
+BitmapStartRead(BitmapHeapScanState *node, TableScanDesc scan,
+				BlockNumber blockno)
+{
+	ReadBuffersOperation *op;
+	int			index;
+
+	if (node->prefetch_reads == NULL)
+	{
+		node->prefetch_reads_size = Max(Min(node->prefetch_maximum,
+											(int) GetPinLimit()), 1);
+		node->prefetch_reads = (ReadBuffersOperation *)
+			palloc(sizeof(ReadBuffersOperation) * node->prefetch_reads_size);
+		node->prefetch_read_buffers = (Buffer *)
+			palloc(sizeof(Buffer) * node->prefetch_reads_size);
+		node->prefetch_reads_head = 0;
+		node->prefetch_reads_count = 0;
+	}
+
+	if (node->prefetch_reads_count >= node->prefetch_reads_size)
+	{
+		PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, blockno);
+		return;
+	}
+
+	index = (node->prefetch_reads_head + node->prefetch_reads_count) %
+		node->prefetch_reads_size;
+	op = &node->prefetch_reads[index];
+	op->rel = scan->rs_rd;
+	op->forknum = MAIN_FORKNUM;
+	op->strategy = NULL;
+	(void) StartReadBuffers(op, &node->prefetch_read_buffers[index], blockno,
+							1, READ_BUFFERS_ISSUE_ADVICE);
+	node->prefetch_reads_count++;
+}
+
+/*
+ * BitmapFinishRead - Complete a read started by BitmapStartRead, if any
+ *
+ * Both iterators return pages in ascending block order, so any entries in
+ * the ring for earlier blocks were not needed after all (the main iterator
+ * skipped them) and can simply be released.
+ */
+static inline void
+BitmapFinishRead(BitmapHeapScanState *node, BlockNumber blockno)
+{
+	while (node->prefetch_reads_count > 0)
+	{
+		int			head = node->prefetch_reads_head;
+		ReadBuffersOperation *op = &node->prefetch_reads[head];
+
+		if (op->blocknum > blockno)
+			break;
+		if (op->blocknum == blockno)
+			WaitReadBuffers(op);
+		ReleaseBuffer(node->prefetch_read_buffers[head]);
+		node->prefetch_reads_head = (head + 1) % node->prefetch_reads_size;
+		node->prefetch_reads_count--;
+	}
+}
+
+/*
+ * BitmapReleaseReads - Release all buffers pinned by BitmapStartRead
+ */
+static void
+BitmapReleaseReads(BitmapHeapScanState *node)
+{
+	while (node->prefetch_reads_count > 0)
+	{
+		int			head = node->prefetch_reads_head;
+
+		ReleaseBuffer(node->prefetch_read_buffers[head]);
+		node->prefetch_reads_head = (head + 1) % node->prefetch_reads_size;
+		node->prefetch_reads_count--;
+	}
+	node->prefetch_reads_head = 0;
+}
+
 /*
  * BitmapPrefetch - Prefetch, if prefetch_pages are behind prefetch_target
  */
@@ -504,7 +601,7 @@ BitmapPrefetch(BitmapHeapScanState *node, TableScanDesc scan)
 											 &node->pvmbuffer));
 
 				if (!skip_fetch)
-					PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, tbmpre->blockno);
+					BitmapStartRead(node, scan, tbmpre->blockno);
 			}
 		}
 
@@ -621,6 +718,7 @@ ExecReScanBitmapHeapScan(BitmapHeapScanState *node)
 		ReleaseBuffer(node->vmbuffer);
 	if (node->pvmbuffer != InvalidBuffer)
 		ReleaseBuffer(node->pvmbuffer);
+	BitmapReleaseReads(node);
 	node->tbm = NULL;
 	node->tbmiterator = NULL;
 	node->tbmres = NULL;
@@ -689,6 +787,7 @@ ExecEndBitmapHeapScan(BitmapHeapScanState *node)
 		ReleaseBuffer(node->vmbuffer);
 	if (node->pvmbuffer != InvalidBuffer)
 		ReleaseBuffer(node->pvmbuffer);
+	BitmapReleaseReads(node);
 
 	/*
 	 * close heap scan
@@ -731,6 +830,11 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	scanstate->return_empty_tuples = 0;
 	scanstate->vmbuffer = InvalidBuffer;
 	scanstate->pvmbuffer = InvalidBuffer;
+	scanstate->prefetch_reads = NULL;
+	scanstate->prefetch_read_buffers = NULL;
+	scanstate->prefetch_reads_head = 0;
+	scanstate->prefetch_reads_count = 0;
+	scanstate->prefetch_reads_size = 0;
 	scanstate->exact_pages = 0;
 	scanstate->lossy_pages = 0;
 	scanstate->prefetch_iterator = NULL;
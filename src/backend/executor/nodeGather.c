@@ -22,6 +22,12 @@
  * return the results.  Therefore, a plan used with a single-copy Gather
  * node need not be parallel-aware.
  *
+ * Finally, a Gather node can be ordered.  Then it returns all the tuples of
+ * the first worker, then all of those of the second worker, and so on, and
+ * only runs the plan itself if no workers could be launched.  This is used
+ * with a parallel-aware Sort, where each worker sorts the next range of the
+ * sort keys.
+ *
  * IDENTIFICATION
  *	  src/backend/executor/nodeGather.c
  *
@@ -74,7 +80,7 @@ ExecInitGather(Gather *node, EState *estate, int eflags)
 
 	gatherstate->initialized = false;
 	gatherstate->need_to_scan_locally =
-		!node->single_copy && parallel_leader_participation;
+		!node->single_copy && !node->ordered && parallel_leader_participation;
 	gatherstate->tuples_needed = -1;
 
 	/*
@@ -207,9 +213,13 @@ ExecGather(PlanState *pstate)
 			node->nextreader = 0;
 		}
 
-		/* Run plan locally if no workers or enabled and not single-copy. */
+		/*
+		 * Run plan locally if no workers or enabled and not single-copy.  An
+		 * ordered Gather can't mix in tuples of its own.
+		 */
 		node->need_to_scan_locally = (node->nreaders == 0)
-			|| (!gather->single_copy && parallel_leader_participation);
+			|| (!gather->single_copy && !gather->ordered &&
+				parallel_leader_participation);
 		node->initialized = true;
 	}
 
@@ -360,6 +370,20 @@ gather_readnext(GatherState *gatherstate)
 		if (tup)
 			return tup;
 
+		/*
+		 * An ordered Gather returns all the tuples of the first surviving
+		 * worker before those of the next one, so all it can do is wait.
+		 * The leader isn't running the plan in that case.
+		 */
+		if (((Gather *) gatherstate->ps.plan)->ordered)
+		{
+			Assert(!gatherstate->need_to_scan_locally);
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+							 WAIT_EVENT_EXECUTE_GATHER);
+			ResetLatch(MyLatch);
+			continue;
+		}
+
 		/*
 		 * Advance nextreader pointer in round-robin fashion.  Note that we
 		 * only reach this code if we weren't able to get a tuple from the
@@ -44,6 +44,7 @@
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
+static void ExecHashCheckBloomFilter(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
@@ -57,6 +58,8 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
+static void *dense_alloc_into(HashJoinTable hashtable,
+							  HashMemoryChunk *chunks, Size size);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 												size_t size,
 												dsa_pointer *shared);
@@ -174,6 +177,11 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloom)
+				bloom_add_element(hashtable->bloom,
+								  (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -200,7 +208,13 @@ MultiExecPrivateHash(HashState *node)
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
+	/* lay out the tuples by radix partition, if the table is large */
+	ExecHashTableRadixCluster(hashtable);
+
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	if (hashtable->bloom)
+		ExecHashCheckBloomFilter(hashtable);
 }
 
 /* ----------------------------------------------------------------
@@ -287,10 +301,25 @@ MultiExecParallelHash(HashState *node)
 				if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
 										 false, hashtable->keepNulls,
 										 &hashvalue))
+				{
+					if (hashtable->bloom)
+						bloom_add_element(hashtable->bloom,
+										  (unsigned char *) &hashvalue,
+										  sizeof(hashvalue));
 					ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+				}
 				hashtable->partialTuples++;
 			}
 
+			/* Merge our part of the runtime filter into the shared one. */
+			if (hashtable->bloom)
+			{
+				LWLockAcquire(&pstate->lock, LW_EXCLUSIVE);
+				bloom_union(dsa_get_address(hashtable->area, pstate->bloom),
+							hashtable->bloom);
+				LWLockRelease(&pstate->lock);
+			}
+
 			/*
 			 * Make sure that any tuples we wrote to disk are visible to
 			 * others before anyone tries to load them.
@@ -335,6 +364,17 @@ MultiExecParallelHash(HashState *node)
 	hashtable->totalTuples = pstate->total_tuples;
 	ExecParallelHashEnsureBatchAccessors(hashtable);
 
+	/*
+	 * Everyone has merged their part of the runtime filter by now, so switch
+	 * from our private one to the shared one.
+	 */
+	if (hashtable->bloom)
+	{
+		bloom_free(hashtable->bloom);
+		hashtable->bloom = dsa_get_address(hashtable->area, pstate->bloom);
+		ExecHashCheckBloomFilter(hashtable);
+	}
+
 	/*
 	 * The next synchronization point is in ExecHashJoin's HJ_BUILD_HASHTABLE
 	 * case, which will bring the build phase to PHJ_BUILD_DONE (if it isn't
@@ -438,7 +478,10 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	int			nbatch;
 	double		rows;
 	int			num_skew_mcvs;
+	int			num_radix_partitions;
 	int			log2_nbuckets;
+	int			bloom_work_mem = 0;
+	size_t		bloom_bytes = 0;
 	int			nkeys;
 	int			i;
 	ListCell   *ho;
@@ -466,12 +509,38 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 							state->parallel_state != NULL ?
 							state->parallel_state->nparticipants - 1 : 0,
 							&space_allowed,
-							&nbuckets, &nbatch, &num_skew_mcvs);
+							&nbuckets, &nbatch, &num_skew_mcvs,
+							&num_radix_partitions);
 
 	/* nbuckets must be a power of 2 */
 	log2_nbuckets = my_log2(nbuckets);
 	Assert(nbuckets == (1 << log2_nbuckets));
 
+	/*
+	 * If our parent pushed a runtime filter down into its outer scan, we
+	 * have to fingerprint the inner hash values for it in a Bloom filter.
+	 * That comes out of the same memory budget as the hash table, so it is
+	 * sized for a quarter of hash_mem at most, and we don't build it at all
+	 * if that wouldn't leave the hash table half of its space.  With
+	 * Parallel Hash, every participant also fills a private filter, which
+	 * it merges into the shared one at the end of the build; see
+	 * MultiExecParallelHash().  Those are charged too.
+	 */
+	if (state->runtime_filter)
+	{
+		int			nfilters = 1;
+
+		bloom_work_mem = (int) Min(get_hash_memory_limit() / 4 / 1024,
+								   (size_t) MAX_KILOBYTES);
+		if (state->parallel_state != NULL)
+			nfilters += state->parallel_state->nparticipants;
+		bloom_bytes = nfilters * bloom_size((int64) rows, bloom_work_mem);
+		if (bloom_bytes <= space_allowed / 2)
+			space_allowed -= bloom_bytes;
+		else
+			bloom_bytes = 0;
+	}
+
 	/*
 	 * Initialize the hash table control block.
 	 *
@@ -508,15 +577,21 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
+	hashtable->spaceBloom = bloom_bytes;
 	hashtable->chunks = NULL;
+	/* Parallel Hash shares its tables, so it doesn't radix-partition them */
+	hashtable->nradix = state->parallel_state ? 1 : num_radix_partitions;
+	hashtable->log2_nradix = my_log2(hashtable->nradix);
+	hashtable->radixPartitionPeak = 0;
 	hashtable->current_chunk = NULL;
+	hashtable->bloom = NULL;
 	hashtable->parallel_state = state->parallel_state;
 	hashtable->area = state->ps.state->es_query_dsa;
 	hashtable->batches = NULL;
 
 #ifdef HJDEBUG
-	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d\n",
-		   hashtable, nbatch, nbuckets);
+	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d, nradix = %d\n",
+		   hashtable, nbatch, nbuckets, hashtable->nradix);
 #endif
 
 	/*
@@ -563,6 +638,10 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 		i++;
 	}
 
+	/* Set up the (private) runtime filter, if there's room for it */
+	if (bloom_bytes > 0)
+		hashtable->bloom = bloom_create((int64) rows, bloom_work_mem, 0);
+
 	if (nbatch > 1 && hashtable->parallel_state == NULL)
 	{
 		/*
@@ -610,6 +689,18 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 			pstate->space_allowed = space_allowed;
 			pstate->growth = PHJ_GROWTH_OK;
 
+			/* Set up an empty shared runtime filter, if needed. */
+			if (bloom_bytes > 0)
+			{
+				pstate->bloom = dsa_allocate(hashtable->area,
+											 bloom_size((int64) rows,
+														bloom_work_mem));
+				bloom_init(dsa_get_address(hashtable->area, pstate->bloom),
+						   (int64) rows, bloom_work_mem, 0);
+			}
+			else
+				pstate->bloom = InvalidDsaPointer;
+
 			/* Set up the shared state for coordinating batches. */
 			ExecParallelHashJoinSetUpBatches(hashtable, nbatch);
 
@@ -671,7 +762,8 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 						size_t *space_allowed,
 						int *numbuckets,
 						int *numbatches,
-						int *num_skew_mcvs)
+						int *num_skew_mcvs,
+						int *num_radix_partitions)
 {
 	int			tupsize;
 	double		inner_rel_bytes;
@@ -680,7 +772,9 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	size_t		max_pointers;
 	int			nbatch = 1;
 	int			nbuckets;
+	int			nradix;
 	double		dbuckets;
+	double		batch_bytes;
 
 	/* Force a plausible relation size if no info */
 	if (ntuples <= 0.0)
@@ -821,7 +915,8 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 									space_allowed,
 									numbuckets,
 									numbatches,
-									num_skew_mcvs);
+									num_skew_mcvs,
+									num_radix_partitions);
 			return;
 		}
 
@@ -855,11 +950,32 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 		nbatch = pg_nextpower2_32(Max(2, minbatch));
 	}
 
+	/*
+	 * If the hash table for one batch will be much larger than the CPU cache,
+	 * radix-partition it into pieces of about HASH_RADIX_PARTITION_SIZE.  A
+	 * batch fills the space allowed if there's more than one.
+	 */
+	if (nbatch == 1)
+		batch_bytes = inner_rel_bytes + bucket_bytes;
+	else
+		batch_bytes = *space_allowed;
+	nradix = 1;
+	if (batch_bytes >= (double) HASH_RADIX_PARTITION_SIZE * HASH_RADIX_MIN_PARTITIONS)
+	{
+		nradix = (int) Min(batch_bytes / HASH_RADIX_PARTITION_SIZE,
+						   HASH_RADIX_MAX_PARTITIONS);
+		nradix = pg_prevpower2_32(nradix);
+		/* each partition has to cover at least one bucket */
+		nradix = Min(nradix, nbuckets);
+	}
+
 	Assert(nbuckets > 0);
 	Assert(nbatch > 0);
+	Assert(nradix > 0);
 
 	*numbuckets = nbuckets;
 	*numbatches = nbatch;
+	*num_radix_partitions = nradix;
 }
 
 
@@ -897,6 +1013,28 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 	pfree(hashtable);
 }
 
+/*
+ * ExecHashCheckBloomFilter
+ *		give up on the runtime filter if it's too full to reject much
+ *
+ * The false positive rate of a Bloom filter with k hash functions is about
+ * (fraction of bits set) ^ k.  This happens when the planner badly
+ * underestimated the inner side, so that the filter is too small for it.
+ */
+#define HASH_BLOOM_MAX_PROP_BITS_SET	0.75
+
+static void
+ExecHashCheckBloomFilter(HashJoinTable hashtable)
+{
+	if (bloom_prop_bits_set(hashtable->bloom) > HASH_BLOOM_MAX_PROP_BITS_SET)
+	{
+		/* A shared filter is freed by ExecHashTableDetach, though */
+		if (hashtable->parallel_state == NULL)
+			bloom_free(hashtable->bloom);
+		hashtable->bloom = NULL;
+	}
+}
+
 /*
  * ExecHashIncreaseNumBatches
  *		increase the original number of batches in order to reduce
@@ -2055,6 +2193,48 @@ ExecParallelScanHashBucket(HashJoinState *hjstate,
 	return false;
 }
 
+/*
+ * ExecHashPrefetchBuckets
+ *		prefetch a group of buckets that are about to be probed
+ *
+ * The bucket headers are requested first, all at once, and only then do we
+ * follow each one to request its first tuple, so that the cache misses for
+ * the whole group overlap instead of being taken one probe at a time.
+ * Tuples that turn out to belong in a skew bucket or in a later batch just
+ * cost a wasted prefetch.
+ */
+void
+ExecHashPrefetchBuckets(HashJoinTable hashtable, const int *bucketnos, int n)
+{
+	int			i;
+
+	if (hashtable->parallel_state)
+	{
+		for (i = 0; i < n; i++)
+			pg_prefetch_mem(&hashtable->buckets.shared[bucketnos[i]]);
+		for (i = 0; i < n; i++)
+		{
+			dsa_pointer p;
+
+			p = dsa_pointer_atomic_read(&hashtable->buckets.shared[bucketnos[i]]);
+			if (DsaPointerIsValid(p))
+				pg_prefetch_mem(dsa_get_address(hashtable->area, p));
+		}
+	}
+	else
+	{
+		for (i = 0; i < n; i++)
+			pg_prefetch_mem(&hashtable->buckets.unshared[bucketnos[i]]);
+		for (i = 0; i < n; i++)
+		{
+			HashJoinTuple hashTuple = hashtable->buckets.unshared[bucketnos[i]];
+
+			if (hashTuple != NULL)
+				pg_prefetch_mem(hashTuple);
+		}
+	}
+}
+
 /*
  * ExecPrepHashTableForUnmatched
  *		set up for a series of ExecScanHashTableForUnmatched calls
@@ -2208,6 +2388,108 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * ExecHashTableRadixCluster
+ *		rearrange the tuples of the current batch by radix partition
+ *
+ * The buckets are divided into nradix equal ranges, and each tuple is moved
+ * into chunks belonging to the partition of its bucket, so that probing the
+ * buckets of one partition touches only that partition's memory.  We rebuild
+ * the bucket chains as we go, and free each old chunk once it has been
+ * emptied, so this needs little more memory than the table itself: at most
+ * one partly filled chunk per partition.
+ *
+ * This must be called after all the batch's tuples have been loaded, since
+ * later insertions would not respect the partitioning.  It does nothing if
+ * the table isn't radix-partitioned.
+ */
+void
+ExecHashTableRadixCluster(HashJoinTable hashtable)
+{
+	HashMemoryChunk *partchunks;
+	Size	   *partsize;
+	HashMemoryChunk oldchunks;
+	HashMemoryChunk chunk;
+	int			shift;
+	int			i;
+
+	if (hashtable->nradix <= 1 || hashtable->chunks == NULL)
+		return;
+
+	Assert(hashtable->parallel_state == NULL);
+	Assert(hashtable->nbuckets >= hashtable->nradix);
+	shift = hashtable->log2_nbuckets - hashtable->log2_nradix;
+
+	partchunks = (HashMemoryChunk *)
+		palloc0(hashtable->nradix * sizeof(HashMemoryChunk));
+	partsize = (Size *) palloc0(hashtable->nradix * sizeof(Size));
+
+	memset(hashtable->buckets.unshared, 0,
+		   hashtable->nbuckets * sizeof(HashJoinTuple));
+
+	oldchunks = hashtable->chunks;
+	hashtable->chunks = NULL;
+	while (oldchunks != NULL)
+	{
+		HashMemoryChunk nextchunk = oldchunks->next.unshared;
+		size_t		idx = 0;
+
+		/* copy each tuple into its partition's chunks */
+		while (idx < oldchunks->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(oldchunks) + idx);
+			int			hashTupleSize = (HJTUPLE_OVERHEAD +
+										 HJTUPLE_MINTUPLE(hashTuple)->t_len);
+			HashJoinTuple copyTuple;
+			int			bucketno;
+			int			batchno;
+			int			partno;
+
+			ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
+									  &bucketno, &batchno);
+			partno = bucketno >> shift;
+
+			copyTuple = (HashJoinTuple) dense_alloc_into(hashtable,
+														 &partchunks[partno],
+														 hashTupleSize);
+			memcpy(copyTuple, hashTuple, hashTupleSize);
+			copyTuple->next.unshared = hashtable->buckets.unshared[bucketno];
+			hashtable->buckets.unshared[bucketno] = copyTuple;
+			partsize[partno] += MAXALIGN(hashTupleSize);
+
+			idx += MAXALIGN(hashTupleSize);
+		}
+
+		/* we're done with the old chunk */
+		pfree(oldchunks);
+		oldchunks = nextchunk;
+
+		/* allow this loop to be cancellable */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* string the partitions' chunk lists together */
+	for (i = hashtable->nradix - 1; i >= 0; i--)
+	{
+		if (partchunks[i] == NULL)
+			continue;
+		chunk = partchunks[i];
+		while (chunk->next.unshared != NULL)
+			chunk = chunk->next.unshared;
+		chunk->next.unshared = hashtable->chunks;
+		hashtable->chunks = partchunks[i];
+
+		/* include the partition's share of the buckets in its size */
+		partsize[i] += (hashtable->nbuckets >> hashtable->log2_nradix) *
+			sizeof(HashJoinTuple);
+		hashtable->radixPartitionPeak = Max(hashtable->radixPartitionPeak,
+											partsize[i]);
+	}
+
+	pfree(partchunks);
+	pfree(partsize);
+}
+
 
 void
 ExecReScanHash(HashState *node)
@@ -2717,7 +2999,11 @@ ExecHashAccumInstrumentation(HashInstrumentation *instrument,
 	instrument->nbatch_original = Max(instrument->nbatch_original,
 									  hashtable->nbatch_original);
 	instrument->space_peak = Max(instrument->space_peak,
-								 hashtable->spacePeak);
+								 hashtable->spacePeak + hashtable->spaceBloom);
+	instrument->nradix = Max(instrument->nradix,
+							 hashtable->nradix);
+	instrument->radix_partition_peak = Max(instrument->radix_partition_peak,
+										   hashtable->radixPartitionPeak);
 }
 
 /*
@@ -2725,6 +3011,16 @@ ExecHashAccumInstrumentation(HashInstrumentation *instrument,
  */
 static void *
 dense_alloc(HashJoinTable hashtable, Size size)
+{
+	return dense_alloc_into(hashtable, &hashtable->chunks, size);
+}
+
+/*
+ * Allocate 'size' bytes from the current chunk of the given list of
+ * HashMemoryChunks, starting a new chunk if necessary
+ */
+static void *
+dense_alloc_into(HashJoinTable hashtable, HashMemoryChunk *chunks, Size size)
 {
 	HashMemoryChunk newChunk;
 	char	   *ptr;
@@ -2748,15 +3044,15 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		 * Add this chunk to the list after the first existing chunk, so that
 		 * we don't lose the remaining space in the "current" chunk.
 		 */
-		if (hashtable->chunks != NULL)
+		if (*chunks != NULL)
 		{
-			newChunk->next = hashtable->chunks->next;
-			hashtable->chunks->next.unshared = newChunk;
+			newChunk->next = (*chunks)->next;
+			(*chunks)->next.unshared = newChunk;
 		}
 		else
 		{
-			newChunk->next.unshared = hashtable->chunks;
-			hashtable->chunks = newChunk;
+			newChunk->next.unshared = *chunks;
+			*chunks = newChunk;
 		}
 
 		return HASH_CHUNK_DATA(newChunk);
@@ -2766,8 +3062,8 @@ dense_alloc(HashJoinTable hashtable, Size size)
 	 * See if we have enough space for it in the current chunk (if any). If
 	 * not, allocate a fresh chunk.
 	 */
-	if ((hashtable->chunks == NULL) ||
-		(hashtable->chunks->maxlen - hashtable->chunks->used) < size)
+	if ((*chunks == NULL) ||
+		((*chunks)->maxlen - (*chunks)->used) < size)
 	{
 		/* allocate new chunk and put it at the beginning of the list */
 		newChunk = (HashMemoryChunk) MemoryContextAlloc(hashtable->batchCxt,
@@ -2777,16 +3073,16 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		newChunk->used = size;
 		newChunk->ntuples = 1;
 
-		newChunk->next.unshared = hashtable->chunks;
-		hashtable->chunks = newChunk;
+		newChunk->next.unshared = *chunks;
+		*chunks = newChunk;
 
 		return HASH_CHUNK_DATA(newChunk);
 	}
 
 	/* There is enough space in the current chunk, let's add the tuple */
-	ptr = HASH_CHUNK_DATA(hashtable->chunks) + hashtable->chunks->used;
-	hashtable->chunks->used += size;
-	hashtable->chunks->ntuples += 1;
+	ptr = HASH_CHUNK_DATA(*chunks) + (*chunks)->used;
+	(*chunks)->used += size;
+	(*chunks)->ntuples += 1;
 
 	/* return pointer to the start of the tuple memory */
 	return ptr;
@@ -3217,8 +3513,15 @@ ExecHashTableDetach(HashJoinTable hashtable)
 				dsa_free(hashtable->area, pstate->batches);
 				pstate->batches = InvalidDsaPointer;
 			}
+			if (DsaPointerIsValid(pstate->bloom))
+			{
+				dsa_free(hashtable->area, pstate->bloom);
+				pstate->bloom = InvalidDsaPointer;
+			}
 		}
 
+		/* The runtime filter may have been in shared memory, too. */
+		hashtable->bloom = NULL;
 		hashtable->parallel_state = NULL;
 	}
 }
@@ -133,12 +133,36 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/*
+ * A runtime filter that rejects less than this fraction of the tuples in a
+ * window of this many tuples is switched off, since then probing it costs
+ * more than it saves.
+ */
+#define HJ_RUNTIME_FILTER_WINDOW		4096
+#define HJ_RUNTIME_FILTER_MIN_REJECT	0.25
+
+static bool ExecHashJoinGetOuterHashValue(HashJoinState *hjstate,
+										  TupleTableSlot *slot,
+										  uint32 *hashvalue);
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinReadOuterTuple(PlanState *outerNode,
+												  HashJoinState *hjstate,
+												  uint32 *hashvalue);
+static bool ExecHashJoinUsePrefetch(HashJoinState *hjstate);
+static HashJoinProbeBuffer *ExecHashJoinCreateProbeBuffer(int nradix);
+static TupleTableSlot *ExecHashJoinBufferedOuterGetTuple(PlanState *outerNode,
+														 HashJoinState *hjstate,
+														 uint32 *hashvalue);
+static void ExecHashJoinFillProbeBuffer(PlanState *outerNode,
+										HashJoinState *hjstate);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
+static TupleTableSlot *ExecParallelHashJoinReadOuterTuple(PlanState *outerNode,
+														  HashJoinState *hjstate,
+														  uint32 *hashvalue);
 static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 												 BufFile *file,
 												 uint32 *hashvalue,
@@ -298,6 +322,29 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (hashtable->totalTuples == 0 && !HJ_FILL_OUTER(node))
 					return NULL;
 
+				/*
+				 * The hash table is complete, so the outer scan can start
+				 * filtering with its hash values.
+				 */
+				if (node->hj_RuntimeFilter)
+				{
+					node->hj_RuntimeFilter->hashtable = hashtable;
+					node->hj_RuntimeFilter->ntested = 0;
+					node->hj_RuntimeFilter->nrejected = 0;
+					node->hj_RuntimeFilter->disabled = false;
+				}
+
+				/*
+				 * If the hash table is radix-partitioned, outer tuples have
+				 * to be buffered so that we can probe one partition at a
+				 * time.  If it's merely too large for the CPU cache, we read
+				 * them ahead a little, to prefetch their buckets.
+				 */
+				if (node->hj_ProbeBuffer == NULL &&
+					(hashtable->nradix > 1 || ExecHashJoinUsePrefetch(node)))
+					node->hj_ProbeBuffer =
+						ExecHashJoinCreateProbeBuffer(hashtable->nradix);
+
 				/*
 				 * need to remember whether nbatch has increased since we
 				 * began scanning the outer relation
@@ -751,6 +798,28 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_JoinState = HJ_BUILD_HASHTABLE;
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
+	hjstate->hj_ProbeBuffer = NULL;
+
+	/*
+	 * If the planner asked for it, hand the outer sequential scan a runtime
+	 * filter with which to discard tuples that can't have a match in the
+	 * hash table.  See use_hashjoin_runtime_filter().
+	 */
+	hjstate->hj_RuntimeFilter = NULL;
+	if (node->runtime_filter)
+	{
+		SeqScanState *scanstate = castNode(SeqScanState,
+										   outerPlanState(hjstate));
+		HashJoinRuntimeFilter *filter;
+
+		filter = (HashJoinRuntimeFilter *) palloc0(sizeof(HashJoinRuntimeFilter));
+		filter->outer_hashkeys = hjstate->hj_OuterHashKeys;
+		filter->econtext = CreateExprContext(estate);
+
+		scanstate->runtime_filter = filter;
+		castNode(HashState, innerPlanState(hjstate))->runtime_filter = true;
+		hjstate->hj_RuntimeFilter = filter;
+	}
 
 	return hjstate;
 }
@@ -769,6 +838,8 @@ ExecEndHashJoin(HashJoinState *node)
 	 */
 	if (node->hj_HashTable)
 	{
+		if (node->hj_RuntimeFilter)
+			node->hj_RuntimeFilter->hashtable = NULL;
 		ExecHashTableDestroy(node->hj_HashTable);
 		node->hj_HashTable = NULL;
 	}
@@ -792,12 +863,44 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecEndNode(innerPlanState(node));
 }
 
+/*
+ * ExecHashJoinGetOuterHashValue
+ *
+ *		compute the hash value of a tuple just fetched from the outer plan
+ *
+ * Returns false if the tuple can't match because of a NULL join key.  If
+ * the outer scan's runtime filter already hashed the tuple to test it, we
+ * take the hash value from there rather than computing it again.
+ */
+static bool
+ExecHashJoinGetOuterHashValue(HashJoinState *hjstate, TupleTableSlot *slot,
+							  uint32 *hashvalue)
+{
+	HashJoinRuntimeFilter *filter = hjstate->hj_RuntimeFilter;
+	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+
+	if (filter != NULL && filter->have_hashvalue)
+	{
+		filter->have_hashvalue = false;
+		*hashvalue = filter->hashvalue;
+		return true;
+	}
+
+	econtext->ecxt_outertuple = slot;
+	return ExecHashGetHashValue(hjstate->hj_HashTable, econtext,
+								hjstate->hj_OuterHashKeys,
+								true,	/* outer tuple */
+								HJ_FILL_OUTER(hjstate),
+								hashvalue);
+}
+
 /*
  * ExecHashJoinOuterGetTuple
  *
  *		get the next outer tuple for a parallel oblivious hashjoin: either by
  *		executing the outer plan node in the first pass, or from the temp
- *		files for the hashjoin batches.
+ *		files for the hashjoin batches.  If the join has a probe buffer,
+ *		the tuples are read ahead through it.
  *
  * Returns a null slot if no more outer tuples (within the current batch).
  *
@@ -808,6 +911,23 @@ static TupleTableSlot *
 ExecHashJoinOuterGetTuple(PlanState *outerNode,
 						  HashJoinState *hjstate,
 						  uint32 *hashvalue)
+{
+	if (hjstate->hj_ProbeBuffer == NULL)
+		return ExecHashJoinReadOuterTuple(outerNode, hjstate, hashvalue);
+
+	return ExecHashJoinBufferedOuterGetTuple(outerNode, hjstate, hashvalue);
+}
+
+/*
+ * ExecHashJoinReadOuterTuple
+ *
+ *		read the next outer tuple for ExecHashJoinOuterGetTuple, from the
+ *		outer plan or from a batch file
+ */
+static TupleTableSlot *
+ExecHashJoinReadOuterTuple(PlanState *outerNode,
+						   HashJoinState *hjstate,
+						   uint32 *hashvalue)
 {
 	HashJoinTable hashtable = hjstate->hj_HashTable;
 	int			curbatch = hashtable->curbatch;
@@ -830,14 +950,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 			/*
 			 * We have to compute the tuple's hash value.
 			 */
-			ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
-
-			econtext->ecxt_outertuple = slot;
-			if (ExecHashGetHashValue(hashtable, econtext,
-									 hjstate->hj_OuterHashKeys,
-									 true,	/* outer tuple */
-									 HJ_FILL_OUTER(hjstate),
-									 hashvalue))
+			if (ExecHashJoinGetOuterHashValue(hjstate, slot, hashvalue))
 			{
 				/* remember outer relation is not empty for possible rescan */
 				hjstate->hj_OuterNotEmpty = true;
@@ -875,6 +988,181 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinUsePrefetch
+ *
+ *		decide whether the hash table for a batch is likely to be so much
+ *		larger than the CPU cache that prefetching buckets pays for the cost
+ *		of reading outer tuples ahead
+ *
+ * This is called before the first batch is loaded, in the parallel case, so
+ * the size is estimated from the number of tuples and the Hash node's width.
+ */
+static bool
+ExecHashJoinUsePrefetch(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	Plan	   *hashplan = innerPlanState(hjstate)->plan;
+	double		tuple_bytes;
+	double		batch_bytes;
+
+	tuple_bytes = HJTUPLE_OVERHEAD + MAXALIGN(SizeofMinimalTupleHeader) +
+		MAXALIGN(hashplan->plan_width);
+	batch_bytes = hashtable->totalTuples / hashtable->nbatch * tuple_bytes +
+		(double) hashtable->nbuckets * sizeof(HashJoinTuple);
+
+	return batch_bytes >= HASH_PREFETCH_MIN_SIZE;
+}
+
+/*
+ * ExecHashJoinCreateProbeBuffer
+ *
+ *		set up a buffer for outer tuples, for a hash table with nradix
+ *		radix partitions
+ *
+ * Without radix partitioning, only one group of tuples is read ahead.
+ */
+static HashJoinProbeBuffer *
+ExecHashJoinCreateProbeBuffer(int nradix)
+{
+	HashJoinProbeBuffer *buffer;
+
+	buffer = (HashJoinProbeBuffer *) palloc0(sizeof(HashJoinProbeBuffer));
+	buffer->tupcxt = AllocSetContextCreate(CurrentMemoryContext,
+										   "HashJoinProbeBuffer",
+										   ALLOCSET_DEFAULT_SIZES);
+	if (nradix > 1)
+		buffer->maxtuples = nradix * HASH_RADIX_PROBE_TUPLES;
+	else
+		buffer->maxtuples = HASH_PREFETCH_GROUP;
+	buffer->tuples = (MinimalTuple *)
+		palloc(buffer->maxtuples * sizeof(MinimalTuple));
+	buffer->hashvalues = (uint32 *) palloc(buffer->maxtuples * sizeof(uint32));
+	buffer->bucketnos = (int *) palloc(buffer->maxtuples * sizeof(int));
+	buffer->order = (int *) palloc(buffer->maxtuples * sizeof(int));
+	buffer->counts = (int *) palloc(nradix * sizeof(int));
+
+	return buffer;
+}
+
+/*
+ * ExecHashJoinBufferedOuterGetTuple
+ *
+ *		return the next outer tuple from the probe buffer, refilling it as
+ *		needed
+ *
+ * Whenever we reach the start of a group of HASH_PREFETCH_GROUP tuples, the
+ * buckets of the whole group are prefetched.  Works for both the parallel
+ * and the parallel-oblivious case.
+ */
+static TupleTableSlot *
+ExecHashJoinBufferedOuterGetTuple(PlanState *outerNode,
+								  HashJoinState *hjstate,
+								  uint32 *hashvalue)
+{
+	HashJoinProbeBuffer *buffer = hjstate->hj_ProbeBuffer;
+	int			i;
+
+	if (buffer->next >= buffer->ntuples)
+	{
+		ExecHashJoinFillProbeBuffer(outerNode, hjstate);
+		if (buffer->ntuples == 0)
+			return NULL;		/* end of this batch */
+	}
+
+	if (buffer->next % HASH_PREFETCH_GROUP == 0)
+	{
+		int			bucketnos[HASH_PREFETCH_GROUP];
+		int			n = Min(HASH_PREFETCH_GROUP,
+							buffer->ntuples - buffer->next);
+
+		for (i = 0; i < n; i++)
+			bucketnos[i] = buffer->bucketnos[buffer->order[buffer->next + i]];
+		ExecHashPrefetchBuckets(hjstate->hj_HashTable, bucketnos, n);
+	}
+
+	i = buffer->order[buffer->next++];
+	*hashvalue = buffer->hashvalues[i];
+	ExecForceStoreMinimalTuple(buffer->tuples[i], hjstate->hj_OuterTupleSlot,
+							   false);
+
+	return hjstate->hj_OuterTupleSlot;
+}
+
+/*
+ * ExecHashJoinFillProbeBuffer
+ *
+ *		read as many outer tuples as fit into the probe buffer, and sort
+ *		them by radix partition if the hash table has more than one
+ *
+ * Leaves the buffer empty at the end of the current batch.
+ */
+static void
+ExecHashJoinFillProbeBuffer(PlanState *outerNode, HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	HashJoinProbeBuffer *buffer = hjstate->hj_ProbeBuffer;
+	int			shift = hashtable->log2_nbuckets - hashtable->log2_nradix;
+	TupleTableSlot *slot;
+	MemoryContext oldcxt;
+	uint32		hashvalue;
+	int			pos;
+	int			i;
+
+	/* the outer slot may point into the tuples we're about to free */
+	ExecClearTuple(hjstate->hj_OuterTupleSlot);
+	MemoryContextReset(buffer->tupcxt);
+	buffer->ntuples = 0;
+	buffer->next = 0;
+
+	while (buffer->ntuples < buffer->maxtuples &&
+		   MemoryContextMemAllocated(buffer->tupcxt, false) <
+		   HASH_RADIX_PROBE_BUFFER_SIZE)
+	{
+		int			bucketno;
+		int			batchno;
+
+		if (hashtable->parallel_state)
+			slot = ExecParallelHashJoinReadOuterTuple(outerNode, hjstate,
+													  &hashvalue);
+		else
+			slot = ExecHashJoinReadOuterTuple(outerNode, hjstate, &hashvalue);
+		if (TupIsNull(slot))
+			break;
+
+		oldcxt = MemoryContextSwitchTo(buffer->tupcxt);
+		buffer->tuples[buffer->ntuples] = ExecCopySlotMinimalTuple(slot);
+		MemoryContextSwitchTo(oldcxt);
+
+		ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+		buffer->hashvalues[buffer->ntuples] = hashvalue;
+		buffer->bucketnos[buffer->ntuples] = bucketno;
+		buffer->ntuples++;
+	}
+
+	if (hashtable->nradix == 1)
+	{
+		for (i = 0; i < buffer->ntuples; i++)
+			buffer->order[i] = i;
+		return;
+	}
+
+	/* counting sort by partition, keeping arrival order within each */
+	memset(buffer->counts, 0, hashtable->nradix * sizeof(int));
+	for (i = 0; i < buffer->ntuples; i++)
+		buffer->counts[buffer->bucketnos[i] >> shift]++;
+	pos = 0;
+	for (i = 0; i < hashtable->nradix; i++)
+	{
+		int			count = buffer->counts[i];
+
+		buffer->counts[i] = pos;
+		pos += count;
+	}
+	for (i = 0; i < buffer->ntuples; i++)
+		buffer->order[buffer->counts[buffer->bucketnos[i] >> shift]++] = i;
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -882,6 +1170,21 @@ static TupleTableSlot *
 ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 								  HashJoinState *hjstate,
 								  uint32 *hashvalue)
+{
+	if (hjstate->hj_ProbeBuffer == NULL)
+		return ExecParallelHashJoinReadOuterTuple(outerNode, hjstate,
+												  hashvalue);
+
+	return ExecHashJoinBufferedOuterGetTuple(outerNode, hjstate, hashvalue);
+}
+
+/*
+ * ExecHashJoinReadOuterTuple variant for the parallel case.
+ */
+static TupleTableSlot *
+ExecParallelHashJoinReadOuterTuple(PlanState *outerNode,
+								   HashJoinState *hjstate,
+								   uint32 *hashvalue)
 {
 	HashJoinTable hashtable = hjstate->hj_HashTable;
 	int			curbatch = hashtable->curbatch;
@@ -898,14 +1201,7 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 
 		while (!TupIsNull(slot))
 		{
-			ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
-
-			econtext->ecxt_outertuple = slot;
-			if (ExecHashGetHashValue(hashtable, econtext,
-									 hjstate->hj_OuterHashKeys,
-									 true,	/* outer tuple */
-									 HJ_FILL_OUTER(hjstate),
-									 hashvalue))
+			if (ExecHashJoinGetOuterHashValue(hjstate, slot, hashvalue))
 				return slot;
 
 			/*
@@ -1065,6 +1361,9 @@ ExecHashJoinNewBatch(HashJoinState *hjstate)
 		hashtable->innerBatchFile[curbatch] = NULL;
 	}
 
+	/* lay out the tuples by radix partition, if the table is large */
+	ExecHashTableRadixCluster(hashtable);
+
 	/*
 	 * Rewind outer batch file (if present), so that we can start reading it.
 	 */
@@ -1203,6 +1502,62 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 	return false;
 }
 
+/*
+ * ExecHashJoinRuntimeFilterPass
+ *		check an outer tuple against a hash join's runtime filter
+ *
+ * Called by the outer scan for each tuple it is about to return.  Returns
+ * false if the tuple certainly has no match in the hash table, either
+ * because its hash value is not in the Bloom filter of inner hash values or
+ * because it has a null join key.  Before the hash table has been built, or
+ * if the filter has proved not to be selective enough, every tuple passes.
+ *
+ * The hash value of a tuple that passes is kept in the filter, for the join
+ * to pick up in ExecHashJoinGetOuterHashValue().
+ */
+bool
+ExecHashJoinRuntimeFilterPass(HashJoinRuntimeFilter *filter,
+							  TupleTableSlot *slot)
+{
+	HashJoinTable hashtable = filter->hashtable;
+	ExprContext *econtext = filter->econtext;
+	uint32		hashvalue;
+	bool		pass;
+
+	filter->have_hashvalue = false;
+	if (hashtable == NULL || hashtable->bloom == NULL || filter->disabled)
+		return true;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_outertuple = slot;
+	if (ExecHashGetHashValue(hashtable, econtext, filter->outer_hashkeys,
+							 true, false, &hashvalue))
+		pass = !bloom_lacks_element(hashtable->bloom,
+									(unsigned char *) &hashvalue,
+									sizeof(hashvalue));
+	else
+		pass = false;
+
+	if (pass)
+	{
+		filter->hashvalue = hashvalue;
+		filter->have_hashvalue = true;
+	}
+
+	if (!pass)
+		filter->nrejected++;
+	if (++filter->ntested >= HJ_RUNTIME_FILTER_WINDOW)
+	{
+		if (filter->nrejected <
+			filter->ntested * HJ_RUNTIME_FILTER_MIN_REJECT)
+			filter->disabled = true;
+		filter->ntested = 0;
+		filter->nrejected = 0;
+	}
+
+	return pass;
+}
+
 /*
  * ExecHashJoinSaveTuple
  *		save a tuple to a batch file.
@@ -1341,11 +1696,31 @@ ExecReScanHashJoin(HashJoinState *node)
 											 hashNode->hashtable);
 			/* for safety, be sure to clear child plan node's pointer too */
 			hashNode->hashtable = NULL;
+			if (node->hj_RuntimeFilter)
+				node->hj_RuntimeFilter->hashtable = NULL;
 
 			ExecHashTableDestroy(node->hj_HashTable);
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/*
+			 * The new hash table may be partitioned differently, or not need
+			 * a probe buffer at all, so drop the old one.
+			 */
+			if (node->hj_ProbeBuffer)
+			{
+				HashJoinProbeBuffer *buffer = node->hj_ProbeBuffer;
+
+				MemoryContextDelete(buffer->tupcxt);
+				pfree(buffer->tuples);
+				pfree(buffer->hashvalues);
+				pfree(buffer->bucketnos);
+				pfree(buffer->order);
+				pfree(buffer->counts);
+				pfree(buffer);
+				node->hj_ProbeBuffer = NULL;
+			}
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
@@ -1364,6 +1739,13 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget any buffered outer tuples */
+	if (node->hj_ProbeBuffer)
+	{
+		node->hj_ProbeBuffer->ntuples = 0;
+		node->hj_ProbeBuffer->next = 0;
+	}
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -1391,7 +1773,6 @@ static void
 ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate)
 {
 	PlanState  *outerState = outerPlanState(hjstate);
-	ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
 	HashJoinTable hashtable = hjstate->hj_HashTable;
 	TupleTableSlot *slot;
 	uint32		hashvalue;
@@ -1405,12 +1786,7 @@ ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate)
 		slot = ExecProcNode(outerState);
 		if (TupIsNull(slot))
 			break;
-		econtext->ecxt_outertuple = slot;
-		if (ExecHashGetHashValue(hashtable, econtext,
-								 hjstate->hj_OuterHashKeys,
-								 true,	/* outer tuple */
-								 HJ_FILL_OUTER(hjstate),
-								 &hashvalue))
+		if (ExecHashJoinGetOuterHashValue(hjstate, slot, &hashvalue))
 		{
 			int			batchno;
 			int			bucketno;
@@ -1478,6 +1854,7 @@ ExecHashJoinInitializeDSM(HashJoinState *state, ParallelContext *pcxt)
 	pg_atomic_init_u32(&pstate->distributor, 0);
 	pstate->nparticipants = pcxt->nworkers + 1;
 	pstate->total_tuples = 0;
+	pstate->bloom = InvalidDsaPointer;
 	LWLockInitialize(&pstate->lock,
 					 LWTRANCHE_PARALLEL_HASH_JOIN);
 	BarrierInit(&pstate->build_barrier, 0);
@@ -20,6 +20,9 @@
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
  *
+ *		ExecSeqScanInitBatch	prepares a seqscan for batch mode
+ *		ExecSeqScanBatch		retrieve next batch of qualifying tuples
+ *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
  *		ExecSeqScanReInitializeDSM reinitialize DSM for fresh parallel scan
@@ -29,8 +32,11 @@
 
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHashjoin.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
@@ -102,16 +108,32 @@ SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
  *		tuple.
  *		We call the ExecScan() routine and pass it the appropriate
  *		access method functions.
+ *
+ *		If a parent hash join pushed a runtime filter down to us,
+ *		tuples that it rejects are skipped as well.
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
 ExecSeqScan(PlanState *pstate)
 {
 	SeqScanState *node = castNode(SeqScanState, pstate);
+	TupleTableSlot *slot;
 
-	return ExecScan(&node->ss,
-					(ExecScanAccessMtd) SeqNext,
-					(ExecScanRecheckMtd) SeqRecheck);
+	if (node->runtime_filter == NULL)
+		return ExecScan(&node->ss,
+						(ExecScanAccessMtd) SeqNext,
+						(ExecScanRecheckMtd) SeqRecheck);
+
+	for (;;)
+	{
+		slot = ExecScan(&node->ss,
+						(ExecScanAccessMtd) SeqNext,
+						(ExecScanRecheckMtd) SeqRecheck);
+		if (TupIsNull(slot) ||
+			ExecHashJoinRuntimeFilterPass(node->runtime_filter, slot))
+			return slot;
+		InstrCountFiltered2(node, 1);
+	}
 }
 
 
@@ -231,9 +253,115 @@ ExecReScanSeqScan(SeqScanState *node)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
 
+	if (node->batch)
+		ExecResetTupleBatch(node->batch);
+
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *						Batch Mode Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitBatch
+ *
+ *		Called by a parent node that has been planned to consume
+ *		this scan in batch mode, instead of through ExecProcNode.
+ *		The planner has checked that the target list consists of
+ *		plain Vars of pass-by-value columns, and that the quals can
+ *		be evaluated by ExecBatchQual().
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanInitBatch(SeqScanState *node)
+{
+	Plan	   *plan = node->ss.ps.plan;
+	TupleDesc	tupdesc = RelationGetDescr(node->ss.ss_currentRelation);
+	Bitmapset  *attnos = NULL;
+	ListCell   *lc;
+
+	foreach(lc, plan->targetlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (IsA(tle->expr, Var) && ((Var *) tle->expr)->varattno > 0)
+			attnos = bms_add_member(attnos, ((Var *) tle->expr)->varattno);
+	}
+
+	node->batchqual = ExecInitBatchQual(plan->qual, &attnos);
+	node->batch = ExecInitTupleBatch(tupdesc->natts, attnos, plan->targetlist);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch
+ *
+ *		Fetches the next batch of rows into node->batch, and
+ *		evaluates the scan's quals over it.  Returns false at the end
+ *		of the scan; otherwise, at least one row of the batch is
+ *		selected.  The batch remains valid until the next call.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanBatch(SeqScanState *node)
+{
+	TupleBatch *batch = node->batch;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+
+	/* ExecProcNode would do this for us in tuple-at-a-time mode */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	while (!batch->done)
+	{
+		int			nrows = 0;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (node->ss.ps.instrument)
+			InstrStartNode(node->ss.ps.instrument);
+
+		ResetExprContext(econtext);
+
+		while (nrows < TUPLE_BATCH_SIZE)
+		{
+			TupleTableSlot *slot = SeqNext(node);
+
+			if (slot == NULL)
+			{
+				batch->done = true;
+				break;
+			}
+
+			slot_getsomeattrs(slot, batch->maxattno);
+			for (int i = 0; i < batch->ncolumns; i++)
+			{
+				AttrNumber	attno = batch->columns[i];
+
+				batch->values[attno - 1][nrows] = slot->tts_values[attno - 1];
+				batch->isnull[attno - 1][nrows] = slot->tts_isnull[attno - 1];
+			}
+			nrows++;
+		}
+
+		batch->nrows = nrows;
+		ExecBatchQual(node->batchqual, batch, econtext);
+		InstrCountFiltered1(node, nrows - batch->nselected);
+
+		if (node->ss.ps.instrument)
+			InstrStopNode(node->ss.ps.instrument, batch->nselected);
+
+		if (batch->nselected > 0)
+			return true;
+	}
+
+	batch->nrows = 0;
+	batch->nselected = 0;
+	batch->next = 0;
+	return false;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
@@ -19,9 +19,90 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
+#include "utils/dsa.h"
+#include "utils/sampling.h"
+#include "utils/sharedtuplestore.h"
 #include "utils/tuplesort.h"
 
 
+/*
+ * A parallel-aware Sort range-partitions its input among the participants,
+ * so that each one sorts a disjoint range of the keys and the Gather above
+ * can simply concatenate their outputs in participant order:
+ *
+ * - First, every participant spools its share of the input to a shared
+ *   tuplestore, keeping a reservoir sample of it on the side.
+ * - An elected participant sorts the pooled samples and picks one splitter
+ *   per participant, save one, at evenly spaced quantiles.
+ * - Then all participants read back the spooled input, and route each tuple
+ *   to the partition of the first splitter that is not less than it.
+ * - Finally, each participant that took part in spooling sorts one
+ *   partition, in order of participant number.  One that showed up later
+ *   only helps with routing, and returns no tuples.
+ */
+#define PARALLEL_SORT_SAMPLE_SIZE	1024
+
+/* Barrier phases of a parallel-aware sort */
+#define PSORT_PHASE_SPOOL		0
+#define PSORT_PHASE_SPLIT		1
+#define PSORT_PHASE_PARTITION	2
+#define PSORT_PHASE_SORT		3
+
+/* shm_toc key of the shared state; the plain plan_node_id is SharedSortInfo */
+#define PARALLEL_SORT_KEY(plan_node_id) \
+	(UINT64CONST(0xE000000000000000) | (plan_node_id))
+
+/*
+ * Shared state of a parallel-aware Sort, in the DSM segment.  It's followed
+ * by each participant's partition number, and then by the shared
+ * tuplestores: the spooled input, the samples, and one partition per
+ * participant, sts_size bytes each.
+ */
+typedef struct ParallelSortState
+{
+	SharedFileSet fileset;		/* space for the spooled tuples */
+	Barrier		barrier;		/* PSORT_PHASE_* */
+	int			nparticipants;	/* leader plus planned workers */
+	int			nsplitters;		/* number of splitters chosen */
+	dsa_pointer splitters;		/* the splitters, as MAXALIGN'd tuples */
+	Size		sts_size;		/* size of each SharedTuplestore */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} ParallelSortState;
+
+#define PSORT_STORE_INPUT		0
+#define PSORT_STORE_SAMPLE		1
+#define PSORT_STORE_PARTITION(partno)	(2 + (partno))
+#define PSORT_NUM_STORES(nparticipants)	(2 + (nparticipants))
+
+/* partition sorted by each participant, or -1 */
+#define ParallelSortPartno(pstate) ((int *) (pstate)->data)
+#define ParallelSortStore(pstate, i) \
+	((SharedTuplestore *) ((pstate)->data + \
+						   MAXALIGN(sizeof(int) * (pstate)->nparticipants) + \
+						   (i) * (pstate)->sts_size))
+
+/* a sampled tuple, weighted by the number of input tuples it stands for */
+typedef struct ParallelSortSample
+{
+	MinimalTuple tuple;
+	double		weight;
+} ParallelSortSample;
+
+static void ExecParallelSortFill(SortState *node,
+								 Tuplesortstate *tuplesortstate);
+static void parallel_sort_spool(SortState *node);
+static void parallel_sort_choose_splitters(SortState *node);
+static void parallel_sort_partition(SortState *node);
+static int	parallel_sort_compare_slots(SortState *node,
+										TupleTableSlot *a,
+										TupleTableSlot *b);
+static int	parallel_sort_sample_cmp(const void *a, const void *b, void *arg);
+static Size parallel_sort_state_size(int nparticipants);
+static void parallel_sort_init_stores(SortState *node);
+
+
 /* ----------------------------------------------------------------
  *		ExecSort
  *
@@ -120,9 +201,12 @@ ExecSort(PlanState *pstate)
 
 		/*
 		 * Scan the subplan and feed all the tuples to tuplesort using the
-		 * appropriate method based on the type of sort we're doing.
+		 * appropriate method based on the type of sort we're doing.  If the
+		 * sort is parallel-aware, we sort only our partition instead.
 		 */
-		if (node->datumSort)
+		if (node->psort_state != NULL)
+			ExecParallelSortFill(node, tuplesortstate);
+		else if (node->datumSort)
 		{
 			for (;;)
 			{
@@ -203,6 +287,349 @@ ExecSort(PlanState *pstate)
 	return slot;
 }
 
+/*
+ * ExecSort for a parallel-aware sort: take part in partitioning the input,
+ * and then feed our own partition, if we got one, to tuplesort.
+ */
+static void
+ExecParallelSortFill(SortState *node, Tuplesortstate *tuplesortstate)
+{
+	ParallelSortState *pstate = node->psort_state;
+	int			participant = ParallelWorkerNumber + 1;
+	int			partno;
+
+	switch (BarrierAttach(&pstate->barrier))
+	{
+		case PSORT_PHASE_SPOOL:
+			/* mark ourselves as owning a partition; see below */
+			ParallelSortPartno(pstate)[participant] = 0;
+			parallel_sort_spool(node);
+			if (BarrierArriveAndWait(&pstate->barrier,
+									 WAIT_EVENT_SORT_SPOOL))
+				parallel_sort_choose_splitters(node);
+			/* FALLTHROUGH */
+		case PSORT_PHASE_SPLIT:
+			BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_SORT_SPLIT);
+			/* FALLTHROUGH */
+		case PSORT_PHASE_PARTITION:
+			parallel_sort_partition(node);
+			BarrierArriveAndWait(&pstate->barrier,
+								 WAIT_EVENT_SORT_PARTITION);
+			break;
+		default:
+			/* too late to help */
+			break;
+	}
+	BarrierDetach(&pstate->barrier);
+
+	partno = ParallelSortPartno(pstate)[participant];
+	if (partno >= 0)
+	{
+		SharedTuplestoreAccessor *accessor;
+		TupleTableSlot *slot = node->psort_slot;
+		MinimalTuple tuple;
+
+		accessor = node->psort_stores[PSORT_STORE_PARTITION(partno)];
+		sts_begin_parallel_scan(accessor);
+		while ((tuple = sts_parallel_scan_next(accessor, NULL)) != NULL)
+		{
+			ExecStoreMinimalTuple(tuple, slot, false);
+			if (node->datumSort)
+			{
+				slot_getsomeattrs(slot, 1);
+				tuplesort_putdatum(tuplesortstate,
+								   slot->tts_values[0],
+								   slot->tts_isnull[0]);
+			}
+			else
+				tuplesort_puttupleslot(tuplesortstate, slot);
+		}
+		sts_end_parallel_scan(accessor);
+	}
+}
+
+/*
+ * Spool our share of the input of a parallel-aware sort, and write a sample
+ * of it to the shared sample store.
+ */
+static void
+parallel_sort_spool(SortState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	SharedTuplestoreAccessor *input = node->psort_stores[PSORT_STORE_INPUT];
+	SharedTuplestoreAccessor *sample = node->psort_stores[PSORT_STORE_SAMPLE];
+	MemoryContext samplecxt;
+	MemoryContext oldcxt;
+	MinimalTuple *samples;
+	int			nsamples = 0;
+	double		ntuples = 0;
+	double		rowstoskip = -1;
+	double		weight;
+	ReservoirStateData rstate;
+
+	samplecxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "ParallelSortSample",
+									  ALLOCSET_DEFAULT_SIZES);
+	samples = (MinimalTuple *)
+		palloc(PARALLEL_SORT_SAMPLE_SIZE * sizeof(MinimalTuple));
+	reservoir_init_selection_state(&rstate, PARALLEL_SORT_SAMPLE_SIZE);
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MinimalTuple tuple;
+		bool		shouldFree;
+		int			k = -1;
+
+		slot = ExecProcNode(outerNode);
+		if (TupIsNull(slot))
+			break;
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(input, NULL, tuple);
+
+		/* Vitter's algorithm Z, the same way as acquire_sample_rows() */
+		if (nsamples < PARALLEL_SORT_SAMPLE_SIZE)
+			k = nsamples++;
+		else
+		{
+			if (rowstoskip < 0)
+				rowstoskip = reservoir_get_next_S(&rstate, ntuples,
+												  PARALLEL_SORT_SAMPLE_SIZE);
+			if (rowstoskip <= 0)
+			{
+				k = (int) (PARALLEL_SORT_SAMPLE_SIZE *
+						   sampler_random_fract(rstate.randstate));
+				pfree(samples[k]);
+			}
+			rowstoskip -= 1;
+		}
+		if (k >= 0)
+		{
+			oldcxt = MemoryContextSwitchTo(samplecxt);
+			samples[k] = heap_copy_minimal_tuple(tuple);
+			MemoryContextSwitchTo(oldcxt);
+		}
+		ntuples += 1;
+
+		if (shouldFree)
+			pfree(tuple);
+	}
+	sts_end_write(input);
+
+	weight = nsamples > 0 ? ntuples / nsamples : 0;
+	for (int i = 0; i < nsamples; i++)
+		sts_puttuple(sample, &weight, samples[i]);
+	sts_end_write(sample);
+
+	pfree(samples);
+	MemoryContextDelete(samplecxt);
+}
+
+/*
+ * Choose the splitters of a parallel-aware sort from the pooled samples,
+ * and number the partitions.  Called by a single participant, after all
+ * the others have finished spooling.
+ */
+static void
+parallel_sort_choose_splitters(SortState *node)
+{
+	ParallelSortState *pstate = node->psort_state;
+	dsa_area   *area = node->ss.ps.state->es_query_dsa;
+	SharedTuplestoreAccessor *sample = node->psort_stores[PSORT_STORE_SAMPLE];
+	int		   *partnos = ParallelSortPartno(pstate);
+	ParallelSortSample *samples;
+	MinimalTuple tuple;
+	double		weight;
+	double		total_weight = 0;
+	double		cum_weight = 0;
+	int			maxsamples = PARALLEL_SORT_SAMPLE_SIZE;
+	int			nsamples = 0;
+	int			nparts = 0;
+	int			nsplitters = 0;
+	int		   *splitters;
+	Size		size = 0;
+	char	   *ptr;
+	int			i;
+
+	/* number the partitions in order of participant */
+	for (i = 0; i < pstate->nparticipants; i++)
+	{
+		if (partnos[i] >= 0)
+			partnos[i] = nparts++;
+	}
+	Assert(nparts > 0);
+
+	samples = (ParallelSortSample *)
+		palloc(maxsamples * sizeof(ParallelSortSample));
+	sts_begin_parallel_scan(sample);
+	while ((tuple = sts_parallel_scan_next(sample, &weight)) != NULL)
+	{
+		if (nsamples >= maxsamples)
+		{
+			maxsamples *= 2;
+			samples = (ParallelSortSample *)
+				repalloc(samples, maxsamples * sizeof(ParallelSortSample));
+		}
+		samples[nsamples].tuple = heap_copy_minimal_tuple(tuple);
+		samples[nsamples].weight = weight;
+		total_weight += weight;
+		nsamples++;
+	}
+	sts_end_parallel_scan(sample);
+
+	qsort_arg(samples, nsamples, sizeof(ParallelSortSample),
+			  parallel_sort_sample_cmp, node);
+
+	/*
+	 * The (j+1)'th splitter is the first sample at which the cumulative
+	 * weight reaches (j+1)/nparts of the total.  With very uneven weights,
+	 * a sample can be more than one splitter, leaving a partition empty.
+	 */
+	splitters = (int *) palloc(nparts * sizeof(int));
+	for (i = 0; i < nsamples; i++)
+	{
+		cum_weight += samples[i].weight;
+		while (nsplitters < nparts - 1 &&
+			   cum_weight >= total_weight * (nsplitters + 1) / nparts)
+		{
+			splitters[nsplitters++] = i;
+			size += MAXALIGN(samples[i].tuple->t_len);
+		}
+	}
+
+	pstate->nsplitters = nsplitters;
+	if (nsplitters > 0)
+	{
+		pstate->splitters = dsa_allocate(area, size);
+		ptr = dsa_get_address(area, pstate->splitters);
+		for (i = 0; i < nsplitters; i++)
+		{
+			tuple = samples[splitters[i]].tuple;
+			memcpy(ptr, tuple, tuple->t_len);
+			ptr += MAXALIGN(tuple->t_len);
+		}
+	}
+
+	pfree(splitters);
+
+	for (i = 0; i < nsamples; i++)
+		pfree(samples[i].tuple);
+	pfree(samples);
+}
+
+/*
+ * Read back the spooled input of a parallel-aware sort, and route each tuple
+ * to its partition.
+ */
+static void
+parallel_sort_partition(SortState *node)
+{
+	ParallelSortState *pstate = node->psort_state;
+	dsa_area   *area = node->ss.ps.state->es_query_dsa;
+	SharedTuplestoreAccessor *input = node->psort_stores[PSORT_STORE_INPUT];
+	TupleDesc	tupDesc = node->psort_slot->tts_tupleDescriptor;
+	TupleTableSlot *slot = node->psort_slot;
+	TupleTableSlot **splitters;
+	int			nsplitters = pstate->nsplitters;
+	MinimalTuple tuple;
+	char	   *ptr = NULL;
+	int			i;
+
+	splitters = (TupleTableSlot **)
+		palloc(Max(nsplitters, 1) * sizeof(TupleTableSlot *));
+	if (nsplitters > 0)
+		ptr = dsa_get_address(area, pstate->splitters);
+	for (i = 0; i < nsplitters; i++)
+	{
+		splitters[i] = MakeSingleTupleTableSlot(tupDesc, &TTSOpsMinimalTuple);
+		ExecStoreMinimalTuple((MinimalTuple) ptr, splitters[i], false);
+		ptr += MAXALIGN(((MinimalTuple) ptr)->t_len);
+	}
+
+	sts_begin_parallel_scan(input);
+	while ((tuple = sts_parallel_scan_next(input, NULL)) != NULL)
+	{
+		int			lo = 0;
+		int			hi = nsplitters;
+
+		/* find the first splitter that is not less than the tuple */
+		ExecStoreMinimalTuple(tuple, slot, false);
+		while (lo < hi)
+		{
+			int			mid = (lo + hi) / 2;
+
+			if (parallel_sort_compare_slots(node, slot, splitters[mid]) <= 0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		sts_puttuple(node->psort_stores[PSORT_STORE_PARTITION(lo)],
+					 NULL, tuple);
+	}
+	sts_end_parallel_scan(input);
+	ExecClearTuple(slot);
+
+	for (i = 0; i < pstate->nparticipants; i++)
+		sts_end_write(node->psort_stores[PSORT_STORE_PARTITION(i)]);
+
+	for (i = 0; i < nsplitters; i++)
+		ExecDropSingleTupleTableSlot(splitters[i]);
+	pfree(splitters);
+}
+
+/*
+ * Compare two slots by the sort keys.
+ */
+static int
+parallel_sort_compare_slots(SortState *node, TupleTableSlot *a,
+							TupleTableSlot *b)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+
+	for (int nkey = 0; nkey < plannode->numCols; nkey++)
+	{
+		SortSupport sortKey = node->psort_keys + nkey;
+		AttrNumber	attno = sortKey->ssup_attno;
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+		int			compare;
+
+		datum1 = slot_getattr(a, attno, &isNull1);
+		datum2 = slot_getattr(b, attno, &isNull2);
+
+		compare = ApplySortComparator(datum1, isNull1,
+									  datum2, isNull2,
+									  sortKey);
+		if (compare != 0)
+			return compare;
+	}
+	return 0;
+}
+
+/*
+ * qsort_arg comparator for ParallelSortSamples.
+ */
+static int
+parallel_sort_sample_cmp(const void *a, const void *b, void *arg)
+{
+	SortState  *node = (SortState *) arg;
+	int			compare;
+
+	ExecStoreMinimalTuple(((const ParallelSortSample *) a)->tuple,
+						  node->psort_slot, false);
+	ExecStoreMinimalTuple(((const ParallelSortSample *) b)->tuple,
+						  node->psort_slot2, false);
+	compare = parallel_sort_compare_slots(node, node->psort_slot,
+										  node->psort_slot2);
+	ExecClearTuple(node->psort_slot);
+	ExecClearTuple(node->psort_slot2);
+
+	return compare;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -277,6 +704,35 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	else
 		sortstate->datumSort = false;
 
+	/*
+	 * A parallel-aware sort needs to compare tuples itself, to sample and
+	 * partition them.  The shared state is set up later, if there turns out
+	 * to be a DSM segment.
+	 */
+	if (node->plan.parallel_aware)
+	{
+		TupleDesc	tupDesc = ExecGetResultType(outerPlanState(sortstate));
+
+		sortstate->psort_keys = (SortSupport)
+			palloc0(node->numCols * sizeof(SortSupportData));
+		for (int i = 0; i < node->numCols; i++)
+		{
+			SortSupport sortKey = sortstate->psort_keys + i;
+
+			sortKey->ssup_cxt = CurrentMemoryContext;
+			sortKey->ssup_collation = node->collations[i];
+			sortKey->ssup_nulls_first = node->nullsFirst[i];
+			sortKey->ssup_attno = node->sortColIdx[i];
+			sortKey->abbreviate = false;
+
+			PrepareSortSupportFromOrderingOp(node->sortOperators[i], sortKey);
+		}
+		sortstate->psort_slot = ExecInitExtraTupleSlot(estate, tupDesc,
+													   &TTSOpsMinimalTuple);
+		sortstate->psort_slot2 = ExecInitExtraTupleSlot(estate, tupDesc,
+														&TTSOpsMinimalTuple);
+	}
+
 	SO1_printf("ExecInitSort: %s\n",
 			   "sort node initialized");
 
@@ -381,7 +837,8 @@ ExecReScanSort(SortState *node)
 	if (outerPlan->chgParam != NULL ||
 		node->bounded != node->bounded_Done ||
 		node->bound != node->bound_Done ||
-		!node->randomAccess)
+		!node->randomAccess ||
+		node->psort_state != NULL)
 	{
 		node->sort_Done = false;
 		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
@@ -400,13 +857,56 @@ ExecReScanSort(SortState *node)
 
 /* ----------------------------------------------------------------
  *						Parallel Query Support
+ *
+ *		A parallel-aware Sort needs the shared state described at
+ *		ParallelSortState.  In addition, any Sort can report
+ *		instrumentation from the workers.
  * ----------------------------------------------------------------
  */
 
+static Size
+parallel_sort_state_size(int nparticipants)
+{
+	return add_size(add_size(offsetof(ParallelSortState, data),
+							 MAXALIGN(mul_size(sizeof(int), nparticipants))),
+					mul_size(PSORT_NUM_STORES(nparticipants),
+							 MAXALIGN(sts_estimate(nparticipants))));
+}
+
+/*
+ * (Re)initialize the shared tuplestores of a parallel-aware sort, and attach
+ * the leader to them.
+ */
+static void
+parallel_sort_init_stores(SortState *node)
+{
+	ParallelSortState *pstate = node->psort_state;
+
+	for (int i = 0; i < pstate->nparticipants; i++)
+		ParallelSortPartno(pstate)[i] = -1;
+
+	for (int i = 0; i < PSORT_NUM_STORES(pstate->nparticipants); i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "sort%d.%d",
+				 node->ss.ps.plan->plan_node_id, i);
+		node->psort_stores[i] =
+			sts_initialize(ParallelSortStore(pstate, i),
+						   pstate->nparticipants,
+						   ParallelWorkerNumber + 1,
+						   i == PSORT_STORE_SAMPLE ? sizeof(double) : 0,
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &pstate->fileset,
+						   name);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics, and for
+ *		the shared state of a parallel-aware Sort.
  * ----------------------------------------------------------------
  */
 void
@@ -414,6 +914,13 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   parallel_sort_state_size(pcxt->nworkers + 1));
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -427,7 +934,8 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics, and the shared state
+ *		of a parallel-aware Sort.
  * ----------------------------------------------------------------
  */
 void
@@ -435,6 +943,33 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	/*
+	 * Without a DSM segment there won't be any workers either, and the
+	 * leader just sorts the whole input the usual way.
+	 */
+	if (node->ss.ps.plan->parallel_aware && pcxt->seg != NULL)
+	{
+		ParallelSortState *pstate;
+		int			nparticipants = pcxt->nworkers + 1;
+
+		pstate = shm_toc_allocate(pcxt->toc,
+								  parallel_sort_state_size(nparticipants));
+		SharedFileSetInit(&pstate->fileset, pcxt->seg);
+		BarrierInit(&pstate->barrier, 0);
+		pstate->nparticipants = nparticipants;
+		pstate->nsplitters = 0;
+		pstate->splitters = InvalidDsaPointer;
+		pstate->sts_size = MAXALIGN(sts_estimate(nparticipants));
+		shm_toc_insert(pcxt->toc,
+					   PARALLEL_SORT_KEY(node->ss.ps.plan->plan_node_id),
+					   pstate);
+
+		node->psort_state = pstate;
+		node->psort_stores = palloc(sizeof(SharedTuplestoreAccessor *) *
+									PSORT_NUM_STORES(nparticipants));
+		parallel_sort_init_stores(node);
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -449,15 +984,58 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset the shared state of a parallel-aware Sort for a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	ParallelSortState *pstate = node->psort_state;
+
+	if (pstate == NULL)
+		return;
+
+	/* The workers are gone by now, so nobody has any of the files open */
+	SharedFileSetDeleteAll(&pstate->fileset);
+	BarrierInit(&pstate->barrier, 0);
+	if (DsaPointerIsValid(pstate->splitters))
+		dsa_free(node->ss.ps.state->es_query_dsa, pstate->splitters);
+	pstate->nsplitters = 0;
+	pstate->splitters = InvalidDsaPointer;
+	parallel_sort_init_stores(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for sort statistics, and to the shared
+ *		state of a parallel-aware Sort.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelSortState *pstate;
+
+		pstate = shm_toc_lookup(pwcxt->toc,
+								PARALLEL_SORT_KEY(node->ss.ps.plan->plan_node_id),
+								false);
+		SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+		node->psort_state = pstate;
+		node->psort_stores = palloc(sizeof(SharedTuplestoreAccessor *) *
+									PSORT_NUM_STORES(pstate->nparticipants));
+		for (int i = 0; i < PSORT_NUM_STORES(pstate->nparticipants); i++)
+			node->psort_stores[i] = sts_attach(ParallelSortStore(pstate, i),
+											   ParallelWorkerNumber + 1,
+											   &pstate->fileset);
+	}
+
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 	node->am_worker = true;
@@ -51,6 +51,7 @@ struct bloom_filter
 	unsigned char bitset[FLEXIBLE_ARRAY_MEMBER];
 };
 
+static uint64 bloom_bitset_bits(int64 total_elems, int bloom_work_mem);
 static int	my_bloom_power(uint64 target_bitset_bits);
 static int	optimal_k(uint64 bitset_bits, int64 total_elems);
 static void k_hashes(bloom_filter *filter, uint32 *hashes, unsigned char *elem,
@@ -87,32 +88,33 @@ static inline uint32 mod_m(uint32 a, uint64 m);
 bloom_filter *
 bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 {
-	bloom_filter *filter;
-	int			bloom_power;
-	uint64		bitset_bytes;
-	uint64		bitset_bits;
+	return bloom_init(palloc(bloom_size(total_elems, bloom_work_mem)),
+					  total_elems, bloom_work_mem, seed);
+}
 
-	/*
-	 * Aim for two bytes per element; this is sufficient to get a false
-	 * positive rate below 1%, independent of the size of the bitset or total
-	 * number of elements.  Also, if rounding down the size of the bitset to
-	 * the next lowest power of two turns out to be a significant drop, the
-	 * false positive rate still won't exceed 2% in almost all cases.
-	 */
-	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
-	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+/*
+ * Size of a Bloom filter created with the given arguments
+ */
+Size
+bloom_size(int64 total_elems, int bloom_work_mem)
+{
+	return offsetof(bloom_filter, bitset) +
+		sizeof(unsigned char) * bloom_bitset_bits(total_elems, bloom_work_mem) /
+		BITS_PER_BYTE;
+}
 
-	/*
-	 * Size in bits should be the highest power of two <= target.  bitset_bits
-	 * is uint64 because PG_UINT32_MAX is 2^32 - 1, not 2^32
-	 */
-	bloom_power = my_bloom_power(bitset_bytes * BITS_PER_BYTE);
-	bitset_bits = UINT64CONST(1) << bloom_power;
-	bitset_bytes = bitset_bits / BITS_PER_BYTE;
+/*
+ * Initialize Bloom filter in caller-supplied space of bloom_size() bytes,
+ * such as shared memory.  The arguments are as for bloom_create().
+ */
+bloom_filter *
+bloom_init(void *space, int64 total_elems, int bloom_work_mem, uint64 seed)
+{
+	bloom_filter *filter = (bloom_filter *) space;
+	uint64		bitset_bits = bloom_bitset_bits(total_elems, bloom_work_mem);
 
-	/* Allocate bloom filter with unset bitset */
-	filter = palloc0(offsetof(bloom_filter, bitset) +
-					 sizeof(unsigned char) * bitset_bytes);
+	/* Start out with unset bitset */
+	memset(filter, 0, bloom_size(total_elems, bloom_work_mem));
 	filter->k_hash_funcs = optimal_k(bitset_bits, total_elems);
 	filter->seed = seed;
 	filter->m = bitset_bits;
@@ -129,6 +131,26 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Add all elements of one Bloom filter to another
+ *
+ * Both filters must have been created with the same arguments.  This allows
+ * several processes to each fingerprint part of a set, and then combine
+ * their filters.
+ */
+void
+bloom_union(bloom_filter *filter, bloom_filter *other)
+{
+	uint64		bitset_bytes = filter->m / BITS_PER_BYTE;
+
+	Assert(filter->m == other->m);
+	Assert(filter->k_hash_funcs == other->k_hash_funcs);
+	Assert(filter->seed == other->seed);
+
+	for (uint64 i = 0; i < bitset_bytes; i++)
+		filter->bitset[i] |= other->bitset[i];
+}
+
 /*
  * Add element to Bloom filter
  */
@@ -193,6 +215,34 @@ bloom_prop_bits_set(bloom_filter *filter)
 	return bits_set / (double) filter->m;
 }
 
+/*
+ * Size of bitset, in bits, for given estimated set size and memory budget
+ */
+static uint64
+bloom_bitset_bits(int64 total_elems, int bloom_work_mem)
+{
+	uint64		bitset_bytes;
+	int			bloom_power;
+
+	/*
+	 * Aim for two bytes per element; this is sufficient to get a false
+	 * positive rate below 1%, independent of the size of the bitset or total
+	 * number of elements.  Also, if rounding down the size of the bitset to
+	 * the next lowest power of two turns out to be a significant drop, the
+	 * false positive rate still won't exceed 2% in almost all cases.
+	 */
+	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
+	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+
+	/*
+	 * Size in bits should be the highest power of two <= target.  bitset_bits
+	 * is uint64 because PG_UINT32_MAX is 2^32 - 1, not 2^32
+	 */
+	bloom_power = my_bloom_power(bitset_bytes * BITS_PER_BYTE);
+
+	return UINT64CONST(1) << bloom_power;
+}
+
 /*
  * Which element in the sequence of powers of two is less than or equal to
  * target_bitset_bits?
@@ -373,6 +373,7 @@ _copyGather(const Gather *from)
 	COPY_SCALAR_FIELD(num_workers);
 	COPY_SCALAR_FIELD(rescan_param);
 	COPY_SCALAR_FIELD(single_copy);
+	COPY_SCALAR_FIELD(ordered);
 	COPY_SCALAR_FIELD(invisible);
 	COPY_BITMAPSET_FIELD(initParam);
 
@@ -928,6 +929,7 @@ _copyHashJoin(const HashJoin *from)
 	COPY_NODE_FIELD(hashoperators);
 	COPY_NODE_FIELD(hashcollations);
 	COPY_NODE_FIELD(hashkeys);
+	COPY_SCALAR_FIELD(runtime_filter);
 
 	return newnode;
 }
@@ -1073,6 +1075,7 @@ _copyAgg(const Agg *from)
 	COPY_BITMAPSET_FIELD(aggParams);
 	COPY_NODE_FIELD(groupingSets);
 	COPY_NODE_FIELD(chain);
+	COPY_SCALAR_FIELD(batched);
 
 	return newnode;
 }
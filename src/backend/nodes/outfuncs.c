@@ -508,6 +508,7 @@ _outGather(StringInfo str, const Gather *node)
 	WRITE_INT_FIELD(num_workers);
 	WRITE_INT_FIELD(rescan_param);
 	WRITE_BOOL_FIELD(single_copy);
+	WRITE_BOOL_FIELD(ordered);
 	WRITE_BOOL_FIELD(invisible);
 	WRITE_BITMAPSET_FIELD(initParam);
 }
@@ -785,6 +786,7 @@ _outHashJoin(StringInfo str, const HashJoin *node)
 	WRITE_NODE_FIELD(hashoperators);
 	WRITE_NODE_FIELD(hashcollations);
 	WRITE_NODE_FIELD(hashkeys);
+	WRITE_BOOL_FIELD(runtime_filter);
 }
 
 static void
@@ -805,6 +807,7 @@ _outAgg(StringInfo str, const Agg *node)
 	WRITE_BITMAPSET_FIELD(aggParams);
 	WRITE_NODE_FIELD(groupingSets);
 	WRITE_NODE_FIELD(chain);
+	WRITE_BOOL_FIELD(batched);
 }
 
 static void
@@ -1992,6 +1995,7 @@ _outGatherPath(StringInfo str, const GatherPath *node)
 
 	WRITE_NODE_FIELD(subpath);
 	WRITE_BOOL_FIELD(single_copy);
+	WRITE_BOOL_FIELD(ordered);
 	WRITE_INT_FIELD(num_workers);
 }
 
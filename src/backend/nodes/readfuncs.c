@@ -2198,6 +2198,7 @@ _readHashJoin(void)
 	READ_NODE_FIELD(hashoperators);
 	READ_NODE_FIELD(hashcollations);
 	READ_NODE_FIELD(hashkeys);
+	READ_BOOL_FIELD(runtime_filter);
 
 	READ_DONE();
 }
@@ -2320,6 +2321,7 @@ _readAgg(void)
 	READ_BITMAPSET_FIELD(aggParams);
 	READ_NODE_FIELD(groupingSets);
 	READ_NODE_FIELD(chain);
+	READ_BOOL_FIELD(batched);
 
 	READ_DONE();
 }
@@ -2386,6 +2388,7 @@ _readGather(void)
 	READ_INT_FIELD(num_workers);
 	READ_INT_FIELD(rescan_param);
 	READ_BOOL_FIELD(single_copy);
+	READ_BOOL_FIELD(ordered);
 	READ_BOOL_FIELD(invisible);
 	READ_BITMAPSET_FIELD(initParam);
 
@@ -2831,6 +2831,27 @@ generate_useful_gather_paths(PlannerInfo *root, RelOptInfo *rel, bool override_r
 
 				add_path(rel, &path->path);
 
+				/*
+				 * Also consider a parallel-aware sort below an ordered
+				 * Gather, which doesn't have to merge.
+				 */
+				if (enable_parallel_sort)
+				{
+					tmp = (Path *) create_parallel_sort_path(root,
+															 rel,
+															 subpath,
+															 useful_pathkeys,
+															 -1.0);
+
+					rows = tmp->rows * tmp->parallel_workers;
+
+					add_path(rel, (Path *)
+							 create_ordered_gather_path(root, rel,
+														tmp,
+														rel->reltarget,
+														rowsp));
+				}
+
 				/* Fall through */
 			}
 
@@ -143,13 +143,17 @@ bool		enable_material = true;
 bool		enable_memoize = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_hashjoin_runtime_filter = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = true;
+bool		enable_parallel_sort = false;
 bool		enable_partition_pruning = true;
 bool		enable_async_append = true;
+bool		enable_batch_execution = false;
 
 typedef struct
 {
@@ -2747,6 +2751,82 @@ cost_agg(Path *path, PlannerInfo *root,
 	path->total_cost = total_cost;
 }
 
+/*
+ * cost_parallel_hashagg
+ *		Determines and returns the cost of a parallel-aware hashed Agg,
+ *		including the cost of its partial input path.
+ *
+ * Each participant writes its share of the input out to the shared batches,
+ * then reads back and aggregates its share of the batches; so it sees about
+ * 1/parallel_divisor of the groups, and of the input tuples, which is what
+ * the partial subpath's row count already is.  The partitioning is charged
+ * like a spill of cost_agg(), all of it to the startup cost since no group
+ * can be emitted before all the input has been partitioned.
+ */
+void
+cost_parallel_hashagg(Path *path, PlannerInfo *root,
+					  const AggClauseCosts *aggcosts,
+					  int numGroupCols, double numGroups,
+					  List *quals, Path *subpath)
+{
+	double		parallel_divisor = get_parallel_divisor(path);
+	double		input_tuples = subpath->rows;
+	double		pages;
+	Cost		partition_cost;
+
+	cost_agg(path, root, AGG_HASHED, aggcosts,
+			 numGroupCols, numGroups / parallel_divisor,
+			 quals,
+			 subpath->startup_cost, subpath->total_cost,
+			 input_tuples, subpath->pathtarget->width);
+
+	pages = relation_byte_size(input_tuples, subpath->pathtarget->width) / BLCKSZ;
+	partition_cost = 2.0 * pages * (random_page_cost + seq_page_cost);
+	partition_cost += input_tuples * 2.0 * cpu_tuple_cost;
+
+	path->startup_cost += partition_cost;
+	path->total_cost += partition_cost;
+}
+
+/*
+ * cost_parallel_sort
+ *	  Determines and returns the cost of a parallel-aware Sort, including the
+ *	  cost of its partial input path.
+ *
+ * Each participant spools its share of the input to a shared tuplestore,
+ * reads back about as much to route it to the partitions, writes that out
+ * again and reads back its own partition to sort it.  That's charged like a
+ * spill in cost_parallel_hashagg(), but twice.  Routing a tuple takes a
+ * binary search among the splitters.  The sort itself is of about
+ * 1/parallel_divisor of the input, which is what the partial subpath's row
+ * count already is.
+ */
+void
+cost_parallel_sort(Path *path, PlannerInfo *root,
+				   List *pathkeys, Path *subpath,
+				   double limit_tuples)
+{
+	double		input_tuples = subpath->rows;
+	double		nparts = subpath->parallel_workers + 1;
+	double		pages;
+	Cost		partition_cost;
+
+	cost_sort(path, root, pathkeys,
+			  subpath->total_cost,
+			  input_tuples,
+			  subpath->pathtarget->width,
+			  0.0,
+			  work_mem, limit_tuples);
+
+	pages = relation_byte_size(input_tuples, subpath->pathtarget->width) / BLCKSZ;
+	partition_cost = 4.0 * pages * (random_page_cost + seq_page_cost);
+	partition_cost += input_tuples *
+		(4.0 * cpu_tuple_cost + 2.0 * cpu_operator_cost * LOG2(nparts));
+
+	path->startup_cost += partition_cost;
+	path->total_cost += partition_cost;
+}
+
 /*
  * cost_windowagg
  *		Determines and returns the cost of performing a WindowAgg plan node,
@@ -3754,6 +3834,7 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	int			numbuckets;
 	int			numbatches;
 	int			num_skew_mcvs;
+	int			num_radix_partitions;
 	size_t		space_allowed;	/* unused */
 
 	/* cost of source data */
@@ -3802,7 +3883,8 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 							&space_allowed,
 							&numbuckets,
 							&numbatches,
-							&num_skew_mcvs);
+							&num_skew_mcvs,
+							&num_radix_partitions);
 
 	/*
 	 * If inner relation is too big then we will need to "batch" the join,
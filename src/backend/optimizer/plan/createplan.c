@@ -108,6 +108,7 @@ static Group *create_group_plan(PlannerInfo *root, GroupPath *best_path);
 static Unique *create_upper_unique_plan(PlannerInfo *root, UpperUniquePath *best_path,
 										int flags);
 static Agg *create_agg_plan(PlannerInfo *root, AggPath *best_path);
+static bool batch_agg_supported(Agg *plan, Plan *subplan);
 static Plan *create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path);
 static Result *create_minmaxagg_plan(PlannerInfo *root, MinMaxAggPath *best_path);
 static WindowAgg *create_windowagg_plan(PlannerInfo *root, WindowAggPath *best_path);
@@ -162,6 +163,7 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static bool use_hashjoin_runtime_filter(HashPath *best_path, Plan *outer_plan);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -1854,6 +1856,8 @@ create_gather_plan(PlannerInfo *root, GatherPath *best_path)
 							  best_path->single_copy,
 							  subplan);
 
+	gather_plan->ordered = best_path->ordered;
+
 	copy_generic_path_info(&gather_plan->plan, &best_path->path);
 
 	/* use parallel mode for parallel plans. */
@@ -2226,12 +2230,17 @@ create_agg_plan(PlannerInfo *root, AggPath *best_path)
 	Plan	   *subplan;
 	List	   *tlist;
 	List	   *quals;
+	int			flags = CP_LABEL_TLIST;
 
 	/*
 	 * Agg can project, so no need to be terribly picky about child tlist, but
-	 * we do need grouping columns to be available
+	 * we do need grouping columns to be available.  If the input might be
+	 * consumed in batch mode, though, ask for exactly the needed columns: a
+	 * physical tlist would likely include columns that batches can't hold.
 	 */
-	subplan = create_plan_recurse(root, best_path->subpath, CP_LABEL_TLIST);
+	if (enable_batch_execution && best_path->subpath->pathtype == T_SeqScan)
+		flags |= CP_EXACT_TLIST;
+	subplan = create_plan_recurse(root, best_path->subpath, flags);
 
 	tlist = build_path_tlist(root, &best_path->path);
 
@@ -2254,9 +2263,80 @@ create_agg_plan(PlannerInfo *root, AggPath *best_path)
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
+	plan->batched = enable_batch_execution &&
+		batch_agg_supported(plan, subplan);
+
 	return plan;
 }
 
+/*
+ * batch_agg_supported
+ *	  Can this Agg consume its input in batches?
+ *
+ * Batch mode is limited to a SeqScan input whose target list consists of
+ * plain columns of pass-by-value types, and whose quals can be evaluated by
+ * ExecBatchQual(), i.e. strict "column op constant" comparisons of
+ * pass-by-value types.  See execBatch.c.
+ */
+static bool
+batch_agg_supported(Agg *plan, Plan *subplan)
+{
+	ListCell   *lc;
+
+	if (plan->aggstrategy != AGG_PLAIN && plan->aggstrategy != AGG_HASHED)
+		return false;
+	if (plan->groupingSets != NIL)
+		return false;
+	if (!IsA(subplan, SeqScan))
+		return false;
+
+	foreach(lc, subplan->targetlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		Var		   *var = (Var *) tle->expr;
+
+		if (!IsA(var, Var) || var->varattno <= 0 || var->varlevelsup != 0)
+			return false;
+		if (!get_typbyval(var->vartype))
+			return false;
+	}
+
+	foreach(lc, subplan->qual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			return false;
+		leftop = linitial(opexpr->args);
+		rightop = lsecond(opexpr->args);
+
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+		}
+		else if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+		}
+		else
+			return false;
+
+		if (var->varattno <= 0 || var->varlevelsup != 0 ||
+			!get_typbyval(var->vartype) || !con->constbyval)
+			return false;
+		if (!func_strict(get_opcode(opexpr->opno)))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Given a groupclause for a collection of grouping sets, produce the
  * corresponding groupColIdx.
@@ -4764,12 +4844,51 @@ create_hashjoin_plan(PlannerInfo *root,
 							  (Plan *) hash_plan,
 							  best_path->jpath.jointype,
 							  best_path->jpath.inner_unique);
+	join_plan->runtime_filter = use_hashjoin_runtime_filter(best_path,
+															outer_plan);
 
 	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
 
 	return join_plan;
 }
 
+/*
+ * use_hashjoin_runtime_filter
+ *	  Decide whether a hash join should push a Bloom filter of its inner hash
+ *	  values down into its outer scan.
+ *
+ * The filter costs at least a megabyte of hash_mem to build and a probe for
+ * every outer row, and only saves work for outer rows without a join
+ * partner.  So we use it only if the outer side is large, the inner side is
+ * much smaller than that, and the join is expected to discard most outer
+ * rows.  Only a plain sequential scan can apply the filter, and only joins
+ * that would discard the unmatched outer rows anyway can let it.
+ */
+#define RUNTIME_FILTER_MIN_OUTER_ROWS		10000.0
+#define RUNTIME_FILTER_MAX_INNER_FRACTION	0.1
+#define RUNTIME_FILTER_MAX_MATCH_FRACTION	0.5
+
+static bool
+use_hashjoin_runtime_filter(HashPath *best_path, Plan *outer_plan)
+{
+	JoinType	jointype = best_path->jpath.jointype;
+	double		outer_rows = best_path->jpath.outerjoinpath->rows;
+	double		inner_rows = best_path->jpath.innerjoinpath->rows;
+
+	if (!enable_hashjoin_runtime_filter)
+		return false;
+	if (jointype != JOIN_INNER && jointype != JOIN_SEMI &&
+		jointype != JOIN_RIGHT)
+		return false;
+	if (!IsA(outer_plan, SeqScan))
+		return false;
+
+	return outer_rows >= RUNTIME_FILTER_MIN_OUTER_ROWS &&
+		inner_rows <= outer_rows * RUNTIME_FILTER_MAX_INNER_FRACTION &&
+		best_path->jpath.path.rows <=
+		outer_rows * RUNTIME_FILTER_MAX_MATCH_FRACTION;
+}
+
 
 /*****************************************************************************
  *
@@ -6713,6 +6832,7 @@ make_gather(List *qptlist,
 	node->num_workers = nworkers;
 	node->rescan_param = rescan_param;
 	node->single_copy = single_copy;
+	node->ordered = false;
 	node->invisible = false;
 	node->initParam = NULL;
 
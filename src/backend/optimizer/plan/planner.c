@@ -4737,6 +4737,32 @@ create_ordered_paths(PlannerInfo *root,
 												path, target);
 
 			add_path(ordered_rel, path);
+
+			/*
+			 * Also consider a parallel-aware sort, in which each worker
+			 * sorts one range of the keys, so that the Gather only has to
+			 * return the workers' outputs one after another.
+			 */
+			if (enable_parallel_sort)
+			{
+				path = (Path *) create_parallel_sort_path(root,
+														  ordered_rel,
+														  cheapest_partial_path,
+														  root->sort_pathkeys,
+														  limit_tuples);
+				path = (Path *)
+					create_ordered_gather_path(root, ordered_rel,
+											   path,
+											   path->pathtarget,
+											   &total_groups);
+
+				/* Add projection step if needed */
+				if (path->pathtarget != target)
+					path = apply_projection_to_path(root, ordered_rel,
+													path, target);
+
+				add_path(ordered_rel, path);
+			}
 		}
 
 		/*
@@ -6428,6 +6454,28 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 									 havingQual,
 									 agg_costs,
 									 dNumGroups));
+
+			/*
+			 * Also consider a parallel-aware HashAgg, where the workers
+			 * share out the groups rather than each aggregating everything
+			 * it sees.  Unlike partial aggregation, that doesn't multiply
+			 * the number of groups by the number of workers, and doesn't
+			 * need the aggregates to be combinable.  The Gather on top gets
+			 * added by gather_grouping_paths() below.
+			 */
+			if (enable_parallel_hashagg && grouped_rel->consider_parallel &&
+				input_rel->partial_pathlist != NIL)
+			{
+				add_partial_path(grouped_rel, (Path *)
+								 create_parallel_hashagg_path(root,
+															  grouped_rel,
+															  linitial(input_rel->partial_pathlist),
+															  grouped_rel->reltarget,
+															  parse->groupClause,
+															  havingQual,
+															  agg_costs,
+															  dNumGroups));
+			}
 		}
 
 		/*
@@ -675,6 +675,26 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	return !max_parallel_hazard_walker(node, &context);
 }
 
+/*
+ * is_parallel_safe_expr
+ *		Detect whether the given expr contains only parallel-safe functions
+ *
+ * Unlike is_parallel_safe, this is for use outside the planner, on an
+ * expression that is to be evaluated entirely within parallel workers, so
+ * there are no Params that could be passed down to them.
+ */
+bool
+is_parallel_safe_expr(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_RESTRICTED;
+	context.safe_param_ids = NIL;
+
+	return !max_parallel_hazard_walker(node, &context);
+}
+
 /* core logic for all parallel-hazard checks */
 static bool
 max_parallel_hazard_test(char proparallel, max_parallel_hazard_context *context)
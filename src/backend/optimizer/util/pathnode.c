@@ -1968,6 +1968,7 @@ create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	pathnode->subpath = subpath;
 	pathnode->num_workers = subpath->parallel_workers;
 	pathnode->single_copy = false;
+	pathnode->ordered = false;
 
 	if (pathnode->num_workers == 0)
 	{
@@ -1981,6 +1982,28 @@ create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	return pathnode;
 }
 
+/*
+ * create_ordered_gather_path
+ *	  Creates a path corresponding to a Gather that returns the output of
+ *	  each worker in turn, on top of a parallel-aware sort
+ *
+ * 'rows' may optionally be set to override row estimates from other sources.
+ */
+GatherPath *
+create_ordered_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+						   PathTarget *target, double *rows)
+{
+	GatherPath *pathnode;
+
+	Assert(IsA(subpath, SortPath) && subpath->parallel_aware);
+
+	pathnode = create_gather_path(root, rel, subpath, target, NULL, rows);
+	pathnode->path.pathkeys = subpath->pathkeys;
+	pathnode->ordered = true;
+
+	return pathnode;
+}
+
 /*
  * create_subqueryscan_path
  *	  Creates a path corresponding to a scan of a subquery,
@@ -2970,6 +2993,47 @@ create_sort_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_parallel_sort_path
+ *	  Creates a pathnode that represents a parallel-aware sort, in which the
+ *	  participants range-partition the input among themselves and each sorts
+ *	  one partition
+ *
+ * 'subpath' must be a partial path.  The result is a partial path too, whose
+ * participants' outputs, taken one after another, are sorted; only an
+ * ordered Gather (see create_ordered_gather_path) can put them together.
+ * Other parameters are as for create_sort_path.
+ */
+SortPath *
+create_parallel_sort_path(PlannerInfo *root,
+						  RelOptInfo *rel,
+						  Path *subpath,
+						  List *pathkeys,
+						  double limit_tuples)
+{
+	SortPath   *pathnode = makeNode(SortPath);
+
+	Assert(subpath->parallel_safe && subpath->parallel_workers > 0);
+
+	pathnode->path.pathtype = T_Sort;
+	pathnode->path.parent = rel;
+	/* Sort doesn't project, so use source path's pathtarget */
+	pathnode->path.pathtarget = subpath->pathtarget;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = rel->consider_parallel;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = pathkeys;
+
+	pathnode->subpath = subpath;
+
+	cost_parallel_sort(&pathnode->path, root, pathkeys, subpath,
+					   limit_tuples);
+
+	return pathnode;
+}
+
 /*
  * create_group_path
  *	  Creates a pathnode that represents performing grouping of presorted input
@@ -3143,6 +3207,59 @@ create_agg_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_parallel_hashagg_path
+ *	  Creates a pathnode that represents a parallel-aware hashed aggregation,
+ *	  in which the participants share out the groups among themselves
+ *
+ * 'subpath' must be a partial path; the result is a partial path too, but
+ * one that emits each group exactly once, so no finalizing is needed above
+ * the Gather.  Other parameters are as for create_agg_path.
+ */
+AggPath *
+create_parallel_hashagg_path(PlannerInfo *root,
+							 RelOptInfo *rel,
+							 Path *subpath,
+							 PathTarget *target,
+							 List *groupClause,
+							 List *qual,
+							 const AggClauseCosts *aggcosts,
+							 double numGroups)
+{
+	AggPath    *pathnode = makeNode(AggPath);
+
+	Assert(subpath->parallel_safe && subpath->parallel_workers > 0);
+
+	pathnode->path.pathtype = T_Agg;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = target;
+	/* For now, assume we are above any joins, so no parameterization */
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = rel->consider_parallel;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = NIL;	/* output is unordered */
+	pathnode->subpath = subpath;
+
+	pathnode->aggstrategy = AGG_HASHED;
+	pathnode->aggsplit = AGGSPLIT_SIMPLE;
+	pathnode->numGroups = numGroups;
+	pathnode->transitionSpace = aggcosts ? aggcosts->transitionSpace : 0;
+	pathnode->groupClause = groupClause;
+	pathnode->qual = qual;
+
+	cost_parallel_hashagg(&pathnode->path, root, aggcosts,
+						  list_length(groupClause), numGroups,
+						  qual, subpath);
+
+	/* add tlist eval cost for each output row */
+	pathnode->path.startup_cost += target->cost.startup;
+	pathnode->path.total_cost += target->cost.startup +
+		target->cost.per_tuple * pathnode->path.rows;
+
+	return pathnode;
+}
+
 /*
  * create_groupingsets_path
  *	  Creates a pathnode that represents performing GROUPING SETS aggregation
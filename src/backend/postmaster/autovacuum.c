@@ -41,6 +41,15 @@
  * launcher can also balance the settings for the various remaining workers'
  * cost-based vacuum delay feature.
  *
+ * Tables are not processed in pg_class order.  Each worker ranks the tables
+ * it finds needing attention by urgency (tables at risk of Xid or multixact
+ * wraparound first, then by how far past its vacuum or analyze thresholds
+ * each table is) and publishes them in a cluster-wide work queue in shared
+ * memory.  Workers then repeatedly claim the most urgent unclaimed entry for
+ * their database.  The launcher looks at the queue too: a database whose
+ * queued tables have waited longer than autovacuum_naptime is given another
+ * worker ahead of the regular schedule, though not twice in a row.
+ *
  * Note that there can be more than one worker in a database concurrently.
  * They will store the table they are currently vacuuming in shared memory, so
  * that other workers avoid being blocked waiting for the vacuum lock for that
@@ -77,6 +86,7 @@
 #include "catalog/pg_database.h"
 #include "commands/dbcommands.h"
 #include "commands/vacuum.h"
+#include "funcapi.h"
 #include "lib/ilist.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
@@ -106,6 +116,7 @@
 #include "utils/syscache.h"
 #include "utils/timeout.h"
 #include "utils/timestamp.h"
+#include "utils/tuplestore.h"
 
 
 /*
@@ -129,9 +140,6 @@ int			autovacuum_vac_cost_limit;
 
 int			Log_autovacuum_min_duration = -1;
 
-/* how long to keep pgstat data in the launcher, in milliseconds */
-#define STATS_READ_DELAY 1000
-
 /* the minimum allowed time between two awakenings of the launcher */
 #define MIN_AUTOVAC_SLEEPTIME 100.0 /* milliseconds */
 #define MAX_AUTOVAC_SLEEPTIME 300	/* seconds */
@@ -263,6 +271,38 @@ typedef struct AutoVacuumWorkItem
 
 #define NUM_WORKITEMS	256
 
+/*
+ * Autovacuum work queue, stored in AutoVacuumShmem->av_queue.  Each entry is
+ * a table that some worker found needing vacuum or analyze, along with the
+ * data it was ranked by.  Shared catalogs are queued with avq_database set to
+ * InvalidOid, so that a worker in any database can process them.  The queue
+ * is protected by AutovacuumScheduleLock.
+ */
+typedef struct AutoVacuumQueueItem
+{
+	bool		avq_used;		/* below data is valid */
+	Oid			avq_database;
+	Oid			avq_relation;
+	int			avq_claimedby;	/* PID of the worker processing it, or 0 */
+	bool		avq_wraparound; /* vacuum needed to prevent wraparound */
+	bool		avq_dovacuum;
+	bool		avq_doanalyze;
+	int32		avq_xid_age;	/* age of relfrozenxid */
+	PgStat_Counter avq_dead_tuples;
+	PgStat_Counter avq_ins_tuples;	/* inserts since last vacuum */
+	double		avq_score;		/* see relation_needs_vacanalyze */
+	TimestampTz avq_queued_at;
+} AutoVacuumQueueItem;
+
+#define NUM_QUEUE_ITEMS	1024
+
+/* struct to keep track of tables a worker found needing vacuum or analyze */
+typedef struct av_candidate
+{
+	bool		ac_queued;		/* already published or processed? */
+	AutoVacuumQueueItem ac_item;	/* work queue entry for this table */
+} av_candidate;
+
 /*-------------
  * The main autovacuum shmem struct.  On shared memory we store this main
  * struct and the array of WorkerInfo structs.  This struct keeps:
@@ -274,9 +314,11 @@ typedef struct AutoVacuumWorkItem
  * av_startingWorker pointer to WorkerInfo currently being started (cleared by
  *					the worker itself as soon as it's up and running)
  * av_workItems		work item array
+ * av_queue			work queue array
  *
- * This struct is protected by AutovacuumLock, except for av_signal and parts
- * of the worker list (see above).
+ * This struct is protected by AutovacuumLock, except for av_signal, parts
+ * of the worker list (see above) and the work queue, which is protected by
+ * AutovacuumScheduleLock.
  *-------------
  */
 typedef struct
@@ -287,6 +329,7 @@ typedef struct
 	dlist_head	av_runningWorkers;
 	WorkerInfo	av_startingWorker;
 	AutoVacuumWorkItem av_workItems[NUM_WORKITEMS];
+	AutoVacuumQueueItem av_queue[NUM_QUEUE_ITEMS];
 } AutoVacuumShmemStruct;
 
 static AutoVacuumShmemStruct *AutoVacuumShmem;
@@ -298,6 +341,9 @@ static AutoVacuumShmemStruct *AutoVacuumShmem;
 static dlist_head DatabaseList = DLIST_STATIC_INIT(DatabaseList);
 static MemoryContext DatabaseListCxt = NULL;
 
+/* Was the last worker the launcher started sent to a backlogged database? */
+static bool LastWorkerForBacklog = false;
+
 /* Pointer to my own WorkerInfo, valid on each worker */
 static WorkerInfo MyWorkerInfo = NULL;
 
@@ -325,6 +371,20 @@ static void autovac_balance_cost(void);
 static void do_autovacuum(void);
 static void FreeWorkerInfo(int code, Datum arg);
 
+static av_candidate *make_candidate(Form_pg_class classForm,
+									PgStat_StatTabEntry *tabentry,
+									bool dovacuum, bool doanalyze,
+									bool wraparound, double score);
+static bool autovac_queue_outranks(const AutoVacuumQueueItem *a,
+								   const AutoVacuumQueueItem *b);
+static int	av_candidate_comparator(const ListCell *a, const ListCell *b);
+static void autovac_queue_forget_database(Oid dboid);
+static int	autovac_queue_publish(List *candidates);
+static Oid	autovac_queue_claim(List *candidates);
+static void autovac_queue_release(void);
+static bool autovac_queue_backlog(Oid dboid, TimestampTz queued_before,
+								  AutoVacuumQueueItem *top);
+
 static autovac_table *table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 											TupleDesc pg_class_desc,
 											int effective_multixact_freeze_max_age);
@@ -336,21 +396,18 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  Form_pg_class classForm,
 									  PgStat_StatTabEntry *tabentry,
 									  int effective_multixact_freeze_max_age,
-									  bool *dovacuum, bool *doanalyze, bool *wraparound);
+									  bool *dovacuum, bool *doanalyze, bool *wraparound,
+									  double *score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 										 TupleDesc pg_class_desc);
-static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
-													  PgStat_StatDBEntry *shared,
-													  PgStat_StatDBEntry *dbentry);
 static void perform_work_item(AutoVacuumWorkItem *workitem);
 static void autovac_report_activity(autovac_table *tab);
 static void autovac_report_workitem(AutoVacuumWorkItem *workitem,
 									const char *nspname, const char *relname);
 static void avl_sigusr2_handler(SIGNAL_ARGS);
-static void autovac_refresh_stats(void);
 
 
 
@@ -556,8 +613,7 @@ AutoVacLauncherMain(int argc, char *argv[])
 		dlist_init(&DatabaseList);
 
 		/*
-		 * Make sure pgstat also considers our stat data as gone.  Note: we
-		 * mustn't use autovac_refresh_stats here.
+		 * Make sure pgstat also considers our stat data as gone.
 		 */
 		pgstat_clear_snapshot();
 
@@ -963,7 +1019,7 @@ rebuild_database_list(Oid newdb)
 	dlist_iter	iter;
 
 	/* use fresh stats */
-	autovac_refresh_stats();
+	pgstat_clear_snapshot();
 
 	newcxt = AllocSetContextCreate(AutovacMemCxt,
 								   "AV dblist",
@@ -1158,8 +1214,11 @@ do_start_worker(void)
 	MultiXactId multiForceLimit;
 	bool		for_xid_wrap;
 	bool		for_multi_wrap;
+	avw_dbase  *backlogdb;
+	AutoVacuumQueueItem backlog_top;
 	avw_dbase  *avdb;
 	TimestampTz current_time;
+	TimestampTz backlog_limit;
 	bool		skipit = false;
 	Oid			retval = InvalidOid;
 	MemoryContext tmpcxt,
@@ -1184,7 +1243,7 @@ do_start_worker(void)
 	oldcxt = MemoryContextSwitchTo(tmpcxt);
 
 	/* use fresh stats */
-	autovac_refresh_stats();
+	pgstat_clear_snapshot();
 
 	/* Get a list of databases */
 	dblist = get_database_list();
@@ -1216,6 +1275,18 @@ do_start_worker(void)
 	 * if any is in MultiXactId wraparound.  Note that those in Xid wraparound
 	 * danger are given more priority than those in multi wraparound danger.
 	 *
+	 * Next come backlogged databases: those with work queue entries that have
+	 * stayed unclaimed for more than autovacuum_naptime, which means that their
+	 * running workers can't keep up.  (A worker queues everything it finds when
+	 * it starts, so merely having unclaimed entries says nothing.)  We pick the
+	 * one whose most urgent such entry outranks the others'.  Like any other
+	 * database, such a database is skipped if we already started a worker for
+	 * it less than autovacuum_naptime ago, so that we don't pile up workers
+	 * while the last one is still getting started.  And so that busy databases
+	 * can't starve quiet ones, we never start two workers in a row for a
+	 * backlog: after one that was, the least recently vacuumed database gets
+	 * its turn.
+	 *
 	 * Note that a database with no stats entry is not considered, except for
 	 * Xid wraparound purposes.  The theory is that if no one has ever
 	 * connected to it since the stats were last initialized, it doesn't need
@@ -1231,10 +1302,15 @@ do_start_worker(void)
 	avdb = NULL;
 	for_xid_wrap = false;
 	for_multi_wrap = false;
+	backlogdb = NULL;
+	memset(&backlog_top, 0, sizeof(backlog_top));
 	current_time = GetCurrentTimestamp();
+	backlog_limit = TimestampTzPlusMilliseconds(current_time,
+												-autovacuum_naptime * 1000);
 	foreach(cell, dblist)
 	{
 		avw_dbase  *tmp = lfirst(cell);
+		AutoVacuumQueueItem topitem;
 		dlist_iter	iter;
 
 		/* Check to see if this one is at risk of wraparound */
@@ -1302,6 +1378,15 @@ do_start_worker(void)
 		if (skipit)
 			continue;
 
+		/* Remember the most urgent work queue backlog, see above */
+		if (autovac_queue_backlog(tmp->adw_datid, backlog_limit, &topitem) &&
+			(backlogdb == NULL ||
+			 autovac_queue_outranks(&topitem, &backlog_top)))
+		{
+			backlogdb = tmp;
+			backlog_top = topitem;
+		}
+
 		/*
 		 * Remember the db with oldest autovac time.  (If we are here, both
 		 * tmp->entry and db->entry must be non-null.)
@@ -1311,6 +1396,18 @@ do_start_worker(void)
 			avdb = tmp;
 	}
 
+	/* Let a backlog go first, unless the previous worker went to one */
+	if (!for_xid_wrap && !for_multi_wrap)
+	{
+		if (backlogdb != NULL && (!LastWorkerForBacklog || avdb == NULL))
+		{
+			avdb = backlogdb;
+			LastWorkerForBacklog = true;
+		}
+		else if (avdb != NULL)
+			LastWorkerForBacklog = false;
+	}
+
 	/* Found a database -- process it */
 	if (avdb != NULL)
 	{
@@ -1688,7 +1785,7 @@ AutoVacWorkerMain(int argc, char *argv[])
 		char		dbname[NAMEDATALEN];
 
 		/*
-		 * Report autovac startup to the stats collector.  We deliberately do
+		 * Report autovac startup to the stats system.  We deliberately do
 		 * this before InitPostgres, so that the last_autovac_time will get
 		 * updated even if the connection attempt fails.  This is to prevent
 		 * autovac from getting "stuck" repeatedly selecting an unopenable
@@ -1735,6 +1832,11 @@ FreeWorkerInfo(int code, Datum arg)
 {
 	if (MyWorkerInfo != NULL)
 	{
+		Oid			dboid = MyWorkerInfo->wi_dboid;
+		dlist_iter	iter;
+		bool		lastworker = true;
+
+		LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
 		LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
 		/*
@@ -1771,7 +1873,30 @@ FreeWorkerInfo(int code, Datum arg)
 		 * workers
 		 */
 		AutoVacuumShmem->av_signal[AutoVacRebalance] = true;
+
+		/*
+		 * Drop the work queue entry we were processing, if we died doing so.
+		 * If we were the last worker in our database, also drop its other
+		 * entries: whatever still needs work will be found by the next
+		 * worker visiting it, and the launcher shouldn't mistake leftovers
+		 * for a backlog that a running worker can't keep up with.
+		 */
+		autovac_queue_release();
+		dlist_foreach(iter, &AutoVacuumShmem->av_runningWorkers)
+		{
+			WorkerInfo	worker = dlist_container(WorkerInfoData, wi_links, iter.cur);
+
+			if (worker->wi_dboid == dboid)
+			{
+				lastworker = false;
+				break;
+			}
+		}
+		if (lastworker)
+			autovac_queue_forget_database(dboid);
+
 		LWLockRelease(AutovacuumLock);
+		LWLockRelease(AutovacuumScheduleLock);
 	}
 }
 
@@ -1947,6 +2072,295 @@ get_database_list(void)
 	return dblist;
 }
 
+/*
+ * make_candidate
+ *		Build the work queue entry for a table that needs vacuum or analyze
+ *		in our database.
+ */
+static av_candidate *
+make_candidate(Form_pg_class classForm, PgStat_StatTabEntry *tabentry,
+			   bool dovacuum, bool doanalyze, bool wraparound, double score)
+{
+	av_candidate *cand = palloc0(sizeof(av_candidate));
+	AutoVacuumQueueItem *item = &cand->ac_item;
+
+	item->avq_used = true;
+	item->avq_database = classForm->relisshared ? InvalidOid : MyDatabaseId;
+	item->avq_relation = classForm->oid;
+	item->avq_wraparound = wraparound;
+	item->avq_dovacuum = dovacuum;
+	item->avq_doanalyze = doanalyze;
+	if (TransactionIdIsNormal(classForm->relfrozenxid))
+		item->avq_xid_age = (int32) (recentXid - classForm->relfrozenxid);
+	if (tabentry)
+	{
+		item->avq_dead_tuples = tabentry->n_dead_tuples;
+		item->avq_ins_tuples = tabentry->inserts_since_vacuum;
+	}
+	item->avq_score = score;
+
+	return cand;
+}
+
+/*
+ * autovac_queue_outranks
+ *		Is work queue entry a more urgent than b?
+ *
+ * Tables at risk of wraparound come first, whatever their score: putting
+ * them off could eventually force the system to stop assigning new XIDs.
+ */
+static bool
+autovac_queue_outranks(const AutoVacuumQueueItem *a,
+					   const AutoVacuumQueueItem *b)
+{
+	if (a->avq_wraparound != b->avq_wraparound)
+		return a->avq_wraparound;
+	return a->avq_score > b->avq_score;
+}
+
+/*
+ * list_sort comparator sorting av_candidate entries, most urgent first
+ */
+static int
+av_candidate_comparator(const ListCell *a, const ListCell *b)
+{
+	av_candidate *ca = (av_candidate *) lfirst(a);
+	av_candidate *cb = (av_candidate *) lfirst(b);
+
+	if (autovac_queue_outranks(&ca->ac_item, &cb->ac_item))
+		return -1;
+	if (autovac_queue_outranks(&cb->ac_item, &ca->ac_item))
+		return 1;
+	return 0;
+}
+
+/*
+ * autovac_queue_forget_database
+ *		Remove the unclaimed work queue entries of the given database.
+ *
+ * Caller must hold AutovacuumScheduleLock exclusively.
+ */
+static void
+autovac_queue_forget_database(Oid dboid)
+{
+	int			i;
+
+	for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+	{
+		AutoVacuumQueueItem *qitem = &AutoVacuumShmem->av_queue[i];
+
+		if (qitem->avq_used && qitem->avq_claimedby == 0 &&
+			qitem->avq_database == dboid)
+			qitem->avq_used = false;
+	}
+}
+
+/*
+ * autovac_queue_publish
+ *		Add those of our candidate tables that aren't queued yet to the work
+ *		queue.
+ *
+ * The candidates list must be sorted by urgency.  A table that somebody else
+ * already queued (a concurrent worker in our database, or in any database for
+ * a shared catalog) just gets its entry refreshed, unless it's being
+ * processed already.  When the queue is full, a candidate takes the place of
+ * the least urgent unclaimed entry if it outranks it; otherwise it, and every
+ * candidate after it, is left for a later call.  An entry pushed out this way
+ * is still processed by the worker that found it, or else found again by the
+ * next worker visiting its database.
+ *
+ * Returns the number of candidates added.  Caller must hold
+ * AutovacuumScheduleLock exclusively.
+ */
+static int
+autovac_queue_publish(List *candidates)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int			nadded = 0;
+	ListCell   *lc;
+
+	foreach(lc, candidates)
+	{
+		av_candidate *cand = (av_candidate *) lfirst(lc);
+		AutoVacuumQueueItem *item = &cand->ac_item;
+		AutoVacuumQueueItem *existing = NULL;
+		AutoVacuumQueueItem *freeslot = NULL;
+		AutoVacuumQueueItem *victim = NULL;
+		int			i;
+
+		if (cand->ac_queued)
+			continue;
+
+		for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+		{
+			AutoVacuumQueueItem *qitem = &AutoVacuumShmem->av_queue[i];
+
+			if (!qitem->avq_used)
+			{
+				if (freeslot == NULL)
+					freeslot = qitem;
+				continue;
+			}
+
+			if (qitem->avq_database == item->avq_database &&
+				qitem->avq_relation == item->avq_relation)
+			{
+				existing = qitem;
+				break;
+			}
+
+			if (qitem->avq_claimedby == 0 &&
+				(victim == NULL || autovac_queue_outranks(victim, qitem)))
+				victim = qitem;
+		}
+
+		if (existing != NULL)
+		{
+			if (existing->avq_claimedby == 0)
+			{
+				TimestampTz queued_at = existing->avq_queued_at;
+
+				*existing = *item;
+				existing->avq_queued_at = queued_at;
+			}
+			cand->ac_queued = true;
+			continue;
+		}
+
+		if (freeslot == NULL)
+		{
+			if (victim == NULL || !autovac_queue_outranks(item, victim))
+				break;
+			freeslot = victim;
+		}
+
+		*freeslot = *item;
+		freeslot->avq_claimedby = 0;
+		freeslot->avq_queued_at = now;
+		cand->ac_queued = true;
+		nadded++;
+	}
+
+	return nadded;
+}
+
+/*
+ * autovac_queue_claim
+ *		Choose the next table for this worker to process.
+ *
+ * That's the most urgent unclaimed work queue entry of our database or of a
+ * shared catalog, which we mark as being processed by us.  If there's none,
+ * we queue more of our candidates and try again; if none of those fit in the
+ * queue, we take the most urgent one directly.  Returns InvalidOid when
+ * there's nothing left to do.
+ *
+ * Caller must hold AutovacuumScheduleLock exclusively.
+ */
+static Oid
+autovac_queue_claim(List *candidates)
+{
+	for (;;)
+	{
+		AutoVacuumQueueItem *best = NULL;
+		ListCell   *lc;
+		int			i;
+
+		for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+		{
+			AutoVacuumQueueItem *qitem = &AutoVacuumShmem->av_queue[i];
+
+			if (!qitem->avq_used || qitem->avq_claimedby != 0)
+				continue;
+			if (qitem->avq_database != MyDatabaseId &&
+				OidIsValid(qitem->avq_database))
+				continue;
+
+			if (best == NULL || autovac_queue_outranks(qitem, best))
+				best = qitem;
+		}
+
+		if (best != NULL)
+		{
+			best->avq_claimedby = MyProcPid;
+			return best->avq_relation;
+		}
+
+		if (autovac_queue_publish(candidates) > 0)
+			continue;
+
+		foreach(lc, candidates)
+		{
+			av_candidate *cand = (av_candidate *) lfirst(lc);
+
+			if (!cand->ac_queued)
+			{
+				cand->ac_queued = true;
+				return cand->ac_item.avq_relation;
+			}
+		}
+
+		return InvalidOid;
+	}
+}
+
+/*
+ * autovac_queue_release
+ *		Remove the work queue entry this worker has claimed, if any.
+ *
+ * Caller must hold AutovacuumScheduleLock exclusively.
+ */
+static void
+autovac_queue_release(void)
+{
+	int			i;
+
+	for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+	{
+		AutoVacuumQueueItem *qitem = &AutoVacuumShmem->av_queue[i];
+
+		if (qitem->avq_used && qitem->avq_claimedby == MyProcPid)
+			qitem->avq_used = false;
+	}
+}
+
+/*
+ * autovac_queue_backlog
+ *		Find the most urgent work queue entry of a database that has been
+ *		waiting to be claimed since queued_before or earlier.
+ *
+ * Returns false if there's none; otherwise a copy of the entry is returned
+ * in *top.  *top is zeroed out in the former case.
+ */
+static bool
+autovac_queue_backlog(Oid dboid, TimestampTz queued_before,
+					  AutoVacuumQueueItem *top)
+{
+	bool		found = false;
+	int			i;
+
+	memset(top, 0, sizeof(AutoVacuumQueueItem));
+
+	LWLockAcquire(AutovacuumScheduleLock, LW_SHARED);
+	for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+	{
+		AutoVacuumQueueItem *qitem = &AutoVacuumShmem->av_queue[i];
+
+		if (!qitem->avq_used || qitem->avq_claimedby != 0 ||
+			qitem->avq_database != dboid ||
+			qitem->avq_queued_at > queued_before)
+			continue;
+
+		if (!found || autovac_queue_outranks(qitem, top))
+		{
+			*top = *qitem;
+			found = true;
+		}
+	}
+	LWLockRelease(AutovacuumScheduleLock);
+
+	return found;
+}
+
 /*
  * Process a database table-by-table
  *
@@ -1960,13 +2374,11 @@ do_autovacuum(void)
 	HeapTuple	tuple;
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
-	List	   *table_oids = NIL;
+	List	   *candidates = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
-	ListCell   *volatile cell;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
+	ListCell   *cell;
 	BufferAccessStrategy bstrategy;
 	ScanKeyData key;
 	TupleDesc	pg_class_desc;
@@ -1985,19 +2397,13 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_SIZES);
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/*
-	 * may be NULL if we couldn't find an entry (only happens if we are
-	 * forcing a vacuum for anti-wrap purposes).
-	 */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* Start a transaction so our commands have one to play into. */
 	StartTransactionCommand();
 
 	/*
-	 * Clean up any dead statistics collector entries for this DB. We always
-	 * want to do this exactly once per DB-processing cycle, even if we find
-	 * nothing worth vacuuming in the database.
+	 * Clean up any dead statistics entries for this DB. We always want to do
+	 * this exactly once per DB-processing cycle, even if we find nothing
+	 * worth vacuuming in the database.
 	 */
 	pgstat_vacuum_stat();
 
@@ -2038,9 +2444,6 @@ do_autovacuum(void)
 	/* StartTransactionCommand changed elsewhere */
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/* The database hash where pgstat keeps shared relations */
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-
 	classRel = table_open(RelationRelationId, AccessShareLock);
 
 	/* create a copy so we can use it after closing pg_class */
@@ -2084,6 +2487,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2118,17 +2522,20 @@ do_autovacuum(void)
 
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+												  relid);
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+			candidates = lappend(candidates,
+								 make_candidate(classForm, tabentry,
+												dovacuum, doanalyze,
+												wraparound, score));
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2177,6 +2584,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2202,21 +2610,36 @@ do_autovacuum(void)
 		}
 
 		/* Fetch the pgstat entry for this table */
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+												  relid);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+			candidates = lappend(candidates,
+								 make_candidate(classForm, tabentry,
+												dovacuum, false,
+												wraparound, score));
 	}
 
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Rank the tables we found by urgency, and publish them in the work
+	 * queue, replacing whatever was left there for this database by previous
+	 * workers; our information is fresher.
+	 */
+	list_sort(candidates, av_candidate_comparator);
+
+	LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
+	autovac_queue_forget_database(MyDatabaseId);
+	autovac_queue_publish(candidates);
+	LWLockRelease(AutovacuumScheduleLock);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2320,11 +2743,11 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_SIZES);
 
 	/*
-	 * Perform operations on collected tables.
+	 * Perform operations on queued tables, most urgent first.
 	 */
-	foreach(cell, table_oids)
+	for (;;)
 	{
-		Oid			relid = lfirst_oid(cell);
+		Oid			relid;
 		HeapTuple	classTup;
 		autovac_table *tab;
 		bool		isshared;
@@ -2351,6 +2774,17 @@ do_autovacuum(void)
 			 */
 		}
 
+		/*
+		 * Claim the next table.  This also marks the work queue entry, if
+		 * any, as being processed by us, so that no other worker picks it.
+		 */
+		LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
+		relid = autovac_queue_claim(candidates);
+		LWLockRelease(AutovacuumScheduleLock);
+
+		if (!OidIsValid(relid))
+			break;
+
 		/*
 		 * Find out whether the table is shared or not.  (It's slightly
 		 * annoying to fetch the syscache entry just for this, but in typical
@@ -2361,7 +2795,13 @@ do_autovacuum(void)
 		 */
 		classTup = SearchSysCache1(RELOID, ObjectIdGetDatum(relid));
 		if (!HeapTupleIsValid(classTup))
-			continue;			/* somebody deleted the rel, forget it */
+		{
+			/* somebody deleted the rel, forget it */
+			LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
+			autovac_queue_release();
+			LWLockRelease(AutovacuumScheduleLock);
+			continue;
+		}
 		isshared = ((Form_pg_class) GETSTRUCT(classTup))->relisshared;
 		ReleaseSysCache(classTup);
 
@@ -2400,6 +2840,7 @@ do_autovacuum(void)
 		LWLockRelease(AutovacuumLock);
 		if (skipit)
 		{
+			autovac_queue_release();
 			LWLockRelease(AutovacuumScheduleLock);
 			continue;
 		}
@@ -2433,6 +2874,7 @@ do_autovacuum(void)
 			LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
 			MyWorkerInfo->wi_tableoid = InvalidOid;
 			MyWorkerInfo->wi_sharedrel = false;
+			autovac_queue_release();
 			LWLockRelease(AutovacuumScheduleLock);
 			continue;
 		}
@@ -2554,6 +2996,7 @@ deleted:
 		LWLockAcquire(AutovacuumScheduleLock, LW_EXCLUSIVE);
 		MyWorkerInfo->wi_tableoid = InvalidOid;
 		MyWorkerInfo->wi_sharedrel = false;
+		autovac_queue_release();
 		LWLockRelease(AutovacuumScheduleLock);
 
 		/* restore vacuum cost GUCs for the next iteration */
@@ -2767,30 +3210,6 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 	return av;
 }
 
-/*
- * get_pgstat_tabentry_relid
- *
- * Fetch the pgstat entry of a table, either local to a database or shared.
- */
-static PgStat_StatTabEntry *
-get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry)
-{
-	PgStat_StatTabEntry *tabentry = NULL;
-
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
-
-	return tabentry;
-}
-
 /*
  * table_recheck_autovac
  *
@@ -2862,7 +3281,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	}
 
 	/* Use fresh stats and recheck again */
-	autovac_refresh_stats();
+	pgstat_clear_snapshot();
 
 	recheck_relation_needs_vacanalyze(relid, avopts, classForm,
 									  effective_multixact_freeze_max_age,
@@ -3000,21 +3419,14 @@ recheck_relation_needs_vacanalyze(Oid relid,
 								  bool *wraparound)
 {
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared = NULL;
-	PgStat_StatDBEntry *dbentry = NULL;
-
-	if (classForm->relisshared)
-		shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	else
-		dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
 
 	/* fetch the pgstat table entry */
-	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+	tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+											  relid);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  dovacuum, doanalyze, wraparound);
+							  dovacuum, doanalyze, wraparound, NULL);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -3026,7 +3438,8 @@ recheck_relation_needs_vacanalyze(Oid relid,
  *
  * Check whether a relation needs to be vacuumed or analyzed; return each into
  * "dovacuum" and "doanalyze", respectively.  Also return whether the vacuum is
- * being forced because of Xid or multixact wraparound.
+ * being forced because of Xid or multixact wraparound, and, if "score" isn't
+ * NULL, how urgent the work is (see below).
  *
  * relopts is a pointer to the AutoVacOpts options (either for itself in the
  * case of a plain table, or for either itself or its parent table in the case
@@ -3040,7 +3453,7 @@ recheck_relation_needs_vacanalyze(Oid relid,
  *
  * For analyze, the analysis done is that the number of tuples inserted,
  * deleted and updated since the last analyze exceeds a threshold calculated
- * in the same fashion as above.  Note that the collector actually stores
+ * in the same fashion as above.  Note that the stats system actually stores
  * the number of tuples (both live and dead) that there were as of the last
  * analyze.  This is asymmetric to the VACUUM case.
  *
@@ -3051,12 +3464,21 @@ recheck_relation_needs_vacanalyze(Oid relid,
  * A table whose autovacuum_enabled option is false is
  * automatically skipped (unless we have to vacuum it due to freeze_max_age).
  * Thus autovacuum can be disabled for specific tables. Also, when the stats
- * collector does not have data about a table, it will be skipped.
+ * system does not have data about a table, it will be skipped.
  *
  * A table whose vac_base_thresh value is < 0 takes the base value from the
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
  * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ *
+ * The urgency score is the largest ratio of one of the quantities above to
+ * its limit: the age of relfrozenxid (resp. relminmxid) relative to
+ * freeze_max_age (resp. multixact_freeze_max_age), and the numbers of dead,
+ * inserted and changed tuples relative to their thresholds.  A score above
+ * 1.0 thus means that some limit has been crossed, and a table twice as far
+ * past its dead-tuple threshold as another one ranks higher, whatever their
+ * sizes.  Autovacuum workers process tables in decreasing order of score,
+ * after all tables at risk of wraparound.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -3067,7 +3489,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -3097,6 +3520,9 @@ relation_needs_vacanalyze(Oid relid,
 	TransactionId xidForceLimit;
 	MultiXactId multiForceLimit;
 
+	/* urgency of the work, see above */
+	double		urgency = 0.0;
+
 	AssertArg(classForm != NULL);
 	AssertArg(OidIsValid(relid));
 
@@ -3159,11 +3585,22 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	if (TransactionIdIsNormal(classForm->relfrozenxid))
+		urgency = Max(urgency,
+					  (double) (recentXid - classForm->relfrozenxid) /
+					  Max(freeze_max_age, 1));
+	if (MultiXactIdIsValid(classForm->relminmxid))
+		urgency = Max(urgency,
+					  (double) (recentMulti - classForm->relminmxid) /
+					  Max(multixact_freeze_max_age, 1));
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
 		*doanalyze = false;
 		*dovacuum = false;
+		if (score)
+			*score = 0.0;
 		return;
 	}
 
@@ -3207,6 +3644,14 @@ relation_needs_vacanalyze(Oid relid,
 		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
 			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		urgency = Max(urgency, vactuples / Max(vacthresh, 1));
+		if (vac_ins_base_thresh >= 0)
+			urgency = Max(urgency, instuples / Max(vacinsthresh, 1));
+		/* TOAST tables and pg_statistic don't get analyzed */
+		if (classForm->relkind != RELKIND_TOASTVALUE &&
+			relid != StatisticRelationId)
+			urgency = Max(urgency, anltuples / Max(anlthresh, 1));
 	}
 	else
 	{
@@ -3222,6 +3667,9 @@ relation_needs_vacanalyze(Oid relid,
 	/* ANALYZE refuses to work with pg_statistic */
 	if (relid == StatisticRelationId)
 		*doanalyze = false;
+
+	if (score)
+		*score = urgency;
 }
 
 /*
@@ -3380,6 +3828,111 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 	return result;
 }
 
+/*
+ * qsort comparator sorting work queue entries, most urgent first
+ */
+static int
+autovac_queue_item_comparator(const void *a, const void *b)
+{
+	const AutoVacuumQueueItem *qa = (const AutoVacuumQueueItem *) a;
+	const AutoVacuumQueueItem *qb = (const AutoVacuumQueueItem *) b;
+
+	if (autovac_queue_outranks(qa, qb))
+		return -1;
+	if (autovac_queue_outranks(qb, qa))
+		return 1;
+	return 0;
+}
+
+/*
+ * Returns the contents of the autovacuum work queue, most urgent first.
+ */
+Datum
+pg_stat_get_autovacuum_queue(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_AUTOVACUUM_QUEUE_COLS	12
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	AutoVacuumQueueItem *items;
+	int			nitems = 0;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Copy the queue, so as not to hold the lock while building the result */
+	items = palloc(sizeof(AutoVacuumQueueItem) * NUM_QUEUE_ITEMS);
+	LWLockAcquire(AutovacuumScheduleLock, LW_SHARED);
+	for (i = 0; i < NUM_QUEUE_ITEMS; i++)
+	{
+		if (AutoVacuumShmem->av_queue[i].avq_used)
+			items[nitems++] = AutoVacuumShmem->av_queue[i];
+	}
+	LWLockRelease(AutovacuumScheduleLock);
+
+	qsort(items, nitems, sizeof(AutoVacuumQueueItem),
+		  autovac_queue_item_comparator);
+
+	for (i = 0; i < nitems; i++)
+	{
+		AutoVacuumQueueItem *item = &items[i];
+		Datum		values[PG_STAT_GET_AUTOVACUUM_QUEUE_COLS];
+		bool		nulls[PG_STAT_GET_AUTOVACUUM_QUEUE_COLS];
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(i + 1);
+		values[1] = ObjectIdGetDatum(item->avq_database);
+		values[2] = ObjectIdGetDatum(item->avq_relation);
+		if (item->avq_claimedby != 0)
+			values[3] = Int32GetDatum(item->avq_claimedby);
+		else
+			nulls[3] = true;
+		values[4] = BoolGetDatum(item->avq_wraparound);
+		values[5] = BoolGetDatum(item->avq_dovacuum);
+		values[6] = BoolGetDatum(item->avq_doanalyze);
+		values[7] = Int32GetDatum(item->avq_xid_age);
+		values[8] = Int64GetDatum(item->avq_dead_tuples);
+		values[9] = Int64GetDatum(item->avq_ins_tuples);
+		values[10] = Float8GetDatum(item->avq_score);
+		values[11] = TimestampTzGetDatum(item->avq_queued_at);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(items);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * autovac_init
  *		This is called at postmaster initialization.
@@ -3459,6 +4012,8 @@ AutoVacuumShmemInit(void)
 		AutoVacuumShmem->av_startingWorker = NULL;
 		memset(AutoVacuumShmem->av_workItems, 0,
 			   sizeof(AutoVacuumWorkItem) * NUM_WORKITEMS);
+		memset(AutoVacuumShmem->av_queue, 0,
+			   sizeof(AutoVacuumQueueItem) * NUM_QUEUE_ITEMS);
 
 		worker = (WorkerInfo) ((char *) AutoVacuumShmem +
 							   MAXALIGN(sizeof(AutoVacuumShmemStruct)));
@@ -3472,34 +4027,3 @@ AutoVacuumShmemInit(void)
 		Assert(found);
 }
 
-/*
- * autovac_refresh_stats
- *		Refresh pgstats data for an autovacuum process
- *
- * Cause the next pgstats read operation to obtain fresh data, but throttle
- * such refreshing in the autovacuum launcher.  This is mostly to avoid
- * rereading the pgstats files too many times in quick succession when there
- * are many databases.
- *
- * Note: we avoid throttling in the autovac worker, as it would be
- * counterproductive in the recheck logic.
- */
-static void
-autovac_refresh_stats(void)
-{
-	if (IsAutoVacuumLauncherProcess())
-	{
-		static TimestampTz last_read = 0;
-		TimestampTz current_time;
-
-		current_time = GetCurrentTimestamp();
-
-		if (!TimestampDifferenceExceeds(last_read, current_time,
-										STATS_READ_DELAY))
-			return;
-
-		last_read = current_time;
-	}
-
-	pgstat_clear_snapshot();
-}
@@ -1,15 +1,23 @@
 /* ----------
  * pgstat.c
  *
- *	All the statistics collector stuff hacked up in one big, ugly file.
+ *	Cumulative statistics system.
  *
- *	TODO:	- Separate collector, postmaster and backend stuff
- *			  into different files.
+ *	Backends and auxiliary processes count what they do in backend-local
+ *	pending counters, and flush them into shared memory at most once every
+ *	PGSTAT_STAT_INTERVAL milliseconds (and at exit).  Any process can then
+ *	read the statistics directly from shared memory.
  *
- *			- Add some automatic call for pgstat vacuuming.
+ *	Per-database, per-table and per-function statistics live in dshash
+ *	tables, in a DSA area that is created in place in the main shared memory
+ *	segment.  The fixed-size cluster-wide statistics (archiver, bgwriter,
+ *	checkpointer, WAL and SLRU), and the replication slot statistics, are
+ *	plain structs in the main segment, each group protected by an LWLock.
  *
- *			- Add a pgstat config column to pg_database, so this
- *			  entire thing can be enabled/disabled on a per db basis.
+ *	The statistics are written to disk only when the server shuts down
+ *	cleanly, by the checkpointer (or by a standalone backend), and read back
+ *	by the startup process at the next start.  After a crash they are
+ *	discarded.
  *
  *	Copyright (c) 2001-2021, PostgreSQL Global Development Group
  *
@@ -19,18 +27,6 @@
 #include "postgres.h"
 
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/param.h>
-#include <sys/time.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <signal.h>
-#include <time.h>
-#ifdef HAVE_SYS_SELECT_H
-#include <sys/select.h>
-#endif
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
@@ -41,32 +37,22 @@
 #include "catalog/catalog.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
-#include "common/ip.h"
 #include "executor/instrument.h"
-#include "libpq/libpq.h"
-#include "libpq/pqsignal.h"
-#include "mb/pg_wchar.h"
+#include "lib/dshash.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
-#include "postmaster/fork_process.h"
-#include "postmaster/interrupt.h"
-#include "postmaster/postmaster.h"
 #include "replication/slot.h"
-#include "replication/walsender.h"
-#include "storage/backendid.h"
-#include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
-#include "storage/latch.h"
 #include "storage/lmgr.h"
-#include "storage/pg_shmem.h"
+#include "storage/lwlock.h"
 #include "storage/proc.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
-#include "utils/guc.h"
+#include "utils/dsa.h"
 #include "utils/memutils.h"
-#include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
@@ -75,37 +61,26 @@
  * Timer definitions.
  * ----------
  */
-#define PGSTAT_STAT_INTERVAL	500 /* Minimum time between stats file
-									 * updates; in milliseconds. */
-
-#define PGSTAT_RETRY_DELAY		10	/* How long to wait between checks for a
-									 * new file; in milliseconds. */
-
-#define PGSTAT_MAX_WAIT_TIME	10000	/* Maximum time to wait for a stats
-										 * file update; in milliseconds. */
-
-#define PGSTAT_INQ_INTERVAL		640 /* How often to ping the collector for a
-									 * new file; in milliseconds. */
-
-#define PGSTAT_RESTART_INTERVAL 60	/* How often to attempt to restart a
-									 * failed statistics collector; in
-									 * seconds. */
-
-#define PGSTAT_POLL_LOOP_COUNT	(PGSTAT_MAX_WAIT_TIME / PGSTAT_RETRY_DELAY)
-#define PGSTAT_INQ_LOOP_COUNT	(PGSTAT_INQ_INTERVAL / PGSTAT_RETRY_DELAY)
-
-/* Minimum receive buffer size for the collector's socket. */
-#define PGSTAT_MIN_RCVBUF		(100 * 1024)
+#define PGSTAT_STAT_INTERVAL	500 /* Minimum time between flushes of the
+									 * pending statistics to shared memory;
+									 * in milliseconds. */
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the backend-local hash tables.
  * ----------
  */
-#define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
-#define PGSTAT_REPLSLOT_HASH_SIZE	32
+#define PGSTAT_SNAPSHOT_HASH_SIZE	64
+
+/*
+ * Size of the DSA area created in place in the main shared memory segment.
+ * It must be large enough to hold the (empty) shared hash tables, which are
+ * created by the postmaster; it also takes the first few hundred entries.
+ * Once it is full, the DSA area grows into DSM segments.
+ */
+#define PGSTAT_DSA_INIT_SIZE	(256 * 1024)
 
 
 /* ----------
@@ -115,22 +90,13 @@
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 
-/* ----------
- * Built from GUC parameter
- * ----------
- */
-char	   *pgstat_stat_directory = NULL;
-char	   *pgstat_stat_filename = NULL;
-char	   *pgstat_stat_tmpname = NULL;
-
 /*
- * BgWriter and WAL global statistics counters.
- * Stored directly in a stats message structure so they can be sent
- * without needing to copy things around.  We assume these init to zeroes.
+ * BgWriter, checkpointer and WAL global statistics counters, waiting to be
+ * flushed to shared memory.  We assume these init to zeroes.
  */
-PgStat_MsgBgWriter PendingBgWriterStats;
-PgStat_MsgCheckpointer PendingCheckpointerStats;
-PgStat_MsgWal WalStats;
+PgStat_BgWriterStats PendingBgWriterStats;
+PgStat_CheckpointerStats PendingCheckpointerStats;
+PgStat_WalStats WalStats;
 
 /*
  * WAL usage counters saved from pgWALUsage at the previous call to
@@ -159,28 +125,124 @@ static const char *const slru_names[] = {
 #define SLRU_NUM_ELEMENTS	lengthof(slru_names)
 
 /*
- * SLRU statistics counts waiting to be sent to the collector.  These are
- * stored directly in stats message format so they can be sent without needing
- * to copy things around.  We assume this variable inits to zeroes.  Entries
- * are one-to-one with slru_names[].
+ * SLRU statistics counts waiting to be flushed to shared memory.  We assume
+ * this variable inits to zeroes.  Entries are one-to-one with slru_names[].
+ */
+static PgStat_SLRUStats pendingSLRUStats[SLRU_NUM_ELEMENTS];
+
+/*
+ * Database-wide counts reported by pgstat_report_deadlock() and friends,
+ * waiting to be flushed into our database's entry by pgstat_report_stat().
+ * Only the counter fields are used.
  */
-static PgStat_MsgSLRU SLRUStats[SLRU_NUM_ELEMENTS];
+static PgStat_StatDBEntry pendingDBStats;
+static bool have_db_stats = false;
 
 /* ----------
- * Local data
+ * Shared memory data structures
  * ----------
  */
-NON_EXEC_STATIC pgsocket pgStatSock = PGINVALID_SOCKET;
 
-static struct sockaddr_storage pgStatAddr;
+/*
+ * Key of the shared per-table and per-function entries.  The entries for
+ * shared relations use InvalidOid as dboid.
+ */
+typedef struct PgStat_ObjectKey
+{
+	Oid			dboid;
+	Oid			objoid;
+} PgStat_ObjectKey;
+
+typedef struct PgStatShared_TabEntry
+{
+	PgStat_ObjectKey key;		/* hash key (must be first) */
+	PgStat_StatTabEntry stats;
+} PgStatShared_TabEntry;
+
+typedef struct PgStatShared_FuncEntry
+{
+	PgStat_ObjectKey key;		/* hash key (must be first) */
+	PgStat_StatFuncEntry stats;
+} PgStatShared_FuncEntry;
+
+/*
+ * The part of the statistics that is kept in the main shared memory segment.
+ *
+ * This struct is followed by an array of max_replication_slots replication
+ * slot entries, protected by replslot_lock; an entry is unused if its slot
+ * name is empty.  After that comes the space for the DSA area that holds the
+ * shared hash tables.
+ */
+typedef struct PgStat_ShmemControl
+{
+	dshash_table_handle db_hash_handle;
+	dshash_table_handle tab_hash_handle;
+	dshash_table_handle func_hash_handle;
+
+	LWLock		archiver_lock;
+	PgStat_ArchiverStats archiver;
+
+	LWLock		global_lock;	/* protects bgwriter and checkpointer */
+	PgStat_BgWriterStats bgwriter;
+	PgStat_CheckpointerStats checkpointer;
 
-static time_t last_pgstat_start_time;
+	LWLock		wal_lock;
+	PgStat_WalStats wal;
 
-static bool pgStatRunningInCollector = false;
+	LWLock		slru_lock;
+	PgStat_SLRUStats slru[SLRU_NUM_ELEMENTS];
+
+	LWLock		replslot_lock;
+} PgStat_ShmemControl;
+
+#define PGSTAT_REPLSLOT_OFFSET	MAXALIGN(sizeof(PgStat_ShmemControl))
+#define PGSTAT_DSA_OFFSET \
+	add_size(PGSTAT_REPLSLOT_OFFSET, \
+			 MAXALIGN(mul_size(max_replication_slots, \
+							   sizeof(PgStat_StatReplSlotEntry))))
+
+#define PgStatReplSlots \
+	((PgStat_StatReplSlotEntry *) ((char *) pgStatShmem + PGSTAT_REPLSLOT_OFFSET))
+#define PgStatRawDSAArea \
+	((void *) ((char *) pgStatShmem + PGSTAT_DSA_OFFSET))
+
+static const dshash_parameters db_hash_params = {
+	sizeof(Oid),
+	sizeof(PgStat_StatDBEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters tab_hash_params = {
+	sizeof(PgStat_ObjectKey),
+	sizeof(PgStatShared_TabEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters func_hash_params = {
+	sizeof(PgStat_ObjectKey),
+	sizeof(PgStatShared_FuncEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+/* ----------
+ * Local data
+ * ----------
+ */
+static PgStat_ShmemControl *pgStatShmem = NULL;
+static dsa_area *pgStatDSA = NULL;
+static dshash_table *pgStatSharedDBHash = NULL;
+static dshash_table *pgStatSharedTabHash = NULL;
+static dshash_table *pgStatSharedFuncHash = NULL;
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * flushed to shared memory.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -215,14 +277,14 @@ typedef struct TabStatHashEntry
 static HTAB *pgStatTabHash = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be flushed to shared
+ * memory in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
@@ -267,28 +329,57 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about the current snapshot of the statistics.
+ *
+ * Within a transaction, each object's statistics are copied out of shared
+ * memory on first access, and the copy is returned from then on, so that
+ * repeated accesses in a query see consistent values.  Objects without
+ * statistics are remembered too.
  */
 static MemoryContext pgStatLocalContext = NULL;
-static HTAB *pgStatDBHash = NULL;
+
+typedef enum PgStat_SnapshotKind
+{
+	PGSTAT_SNAPSHOT_DB,
+	PGSTAT_SNAPSHOT_TABLE,
+	PGSTAT_SNAPSHOT_FUNCTION
+} PgStat_SnapshotKind;
+
+typedef struct PgStat_SnapshotKey
+{
+	int			kind;			/* a PgStat_SnapshotKind */
+	Oid			dboid;
+	Oid			objoid;
+} PgStat_SnapshotKey;
+
+typedef struct PgStat_SnapshotEntry
+{
+	PgStat_SnapshotKey key;		/* hash key (must be first) */
+	bool		found;			/* does the object have statistics? */
+	union
+	{
+		PgStat_StatDBEntry db;
+		PgStat_StatTabEntry tab;
+		PgStat_StatFuncEntry func;
+	}			data;
+} PgStat_SnapshotEntry;
+
+static HTAB *pgStatSnapshotHash = NULL;
 
 /*
- * Cluster wide statistics, kept in the stats collector.
- * Contains statistics that are not collected per database
- * or per table.
+ * Snapshot of the cluster wide statistics, i.e. those that are not kept per
+ * database or per table.  The replication slot snapshot lives in
+ * pgStatLocalContext.
  */
 static PgStat_ArchiverStats archiverStats;
+static bool archiverSnapshotValid = false;
 static PgStat_GlobalStats globalStats;
+static bool globalSnapshotValid = false;
 static PgStat_WalStats walStats;
+static bool walSnapshotValid = false;
 static PgStat_SLRUStats slruStats[SLRU_NUM_ELEMENTS];
-static HTAB *replSlotStatHash = NULL;
-
-/*
- * List of OIDs of databases we need to write out.  If an entry is InvalidOid,
- * it means to write only the shared-catalog stats ("DB 0"); otherwise, we
- * will write both that DB's data and the shared stats.
- */
-static List *pending_write_requests = NIL;
+static bool slruSnapshotValid = false;
+static PgStat_StatReplSlotEntry *replSlotSnapshot = NULL;
 
 /*
  * Total time charged to functions so far in the current backend.
@@ -311,527 +402,424 @@ static bool pgstat_is_shutdown = false;
  * Local function forward declarations
  * ----------
  */
-#ifdef EXEC_BACKEND
-static pid_t pgstat_forkexec(void);
-#endif
-
-NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
+static void pgstat_attach_shmem(void);
+static void pgstat_detach_shmem(void);
 
-static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-												 Oid tableoid, bool create);
-static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
-static void backend_read_statsfile(void);
+static PgStat_StatDBEntry *pgstat_lock_db_entry(Oid dboid);
+static PgStatShared_TabEntry *pgstat_lock_tab_entry(Oid dboid, Oid relid);
+static void pgstat_reset_dbentry(PgStat_StatDBEntry *dbentry);
+static void pgstat_add_dbentry_counts(PgStat_StatDBEntry *dst,
+									  const PgStat_StatDBEntry *src);
+static void pgstat_drop_db_objects(Oid dboid);
+static void pgstat_reset_all_stats(void);
+static void *pgstat_snapshot_entry(PgStat_SnapshotKind kind, Oid dboid,
+								   Oid objoid);
+static void pgstat_snapshot_global(void);
 
-static bool pgstat_write_statsfile_needed(void);
-static bool pgstat_db_requested(Oid databaseid);
+static void pgstat_write_statsfile(void);
 
-static PgStat_StatReplSlotEntry *pgstat_get_replslot_entry(NameData name, bool create_it);
+static PgStat_StatReplSlotEntry *pgstat_get_replslot_entry(const char *name,
+														   bool create);
 static void pgstat_reset_replslot(PgStat_StatReplSlotEntry *slotstats, TimestampTz ts);
 
-static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg, TimestampTz now);
+static void pgstat_flush_tabstat(Oid dboid, PgStat_TableStatus *tabstat);
+static void pgstat_flush_dbstat(Oid dboid, PgStat_StatDBEntry *delta);
 static void pgstat_send_funcstats(void);
 static void pgstat_send_slru(void);
 static HTAB *pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid);
 static bool pgstat_should_report_connstat(void);
-static void pgstat_report_disconnect(Oid dboid);
 
 static PgStat_TableStatus *get_tabstat_entry(Oid rel_id, bool isshared);
 
 static void pgstat_setup_memcxt(void);
 static void pgstat_assert_is_up(void);
 
-static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
-static void pgstat_send(void *msg, int len);
-
-static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
-static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
-static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
-static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
-static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
-static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
-static void pgstat_recv_resetslrucounter(PgStat_MsgResetslrucounter *msg, int len);
-static void pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg, int len);
-static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
-static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
-static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
-static void pgstat_recv_checkpointer(PgStat_MsgCheckpointer *msg, int len);
-static void pgstat_recv_wal(PgStat_MsgWal *msg, int len);
-static void pgstat_recv_slru(PgStat_MsgSLRU *msg, int len);
-static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
-static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
-static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
-static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
-static void pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len);
-static void pgstat_recv_connect(PgStat_MsgConnect *msg, int len);
-static void pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len);
-static void pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len);
-static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
-
 /* ------------------------------------------------------------
- * Public functions called from postmaster follow
+ * Shared memory setup, and functions called from postmaster and the startup
+ * and checkpointer processes follow
  * ------------------------------------------------------------
  */
 
-/* ----------
- * pgstat_init() -
- *
- *	Called from postmaster at startup. Create the resources required
- *	by the statistics collector process.  If unable to do so, do not
- *	fail --- better to let the postmaster start with stats collection
- *	disabled.
- * ----------
+/*
+ * Report the amount of shared memory needed for the statistics.
  */
-void
-pgstat_init(void)
+Size
+StatsShmemSize(void)
 {
-	ACCEPT_TYPE_ARG3 alen;
-	struct addrinfo *addrs = NULL,
-			   *addr,
-				hints;
-	int			ret;
-	fd_set		rset;
-	struct timeval tv;
-	char		test_byte;
-	int			sel_res;
-	int			tries = 0;
-
-#define TESTBYTEVAL ((char) 199)
+	return add_size(PGSTAT_DSA_OFFSET, PGSTAT_DSA_INIT_SIZE);
+}
 
-	/*
-	 * This static assertion verifies that we didn't mess up the calculations
-	 * involved in selecting maximum payload sizes for our UDP messages.
-	 * Because the only consequence of overrunning PGSTAT_MAX_MSG_SIZE would
-	 * be silent performance loss from fragmentation, it seems worth having a
-	 * compile-time cross-check that we didn't.
-	 */
-	StaticAssertStmt(sizeof(PgStat_Msg) <= PGSTAT_MAX_MSG_SIZE,
-					 "maximum stats message size exceeds PGSTAT_MAX_MSG_SIZE");
+/*
+ * Initialize the statistics in shared memory, or attach to them if they are
+ * already there (in an EXEC_BACKEND child).
+ */
+void
+StatsShmemInit(void)
+{
+	bool		found;
 
-	/*
-	 * Create the UDP socket for sending and receiving statistic messages
-	 */
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_protocol = 0;
-	hints.ai_addrlen = 0;
-	hints.ai_addr = NULL;
-	hints.ai_canonname = NULL;
-	hints.ai_next = NULL;
-	ret = pg_getaddrinfo_all("localhost", NULL, &hints, &addrs);
-	if (ret || !addrs)
-	{
-		ereport(LOG,
-				(errmsg("could not resolve \"localhost\": %s",
-						gai_strerror(ret))));
-		goto startup_failed;
-	}
+	pgStatShmem = (PgStat_ShmemControl *)
+		ShmemInitStruct("Shared Memory Stats", StatsShmemSize(), &found);
 
-	/*
-	 * On some platforms, pg_getaddrinfo_all() may return multiple addresses
-	 * only one of which will actually work (eg, both IPv6 and IPv4 addresses
-	 * when kernel will reject IPv6).  Worse, the failure may occur at the
-	 * bind() or perhaps even connect() stage.  So we must loop through the
-	 * results till we find a working combination. We will generate LOG
-	 * messages, but no error, for bogus combinations.
-	 */
-	for (addr = addrs; addr; addr = addr->ai_next)
+	if (!found)
 	{
-#ifdef HAVE_UNIX_SOCKETS
-		/* Ignore AF_UNIX sockets, if any are returned. */
-		if (addr->ai_family == AF_UNIX)
-			continue;
-#endif
-
-		if (++tries > 1)
-			ereport(LOG,
-					(errmsg("trying another address for the statistics collector")));
-
-		/*
-		 * Create the socket.
-		 */
-		if ((pgStatSock = socket(addr->ai_family, SOCK_DGRAM, 0)) == PGINVALID_SOCKET)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not create socket for statistics collector: %m")));
-			continue;
-		}
-
-		/*
-		 * Bind it to a kernel assigned port on localhost and get the assigned
-		 * port via getsockname().
-		 */
-		if (bind(pgStatSock, addr->ai_addr, addr->ai_addrlen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not bind socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		alen = sizeof(pgStatAddr);
-		if (getsockname(pgStatSock, (struct sockaddr *) &pgStatAddr, &alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not get address of socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Connect the socket to its own address.  This saves a few cycles by
-		 * not having to respecify the target address on every send. This also
-		 * provides a kernel-level check that only packets from this same
-		 * address will be received.
-		 */
-		if (connect(pgStatSock, (struct sockaddr *) &pgStatAddr, alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not connect socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Try to send and receive a one-byte test message on the socket. This
-		 * is to catch situations where the socket can be created but will not
-		 * actually pass data (for instance, because kernel packet filtering
-		 * rules prevent it).
-		 */
-		test_byte = TESTBYTEVAL;
+		dsa_area   *dsa;
+		dshash_table *dsh;
+		TimestampTz ts = GetCurrentTimestamp();
+		int			i;
 
-retry1:
-		if (send(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry1;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not send test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+		memset(pgStatShmem, 0, PGSTAT_DSA_OFFSET);
 
 		/*
-		 * There could possibly be a little delay before the message can be
-		 * received.  We arbitrarily allow up to half a second before deciding
-		 * it's broken.
+		 * Create the DSA area and the (empty) hash tables.  Temporarily limit
+		 * the area to its in-place size, so that the hash tables are sure to
+		 * be created in the main shared memory segment rather than in a DSM
+		 * segment that only the postmaster would have mapped.
 		 */
-		for (;;)				/* need a loop to handle EINTR */
-		{
-			FD_ZERO(&rset);
-			FD_SET(pgStatSock, &rset);
-
-			tv.tv_sec = 0;
-			tv.tv_usec = 500000;
-			sel_res = select(pgStatSock + 1, &rset, NULL, NULL, &tv);
-			if (sel_res >= 0 || errno != EINTR)
-				break;
-		}
-		if (sel_res < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-		if (sel_res == 0 || !FD_ISSET(pgStatSock, &rset))
-		{
-			/*
-			 * This is the case we actually think is likely, so take pains to
-			 * give a specific message for it.
-			 *
-			 * errno will not be set meaningfully here, so don't use it.
-			 */
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("test message did not get through on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		test_byte++;			/* just make sure variable is changed */
-
-retry2:
-		if (recv(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry2;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		if (test_byte != TESTBYTEVAL)	/* strictly paranoia ... */
-		{
-			ereport(LOG,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("incorrect test message transmission on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+		dsa = dsa_create_in_place(PgStatRawDSAArea, PGSTAT_DSA_INIT_SIZE,
+								  LWTRANCHE_PGSTATS_DSA, NULL);
+		dsa_pin(dsa);
+		dsa_set_size_limit(dsa, PGSTAT_DSA_INIT_SIZE);
 
-		/* If we get here, we have a working socket */
-		break;
-	}
+		dsh = dshash_create(dsa, &db_hash_params, NULL);
+		pgStatShmem->db_hash_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
 
-	/* Did we find a working address? */
-	if (!addr || pgStatSock == PGINVALID_SOCKET)
-		goto startup_failed;
+		dsh = dshash_create(dsa, &tab_hash_params, NULL);
+		pgStatShmem->tab_hash_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
 
-	/*
-	 * Set the socket to non-blocking IO.  This ensures that if the collector
-	 * falls behind, statistics messages will be discarded; backends won't
-	 * block waiting to send messages to the collector.
-	 */
-	if (!pg_set_noblock(pgStatSock))
-	{
-		ereport(LOG,
-				(errcode_for_socket_access(),
-				 errmsg("could not set statistics collector socket to nonblocking mode: %m")));
-		goto startup_failed;
-	}
+		dsh = dshash_create(dsa, &func_hash_params, NULL);
+		pgStatShmem->func_hash_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
 
-	/*
-	 * Try to ensure that the socket's receive buffer is at least
-	 * PGSTAT_MIN_RCVBUF bytes, so that it won't easily overflow and lose
-	 * data.  Use of UDP protocol means that we are willing to lose data under
-	 * heavy load, but we don't want it to happen just because of ridiculously
-	 * small default buffer sizes (such as 8KB on older Windows versions).
-	 */
-	{
-		int			old_rcvbuf;
-		int			new_rcvbuf;
-		ACCEPT_TYPE_ARG3 rcvbufsize = sizeof(old_rcvbuf);
+		dsa_set_size_limit(dsa, -1);
+		dsa_detach(dsa);
 
-		if (getsockopt(pgStatSock, SOL_SOCKET, SO_RCVBUF,
-					   (char *) &old_rcvbuf, &rcvbufsize) < 0)
-		{
-			ereport(LOG,
-					(errmsg("%s(%s) failed: %m", "getsockopt", "SO_RCVBUF")));
-			/* if we can't get existing size, always try to set it */
-			old_rcvbuf = 0;
-		}
+		LWLockInitialize(&pgStatShmem->archiver_lock, LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&pgStatShmem->global_lock, LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&pgStatShmem->wal_lock, LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&pgStatShmem->slru_lock, LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&pgStatShmem->replslot_lock, LWTRANCHE_PGSTATS_DATA);
 
-		new_rcvbuf = PGSTAT_MIN_RCVBUF;
-		if (old_rcvbuf < new_rcvbuf)
-		{
-			if (setsockopt(pgStatSock, SOL_SOCKET, SO_RCVBUF,
-						   (char *) &new_rcvbuf, sizeof(new_rcvbuf)) < 0)
-				ereport(LOG,
-						(errmsg("%s(%s) failed: %m", "setsockopt", "SO_RCVBUF")));
-		}
+		pgStatShmem->archiver.stat_reset_timestamp = ts;
+		pgStatShmem->bgwriter.stat_reset_timestamp = ts;
+		pgStatShmem->wal.stat_reset_timestamp = ts;
+		for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
+			pgStatShmem->slru[i].stat_reset_timestamp = ts;
 	}
-
-	pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	/* Now that we have a long-lived socket, tell fd.c about it. */
-	ReserveExternalFD();
-
-	return;
-
-startup_failed:
-	ereport(LOG,
-			(errmsg("disabling statistics collector for lack of working socket")));
-
-	if (addrs)
-		pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	if (pgStatSock != PGINVALID_SOCKET)
-		closesocket(pgStatSock);
-	pgStatSock = PGINVALID_SOCKET;
-
-	/*
-	 * Adjust GUC variables to suppress useless activity, and for debugging
-	 * purposes (seeing track_counts off is a clue that we failed here). We
-	 * use PGC_S_OVERRIDE because there is no point in trying to turn it back
-	 * on from postgresql.conf without a restart.
-	 */
-	SetConfigOption("track_counts", "off", PGC_INTERNAL, PGC_S_OVERRIDE);
 }
 
 /*
- * subroutine for pgstat_reset_all
+ * Attach to the shared hash tables.  Called from pgstat_initialize().
  */
 static void
-pgstat_reset_remove_files(const char *directory)
+pgstat_attach_shmem(void)
 {
-	DIR		   *dir;
-	struct dirent *entry;
-	char		fname[MAXPGPATH * 2];
+	MemoryContext oldcontext;
 
-	dir = AllocateDir(directory);
-	while ((entry = ReadDir(dir, directory)) != NULL)
-	{
-		int			nchars;
-		Oid			tmp_oid;
+	Assert(pgStatShmem != NULL);
+	Assert(pgStatDSA == NULL);
 
-		/*
-		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
-		 */
-		if (strncmp(entry->d_name, "global.", 7) == 0)
-			nchars = 7;
-		else
-		{
-			nchars = 0;
-			(void) sscanf(entry->d_name, "db_%u.%n",
-						  &tmp_oid, &nchars);
-			if (nchars <= 0)
-				continue;
-			/* %u allows leading whitespace, so reject that */
-			if (strchr("0123456789", entry->d_name[3]) == NULL)
-				continue;
-		}
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
 
-		if (strcmp(entry->d_name + nchars, "tmp") != 0 &&
-			strcmp(entry->d_name + nchars, "stat") != 0)
-			continue;
+	pgStatDSA = dsa_attach_in_place(PgStatRawDSAArea, NULL);
+	dsa_pin_mapping(pgStatDSA);
 
-		snprintf(fname, sizeof(fname), "%s/%s", directory,
-				 entry->d_name);
-		unlink(fname);
-	}
-	FreeDir(dir);
-}
+	pgStatSharedDBHash = dshash_attach(pgStatDSA, &db_hash_params,
+									   pgStatShmem->db_hash_handle, NULL);
+	pgStatSharedTabHash = dshash_attach(pgStatDSA, &tab_hash_params,
+										pgStatShmem->tab_hash_handle, NULL);
+	pgStatSharedFuncHash = dshash_attach(pgStatDSA, &func_hash_params,
+										 pgStatShmem->func_hash_handle, NULL);
 
-/*
- * pgstat_reset_all() -
- *
- * Remove the stats files.  This is currently used only if WAL
- * recovery is needed after a crash.
- */
-void
-pgstat_reset_all(void)
-{
-	pgstat_reset_remove_files(pgstat_stat_directory);
-	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
+	MemoryContextSwitchTo(oldcontext);
 }
 
-#ifdef EXEC_BACKEND
-
 /*
- * pgstat_forkexec() -
- *
- * Format up the arglist for, then fork and exec, statistics collector process
+ * Detach from the shared hash tables at process exit.
  */
-static pid_t
-pgstat_forkexec(void)
+static void
+pgstat_detach_shmem(void)
 {
-	char	   *av[10];
-	int			ac = 0;
+	Assert(pgStatDSA != NULL);
 
-	av[ac++] = "postgres";
-	av[ac++] = "--forkcol";
-	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
+	dshash_detach(pgStatSharedDBHash);
+	dshash_detach(pgStatSharedTabHash);
+	dshash_detach(pgStatSharedFuncHash);
+	pgStatSharedDBHash = NULL;
+	pgStatSharedTabHash = NULL;
+	pgStatSharedFuncHash = NULL;
 
-	av[ac] = NULL;
-	Assert(ac < lengthof(av));
+	dsa_detach(pgStatDSA);
 
-	return postmaster_forkexec(ac, av);
+	/*
+	 * dsa_detach() does not drop the reference taken by
+	 * dsa_attach_in_place(), since no segment was passed to it; do that
+	 * ourselves.
+	 */
+	dsa_release_in_place(PgStatRawDSAArea);
+	pgStatDSA = NULL;
 }
-#endif							/* EXEC_BACKEND */
-
 
-/*
- * pgstat_start() -
- *
- *	Called from postmaster at startup or after an existing collector
- *	died.  Attempt to fire up a fresh statistics collector.
- *
- *	Returns PID of child process, or 0 if fail.
+/* ----------
+ * pgstat_restore_stats() -
  *
- *	Note: if fail, we will be called again from the postmaster main loop.
+ *	Called by the startup process after a clean shutdown, to load the
+ *	statistics saved by pgstat_write_statsfile().  The file is removed
+ *	afterwards, so that a crash later on can't bring back stale data.
+ * ----------
  */
-int
-pgstat_start(void)
+void
+pgstat_restore_stats(void)
 {
-	time_t		curtime;
-	pid_t		pgStatPid;
+	FILE	   *fpin;
+	int32		format_id;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
+	PgStat_ArchiverStats archiver;
+	PgStat_BgWriterStats bgwriter;
+	PgStat_CheckpointerStats checkpointer;
+	PgStat_WalStats wal;
+	PgStat_SLRUStats slru[SLRU_NUM_ELEMENTS];
+
+	elog(DEBUG2, "reading stats file \"%s\"", statfile);
 
 	/*
-	 * Check that the socket is there, else pgstat_init failed and we can do
-	 * nothing useful.
+	 * Try to open the stats file.  If it doesn't exist, we simply start
+	 * with empty counters.  Any other failure condition is suspicious.
 	 */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return 0;
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
+		return;
+	}
 
 	/*
-	 * Do nothing if too soon since last collector start.  This is a safety
-	 * valve to protect against continuous respawn attempts if the collector
-	 * is dying immediately at launch.  Note that since we will be re-called
-	 * from the postmaster main loop, we will get another chance later.
+	 * Verify it's of the expected format, and read the fixed-size stats.
 	 */
-	curtime = time(NULL);
-	if ((unsigned int) (curtime - last_pgstat_start_time) <
-		(unsigned int) PGSTAT_RESTART_INTERVAL)
-		return 0;
-	last_pgstat_start_time = curtime;
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID ||
+		fread(&archiver, 1, sizeof(archiver), fpin) != sizeof(archiver) ||
+		fread(&bgwriter, 1, sizeof(bgwriter), fpin) != sizeof(bgwriter) ||
+		fread(&checkpointer, 1, sizeof(checkpointer), fpin) != sizeof(checkpointer) ||
+		fread(&wal, 1, sizeof(wal), fpin) != sizeof(wal) ||
+		fread(slru, 1, sizeof(slru), fpin) != sizeof(slru))
+		goto error;
+
+	LWLockAcquire(&pgStatShmem->archiver_lock, LW_EXCLUSIVE);
+	memcpy(&pgStatShmem->archiver, &archiver, sizeof(archiver));
+	LWLockRelease(&pgStatShmem->archiver_lock);
+
+	LWLockAcquire(&pgStatShmem->global_lock, LW_EXCLUSIVE);
+	memcpy(&pgStatShmem->bgwriter, &bgwriter, sizeof(bgwriter));
+	memcpy(&pgStatShmem->checkpointer, &checkpointer, sizeof(checkpointer));
+	LWLockRelease(&pgStatShmem->global_lock);
+
+	LWLockAcquire(&pgStatShmem->wal_lock, LW_EXCLUSIVE);
+	memcpy(&pgStatShmem->wal, &wal, sizeof(wal));
+	LWLockRelease(&pgStatShmem->wal_lock);
+
+	LWLockAcquire(&pgStatShmem->slru_lock, LW_EXCLUSIVE);
+	memcpy(pgStatShmem->slru, slru, sizeof(slru));
+	LWLockRelease(&pgStatShmem->slru_lock);
 
 	/*
-	 * Okay, fork off the collector.
+	 * Read the variable-sized entries and put them into the shared hash
+	 * tables.
 	 */
-#ifdef EXEC_BACKEND
-	switch ((pgStatPid = pgstat_forkexec()))
-#else
-	switch ((pgStatPid = fork_process()))
-#endif
+	for (;;)
 	{
-		case -1:
-			ereport(LOG,
-					(errmsg("could not fork statistics collector: %m")));
-			return 0;
+		switch (fgetc(fpin))
+		{
+				/*
+				 * 'D'	A PgStat_StatDBEntry struct describing a database
+				 * follows.
+				 */
+			case 'D':
+				{
+					PgStat_StatDBEntry dbbuf;
+					PgStat_StatDBEntry *dbentry;
+					bool		found;
+
+					if (fread(&dbbuf, 1, sizeof(dbbuf), fpin) != sizeof(dbbuf))
+						goto error;
+
+					dbentry = dshash_find_or_insert(pgStatSharedDBHash,
+													&dbbuf.databaseid, &found);
+					if (!found)
+						memcpy(dbentry, &dbbuf, sizeof(dbbuf));
+					dshash_release_lock(pgStatSharedDBHash, dbentry);
+					if (found)
+						goto error;
+					break;
+				}
 
-#ifndef EXEC_BACKEND
-		case 0:
-			/* in postmaster child ... */
-			InitPostmasterChild();
+				/*
+				 * 'T'	A table entry, including its key, follows.
+				 */
+			case 'T':
+				{
+					PgStatShared_TabEntry tabbuf;
+					PgStatShared_TabEntry *tabentry;
+					bool		found;
+
+					if (fread(&tabbuf, 1, sizeof(tabbuf), fpin) != sizeof(tabbuf))
+						goto error;
+
+					tabentry = dshash_find_or_insert(pgStatSharedTabHash,
+													 &tabbuf.key, &found);
+					if (!found)
+						memcpy(tabentry, &tabbuf, sizeof(tabbuf));
+					dshash_release_lock(pgStatSharedTabHash, tabentry);
+					if (found)
+						goto error;
+					break;
+				}
 
-			/* Close the postmaster's sockets */
-			ClosePostmasterPorts(false);
+				/*
+				 * 'F'	A function entry, including its key, follows.
+				 */
+			case 'F':
+				{
+					PgStatShared_FuncEntry funcbuf;
+					PgStatShared_FuncEntry *funcentry;
+					bool		found;
+
+					if (fread(&funcbuf, 1, sizeof(funcbuf), fpin) != sizeof(funcbuf))
+						goto error;
+
+					funcentry = dshash_find_or_insert(pgStatSharedFuncHash,
+													  &funcbuf.key, &found);
+					if (!found)
+						memcpy(funcentry, &funcbuf, sizeof(funcbuf));
+					dshash_release_lock(pgStatSharedFuncHash, funcentry);
+					if (found)
+						goto error;
+					break;
+				}
 
-			/* Drop our connection to postmaster's shared memory, as well */
-			dsm_detach_all();
-			PGSharedMemoryDetach();
+				/*
+				 * 'R'	A PgStat_StatReplSlotEntry struct describing a
+				 * replication slot follows.
+				 */
+			case 'R':
+				{
+					PgStat_StatReplSlotEntry slotbuf;
+					PgStat_StatReplSlotEntry *slotent;
 
-			PgstatCollectorMain(0, NULL);
-			break;
-#endif
+					if (fread(&slotbuf, 1, sizeof(slotbuf), fpin) != sizeof(slotbuf) ||
+						NameStr(slotbuf.slotname)[0] == '\0')
+						goto error;
 
-		default:
-			return (int) pgStatPid;
-	}
+					/*
+					 * Skip the statistics of slots that don't exist anymore.
+					 * The slots have already been restored from disk.
+					 */
+					if (SearchNamedReplicationSlot(NameStr(slotbuf.slotname),
+												   true) == NULL)
+						break;
 
-	/* shouldn't get here */
-	return 0;
-}
+					/*
+					 * If max_replication_slots has been lowered, there might
+					 * not be room for all the slots; skip the rest.
+					 */
+					LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
+					slotent = pgstat_get_replslot_entry(NameStr(slotbuf.slotname),
+														true);
+					if (slotent)
+						memcpy(slotent, &slotbuf, sizeof(slotbuf));
+					LWLockRelease(&pgStatShmem->replslot_lock);
+					break;
+				}
 
-void
-allow_immediate_pgstat_restart(void)
-{
-	last_pgstat_start_time = 0;
+			case 'E':
+				goto done;
+
+			default:
+				goto error;
+		}
+	}
+
+error:
+	ereport(LOG,
+			(errmsg("corrupted statistics file \"%s\"", statfile)));
+
+	/* don't keep half-loaded statistics around */
+	pgstat_reset_all_stats();
+
+done:
+	FreeFile(fpin);
+
+	elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
+	unlink(statfile);
+}
+
+/* ----------
+ * pgstat_discard_stats() -
+ *
+ *	Called by the startup process when starting up after a crash (or from
+ *	a base backup), to throw away any saved statistics.
+ * ----------
+ */
+void
+pgstat_discard_stats(void)
+{
+	int			ret;
+
+	ret = unlink(PGSTAT_STAT_PERMANENT_FILENAME);
+	if (ret != 0)
+	{
+		if (errno == ENOENT)
+			elog(DEBUG2,
+				 "didn't need to unlink permanent stats file \"%s\" - didn't exist",
+				 PGSTAT_STAT_PERMANENT_FILENAME);
+		else
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not unlink permanent statistics file \"%s\": %m",
+							PGSTAT_STAT_PERMANENT_FILENAME)));
+	}
+	else
+		elog(DEBUG2, "unlinked permanent statistics file \"%s\"",
+			 PGSTAT_STAT_PERMANENT_FILENAME);
+
+	pgstat_reset_all_stats();
+}
+
+/* ----------
+ * pgstat_before_server_shutdown() -
+ *
+ *	before_shmem_exit callback of the checkpointer, and of a standalone
+ *	backend: write the statistics out to disk, so that they survive a clean
+ *	shutdown.  It must run after the shutdown checkpoint has been written,
+ *	since that is what makes the startup process load the file again.
+ * ----------
+ */
+void
+pgstat_before_server_shutdown(int code, Datum arg)
+{
+	pgstat_assert_is_up();
+
+	/*
+	 * After a crash the statistics would be thrown away at the next start
+	 * anyway, so don't bother.
+	 */
+	if (code != 0)
+		return;
+
+	/* make sure our own pending counts are included */
+	if (OidIsValid(MyDatabaseId))
+		pgstat_report_stat(true);
+	pgstat_send_bgwriter();
+	pgstat_send_checkpointer();
+	pgstat_send_wal(true);
+	pgstat_send_slru();
+
+	pgstat_write_statsfile();
 }
 
 /* ------------------------------------------------------------
@@ -844,9 +832,9 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
- *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
- *	is called only when not within a transaction, so it is fair to use
+ *	receiver processes, SPI worker, etc. to flush the so far collected
+ *	per-table and function usage statistics to shared memory.  Note that
+ *	this is called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  *
  *	"disconnect" is "true" only for the last call before the backend
@@ -862,8 +850,10 @@ pgstat_report_stat(bool disconnect)
 	static TimestampTz last_report = 0;
 
 	TimestampTz now;
-	PgStat_MsgTabstat regular_msg;
-	PgStat_MsgTabstat shared_msg;
+	PgStat_StatDBEntry regular_delta;
+	PgStat_StatDBEntry shared_delta;
+	bool		have_regular = false;
+	bool		have_shared = false;
 	TabStatusArray *tsa;
 	int			i;
 
@@ -881,13 +871,14 @@ pgstat_report_stat(bool disconnect)
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
 		pgStatXactCommit == 0 && pgStatXactRollback == 0 &&
 		pgWalUsage.wal_records == prevWalUsage.wal_records &&
-		WalStats.m_wal_write == 0 && WalStats.m_wal_sync == 0 &&
-		!have_function_stats && !disconnect)
+		WalStats.wal_write == 0 && WalStats.wal_sync == 0 &&
+		!have_function_stats && !have_db_stats && !disconnect)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the backend is about to exit.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the backend is about to exit.  Accumulating the counts
+	 * locally in between keeps the traffic on the shared hash tables low.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!disconnect &&
@@ -896,9 +887,6 @@ pgstat_report_stat(bool disconnect)
 
 	last_report = now;
 
-	if (disconnect)
-		pgstat_report_disconnect(MyDatabaseId);
-
 	/*
 	 * Destroy pgStatTabHash before we start invalidating PgStat_TableEntry
 	 * entries it points to.  (Should we fail partway through the loop below,
@@ -912,22 +900,18 @@ pgstat_report_stat(bool disconnect)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
-	 * relations from regular ones because the databaseid field in the message
-	 * header has to depend on that.
+	 * have counts, and flush them.  The database-wide sums are accumulated
+	 * separately for shared and regular relations, and flushed at the end.
 	 */
-	regular_msg.m_databaseid = MyDatabaseId;
-	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
+	memset(&regular_delta, 0, sizeof(regular_delta));
+	memset(&shared_delta, 0, sizeof(shared_delta));
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
 		for (i = 0; i < tsa->tsa_used; i++)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
-			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
+			PgStat_StatDBEntry *delta;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -940,19 +924,29 @@ pgstat_report_stat(bool disconnect)
 					   sizeof(PgStat_TableCounts)) == 0)
 				continue;
 
-			/*
-			 * OK, insert data into the appropriate message, and send if full.
-			 */
-			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
+			if (entry->t_shared)
 			{
-				pgstat_send_tabstat(this_msg, now);
-				this_msg->m_nentries = 0;
+				pgstat_flush_tabstat(InvalidOid, entry);
+				delta = &shared_delta;
+				have_shared = true;
 			}
+			else
+			{
+				pgstat_flush_tabstat(MyDatabaseId, entry);
+				delta = &regular_delta;
+				have_regular = true;
+			}
+
+			/*
+			 * Add per-table stats to the per-database entry, too.
+			 */
+			delta->n_tuples_returned += entry->t_counts.t_tuples_returned;
+			delta->n_tuples_fetched += entry->t_counts.t_tuples_fetched;
+			delta->n_tuples_inserted += entry->t_counts.t_tuples_inserted;
+			delta->n_tuples_updated += entry->t_counts.t_tuples_updated;
+			delta->n_tuples_deleted += entry->t_counts.t_tuples_deleted;
+			delta->n_blocks_fetched += entry->t_counts.t_blocks_fetched;
+			delta->n_blocks_hit += entry->t_counts.t_blocks_hit;
 		}
 		/* zero out PgStat_TableStatus structs after use */
 		MemSet(tsa->tsa_entries, 0,
@@ -961,99 +955,152 @@ pgstat_report_stat(bool disconnect)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
-	 * and connection stats get counted, even if there are no table stats to
-	 * send.
+	 * Flush the database-wide counts.  Make sure that any pending xact
+	 * commit/abort, connection and other database-level stats get counted,
+	 * even if there are no table stats to flush.
 	 */
-	if (regular_msg.m_nentries > 0 ||
-		pgStatXactCommit > 0 || pgStatXactRollback > 0 || disconnect)
-		pgstat_send_tabstat(&regular_msg, now);
-	if (shared_msg.m_nentries > 0)
-		pgstat_send_tabstat(&shared_msg, now);
+	if (have_regular || pgStatXactCommit > 0 || pgStatXactRollback > 0 ||
+		have_db_stats || disconnect)
+	{
+		/*
+		 * Report and reset accumulated xact commit/rollback, I/O timings and
+		 * session times along with our database's counts.
+		 */
+		if (OidIsValid(MyDatabaseId))
+		{
+			regular_delta.n_xact_commit = pgStatXactCommit;
+			regular_delta.n_xact_rollback = pgStatXactRollback;
+			regular_delta.n_block_read_time = pgStatBlockReadTime;
+			regular_delta.n_block_write_time = pgStatBlockWriteTime;
+
+			if (pgstat_should_report_connstat())
+			{
+				long		secs;
+				int			usecs;
 
-	/* Now, send function statistics */
+				/*
+				 * pgLastSessionReportTime is initialized to MyStartTimestamp
+				 * by pgstat_report_connect().
+				 */
+				TimestampDifference(pgLastSessionReportTime, now, &secs, &usecs);
+				pgLastSessionReportTime = now;
+				regular_delta.total_session_time =
+					(PgStat_Counter) secs * 1000000 + usecs;
+				regular_delta.total_active_time = pgStatActiveTime;
+				regular_delta.total_idle_in_xact_time = pgStatTransactionIdleTime;
+
+				if (disconnect)
+				{
+					switch (pgStatSessionEndCause)
+					{
+						case DISCONNECT_NOT_YET:
+						case DISCONNECT_NORMAL:
+							/* we don't collect these */
+							break;
+						case DISCONNECT_CLIENT_EOF:
+							regular_delta.n_sessions_abandoned++;
+							break;
+						case DISCONNECT_FATAL:
+							regular_delta.n_sessions_fatal++;
+							break;
+						case DISCONNECT_KILLED:
+							regular_delta.n_sessions_killed++;
+							break;
+					}
+				}
+			}
+			pgStatXactCommit = 0;
+			pgStatXactRollback = 0;
+			pgStatBlockReadTime = 0;
+			pgStatBlockWriteTime = 0;
+			pgStatActiveTime = 0;
+			pgStatTransactionIdleTime = 0;
+		}
+
+		if (have_db_stats)
+		{
+			pgstat_add_dbentry_counts(&regular_delta, &pendingDBStats);
+			memset(&pendingDBStats, 0, sizeof(pendingDBStats));
+			have_db_stats = false;
+		}
+
+		pgstat_flush_dbstat(MyDatabaseId, &regular_delta);
+	}
+	if (have_shared)
+		pgstat_flush_dbstat(InvalidOid, &shared_delta);
+
+	/* Now, flush function statistics */
 	pgstat_send_funcstats();
 
-	/* Send WAL statistics */
+	/* Flush WAL statistics */
 	pgstat_send_wal(true);
 
-	/* Finally send SLRU statistics */
+	/* Finally flush SLRU statistics */
 	pgstat_send_slru();
 }
 
 /*
- * Subroutine for pgstat_report_stat: finish and send a tabstat message
+ * Subroutine for pgstat_report_stat: add a table's pending counts to its
+ * shared entry
  */
 static void
-pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg, TimestampTz now)
+pgstat_flush_tabstat(Oid dboid, PgStat_TableStatus *tabstat)
 {
-	int			n;
-	int			len;
+	PgStatShared_TabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
+	PgStat_TableCounts *counts = &tabstat->t_counts;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	shent = pgstat_lock_tab_entry(dboid, tabstat->t_id);
+	tabentry = &shent->stats;
+
+	tabentry->numscans += counts->t_numscans;
+	tabentry->tuples_returned += counts->t_tuples_returned;
+	tabentry->tuples_fetched += counts->t_tuples_fetched;
+	tabentry->tuples_inserted += counts->t_tuples_inserted;
+	tabentry->tuples_updated += counts->t_tuples_updated;
+	tabentry->tuples_deleted += counts->t_tuples_deleted;
+	tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
 
 	/*
-	 * Report and reset accumulated xact commit/rollback and I/O timings
-	 * whenever we send a normal tabstat message
+	 * If table was truncated/dropped, first reset the live/dead counters.
 	 */
-	if (OidIsValid(tsmsg->m_databaseid))
+	if (counts->t_truncdropped)
 	{
-		tsmsg->m_xact_commit = pgStatXactCommit;
-		tsmsg->m_xact_rollback = pgStatXactRollback;
-		tsmsg->m_block_read_time = pgStatBlockReadTime;
-		tsmsg->m_block_write_time = pgStatBlockWriteTime;
+		tabentry->n_live_tuples = 0;
+		tabentry->n_dead_tuples = 0;
+		tabentry->inserts_since_vacuum = 0;
+	}
+	tabentry->n_live_tuples += counts->t_delta_live_tuples;
+	tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+	tabentry->changes_since_analyze += counts->t_changed_tuples;
+	tabentry->inserts_since_vacuum += counts->t_tuples_inserted;
+	tabentry->blocks_fetched += counts->t_blocks_fetched;
+	tabentry->blocks_hit += counts->t_blocks_hit;
 
-		if (pgstat_should_report_connstat())
-		{
-			long		secs;
-			int			usecs;
+	/* Clamp n_live_tuples in case of negative delta_live_tuples */
+	tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+	/* Likewise for n_dead_tuples */
+	tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
 
-			/*
-			 * pgLastSessionReportTime is initialized to MyStartTimestamp by
-			 * pgstat_report_connect().
-			 */
-			TimestampDifference(pgLastSessionReportTime, now, &secs, &usecs);
-			pgLastSessionReportTime = now;
-			tsmsg->m_session_time = (PgStat_Counter) secs * 1000000 + usecs;
-			tsmsg->m_active_time = pgStatActiveTime;
-			tsmsg->m_idle_in_xact_time = pgStatTransactionIdleTime;
-		}
-		else
-		{
-			tsmsg->m_session_time = 0;
-			tsmsg->m_active_time = 0;
-			tsmsg->m_idle_in_xact_time = 0;
-		}
-		pgStatXactCommit = 0;
-		pgStatXactRollback = 0;
-		pgStatBlockReadTime = 0;
-		pgStatBlockWriteTime = 0;
-		pgStatActiveTime = 0;
-		pgStatTransactionIdleTime = 0;
-	}
-	else
-	{
-		tsmsg->m_xact_commit = 0;
-		tsmsg->m_xact_rollback = 0;
-		tsmsg->m_block_read_time = 0;
-		tsmsg->m_block_write_time = 0;
-		tsmsg->m_session_time = 0;
-		tsmsg->m_active_time = 0;
-		tsmsg->m_idle_in_xact_time = 0;
-	}
+	dshash_release_lock(pgStatSharedTabHash, shent);
+}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
+/*
+ * Subroutine for pgstat_report_stat: add database-wide counts to the shared
+ * entry of the given database
+ */
+static void
+pgstat_flush_dbstat(Oid dboid, PgStat_StatDBEntry *delta)
+{
+	PgStat_StatDBEntry *dbentry;
 
-	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	dbentry = pgstat_lock_db_entry(dboid);
+	pgstat_add_dbentry_counts(dbentry, delta);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 /*
- * Subroutine for pgstat_report_stat: populate and send a function stat message
+ * Subroutine for pgstat_report_stat: flush the pending function statistics
  */
 static void
 pgstat_send_funcstats(void)
@@ -1061,49 +1108,46 @@ pgstat_send_funcstats(void)
 	/* we assume this inits to all zeroes: */
 	static const PgStat_FunctionCounts all_zeroes;
 
-	PgStat_MsgFuncstat msg;
 	PgStat_BackendFunctionEntry *entry;
 	HASH_SEQ_STATUS fstat;
 
 	if (pgStatFunctions == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_FUNCSTAT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_nentries = 0;
-
 	hash_seq_init(&fstat, pgStatFunctions);
 	while ((entry = (PgStat_BackendFunctionEntry *) hash_seq_search(&fstat)) != NULL)
 	{
-		PgStat_FunctionEntry *m_ent;
+		PgStatShared_FuncEntry *shent;
+		PgStat_ObjectKey key;
+		bool		found;
 
 		/* Skip it if no counts accumulated since last time */
 		if (memcmp(&entry->f_counts, &all_zeroes,
 				   sizeof(PgStat_FunctionCounts)) == 0)
 			continue;
 
-		/* need to convert format of time accumulators */
-		m_ent = &msg.m_entry[msg.m_nentries];
-		m_ent->f_id = entry->f_id;
-		m_ent->f_numcalls = entry->f_counts.f_numcalls;
-		m_ent->f_total_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
-		m_ent->f_self_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
-
-		if (++msg.m_nentries >= PGSTAT_NUM_FUNCENTRIES)
+		key.dboid = MyDatabaseId;
+		key.objoid = entry->f_id;
+		shent = dshash_find_or_insert(pgStatSharedFuncHash, &key, &found);
+		if (!found)
 		{
-			pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-						msg.m_nentries * sizeof(PgStat_FunctionEntry));
-			msg.m_nentries = 0;
+			memset(&shent->stats, 0, sizeof(PgStat_StatFuncEntry));
+			shent->stats.functionid = entry->f_id;
 		}
 
+		/* need to convert format of time accumulators */
+		shent->stats.f_numcalls += entry->f_counts.f_numcalls;
+		shent->stats.f_total_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
+		shent->stats.f_self_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
+
+		dshash_release_lock(pgStatSharedFuncHash, shent);
+
 		/* reset the entry's counts */
 		MemSet(&entry->f_counts, 0, sizeof(PgStat_FunctionCounts));
 	}
 
-	if (msg.m_nentries > 0)
-		pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-					msg.m_nentries * sizeof(PgStat_FunctionEntry));
-
 	have_function_stats = false;
 }
 
@@ -1111,29 +1155,22 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the statistics of objects that no longer exist.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
-	PgStat_MsgFuncpurge f_msg;
-	HASH_SEQ_STATUS hstat;
+	dshash_seq_status hstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			len;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	PgStatShared_TabEntry *tabentry;
+	PgStatShared_FuncEntry *funcentry;
+	PgStat_StatReplSlotEntry *slots;
+	List	   *dropped_dbs = NIL;
+	ListCell   *lc;
+	bool		have_funcs = false;
+	int			i;
 
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
@@ -1141,51 +1178,48 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases, and drop them.  We
+	 * can't do that while scanning, since dropping a database has to scan
+	 * the other hash tables too.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
 	{
 		Oid			dbid = dbentry->databaseid;
 
-		CHECK_FOR_INTERRUPTS();
-
 		/* the DB entry for shared tables (with InvalidOid) is never dropped */
 		if (OidIsValid(dbid) &&
 			hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
-			pgstat_drop_database(dbid);
+			dropped_dbs = lappend_oid(dropped_dbs, dbid);
 	}
+	dshash_seq_term(&hstat);
+
+	foreach(lc, dropped_dbs)
+		pgstat_drop_database(lfirst_oid(lc));
 
 	/* Clean up */
 	hash_destroy(htab);
+	list_free(dropped_dbs);
 
 	/*
-	 * Search for all the dead replication slots in stats hashtable and tell
-	 * the stats collector to drop them.
+	 * Search for all the dead replication slots in the stats array and drop
+	 * them.  Work on a copy, since looking up the slots takes their own lock.
 	 */
-	if (replSlotStatHash)
-	{
-		PgStat_StatReplSlotEntry *slotentry;
+	slots = palloc(sizeof(PgStat_StatReplSlotEntry) * max_replication_slots);
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_SHARED);
+	memcpy(slots, PgStatReplSlots,
+		   sizeof(PgStat_StatReplSlotEntry) * max_replication_slots);
+	LWLockRelease(&pgStatShmem->replslot_lock);
 
-		hash_seq_init(&hstat, replSlotStatHash);
-		while ((slotentry = (PgStat_StatReplSlotEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			CHECK_FOR_INTERRUPTS();
+	for (i = 0; i < max_replication_slots; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
 
-			if (SearchNamedReplicationSlot(NameStr(slotentry->slotname), true) == NULL)
-				pgstat_report_replslot_drop(NameStr(slotentry->slotname));
-		}
+		if (NameStr(slots[i].slotname)[0] != '\0' &&
+			SearchNamedReplicationSlot(NameStr(slots[i].slotname), true) == NULL)
+			pgstat_report_replslot_drop(NameStr(slots[i].slotname));
 	}
-
-	/*
-	 * Lookup our own database entry; if not found, nothing more to do.
-	 */
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &MyDatabaseId,
-												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
-		return;
+	pfree(slots);
 
 	/*
 	 * Similarly to above, make a list of all known relations in this DB.
@@ -1193,56 +1227,20 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
 
 	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
-
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
+	 * Check for all tables of this DB listed in the stats hashtable if they
+	 * still exist.
 	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedTabHash, true);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
+		if (tabentry->key.dboid != MyDatabaseId)
 			continue;
 
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
-		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
-		}
-	}
-
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
-	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
+		if (hash_search(htab, (void *) &tabentry->key.objoid,
+						HASH_FIND, NULL) == NULL)
+			dshash_delete_current(&hstat);
 	}
+	dshash_seq_term(&hstat);
 
 	/* Clean up */
 	hash_destroy(htab);
@@ -1251,54 +1249,32 @@ pgstat_vacuum_stat(void)
 	 * Now repeat the above steps for functions.  However, we needn't bother
 	 * in the common case where no function stats are being collected.
 	 */
-	if (dbentry->functions != NULL &&
-		hash_get_num_entries(dbentry->functions) > 0)
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, false);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
-
-		pgstat_setheader(&f_msg.m_hdr, PGSTAT_MTYPE_FUNCPURGE);
-		f_msg.m_databaseid = MyDatabaseId;
-		f_msg.m_nentries = 0;
-
-		hash_seq_init(&hstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&hstat)) != NULL)
+		if (funcentry->key.dboid == MyDatabaseId)
 		{
-			Oid			funcid = funcentry->functionid;
-
-			CHECK_FOR_INTERRUPTS();
-
-			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) != NULL)
-				continue;
-
-			/*
-			 * Not there, so add this function's Oid to the message
-			 */
-			f_msg.m_functionid[f_msg.m_nentries++] = funcid;
-
-			/*
-			 * If the message is full, send it out and reinitialize to empty
-			 */
-			if (f_msg.m_nentries >= PGSTAT_NUM_FUNCPURGE)
-			{
-				len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-					+ f_msg.m_nentries * sizeof(Oid);
-
-				pgstat_send(&f_msg, len);
-
-				f_msg.m_nentries = 0;
-			}
+			have_funcs = true;
+			break;
 		}
+	}
+	dshash_seq_term(&hstat);
 
-		/*
-		 * Send the rest
-		 */
-		if (f_msg.m_nentries > 0)
+	if (have_funcs)
+	{
+		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
+
+		dshash_seq_init(&hstat, pgStatSharedFuncHash, true);
+		while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 		{
-			len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-				+ f_msg.m_nentries * sizeof(Oid);
+			if (funcentry->key.dboid != MyDatabaseId)
+				continue;
 
-			pgstat_send(&f_msg, len);
+			if (hash_search(htab, (void *) &funcentry->key.objoid,
+							HASH_FIND, NULL) == NULL)
+				dshash_delete_current(&hstat);
 		}
+		dshash_seq_term(&hstat);
 
 		hash_destroy(htab);
 	}
@@ -1358,61 +1334,25 @@ pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a database we just dropped.  (If we fail to
+ *	get here, we will still clean the dead DB eventually via future
+ *	invocations of pgstat_vacuum_stat().)
  * ----------
  */
 void
 pgstat_drop_database(Oid databaseid)
 {
-	PgStat_MsgDropdb msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	Assert(OidIsValid(databaseid));
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
-	msg.m_databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
+	(void) dshash_delete_key(pgStatSharedDBHash, &databaseid);
+	pgstat_drop_db_objects(databaseid);
 }
 
 
-/* ----------
- * pgstat_drop_relation() -
- *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
- *
- *	Currently not used for lack of any good place to call it; we rely
- *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
- * ----------
- */
-#ifdef NOT_USED
-void
-pgstat_drop_relation(Oid relid)
-{
-	PgStat_MsgTabpurge msg;
-	int			len;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
-}
-#endif							/* NOT_USED */
-
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset counters for our database.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1421,20 +1361,23 @@ pgstat_drop_relation(Oid relid)
 void
 pgstat_reset_counters(void)
 {
-	PgStat_MsgResetcounter msg;
+	PgStat_StatDBEntry *dbentry;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	/* nothing to do if we don't have statistics for the database yet */
+	dbentry = dshash_find(pgStatSharedDBHash, &MyDatabaseId, true);
+	if (dbentry == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETCOUNTER);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, sizeof(msg));
+	pgstat_reset_dbentry(dbentry);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+
+	pgstat_drop_db_objects(MyDatabaseId);
 }
 
 /* ----------
  * pgstat_reset_shared_counters() -
  *
- *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	Reset cluster-wide shared counters.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1443,31 +1386,46 @@ pgstat_reset_counters(void)
 void
 pgstat_reset_shared_counters(const char *target)
 {
-	PgStat_MsgResetsharedcounter msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	TimestampTz ts;
 
 	if (strcmp(target, "archiver") == 0)
-		msg.m_resettarget = RESET_ARCHIVER;
+	{
+		ts = GetCurrentTimestamp();
+		LWLockAcquire(&pgStatShmem->archiver_lock, LW_EXCLUSIVE);
+		memset(&pgStatShmem->archiver, 0, sizeof(PgStat_ArchiverStats));
+		pgStatShmem->archiver.stat_reset_timestamp = ts;
+		LWLockRelease(&pgStatShmem->archiver_lock);
+	}
 	else if (strcmp(target, "bgwriter") == 0)
-		msg.m_resettarget = RESET_BGWRITER;
+	{
+		/* Reset the bgwriter and checkpointer statistics for the cluster. */
+		ts = GetCurrentTimestamp();
+		LWLockAcquire(&pgStatShmem->global_lock, LW_EXCLUSIVE);
+		memset(&pgStatShmem->bgwriter, 0, sizeof(PgStat_BgWriterStats));
+		memset(&pgStatShmem->checkpointer, 0, sizeof(PgStat_CheckpointerStats));
+		pgStatShmem->bgwriter.stat_reset_timestamp = ts;
+		LWLockRelease(&pgStatShmem->global_lock);
+	}
 	else if (strcmp(target, "wal") == 0)
-		msg.m_resettarget = RESET_WAL;
+	{
+		ts = GetCurrentTimestamp();
+		LWLockAcquire(&pgStatShmem->wal_lock, LW_EXCLUSIVE);
+		memset(&pgStatShmem->wal, 0, sizeof(PgStat_WalStats));
+		pgStatShmem->wal.stat_reset_timestamp = ts;
+		LWLockRelease(&pgStatShmem->wal_lock);
+	}
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
 				 errhint("Target must be \"archiver\", \"bgwriter\", or \"wal\".")));
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
-	pgstat_send(&msg, sizeof(msg));
 }
 
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset the statistics of a single object, which may be of the current
+ *	database or shared across all databases in the cluster.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1476,24 +1434,31 @@ pgstat_reset_shared_counters(const char *target)
 void
 pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
-	PgStat_MsgResetsinglecounter msg;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	key.dboid = IsSharedRelation(objoid) ? InvalidOid : MyDatabaseId;
+	key.objoid = objoid;
+
+	dbentry = dshash_find(pgStatSharedDBHash, &key.dboid, true);
+	if (dbentry == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSINGLECOUNTER);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_resettype = type;
-	msg.m_objectid = objoid;
+	/* Set the reset timestamp for the whole database */
+	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 
-	pgstat_send(&msg, sizeof(msg));
+	/* Remove object if it exists, ignore it if not */
+	if (type == RESET_TABLE)
+		(void) dshash_delete_key(pgStatSharedTabHash, &key);
+	else if (type == RESET_FUNCTION)
+		(void) dshash_delete_key(pgStatSharedFuncHash, &key);
 }
 
 /* ----------
  * pgstat_reset_slru_counter() -
  *
- *	Tell the statistics collector to reset a single SLRU counter, or all
- *	SLRU counters (when name is null).
+ *	Reset a single SLRU counter, or all SLRU counters (when name is null).
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1502,22 +1467,28 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 void
 pgstat_reset_slru_counter(const char *name)
 {
-	PgStat_MsgResetslrucounter msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSLRUCOUNTER);
-	msg.m_index = (name) ? pgstat_slru_index(name) : -1;
+	int			index = (name) ? pgstat_slru_index(name) : -1;
+	TimestampTz ts = GetCurrentTimestamp();
+	int			i;
 
-	pgstat_send(&msg, sizeof(msg));
+	LWLockAcquire(&pgStatShmem->slru_lock, LW_EXCLUSIVE);
+	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
+	{
+		/* reset entry with the given index, or all entries (index is -1) */
+		if ((index == -1) || (index == i))
+		{
+			memset(&pgStatShmem->slru[i], 0, sizeof(PgStat_SLRUStats));
+			pgStatShmem->slru[i].stat_reset_timestamp = ts;
+		}
+	}
+	LWLockRelease(&pgStatShmem->slru_lock);
 }
 
 /* ----------
  * pgstat_reset_replslot_counter() -
  *
- *	Tell the statistics collector to reset a single replication slot
- *	counter, or all replication slots counters (when name is null).
+ *	Reset a single replication slot counter, or all replication slots
+ *	counters (when name is null).
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1526,22 +1497,32 @@ pgstat_reset_slru_counter(const char *name)
 void
 pgstat_reset_replslot_counter(const char *name)
 {
-	PgStat_MsgResetreplslotcounter msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	PgStat_StatReplSlotEntry *slotent;
+	TimestampTz ts = GetCurrentTimestamp();
 
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
 	if (name)
 	{
-		namestrcpy(&msg.m_slotname, name);
-		msg.clearall = false;
+		/*
+		 * Nothing to do if the given slot entry is not found.  This could
+		 * happen when the slot with the given name was removed concurrently.
+		 */
+		slotent = pgstat_get_replslot_entry(name, false);
+		if (slotent)
+			pgstat_reset_replslot(slotent, ts);
 	}
 	else
-		msg.clearall = true;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETREPLSLOTCOUNTER);
+	{
+		int			i;
 
-	pgstat_send(&msg, sizeof(msg));
+		for (i = 0; i < max_replication_slots; i++)
+		{
+			slotent = &PgStatReplSlots[i];
+			if (NameStr(slotent->slotname)[0] != '\0')
+				pgstat_reset_replslot(slotent, ts);
+		}
+	}
+	LWLockRelease(&pgStatShmem->replslot_lock);
 }
 
 /* ----------
@@ -1555,61 +1536,91 @@ pgstat_reset_replslot_counter(const char *name)
 void
 pgstat_report_autovac(Oid dboid)
 {
-	PgStat_MsgAutovacStart msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
-	msg.m_databaseid = dboid;
-	msg.m_start_time = GetCurrentTimestamp();
+	PgStat_StatDBEntry *dbentry;
+	TimestampTz ts = GetCurrentTimestamp();
 
-	pgstat_send(&msg, sizeof(msg));
+	/*
+	 * Store the last autovacuum time in the database's hashtable entry.
+	 */
+	dbentry = pgstat_lock_db_entry(dboid);
+	dbentry->last_autovac_time = ts;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Report about the table we just vacuumed.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
+	PgStatShared_TabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
-}
+	ts = GetCurrentTimestamp();
 
-/* --------
- * pgstat_report_analyze() -
- *
- *	Tell the collector about the table we just analyzed.
- *
- * Caller must provide new live- and dead-tuples estimates, as well as a
- * flag indicating whether to reset the changes_since_analyze counter.
- * --------
- */
-void
-pgstat_report_analyze(Relation rel,
-					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
-					  bool resetcounter)
-{
-	PgStat_MsgAnalyze msg;
+	/*
+	 * Store the data in the table's hashtable entry.
+	 */
+	shent = pgstat_lock_tab_entry(shared ? InvalidOid : MyDatabaseId, tableoid);
+	tabentry = &shent->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * It is quite possible that a non-aggressive VACUUM ended up skipping
+	 * various pages, however, we'll zero the insert counter here regardless.
+	 * It's currently used only to track when we need to perform an "insert"
+	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
+	 * Zeroing this may just mean we'll not try to vacuum the table again
+	 * until enough tuples have been inserted to trigger another insert
+	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
+	 * stragglers.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_vacuum_timestamp = ts;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = ts;
+		tabentry->vacuum_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTabHash, shent);
+}
+
+/* --------
+ * pgstat_report_analyze() -
+ *
+ *	Report about the table we just analyzed.
+ *
+ * Caller must provide new live- and dead-tuples estimates, as well as a
+ * flag indicating whether to reset the changes_since_analyze counter.
+ * --------
+ */
+void
+pgstat_report_analyze(Relation rel,
+					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
+					  bool resetcounter)
+{
+	PgStatShared_TabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1617,10 +1628,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that the shared counters
+	 * end up with the right numbers if we abort instead of committing.)
 	 *
 	 * Waste no time on partitioned tables, though.
 	 */
@@ -1641,54 +1651,94 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_resetcounter = resetcounter;
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	ts = GetCurrentTimestamp();
+
+	/*
+	 * Store the data in the table's hashtable entry.
+	 */
+	shent = pgstat_lock_tab_entry(rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId,
+								  RelationGetRelid(rel));
+	tabentry = &shent->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * If commanded, reset changes_since_analyze to zero.  This forgets any
+	 * changes that were committed while the ANALYZE was in progress, but we
+	 * have no good way to estimate how many of those there were.
+	 */
+	if (resetcounter)
+		tabentry->changes_since_analyze = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_analyze_timestamp = ts;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = ts;
+		tabentry->analyze_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTabHash, shent);
 }
 
 /* --------
  * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a Hot Standby recovery conflict.
+ *	Count a Hot Standby recovery conflict.
  * --------
  */
 void
 pgstat_report_recovery_conflict(int reason)
 {
-	PgStat_MsgRecoveryConflict msg;
-
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_reason = reason;
-	pgstat_send(&msg, sizeof(msg));
+	switch (reason)
+	{
+		case PROCSIG_RECOVERY_CONFLICT_DATABASE:
+
+			/*
+			 * Since we drop the information about the database as soon as it
+			 * replicates, there is no point in counting these conflicts.
+			 */
+			return;
+		case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
+			pendingDBStats.n_conflict_tablespace++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_LOCK:
+			pendingDBStats.n_conflict_lock++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
+			pendingDBStats.n_conflict_snapshot++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
+			pendingDBStats.n_conflict_bufferpin++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
+			pendingDBStats.n_conflict_startup_deadlock++;
+			break;
+	}
+	have_db_stats = true;
 }
 
 /* --------
  * pgstat_report_deadlock() -
  *
- *	Tell the collector about a deadlock detected.
+ *	Count a deadlock detected.
  * --------
  */
 void
 pgstat_report_deadlock(void)
 {
-	PgStat_MsgDeadlock msg;
-
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCK);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, sizeof(msg));
+	pendingDBStats.n_deadlocks++;
+	have_db_stats = true;
 }
 
 
@@ -1696,29 +1746,31 @@ pgstat_report_deadlock(void)
 /* --------
  * pgstat_report_checksum_failures_in_db() -
  *
- *	Tell the collector about one or more checksum failures.
+ *	Report one or more checksum failures.  The database need not be ours,
+ *	so this goes straight to shared memory.
  * --------
  */
 void
 pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount)
 {
-	PgStat_MsgChecksumFailure msg;
+	PgStat_StatDBEntry *dbentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_CHECKSUMFAILURE);
-	msg.m_databaseid = dboid;
-	msg.m_failurecount = failurecount;
-	msg.m_failure_time = GetCurrentTimestamp();
+	ts = GetCurrentTimestamp();
 
-	pgstat_send(&msg, sizeof(msg));
+	dbentry = pgstat_lock_db_entry(dboid);
+	dbentry->n_checksum_failures += failurecount;
+	dbentry->last_checksum_failure = ts;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 /* --------
  * pgstat_report_checksum_failure() -
  *
- *	Tell the collector about a checksum failure.
+ *	Report a checksum failure.
  * --------
  */
 void
@@ -1730,62 +1782,36 @@ pgstat_report_checksum_failure(void)
 /* --------
  * pgstat_report_tempfile() -
  *
- *	Tell the collector about a temporary file.
+ *	Count a temporary file.
  * --------
  */
 void
 pgstat_report_tempfile(size_t filesize)
 {
-	PgStat_MsgTempFile msg;
-
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_filesize = filesize;
-	pgstat_send(&msg, sizeof(msg));
+	pendingDBStats.n_temp_bytes += filesize;
+	pendingDBStats.n_temp_files += 1;
+	have_db_stats = true;
 }
 
 /* --------
  * pgstat_report_connect() -
  *
- *	Tell the collector about a new connection.
+ *	Count a new connection.
  * --------
  */
 void
 pgstat_report_connect(Oid dboid)
 {
-	PgStat_MsgConnect msg;
-
 	if (!pgstat_should_report_connstat())
 		return;
 
 	pgLastSessionReportTime = MyStartTimestamp;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_CONNECT);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, sizeof(PgStat_MsgConnect));
-}
-
-/* --------
- * pgstat_report_disconnect() -
- *
- *	Tell the collector about a disconnect.
- * --------
- */
-static void
-pgstat_report_disconnect(Oid dboid)
-{
-	PgStat_MsgDisconnect msg;
-
-	if (!pgstat_should_report_connstat())
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DISCONNECT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_cause = pgStatSessionEndCause;
-	pgstat_send(&msg, sizeof(PgStat_MsgDisconnect));
+	pendingDBStats.n_sessions++;
+	have_db_stats = true;
 }
 
 /* --------
@@ -1807,105 +1833,72 @@ pgstat_should_report_connstat(void)
 /* ----------
  * pgstat_report_replslot() -
  *
- *	Tell the collector about replication slot statistics.
+ *	Add to the statistics of a replication slot.
  * ----------
  */
 void
 pgstat_report_replslot(const PgStat_StatReplSlotEntry *repSlotStat)
 {
-	PgStat_MsgReplSlot msg;
+	PgStat_StatReplSlotEntry *slotent;
 
-	/*
-	 * Prepare and send the message
-	 */
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_REPLSLOT);
-	namestrcpy(&msg.m_slotname, NameStr(repSlotStat->slotname));
-	msg.m_create = false;
-	msg.m_drop = false;
-	msg.m_spill_txns = repSlotStat->spill_txns;
-	msg.m_spill_count = repSlotStat->spill_count;
-	msg.m_spill_bytes = repSlotStat->spill_bytes;
-	msg.m_stream_txns = repSlotStat->stream_txns;
-	msg.m_stream_count = repSlotStat->stream_count;
-	msg.m_stream_bytes = repSlotStat->stream_bytes;
-	msg.m_total_txns = repSlotStat->total_txns;
-	msg.m_total_bytes = repSlotStat->total_bytes;
-	pgstat_send(&msg, sizeof(PgStat_MsgReplSlot));
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
+	slotent = pgstat_get_replslot_entry(NameStr(repSlotStat->slotname), true);
+	if (slotent)
+	{
+		slotent->spill_txns += repSlotStat->spill_txns;
+		slotent->spill_count += repSlotStat->spill_count;
+		slotent->spill_bytes += repSlotStat->spill_bytes;
+		slotent->stream_txns += repSlotStat->stream_txns;
+		slotent->stream_count += repSlotStat->stream_count;
+		slotent->stream_bytes += repSlotStat->stream_bytes;
+		slotent->total_txns += repSlotStat->total_txns;
+		slotent->total_bytes += repSlotStat->total_bytes;
+	}
+	LWLockRelease(&pgStatShmem->replslot_lock);
 }
 
 /* ----------
  * pgstat_report_replslot_create() -
  *
- *	Tell the collector about creating the replication slot.
+ *	Set up the statistics of a newly created replication slot.
  * ----------
  */
 void
 pgstat_report_replslot_create(const char *slotname)
 {
-	PgStat_MsgReplSlot msg;
+	PgStat_StatReplSlotEntry *slotent;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_REPLSLOT);
-	namestrcpy(&msg.m_slotname, slotname);
-	msg.m_create = true;
-	msg.m_drop = false;
-	pgstat_send(&msg, sizeof(PgStat_MsgReplSlot));
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
+	slotent = pgstat_get_replslot_entry(slotname, true);
+
+	/*
+	 * If the statistics of a dropped slot with the same name were not
+	 * removed, the entry has stats for the old slot.  So we initialize all
+	 * counters at slot creation.
+	 */
+	if (slotent)
+		pgstat_reset_replslot(slotent, 0);
+	LWLockRelease(&pgStatShmem->replslot_lock);
 }
 
 /* ----------
  * pgstat_report_replslot_drop() -
  *
- *	Tell the collector about dropping the replication slot.
+ *	Remove the statistics of a dropped replication slot.
  * ----------
  */
 void
 pgstat_report_replslot_drop(const char *slotname)
 {
-	PgStat_MsgReplSlot msg;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_REPLSLOT);
-	namestrcpy(&msg.m_slotname, slotname);
-	msg.m_create = false;
-	msg.m_drop = true;
-	pgstat_send(&msg, sizeof(PgStat_MsgReplSlot));
-}
-
-/* ----------
- * pgstat_ping() -
- *
- *	Send some junk data to the collector to increase traffic.
- * ----------
- */
-void
-pgstat_ping(void)
-{
-	PgStat_MsgDummy msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DUMMY);
-	pgstat_send(&msg, sizeof(msg));
-}
-
-/* ----------
- * pgstat_send_inquiry() -
- *
- *	Notify collector that we need fresh data.
- * ----------
- */
-static void
-pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time, Oid databaseid)
-{
-	PgStat_MsgInquiry msg;
+	PgStat_StatReplSlotEntry *slotent;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
-	msg.clock_time = clock_time;
-	msg.cutoff_time = cutoff_time;
-	msg.databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
+	slotent = pgstat_get_replslot_entry(slotname, false);
+	if (slotent)
+		memset(slotent, 0, sizeof(PgStat_StatReplSlotEntry));
+	LWLockRelease(&pgStatShmem->replslot_lock);
 }
 
-
 /*
  * Initialize function call usage data.
  * Called by the executor before invoking a function.
@@ -2023,7 +2016,7 @@ pgstat_end_function_usage(PgStat_FunctionCallUsage *fcu, bool finalize)
 	fs->f_total_time = f_total;
 	INSTR_TIME_ADD(fs->f_self_time, f_self);
 
-	/* indicate that we have something to send */
+	/* indicate that we have something to flush */
 	have_function_stats = true;
 }
 
@@ -2055,7 +2048,7 @@ pgstat_initstats(Relation rel)
 		return;
 	}
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 	{
 		/* We're not counting at all */
 		rel->pgstat_info = NULL;
@@ -2445,7 +2438,7 @@ AtEOXact_PgStat_Database(bool isCommit, bool parallel)
 	{
 		/*
 		 * Count transaction commit or abort.  (We use counters, not just
-		 * bools, in case the reporting message isn't sent right away.)
+		 * bools, in case the counts aren't flushed right away.)
 		 */
 		if (isCommit)
 			pgStatXactCommit++;
@@ -2647,7 +2640,7 @@ AtPrepare_PgStat(void)
 /*
  * All we need do here is unlink the transaction stats state from the
  * nontransactional state.  The nontransactional action counts will be
- * reported to the stats collector immediately, while the effects on
+ * flushed by the next pgstat_report_stat() as usual, while the effects on
  * live and dead tuple counts are preserved in the 2PC state file.
  *
  * Note: AtEOXact_PgStat_Relations is not called during PREPARE.
@@ -2761,30 +2754,25 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
 }
 
 
+/* ------------------------------------------------------------
+ * Fetching statistics
+ * ------------------------------------------------------------
+ */
+
 /* ----------
  * pgstat_fetch_stat_dbentry() -
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
- *	the collected statistics for one database or NULL. NULL doesn't mean
- *	that the database doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	the statistics for one database or NULL. NULL doesn't mean
+ *	that the database doesn't exist, just that it has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
-
-	/*
-	 * Lookup the requested database; return NULL if not found
-	 */
-	return (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-											  (void *) &dbid,
-											  HASH_FIND, NULL);
+	return (PgStat_StatDBEntry *)
+		pgstat_snapshot_entry(PGSTAT_SNAPSHOT_DB, dbid, InvalidOid);
 }
 
 
@@ -2792,57 +2780,42 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  * pgstat_fetch_stat_tabentry() -
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
- *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	the statistics for one table or NULL. NULL doesn't mean
+ *	that the table doesn't exist, just that it has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * Lookup the table in our database first.
 	 */
-	backend_read_statsfile();
-
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	tabentry = pgstat_fetch_stat_tabentry_ext(false, relid);
+	if (tabentry != NULL)
+		return tabentry;
 
 	/*
 	 * If we didn't find it, maybe it's a shared table.
 	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	return pgstat_fetch_stat_tabentry_ext(true, relid);
+}
 
-	return NULL;
+/* ----------
+ * pgstat_fetch_stat_tabentry_ext() -
+ *
+ *	Like pgstat_fetch_stat_tabentry(), but for callers that know whether the
+ *	table is shared, and so need only one lookup.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_stat_tabentry_ext(bool shared, Oid relid)
+{
+	return (PgStat_StatTabEntry *)
+		pgstat_snapshot_entry(PGSTAT_SNAPSHOT_TABLE,
+							  shared ? InvalidOid : MyDatabaseId, relid);
 }
 
 
@@ -2850,28 +2823,14 @@ pgstat_fetch_stat_tabentry(Oid relid)
  * pgstat_fetch_stat_funcentry() -
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
- *	the collected statistics for one function or NULL.
+ *	the statistics for one function or NULL.
  * ----------
  */
 PgStat_StatFuncEntry *
 pgstat_fetch_stat_funcentry(Oid func_id)
 {
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry = NULL;
-
-	/* load the stats file if needed */
-	backend_read_statsfile();
-
-	/* Lookup our database, then find the requested function.  */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-	if (dbentry != NULL && dbentry->functions != NULL)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &func_id,
-														 HASH_FIND, NULL);
-	}
-
-	return funcentry;
+	return (PgStat_StatFuncEntry *)
+		pgstat_snapshot_entry(PGSTAT_SNAPSHOT_FUNCTION, MyDatabaseId, func_id);
 }
 
 
@@ -2886,7 +2845,14 @@ pgstat_fetch_stat_funcentry(Oid func_id)
 PgStat_ArchiverStats *
 pgstat_fetch_stat_archiver(void)
 {
-	backend_read_statsfile();
+	if (!archiverSnapshotValid)
+	{
+		LWLockAcquire(&pgStatShmem->archiver_lock, LW_SHARED);
+		memcpy(&archiverStats, &pgStatShmem->archiver,
+			   sizeof(PgStat_ArchiverStats));
+		LWLockRelease(&pgStatShmem->archiver_lock);
+		archiverSnapshotValid = true;
+	}
 
 	return &archiverStats;
 }
@@ -2902,7 +2868,7 @@ pgstat_fetch_stat_archiver(void)
 PgStat_BgWriterStats *
 pgstat_fetch_stat_bgwriter(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats.bgwriter;
 }
@@ -2918,7 +2884,7 @@ pgstat_fetch_stat_bgwriter(void)
 PgStat_CheckpointerStats *
 pgstat_fetch_stat_checkpointer(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats.checkpointer;
 }
@@ -2934,7 +2900,7 @@ pgstat_fetch_stat_checkpointer(void)
 PgStat_GlobalStats *
 pgstat_fetch_global(void)
 {
-	backend_read_statsfile();
+	pgstat_snapshot_global();
 
 	return &globalStats;
 }
@@ -2950,7 +2916,13 @@ pgstat_fetch_global(void)
 PgStat_WalStats *
 pgstat_fetch_stat_wal(void)
 {
-	backend_read_statsfile();
+	if (!walSnapshotValid)
+	{
+		LWLockAcquire(&pgStatShmem->wal_lock, LW_SHARED);
+		memcpy(&walStats, &pgStatShmem->wal, sizeof(PgStat_WalStats));
+		LWLockRelease(&pgStatShmem->wal_lock);
+		walSnapshotValid = true;
+	}
 
 	return &walStats;
 }
@@ -2966,7 +2938,13 @@ pgstat_fetch_stat_wal(void)
 PgStat_SLRUStats *
 pgstat_fetch_slru(void)
 {
-	backend_read_statsfile();
+	if (!slruSnapshotValid)
+	{
+		LWLockAcquire(&pgStatShmem->slru_lock, LW_SHARED);
+		memcpy(slruStats, pgStatShmem->slru, sizeof(slruStats));
+		LWLockRelease(&pgStatShmem->slru_lock);
+		slruSnapshotValid = true;
+	}
 
 	return slruStats;
 }
@@ -2982,15 +2960,37 @@ pgstat_fetch_slru(void)
 PgStat_StatReplSlotEntry *
 pgstat_fetch_replslot(NameData slotname)
 {
-	backend_read_statsfile();
+	int			i;
+
+	if (replSlotSnapshot == NULL)
+	{
+		pgstat_setup_memcxt();
+		replSlotSnapshot = (PgStat_StatReplSlotEntry *)
+			MemoryContextAlloc(pgStatLocalContext,
+							   sizeof(PgStat_StatReplSlotEntry) * max_replication_slots);
 
-	return pgstat_get_replslot_entry(slotname, false);
+		LWLockAcquire(&pgStatShmem->replslot_lock, LW_SHARED);
+		memcpy(replSlotSnapshot, PgStatReplSlots,
+			   sizeof(PgStat_StatReplSlotEntry) * max_replication_slots);
+		LWLockRelease(&pgStatShmem->replslot_lock);
+	}
+
+	for (i = 0; i < max_replication_slots; i++)
+	{
+		PgStat_StatReplSlotEntry *slotent = &replSlotSnapshot[i];
+
+		if (NameStr(slotent->slotname)[0] != '\0' &&
+			namestrcmp(&slotent->slotname, NameStr(slotname)) == 0)
+			return slotent;
+	}
+
+	return NULL;
 }
 
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
+ * Flush any remaining statistics counts out to shared memory.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
  */
@@ -3001,13 +3001,15 @@ pgstat_shutdown_hook(int code, Datum arg)
 
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
-	 * database ID, so forget it.  (This means that accesses to pg_database
-	 * during failed backend starts might never get counted.)
+	 * we did.  Otherwise, we'd be reporting an invalid database ID, so forget
+	 * it.  (This means that accesses to pg_database during failed backend
+	 * starts might never get counted.)
 	 */
 	if (OidIsValid(MyDatabaseId))
 		pgstat_report_stat(true);
 
+	pgstat_detach_shmem();
+
 #ifdef USE_ASSERT_CHECKING
 	pgstat_is_shutdown = true;
 #endif
@@ -3016,8 +3018,8 @@ pgstat_shutdown_hook(int code, Datum arg)
 /* ----------
  * pgstat_initialize() -
  *
- *	Initialize pgstats state, and set up our on-proc-exit hook. Called from
- *	BaseInit().
+ *	Initialize pgstats state, attach to the shared statistics, and set up
+ *	our on-proc-exit hook. Called from BaseInit().
  *
  *	NOTE: MyDatabaseId isn't set yet; so the shutdown hook has to be careful.
  * ----------
@@ -3027,6 +3029,8 @@ pgstat_initialize(void)
 {
 	Assert(!pgstat_is_initialized);
 
+	pgstat_attach_shmem();
+
 	/*
 	 * Initialize prevWalUsage with pgWalUsage so that pgstat_send_wal() can
 	 * calculate how much pgWalUsage counters are increased by subtracting
@@ -3042,105 +3046,66 @@ pgstat_initialize(void)
 #endif
 }
 
-/* ------------------------------------------------------------
- * Local support functions follow
- * ------------------------------------------------------------
- */
-
-
-/* ----------
- * pgstat_setheader() -
- *
- *		Set common header fields in a statistics message
- * ----------
- */
-static void
-pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype)
-{
-	hdr->m_type = mtype;
-}
-
-
-/* ----------
- * pgstat_send() -
- *
- *		Send out one statistics message to the collector
- * ----------
- */
-static void
-pgstat_send(void *msg, int len)
-{
-	int			rc;
-
-	pgstat_assert_is_up();
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	((PgStat_MsgHdr *) msg)->m_size = len;
-
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
-	{
-		rc = send(pgStatSock, msg, len, 0);
-	} while (rc < 0 && errno == EINTR);
-
-#ifdef USE_ASSERT_CHECKING
-	/* In debug builds, log send failures ... */
-	if (rc < 0)
-		elog(LOG, "could not send to statistics collector: %m");
-#endif
-}
-
 /* ----------
  * pgstat_send_archiver() -
  *
- *	Tell the collector about the WAL file that we successfully
+ *	Tell shared memory about a WAL file that we successfully
  *	archived or failed to archive.
  * ----------
  */
 void
 pgstat_send_archiver(const char *xlog, bool failed)
 {
-	PgStat_MsgArchiver msg;
+	TimestampTz now = GetCurrentTimestamp();
+	PgStat_ArchiverStats *archiver = &pgStatShmem->archiver;
 
-	/*
-	 * Prepare and send the message
-	 */
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ARCHIVER);
-	msg.m_failed = failed;
-	strlcpy(msg.m_xlog, xlog, sizeof(msg.m_xlog));
-	msg.m_timestamp = GetCurrentTimestamp();
-	pgstat_send(&msg, sizeof(msg));
+	LWLockAcquire(&pgStatShmem->archiver_lock, LW_EXCLUSIVE);
+	if (failed)
+	{
+		/* Failed archival attempt */
+		++archiver->failed_count;
+		strlcpy(archiver->last_failed_wal, xlog,
+				sizeof(archiver->last_failed_wal));
+		archiver->last_failed_timestamp = now;
+	}
+	else
+	{
+		/* Successful archival operation */
+		++archiver->archived_count;
+		strlcpy(archiver->last_archived_wal, xlog,
+				sizeof(archiver->last_archived_wal));
+		archiver->last_archived_timestamp = now;
+	}
+	LWLockRelease(&pgStatShmem->archiver_lock);
 }
 
 /* ----------
  * pgstat_send_bgwriter() -
  *
- *		Send bgwriter statistics to the collector
+ *		Add the pending bgwriter statistics to shared memory
  * ----------
  */
 void
 pgstat_send_bgwriter(void)
 {
 	/* We assume this initializes to zeroes */
-	static const PgStat_MsgBgWriter all_zeroes;
+	static const PgStat_BgWriterStats all_zeroes;
+	PgStat_BgWriterStats *shstats = &pgStatShmem->bgwriter;
 
 	pgstat_assert_is_up();
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, don't bother taking the lock.
 	 */
-	if (memcmp(&PendingBgWriterStats, &all_zeroes, sizeof(PgStat_MsgBgWriter)) == 0)
+	if (memcmp(&PendingBgWriterStats, &all_zeroes, sizeof(PgStat_BgWriterStats)) == 0)
 		return;
 
-	/*
-	 * Prepare and send the message
-	 */
-	pgstat_setheader(&PendingBgWriterStats.m_hdr, PGSTAT_MTYPE_BGWRITER);
-	pgstat_send(&PendingBgWriterStats, sizeof(PendingBgWriterStats));
+	LWLockAcquire(&pgStatShmem->global_lock, LW_EXCLUSIVE);
+	shstats->buf_written_clean += PendingBgWriterStats.buf_written_clean;
+	shstats->maxwritten_clean += PendingBgWriterStats.maxwritten_clean;
+	shstats->buf_alloc += PendingBgWriterStats.buf_alloc;
+	LWLockRelease(&pgStatShmem->global_lock);
 
 	/*
 	 * Clear out the statistics buffer, so it can be re-used.
@@ -3151,28 +3116,32 @@ pgstat_send_bgwriter(void)
 /* ----------
  * pgstat_send_checkpointer() -
  *
- *		Send checkpointer statistics to the collector
+ *		Add the pending checkpointer statistics to shared memory
  * ----------
  */
 void
 pgstat_send_checkpointer(void)
 {
 	/* We assume this initializes to zeroes */
-	static const PgStat_MsgCheckpointer all_zeroes;
+	static const PgStat_CheckpointerStats all_zeroes;
+	PgStat_CheckpointerStats *shstats = &pgStatShmem->checkpointer;
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, don't bother taking the lock.
 	 */
-	if (memcmp(&PendingCheckpointerStats, &all_zeroes, sizeof(PgStat_MsgCheckpointer)) == 0)
+	if (memcmp(&PendingCheckpointerStats, &all_zeroes, sizeof(PgStat_CheckpointerStats)) == 0)
 		return;
 
-	/*
-	 * Prepare and send the message
-	 */
-	pgstat_setheader(&PendingCheckpointerStats.m_hdr, PGSTAT_MTYPE_CHECKPOINTER);
-	pgstat_send(&PendingCheckpointerStats, sizeof(PendingCheckpointerStats));
+	LWLockAcquire(&pgStatShmem->global_lock, LW_EXCLUSIVE);
+	shstats->timed_checkpoints += PendingCheckpointerStats.timed_checkpoints;
+	shstats->requested_checkpoints += PendingCheckpointerStats.requested_checkpoints;
+	shstats->checkpoint_write_time += PendingCheckpointerStats.checkpoint_write_time;
+	shstats->checkpoint_sync_time += PendingCheckpointerStats.checkpoint_sync_time;
+	shstats->buf_written_checkpoints += PendingCheckpointerStats.buf_written_checkpoints;
+	shstats->buf_written_backend += PendingCheckpointerStats.buf_written_backend;
+	shstats->buf_fsync_backend += PendingCheckpointerStats.buf_fsync_backend;
+	LWLockRelease(&pgStatShmem->global_lock);
 
 	/*
 	 * Clear out the statistics buffer, so it can be re-used.
@@ -3183,31 +3152,31 @@ pgstat_send_checkpointer(void)
 /* ----------
  * pgstat_send_wal() -
  *
- *	Send WAL statistics to the collector.
+ *	Add the pending WAL statistics to shared memory.
  *
- * If 'force' is not set, WAL stats message is only sent if enough time has
- * passed since last one was sent to reach PGSTAT_STAT_INTERVAL.
+ * If 'force' is not set, the WAL stats are only flushed if enough time has
+ * passed since the last flush to reach PGSTAT_STAT_INTERVAL.
  * ----------
  */
 void
 pgstat_send_wal(bool force)
 {
 	static TimestampTz sendTime = 0;
+	PgStat_WalStats *shstats = &pgStatShmem->wal;
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, don't bother taking the lock.
 	 *
 	 * Check wal_records counter to determine whether any WAL activity has
 	 * happened since last time. Note that other WalUsage counters don't need
 	 * to be checked because they are incremented always together with
 	 * wal_records counter.
 	 *
-	 * m_wal_buffers_full also doesn't need to be checked because it's
+	 * wal_buffers_full also doesn't need to be checked because it's
 	 * incremented only when at least one WAL record is generated (i.e.,
 	 * wal_records counter is incremented). But for safely, we assert that
-	 * m_wal_buffers_full is always zero when no WAL record is generated
+	 * wal_buffers_full is always zero when no WAL record is generated
 	 *
 	 * This function can be called by a process like walwriter that normally
 	 * generates no WAL records. To determine whether any WAL activity has
@@ -3215,9 +3184,9 @@ pgstat_send_wal(bool force)
 	 * and syncs are also checked.
 	 */
 	if (pgWalUsage.wal_records == prevWalUsage.wal_records &&
-		WalStats.m_wal_write == 0 && WalStats.m_wal_sync == 0)
+		WalStats.wal_write == 0 && WalStats.wal_sync == 0)
 	{
-		Assert(WalStats.m_wal_buffers_full == 0);
+		Assert(WalStats.wal_buffers_full == 0);
 		return;
 	}
 
@@ -3226,9 +3195,8 @@ pgstat_send_wal(bool force)
 		TimestampTz now = GetCurrentTimestamp();
 
 		/*
-		 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-		 * msec since we last sent one to avoid overloading the stats
-		 * collector.
+		 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec
+		 * since we last did, to keep the lock traffic low.
 		 */
 		if (!TimestampDifferenceExceeds(sendTime, now, PGSTAT_STAT_INTERVAL))
 			return;
@@ -3245,15 +3213,14 @@ pgstat_send_wal(bool force)
 
 		/*
 		 * Calculate how much WAL usage counters were increased by
-		 * subtracting the previous counters from the current ones. Fill the
-		 * results in WAL stats message.
+		 * subtracting the previous counters from the current ones.
 		 */
 		MemSet(&walusage, 0, sizeof(WalUsage));
 		WalUsageAccumDiff(&walusage, &pgWalUsage, &prevWalUsage);
 
-		WalStats.m_wal_records = walusage.wal_records;
-		WalStats.m_wal_fpi = walusage.wal_fpi;
-		WalStats.m_wal_bytes = walusage.wal_bytes;
+		WalStats.wal_records = walusage.wal_records;
+		WalStats.wal_fpi = walusage.wal_fpi;
+		WalStats.wal_bytes = walusage.wal_bytes;
 
 		/*
 		 * Save the current counters for the subsequent calculation of WAL
@@ -3262,11 +3229,16 @@ pgstat_send_wal(bool force)
 		prevWalUsage = pgWalUsage;
 	}
 
-	/*
-	 * Prepare and send the message
-	 */
-	pgstat_setheader(&WalStats.m_hdr, PGSTAT_MTYPE_WAL);
-	pgstat_send(&WalStats, sizeof(WalStats));
+	LWLockAcquire(&pgStatShmem->wal_lock, LW_EXCLUSIVE);
+	shstats->wal_records += WalStats.wal_records;
+	shstats->wal_fpi += WalStats.wal_fpi;
+	shstats->wal_bytes += WalStats.wal_bytes;
+	shstats->wal_buffers_full += WalStats.wal_buffers_full;
+	shstats->wal_write += WalStats.wal_write;
+	shstats->wal_sync += WalStats.wal_sync;
+	shstats->wal_write_time += WalStats.wal_write_time;
+	shstats->wal_sync_time += WalStats.wal_sync_time;
+	LWLockRelease(&pgStatShmem->wal_lock);
 
 	/*
 	 * Clear out the statistics buffer, so it can be re-used.
@@ -3277,502 +3249,249 @@ pgstat_send_wal(bool force)
 /* ----------
  * pgstat_send_slru() -
  *
- *		Send SLRU statistics to the collector
+ *		Add the pending SLRU statistics to shared memory
  * ----------
  */
 static void
 pgstat_send_slru(void)
 {
 	/* We assume this initializes to zeroes */
-	static const PgStat_MsgSLRU all_zeroes;
+	static const PgStat_SLRUStats all_zeroes;
+	bool		locked = false;
 
 	for (int i = 0; i < SLRU_NUM_ELEMENTS; i++)
 	{
+		PgStat_SLRUStats *pending = &pendingSLRUStats[i];
+		PgStat_SLRUStats *shstats = &pgStatShmem->slru[i];
+
 		/*
 		 * This function can be called even if nothing at all has happened. In
-		 * this case, avoid sending a completely empty message to the stats
-		 * collector.
+		 * this case, don't bother taking the lock.
 		 */
-		if (memcmp(&SLRUStats[i], &all_zeroes, sizeof(PgStat_MsgSLRU)) == 0)
+		if (memcmp(pending, &all_zeroes, sizeof(PgStat_SLRUStats)) == 0)
 			continue;
 
-		/* set the SLRU type before each send */
-		SLRUStats[i].m_index = i;
+		if (!locked)
+		{
+			LWLockAcquire(&pgStatShmem->slru_lock, LW_EXCLUSIVE);
+			locked = true;
+		}
 
-		/*
-		 * Prepare and send the message
-		 */
-		pgstat_setheader(&SLRUStats[i].m_hdr, PGSTAT_MTYPE_SLRU);
-		pgstat_send(&SLRUStats[i], sizeof(PgStat_MsgSLRU));
+		shstats->blocks_zeroed += pending->blocks_zeroed;
+		shstats->blocks_hit += pending->blocks_hit;
+		shstats->blocks_read += pending->blocks_read;
+		shstats->blocks_written += pending->blocks_written;
+		shstats->blocks_exists += pending->blocks_exists;
+		shstats->flush += pending->flush;
+		shstats->truncate += pending->truncate;
 
 		/*
 		 * Clear out the statistics buffer, so it can be re-used.
 		 */
-		MemSet(&SLRUStats[i], 0, sizeof(PgStat_MsgSLRU));
+		MemSet(pending, 0, sizeof(PgStat_SLRUStats));
 	}
+
+	if (locked)
+		LWLockRelease(&pgStatShmem->slru_lock);
 }
 
+/* ------------------------------------------------------------
+ * Local support functions follow
+ * ------------------------------------------------------------
+ */
 
-/* ----------
- * PgstatCollectorMain() -
- *
- *	Start up the statistics collector process.  This is the body of the
- *	postmaster child process.
- *
- *	The argc/argv parameters are valid only in EXEC_BACKEND case.
- * ----------
+/*
+ * Find the shared entry of the specified database, creating it if it doesn't
+ * exist yet.  The entry is returned locked exclusively; release it with
+ * dshash_release_lock().
  */
-NON_EXEC_STATIC void
-PgstatCollectorMain(int argc, char *argv[])
+static PgStat_StatDBEntry *
+pgstat_lock_db_entry(Oid dboid)
 {
-	int			len;
-	PgStat_Msg	msg;
-	int			wr;
-	WaitEvent	event;
-	WaitEventSet *wes;
+	PgStat_StatDBEntry *dbentry;
+	bool		found;
 
-	/*
-	 * Ignore all signals usually bound to some action in the postmaster,
-	 * except SIGHUP and SIGQUIT.  Note we don't need a SIGUSR1 handler to
-	 * support latch operations, because we only use a local latch.
-	 */
-	pqsignal(SIGHUP, SignalHandlerForConfigReload);
-	pqsignal(SIGINT, SIG_IGN);
-	pqsignal(SIGTERM, SIG_IGN);
-	pqsignal(SIGQUIT, SignalHandlerForShutdownRequest);
-	pqsignal(SIGALRM, SIG_IGN);
-	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);
-	pqsignal(SIGUSR2, SIG_IGN);
-	/* Reset some signals that are accepted by postmaster but not here */
-	pqsignal(SIGCHLD, SIG_DFL);
-	PG_SETMASK(&UnBlockSig);
-
-	MyBackendType = B_STATS_COLLECTOR;
-	init_ps_display(NULL);
+	dbentry = dshash_find_or_insert(pgStatSharedDBHash, &dboid, &found);
+	if (!found)
+		pgstat_reset_dbentry(dbentry);
 
-	/*
-	 * Read in existing stats files or initialize the stats to zero.
-	 */
-	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
+	return dbentry;
+}
 
-	/* Prepare to wait for our latch or data in our socket. */
-	wes = CreateWaitEventSet(CurrentMemoryContext, 3);
-	AddWaitEventToSet(wes, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
-	AddWaitEventToSet(wes, WL_POSTMASTER_DEATH, PGINVALID_SOCKET, NULL, NULL);
-	AddWaitEventToSet(wes, WL_SOCKET_READABLE, pgStatSock, NULL, NULL);
+/*
+ * Likewise for the shared entry of a table.
+ */
+static PgStatShared_TabEntry *
+pgstat_lock_tab_entry(Oid dboid, Oid relid)
+{
+	PgStatShared_TabEntry *shent;
+	PgStat_ObjectKey key;
+	bool		found;
 
-	/*
-	 * Loop to process messages until we get SIGQUIT or detect ungraceful
-	 * death of our parent postmaster.
-	 *
-	 * For performance reasons, we don't want to do ResetLatch/WaitLatch after
-	 * every message; instead, do that only after a recv() fails to obtain a
-	 * message.  (This effectively means that if backends are sending us stuff
-	 * like mad, we won't notice postmaster death until things slack off a
-	 * bit; which seems fine.)	To do that, we have an inner loop that
-	 * iterates as long as recv() succeeds.  We do check ConfigReloadPending
-	 * inside the inner loop, which means that such interrupts will get
-	 * serviced but the latch won't get cleared until next time there is a
-	 * break in the action.
-	 */
-	for (;;)
+	key.dboid = dboid;
+	key.objoid = relid;
+	shent = dshash_find_or_insert(pgStatSharedTabHash, &key, &found);
+	if (!found)
 	{
-		/* Clear any already-pending wakeups */
-		ResetLatch(MyLatch);
-
-		/*
-		 * Quit if we get SIGQUIT from the postmaster.
-		 */
-		if (ShutdownRequestPending)
-			break;
-
-		/*
-		 * Inner loop iterates as long as we keep getting messages, or until
-		 * ShutdownRequestPending becomes set.
-		 */
-		while (!ShutdownRequestPending)
-		{
-			/*
-			 * Reload configuration if we got SIGHUP from the postmaster.
-			 */
-			if (ConfigReloadPending)
-			{
-				ConfigReloadPending = false;
-				ProcessConfigFile(PGC_SIGHUP);
-			}
-
-			/*
-			 * Write the stats file(s) if a new request has arrived that is
-			 * not satisfied by existing file(s).
-			 */
-			if (pgstat_write_statsfile_needed())
-				pgstat_write_statsfiles(false, false);
-
-			/*
-			 * Try to receive and process a message.  This will not block,
-			 * since the socket is set to non-blocking mode.
-			 *
-			 * XXX On Windows, we have to force pgwin32_recv to cooperate,
-			 * despite the previous use of pg_set_noblock() on the socket.
-			 * This is extremely broken and should be fixed someday.
-			 */
-#ifdef WIN32
-			pgwin32_noblock = 1;
-#endif
-
-			len = recv(pgStatSock, (char *) &msg,
-					   sizeof(PgStat_Msg), 0);
-
-#ifdef WIN32
-			pgwin32_noblock = 0;
-#endif
-
-			if (len < 0)
-			{
-				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-					break;		/* out of inner loop */
-				ereport(ERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not read statistics message: %m")));
-			}
-
-			/*
-			 * We ignore messages that are smaller than our common header
-			 */
-			if (len < sizeof(PgStat_MsgHdr))
-				continue;
-
-			/*
-			 * The received length must match the length in the header
-			 */
-			if (msg.msg_hdr.m_size != len)
-				continue;
-
-			/*
-			 * O.K. - we accept this message.  Process it.
-			 */
-			switch (msg.msg_hdr.m_type)
-			{
-				case PGSTAT_MTYPE_DUMMY:
-					break;
-
-				case PGSTAT_MTYPE_INQUIRY:
-					pgstat_recv_inquiry(&msg.msg_inquiry, len);
-					break;
-
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat(&msg.msg_tabstat, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge(&msg.msg_tabpurge, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb(&msg.msg_dropdb, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter(&msg.msg_resetcounter, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
-					pgstat_recv_resetsharedcounter(&msg.msg_resetsharedcounter,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(&msg.msg_resetsinglecounter,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSLRUCOUNTER:
-					pgstat_recv_resetslrucounter(&msg.msg_resetslrucounter,
-												 len);
-					break;
-
-				case PGSTAT_MTYPE_RESETREPLSLOTCOUNTER:
-					pgstat_recv_resetreplslotcounter(&msg.msg_resetreplslotcounter,
-													 len);
-					break;
-
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac(&msg.msg_autovacuum_start, len);
-					break;
-
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum(&msg.msg_vacuum, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze(&msg.msg_analyze, len);
-					break;
-
-				case PGSTAT_MTYPE_ARCHIVER:
-					pgstat_recv_archiver(&msg.msg_archiver, len);
-					break;
-
-				case PGSTAT_MTYPE_BGWRITER:
-					pgstat_recv_bgwriter(&msg.msg_bgwriter, len);
-					break;
-
-				case PGSTAT_MTYPE_CHECKPOINTER:
-					pgstat_recv_checkpointer(&msg.msg_checkpointer, len);
-					break;
-
-				case PGSTAT_MTYPE_WAL:
-					pgstat_recv_wal(&msg.msg_wal, len);
-					break;
-
-				case PGSTAT_MTYPE_SLRU:
-					pgstat_recv_slru(&msg.msg_slru, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat(&msg.msg_funcstat, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge(&msg.msg_funcpurge, len);
-					break;
-
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict(&msg.msg_recoveryconflict,
-												 len);
-					break;
-
-				case PGSTAT_MTYPE_DEADLOCK:
-					pgstat_recv_deadlock(&msg.msg_deadlock, len);
-					break;
-
-				case PGSTAT_MTYPE_TEMPFILE:
-					pgstat_recv_tempfile(&msg.msg_tempfile, len);
-					break;
-
-				case PGSTAT_MTYPE_CHECKSUMFAILURE:
-					pgstat_recv_checksum_failure(&msg.msg_checksumfailure,
-												 len);
-					break;
-
-				case PGSTAT_MTYPE_REPLSLOT:
-					pgstat_recv_replslot(&msg.msg_replslot, len);
-					break;
-
-				case PGSTAT_MTYPE_CONNECT:
-					pgstat_recv_connect(&msg.msg_connect, len);
-					break;
-
-				case PGSTAT_MTYPE_DISCONNECT:
-					pgstat_recv_disconnect(&msg.msg_disconnect, len);
-					break;
-
-				default:
-					break;
-			}
-		}						/* end of inner message-processing loop */
-
-		/* Sleep until there's something to do */
-#ifndef WIN32
-		wr = WaitEventSetWait(wes, -1L, &event, 1, WAIT_EVENT_PGSTAT_MAIN);
-#else
-
-		/*
-		 * Windows, at least in its Windows Server 2003 R2 incarnation,
-		 * sometimes loses FD_READ events.  Waking up and retrying the recv()
-		 * fixes that, so don't sleep indefinitely.  This is a crock of the
-		 * first water, but until somebody wants to debug exactly what's
-		 * happening there, this is the best we can do.  The two-second
-		 * timeout matches our pre-9.2 behavior, and needs to be short enough
-		 * to not provoke "using stale statistics" complaints from
-		 * backend_read_statsfile.
-		 */
-		wr = WaitEventSetWait(wes, 2 * 1000L /* msec */ , &event, 1,
-							  WAIT_EVENT_PGSTAT_MAIN);
-#endif
-
-		/*
-		 * Emergency bailout if postmaster has died.  This is to avoid the
-		 * necessity for manual cleanup of all postmaster children.
-		 */
-		if (wr == 1 && event.events == WL_POSTMASTER_DEATH)
-			break;
-	}							/* end of outer loop */
-
-	/*
-	 * Save the final stats to reuse at next startup.
-	 */
-	pgstat_write_statsfiles(true, true);
-
-	FreeWaitEventSet(wes);
+		memset(&shent->stats, 0, sizeof(PgStat_StatTabEntry));
+		shent->stats.tableid = relid;
+	}
 
-	exit(0);
+	return shent;
 }
 
 /*
  * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
  */
 static void
-reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
+pgstat_reset_dbentry(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
-	dbentry->n_xact_commit = 0;
-	dbentry->n_xact_rollback = 0;
-	dbentry->n_blocks_fetched = 0;
-	dbentry->n_blocks_hit = 0;
-	dbentry->n_tuples_returned = 0;
-	dbentry->n_tuples_fetched = 0;
-	dbentry->n_tuples_inserted = 0;
-	dbentry->n_tuples_updated = 0;
-	dbentry->n_tuples_deleted = 0;
-	dbentry->last_autovac_time = 0;
-	dbentry->n_conflict_tablespace = 0;
-	dbentry->n_conflict_lock = 0;
-	dbentry->n_conflict_snapshot = 0;
-	dbentry->n_conflict_bufferpin = 0;
-	dbentry->n_conflict_startup_deadlock = 0;
-	dbentry->n_temp_files = 0;
-	dbentry->n_temp_bytes = 0;
-	dbentry->n_deadlocks = 0;
-	dbentry->n_checksum_failures = 0;
-	dbentry->last_checksum_failure = 0;
-	dbentry->n_block_read_time = 0;
-	dbentry->n_block_write_time = 0;
-	dbentry->n_sessions = 0;
-	dbentry->total_session_time = 0;
-	dbentry->total_active_time = 0;
-	dbentry->total_idle_in_xact_time = 0;
-	dbentry->n_sessions_abandoned = 0;
-	dbentry->n_sessions_fatal = 0;
-	dbentry->n_sessions_killed = 0;
+	Oid			dboid = dbentry->databaseid;
 
+	memset(dbentry, 0, sizeof(PgStat_StatDBEntry));
+	dbentry->databaseid = dboid;
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-	dbentry->stats_timestamp = 0;
-
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
+}
 
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_BLOBS);
+/*
+ * Add the counters of a database entry to another one.  The timestamps are
+ * left alone.
+ */
+static void
+pgstat_add_dbentry_counts(PgStat_StatDBEntry *dst, const PgStat_StatDBEntry *src)
+{
+	dst->n_xact_commit += src->n_xact_commit;
+	dst->n_xact_rollback += src->n_xact_rollback;
+	dst->n_blocks_fetched += src->n_blocks_fetched;
+	dst->n_blocks_hit += src->n_blocks_hit;
+	dst->n_tuples_returned += src->n_tuples_returned;
+	dst->n_tuples_fetched += src->n_tuples_fetched;
+	dst->n_tuples_inserted += src->n_tuples_inserted;
+	dst->n_tuples_updated += src->n_tuples_updated;
+	dst->n_tuples_deleted += src->n_tuples_deleted;
+	dst->n_conflict_tablespace += src->n_conflict_tablespace;
+	dst->n_conflict_lock += src->n_conflict_lock;
+	dst->n_conflict_snapshot += src->n_conflict_snapshot;
+	dst->n_conflict_bufferpin += src->n_conflict_bufferpin;
+	dst->n_conflict_startup_deadlock += src->n_conflict_startup_deadlock;
+	dst->n_temp_files += src->n_temp_files;
+	dst->n_temp_bytes += src->n_temp_bytes;
+	dst->n_deadlocks += src->n_deadlocks;
+	dst->n_checksum_failures += src->n_checksum_failures;
+	dst->n_block_read_time += src->n_block_read_time;
+	dst->n_block_write_time += src->n_block_write_time;
+	dst->n_sessions += src->n_sessions;
+	dst->total_session_time += src->total_session_time;
+	dst->total_active_time += src->total_active_time;
+	dst->total_idle_in_xact_time += src->total_idle_in_xact_time;
+	dst->n_sessions_abandoned += src->n_sessions_abandoned;
+	dst->n_sessions_fatal += src->n_sessions_fatal;
+	dst->n_sessions_killed += src->n_sessions_killed;
 }
 
 /*
- * Lookup the hash table entry for the specified database. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Remove the shared entries of all tables and functions of a database.
  */
-static PgStat_StatDBEntry *
-pgstat_get_db_entry(Oid databaseid, bool create)
+static void
+pgstat_drop_db_objects(Oid dboid)
 {
-	PgStat_StatDBEntry *result;
-	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
-
-	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												&databaseid,
-												action, &found);
+	dshash_seq_status hstat;
+	PgStatShared_TabEntry *tabentry;
+	PgStatShared_FuncEntry *funcentry;
 
-	if (!create && !found)
-		return NULL;
-
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
-	if (!found)
-		reset_dbentry_counters(result);
+	dshash_seq_init(&hstat, pgStatSharedTabHash, true);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		if (tabentry->key.dboid == dboid)
+			dshash_delete_current(&hstat);
+	}
+	dshash_seq_term(&hstat);
 
-	return result;
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, true);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		if (funcentry->key.dboid == dboid)
+			dshash_delete_current(&hstat);
+	}
+	dshash_seq_term(&hstat);
 }
 
-
 /*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Forget all statistics, and set the reset timestamps of the cluster-wide
+ * ones to now.
  */
-static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+static void
+pgstat_reset_all_stats(void)
 {
-	PgStat_StatTabEntry *result;
-	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
-
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
-
-	if (!create && !found)
-		return NULL;
+	dshash_seq_status hstat;
+	TimestampTz ts = GetCurrentTimestamp();
+	int			i;
 
-	/* If not found, initialize the new one. */
-	if (!found)
-	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->inserts_since_vacuum = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
-	}
+	dshash_seq_init(&hstat, pgStatSharedDBHash, true);
+	while (dshash_seq_next(&hstat) != NULL)
+		dshash_delete_current(&hstat);
+	dshash_seq_term(&hstat);
+
+	dshash_seq_init(&hstat, pgStatSharedTabHash, true);
+	while (dshash_seq_next(&hstat) != NULL)
+		dshash_delete_current(&hstat);
+	dshash_seq_term(&hstat);
+
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, true);
+	while (dshash_seq_next(&hstat) != NULL)
+		dshash_delete_current(&hstat);
+	dshash_seq_term(&hstat);
+
+	LWLockAcquire(&pgStatShmem->archiver_lock, LW_EXCLUSIVE);
+	memset(&pgStatShmem->archiver, 0, sizeof(PgStat_ArchiverStats));
+	pgStatShmem->archiver.stat_reset_timestamp = ts;
+	LWLockRelease(&pgStatShmem->archiver_lock);
+
+	LWLockAcquire(&pgStatShmem->global_lock, LW_EXCLUSIVE);
+	memset(&pgStatShmem->bgwriter, 0, sizeof(PgStat_BgWriterStats));
+	memset(&pgStatShmem->checkpointer, 0, sizeof(PgStat_CheckpointerStats));
+	pgStatShmem->bgwriter.stat_reset_timestamp = ts;
+	LWLockRelease(&pgStatShmem->global_lock);
+
+	LWLockAcquire(&pgStatShmem->wal_lock, LW_EXCLUSIVE);
+	memset(&pgStatShmem->wal, 0, sizeof(PgStat_WalStats));
+	pgStatShmem->wal.stat_reset_timestamp = ts;
+	LWLockRelease(&pgStatShmem->wal_lock);
+
+	LWLockAcquire(&pgStatShmem->slru_lock, LW_EXCLUSIVE);
+	memset(pgStatShmem->slru, 0, sizeof(pgStatShmem->slru));
+	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
+		pgStatShmem->slru[i].stat_reset_timestamp = ts;
+	LWLockRelease(&pgStatShmem->slru_lock);
 
-	return result;
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_EXCLUSIVE);
+	memset(PgStatReplSlots, 0,
+		   sizeof(PgStat_StatReplSlotEntry) * max_replication_slots);
+	LWLockRelease(&pgStatShmem->replslot_lock);
 }
 
-
 /* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
+ * pgstat_write_statsfile() -
+ *		Write the statistics out to the permanent stats file.
  *
- *	'permanent' specifies writing to the permanent files not temporary ones.
- *	When true (happens only when the collector is shutting down), also remove
- *	the temporary files so that backends starting up under a new postmaster
- *	can't read old data before the new collector is ready.
- *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	pending_write_requests) will be written; otherwise, all databases
- *	will be written.
+ *	Only called at shutdown, when nobody else is changing the statistics
+ *	anymore; so we don't worry about doing I/O while holding the hash table
+ *	partition locks.
  * ----------
  */
 static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+pgstat_write_statsfile(void)
 {
-	HASH_SEQ_STATUS hstat;
-	PgStat_StatDBEntry *dbentry;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
+	dshash_seq_status hstat;
+	PgStat_StatDBEntry *dbentry;
+	PgStatShared_TabEntry *tabentry;
+	PgStatShared_FuncEntry *funcentry;
 	int			rc;
+	int			i;
 
 	elog(DEBUG2, "writing stats file \"%s\"", statfile);
 
@@ -3789,11 +3508,6 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		return;
 	}
 
-	/*
-	 * Set the timestamp of the stats file.
-	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
-
 	/*
 	 * Write the file header --- currently just a format ID.
 	 */
@@ -3802,71 +3516,79 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Write global stats struct
+	 * Write the cluster-wide statistics.
 	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	LWLockAcquire(&pgStatShmem->archiver_lock, LW_SHARED);
+	rc = fwrite(&pgStatShmem->archiver, sizeof(PgStat_ArchiverStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
+	LWLockRelease(&pgStatShmem->archiver_lock);
 
-	/*
-	 * Write archiver stats struct
-	 */
-	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
+	LWLockAcquire(&pgStatShmem->global_lock, LW_SHARED);
+	rc = fwrite(&pgStatShmem->bgwriter, sizeof(PgStat_BgWriterStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
+	rc = fwrite(&pgStatShmem->checkpointer, sizeof(PgStat_CheckpointerStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+	LWLockRelease(&pgStatShmem->global_lock);
 
-	/*
-	 * Write WAL stats struct
-	 */
-	rc = fwrite(&walStats, sizeof(walStats), 1, fpout);
+	LWLockAcquire(&pgStatShmem->wal_lock, LW_SHARED);
+	rc = fwrite(&pgStatShmem->wal, sizeof(PgStat_WalStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
+	LWLockRelease(&pgStatShmem->wal_lock);
 
-	/*
-	 * Write SLRU stats struct
-	 */
-	rc = fwrite(slruStats, sizeof(slruStats), 1, fpout);
+	LWLockAcquire(&pgStatShmem->slru_lock, LW_SHARED);
+	rc = fwrite(pgStatShmem->slru, sizeof(pgStatShmem->slru), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
+	LWLockRelease(&pgStatShmem->slru_lock);
 
 	/*
 	 * Walk through the database table.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
-		 */
-		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			/* Make DB's timestamp consistent with the global stats */
-			dbentry->stats_timestamp = globalStats.stats_timestamp;
+		fputc('D', fpout);
+		rc = fwrite(dbentry, sizeof(PgStat_StatDBEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+	dshash_seq_term(&hstat);
 
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
+	/*
+	 * Walk through the table and function tables.
+	 */
+	dshash_seq_init(&hstat, pgStatSharedTabHash, false);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(tabentry, sizeof(PgStatShared_TabEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+	dshash_seq_term(&hstat);
 
-		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
-		 */
-		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, false);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		fputc('F', fpout);
+		rc = fwrite(funcentry, sizeof(PgStatShared_FuncEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
+	dshash_seq_term(&hstat);
 
 	/*
 	 * Write replication slot stats struct
 	 */
-	if (replSlotStatHash)
+	LWLockAcquire(&pgStatShmem->replslot_lock, LW_SHARED);
+	for (i = 0; i < max_replication_slots; i++)
 	{
-		PgStat_StatReplSlotEntry *slotent;
+		PgStat_StatReplSlotEntry *slotent = &PgStatReplSlots[i];
 
-		hash_seq_init(&hstat, replSlotStatHash);
-		while ((slotent = (PgStat_StatReplSlotEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			fputc('R', fpout);
-			rc = fwrite(slotent, sizeof(PgStat_StatReplSlotEntry), 1, fpout);
-			(void) rc;			/* we'll check for error with ferror */
-		}
+		if (NameStr(slotent->slotname)[0] == '\0')
+			continue;
+
+		fputc('R', fpout);
+		rc = fwrite(slotent, sizeof(PgStat_StatReplSlotEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
 	}
+	LWLockRelease(&pgStatShmem->replslot_lock);
 
 	/*
 	 * No more output to be done. Close the temp file and replace the old
@@ -3900,2017 +3622,220 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 						tmpfile, statfile)));
 		unlink(tmpfile);
 	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
-
-	/*
-	 * Now throw away the list of requests.  Note that requests sent after we
-	 * started the write are still waiting on the network socket.
-	 */
-	list_free(pending_write_requests);
-	pending_write_requests = NIL;
 }
 
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
+/* ----------
+ * pgstat_setup_memcxt() -
+ *
+ *	Create pgStatLocalContext, if not already done.
+ * ----------
  */
 static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
+pgstat_setup_memcxt(void)
 {
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed >= len)
-		elog(ERROR, "overlength pgstat path");
+	if (!pgStatLocalContext)
+		pgStatLocalContext = AllocSetContextCreate(TopMemoryContext,
+												   "Statistics snapshot",
+												   ALLOCSET_SMALL_SIZES);
 }
 
-/* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
- *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
- * ----------
+/*
+ * Stats should only be reported after pgstat_initialize() and before
+ * pgstat_shutdown(). This check is put in a few central places to catch
+ * violations of this rule more easily.
  */
 static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
+pgstat_assert_is_up(void)
 {
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
-	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
+	Assert(pgstat_is_initialized && !pgstat_is_shutdown);
+}
 
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
+/*
+ * Return this transaction's copy of the statistics of a database, table or
+ * function, copying them out of shared memory on first access.  Returns NULL
+ * if the object has no statistics.
+ */
+static void *
+pgstat_snapshot_entry(PgStat_SnapshotKind kind, Oid dboid, Oid objoid)
+{
+	PgStat_SnapshotKey key;
+	PgStat_SnapshotEntry *entry;
+	bool		found;
 
-	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+	pgstat_assert_is_up();
 
-	/*
-	 * Open the statistics temp file to write out the current values.
-	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
+	if (pgStatSnapshotHash == NULL)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
-	}
+		HASHCTL		hash_ctl;
 
-	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
+		pgstat_setup_memcxt();
 
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
+		hash_ctl.keysize = sizeof(PgStat_SnapshotKey);
+		hash_ctl.entrysize = sizeof(PgStat_SnapshotEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatSnapshotHash = hash_create("Statistics snapshot",
+										 PGSTAT_SNAPSHOT_HASH_SIZE,
+										 &hash_ctl,
+										 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 	}
 
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
+	memset(&key, 0, sizeof(key));
+	key.kind = kind;
+	key.dboid = dboid;
+	key.objoid = objoid;
+
+	entry = (PgStat_SnapshotEntry *) hash_search(pgStatSnapshotHash, &key,
+												 HASH_ENTER, &found);
+	if (!found)
 	{
-		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
-	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write temporary statistics file \"%s\": %m",
-						tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close temporary statistics file \"%s\": %m",
-						tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
-/* ----------
- * pgstat_read_statsfiles() -
- *
- *	Reads in some existing statistics collector files and returns the
- *	databases hash table that is the top level of the data.
- *
- *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
- *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
- *	hash tables for other databases.
- *
- *	'permanent' specifies reading from the permanent files not temporary ones.
- *	When true (happens only when the collector is starting up), remove the
- *	files after reading; the in-memory status is now authoritative, and the
- *	files would be out of date in case somebody else reads them.
- *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
- * ----------
- */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-	int			i;
-	TimestampTz	ts;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-	/*
-	 * Clear out global, archiver, WAL and SLRU statistics so they start from
-	 * zero in case we can't load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-	memset(&archiverStats, 0, sizeof(archiverStats));
-	memset(&walStats, 0, sizeof(walStats));
-	memset(&slruStats, 0, sizeof(slruStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	ts = GetCurrentTimestamp();
-	globalStats.bgwriter.stat_reset_timestamp = ts;
-	archiverStats.stat_reset_timestamp = ts;
-	walStats.stat_reset_timestamp = ts;
-
-	/*
-	 * Set the same reset timestamp for all SLRU items too.
-	 */
-	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
-		slruStats[i].stat_reset_timestamp = ts;
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return dbhash;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&globalStats, 0, sizeof(globalStats));
-		goto done;
-	}
-
-	/*
-	 * In the collector, disregard the timestamp we read from the permanent
-	 * stats file; we should be willing to write a temp stats file immediately
-	 * upon the first request from any backend.  This only matters if the old
-	 * file's timestamp is less than PGSTAT_STAT_INTERVAL ago, but that's not
-	 * an unusual scenario.
-	 */
-	if (pgStatRunningInCollector)
-		globalStats.stats_timestamp = 0;
-
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&archiverStats, 1, sizeof(archiverStats), fpin) != sizeof(archiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		goto done;
-	}
-
-	/*
-	 * Read WAL stats struct
-	 */
-	if (fread(&walStats, 1, sizeof(walStats), fpin) != sizeof(walStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&walStats, 0, sizeof(walStats));
-		goto done;
-	}
-
-	/*
-	 * Read SLRU stats struct
-	 */
-	if (fread(slruStats, 1, sizeof(slruStats), fpin) != sizeof(slruStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&slruStats, 0, sizeof(slruStats));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-															 (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * In the collector, disregard the timestamp we read from the
-				 * permanent stats file; we should be willing to write a temp
-				 * stats file immediately upon the first request from any
-				 * backend.
-				 */
-				if (pgStatRunningInCollector)
-					dbentry->stats_timestamp = 0;
-
-				/*
-				 * Don't create tables/functions hashtables for uninteresting
-				 * databases.
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
-				break;
-
-				/*
-				 * 'R'	A PgStat_StatReplSlotEntry struct describing a
-				 * replication slot follows.
-				 */
-			case 'R':
-				{
-					PgStat_StatReplSlotEntry slotbuf;
-					PgStat_StatReplSlotEntry *slotent;
-
-					if (fread(&slotbuf, 1, sizeof(PgStat_StatReplSlotEntry), fpin)
-						!= sizeof(PgStat_StatReplSlotEntry))
-					{
-						ereport(pgStatRunningInCollector ? LOG : WARNING,
-								(errmsg("corrupted statistics file \"%s\"",
-										statfile)));
-						goto done;
-					}
-
-					/* Create hash table if we don't have it already. */
-					if (replSlotStatHash == NULL)
-					{
-						HASHCTL		hash_ctl;
-
-						hash_ctl.keysize = sizeof(NameData);
-						hash_ctl.entrysize = sizeof(PgStat_StatReplSlotEntry);
-						hash_ctl.hcxt = pgStatLocalContext;
-						replSlotStatHash = hash_create("Replication slots hash",
-													   PGSTAT_REPLSLOT_HASH_SIZE,
-													   &hash_ctl,
-													   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-					}
-
-					slotent = (PgStat_StatReplSlotEntry *) hash_search(replSlotStatHash,
-																	   (void *) &slotbuf.slotname,
-																	   HASH_ENTER, NULL);
-					memcpy(slotent, &slotbuf, sizeof(PgStat_StatReplSlotEntry));
-					break;
-				}
-
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
-}
-
-
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
- *
- *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table data not wanted.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
-				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
-				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if function data not wanted.
-				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-																 (void *) &funcbuf.functionid,
-																 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
-				break;
-
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
-/* ----------
- * pgstat_read_db_statsfile_timestamp() -
- *
- *	Attempt to determine the timestamp of the last db statfile write.
- *	Returns true if successful; the timestamp is stored in *ts. The caller must
- *	rely on timestamp stored in *ts iff the function returns true.
- *
- *	This needs to be careful about handling databases for which no stats file
- *	exists, such as databases without a stat entry or those not yet written:
- *
- *	- if there's a database entry in the global file, return the corresponding
- *	stats_timestamp value.
- *
- *	- if there's no db stat entry (e.g. for a new or inactive database),
- *	there's no stats_timestamp value, but also nothing to write so we return
- *	the timestamp of the global statfile.
- * ----------
- */
-static bool
-pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
-								   TimestampTz *ts)
-{
-	PgStat_StatDBEntry dbentry;
-	PgStat_GlobalStats myGlobalStats;
-	PgStat_ArchiverStats myArchiverStats;
-	PgStat_WalStats myWalStats;
-	PgStat_SLRUStats mySLRUStats[SLRU_NUM_ELEMENTS];
-	PgStat_StatReplSlotEntry myReplSlotStats;
-	FILE	   *fpin;
-	int32		format_id;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * Try to open the stats file.  As above, anything but ENOENT is worthy of
-	 * complaining about.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return false;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats),
-			  fpin) != sizeof(myGlobalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&myArchiverStats, 1, sizeof(myArchiverStats),
-			  fpin) != sizeof(myArchiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read WAL stats struct
-	 */
-	if (fread(&myWalStats, 1, sizeof(myWalStats), fpin) != sizeof(myWalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read SLRU stats struct
-	 */
-	if (fread(mySLRUStats, 1, sizeof(mySLRUStats), fpin) != sizeof(mySLRUStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/* By default, we're going to return the timestamp of the global file. */
-	*ts = myGlobalStats.stats_timestamp;
-
-	/*
-	 * We found an existing collector stats file.  Read it and look for a
-	 * record for the requested database.  If found, use its timestamp.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-
-				/*
-				 * If this is the DB we're looking for, save its timestamp and
-				 * we're done.
-				 */
-				if (dbentry.databaseid == databaseid)
-				{
-					*ts = dbentry.stats_timestamp;
-					goto done;
-				}
-
-				break;
-
-				/*
-				 * 'R'	A PgStat_StatReplSlotEntry struct describing a
-				 * replication slot follows.
-				 */
-			case 'R':
-				if (fread(&myReplSlotStats, 1, sizeof(PgStat_StatReplSlotEntry), fpin)
-					!= sizeof(PgStat_StatReplSlotEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-				break;
-
-			case 'E':
-				goto done;
-
-			default:
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-		}
-	}
-
-done:
-	FreeFile(fpin);
-	return true;
-}
-
-/*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
- */
-static void
-backend_read_statsfile(void)
-{
-	TimestampTz min_ts = 0;
-	TimestampTz ref_ts = 0;
-	Oid			inquiry_db;
-	int			count;
-
-	pgstat_assert_is_up();
-
-	/* already read it? */
-	if (pgStatDBHash)
-		return;
-	Assert(!pgStatRunningInCollector);
-
-	/*
-	 * In a normal backend, we check staleness of the data for our own DB, and
-	 * so we send MyDatabaseId in inquiry messages.  In the autovac launcher,
-	 * check staleness of the shared-catalog data, and send InvalidOid in
-	 * inquiry messages so as not to force writing unnecessary data.
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		inquiry_db = InvalidOid;
-	else
-		inquiry_db = MyDatabaseId;
-
-	/*
-	 * Loop until fresh enough stats file is available or we ran out of time.
-	 * The stats inquiry message is sent repeatedly in case collector drops
-	 * it; but not every single time, as that just swamps the collector.
-	 */
-	for (count = 0; count < PGSTAT_POLL_LOOP_COUNT; count++)
-	{
-		bool		ok;
-		TimestampTz file_ts = 0;
-		TimestampTz cur_ts;
-
-		CHECK_FOR_INTERRUPTS();
-
-		ok = pgstat_read_db_statsfile_timestamp(inquiry_db, false, &file_ts);
-
-		cur_ts = GetCurrentTimestamp();
-		/* Calculate min acceptable timestamp, if we didn't already */
-		if (count == 0 || cur_ts < ref_ts)
-		{
-			/*
-			 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL
-			 * msec before now.  This indirectly ensures that the collector
-			 * needn't write the file more often than PGSTAT_STAT_INTERVAL. In
-			 * an autovacuum worker, however, we want a lower delay to avoid
-			 * using stale data, so we use PGSTAT_RETRY_DELAY (since the
-			 * number of workers is low, this shouldn't be a problem).
-			 *
-			 * We don't recompute min_ts after sleeping, except in the
-			 * unlikely case that cur_ts went backwards.  So we might end up
-			 * accepting a file a bit older than PGSTAT_STAT_INTERVAL.  In
-			 * practice that shouldn't happen, though, as long as the sleep
-			 * time is less than PGSTAT_STAT_INTERVAL; and we don't want to
-			 * tell the collector that our cutoff time is less than what we'd
-			 * actually accept.
-			 */
-			ref_ts = cur_ts;
-			if (IsAutoVacuumWorkerProcess())
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_RETRY_DELAY);
-			else
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_STAT_INTERVAL);
-		}
-
-		/*
-		 * If the file timestamp is actually newer than cur_ts, we must have
-		 * had a clock glitch (system time went backwards) or there is clock
-		 * skew between our processor and the stats collector's processor.
-		 * Accept the file, but send an inquiry message anyway to make
-		 * pgstat_recv_inquiry do a sanity check on the collector's time.
-		 */
-		if (ok && file_ts > cur_ts)
-		{
-			/*
-			 * A small amount of clock skew between processors isn't terribly
-			 * surprising, but a large difference is worth logging.  We
-			 * arbitrarily define "large" as 1000 msec.
-			 */
-			if (file_ts >= TimestampTzPlusMilliseconds(cur_ts, 1000))
-			{
-				char	   *filetime;
-				char	   *mytime;
-
-				/* Copy because timestamptz_to_str returns a static buffer */
-				filetime = pstrdup(timestamptz_to_str(file_ts));
-				mytime = pstrdup(timestamptz_to_str(cur_ts));
-				ereport(LOG,
-						(errmsg("statistics collector's time %s is later than backend local time %s",
-								filetime, mytime)));
-				pfree(filetime);
-				pfree(mytime);
-			}
-
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
-			break;
-		}
-
-		/* Normal acceptance case: file is not older than cutoff time */
-		if (ok && file_ts >= min_ts)
-			break;
-
-		/* Not there or too old, so kick the collector and wait a bit */
-		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
-
-		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
-	}
-
-	if (count >= PGSTAT_POLL_LOOP_COUNT)
-		ereport(LOG,
-				(errmsg("using stale statistics instead of current ones "
-						"because stats collector is not responding")));
-
-	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.  Regular backends want a deep read for just the tables
-	 * they can see (MyDatabaseId + shared catalogs).
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
-}
-
-
-/* ----------
- * pgstat_setup_memcxt() -
- *
- *	Create pgStatLocalContext, if not already done.
- * ----------
- */
-static void
-pgstat_setup_memcxt(void)
-{
-	if (!pgStatLocalContext)
-		pgStatLocalContext = AllocSetContextCreate(TopMemoryContext,
-												   "Statistics snapshot",
-												   ALLOCSET_SMALL_SIZES);
-}
-
-/*
- * Stats should only be reported after pgstat_initialize() and before
- * pgstat_shutdown(). This check is put in a few central places to catch
- * violations of this rule more easily.
- */
-static void
-pgstat_assert_is_up(void)
-{
-	Assert(pgstat_is_initialized && !pgstat_is_shutdown);
-}
-
-
-/* ----------
- * pgstat_clear_snapshot() -
- *
- *	Discard any data collected in the current transaction.  Any subsequent
- *	request will cause new snapshots to be read.
- *
- *	This is also invoked during transaction commit or abort to discard
- *	the no-longer-wanted snapshot.
- * ----------
- */
-void
-pgstat_clear_snapshot(void)
-{
-	pgstat_assert_is_up();
-
-	/* Release memory, if any was allocated */
-	if (pgStatLocalContext)
-		MemoryContextDelete(pgStatLocalContext);
-
-	/* Reset variables */
-	pgStatLocalContext = NULL;
-	pgStatDBHash = NULL;
-	replSlotStatHash = NULL;
-
-	/*
-	 * Historically the backend_status.c facilities lived in this file, and
-	 * were reset with the same function. For now keep it that way, and
-	 * forward the reset request.
-	 */
-	pgstat_clear_backend_activity_snapshot();
-}
-
-
-/* ----------
- * pgstat_recv_inquiry() -
- *
- *	Process stat inquiry requests.
- * ----------
- */
-static void
-pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	elog(DEBUG2, "received inquiry for database %u", msg->databaseid);
-
-	/*
-	 * If there's already a write request for this DB, there's nothing to do.
-	 *
-	 * Note that if a request is found, we return early and skip the below
-	 * check for clock skew.  This is okay, since the only way for a DB
-	 * request to be present in the list is that we have been here since the
-	 * last write round.  It seems sufficient to check for clock skew once per
-	 * write round.
-	 */
-	if (list_member_oid(pending_write_requests, msg->databaseid))
-		return;
-
-	/*
-	 * Check to see if we last wrote this database at a time >= the requested
-	 * cutoff time.  If so, this is a stale request that was generated before
-	 * we updated the DB file, and we don't need to do so again.
-	 *
-	 * If the requestor's local clock time is older than stats_timestamp, we
-	 * should suspect a clock glitch, ie system time going backwards; though
-	 * the more likely explanation is just delayed message receipt.  It is
-	 * worth expending a GetCurrentTimestamp call to be sure, since a large
-	 * retreat in the system clock reading could otherwise cause us to neglect
-	 * to update the stats file for a long time.
-	 */
-	dbentry = pgstat_get_db_entry(msg->databaseid, false);
-	if (dbentry == NULL)
-	{
-		/*
-		 * We have no data for this DB.  Enter a write request anyway so that
-		 * the global stats will get updated.  This is needed to prevent
-		 * backend_read_statsfile from waiting for data that we cannot supply,
-		 * in the case of a new DB that nobody has yet reported any stats for.
-		 * See the behavior of pgstat_read_db_statsfile_timestamp.
-		 */
-	}
-	else if (msg->clock_time < dbentry->stats_timestamp)
-	{
-		TimestampTz cur_ts = GetCurrentTimestamp();
-
-		if (cur_ts < dbentry->stats_timestamp)
-		{
-			/*
-			 * Sure enough, time went backwards.  Force a new stats file write
-			 * to get back in sync; but first, log a complaint.
-			 */
-			char	   *writetime;
-			char	   *mytime;
-
-			/* Copy because timestamptz_to_str returns a static buffer */
-			writetime = pstrdup(timestamptz_to_str(dbentry->stats_timestamp));
-			mytime = pstrdup(timestamptz_to_str(cur_ts));
-			ereport(LOG,
-					(errmsg("stats_timestamp %s is later than collector's time %s for database %u",
-							writetime, mytime, dbentry->databaseid)));
-			pfree(writetime);
-			pfree(mytime);
-		}
-		else
-		{
-			/*
-			 * Nope, it's just an old request.  Assuming msg's clock_time is
-			 * >= its cutoff_time, it must be stale, so we can ignore it.
-			 */
-			return;
-		}
-	}
-	else if (msg->cutoff_time <= dbentry->stats_timestamp)
-	{
-		/* Stale request, ignore it */
-		return;
-	}
-
-	/*
-	 * We need to write this DB, so create a request.
-	 */
-	pending_write_requests = lappend_oid(pending_write_requests,
-										 msg->databaseid);
-}
-
-
-/* ----------
- * pgstat_recv_tabstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Update database-wide stats.
-	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
-	dbentry->n_block_read_time += msg->m_block_read_time;
-	dbentry->n_block_write_time += msg->m_block_write_time;
-
-	dbentry->total_session_time += msg->m_session_time;
-	dbentry->total_active_time += msg->m_active_time;
-	dbentry->total_idle_in_xact_time += msg->m_idle_in_xact_time;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/*
-			 * If table was truncated/dropped, first reset the live/dead
-			 * counters.
-			 */
-			if (tabmsg->t_counts.t_truncdropped)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-				tabentry->inserts_since_vacuum = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
-
-/* ----------
- * pgstat_recv_dropdb() -
- *
- *	Arrange for dead database removal
- * ----------
- */
-static void
-pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
-{
-	Oid			dbid = msg->m_databaseid;
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.
-	 */
-	dbentry = pgstat_get_db_entry(dbid, false);
-
-	/*
-	 * If found, remove it (along with the db statfile).
-	 */
-	if (dbentry)
-	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing stats file \"%s\"", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
-		if (hash_search(pgStatDBHash,
-						(void *) &dbid,
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted during cleanup --- abort")));
-	}
-}
-
-
-/* ----------
- * pgstat_recv_resetcounter() -
- *
- *	Reset the statistics for the specified database.
- * ----------
- */
-static void
-pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.  Nothing to do if not there.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	if (!dbentry)
-		return;
-
-	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
-
-	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
-	 */
-	reset_dbentry_counters(dbentry);
-}
-
-/* ----------
- * pgstat_recv_resetsharedcounter() -
- *
- *	Reset some shared statistics of the cluster.
- * ----------
- */
-static void
-pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
-{
-	if (msg->m_resettarget == RESET_BGWRITER)
-	{
-		/* Reset the global, bgwriter and checkpointer statistics for the cluster. */
-		memset(&globalStats, 0, sizeof(globalStats));
-		globalStats.bgwriter.stat_reset_timestamp = GetCurrentTimestamp();
-	}
-	else if (msg->m_resettarget == RESET_ARCHIVER)
-	{
-		/* Reset the archiver statistics for the cluster. */
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		archiverStats.stat_reset_timestamp = GetCurrentTimestamp();
-	}
-	else if (msg->m_resettarget == RESET_WAL)
-	{
-		/* Reset the WAL statistics for the cluster. */
-		memset(&walStats, 0, sizeof(walStats));
-		walStats.stat_reset_timestamp = GetCurrentTimestamp();
-	}
-
-	/*
-	 * Presumably the sender of this message validated the target, don't
-	 * complain here if it's not valid
-	 */
-}
-
-/* ----------
- * pgstat_recv_resetsinglecounter() -
- *
- *	Reset a statistics for a single object, which may be of current
- *	database or shared across all databases in the cluster.
- * ----------
- */
-static void
-pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	if (IsSharedRelation(msg->m_objectid))
-		dbentry = pgstat_get_db_entry(InvalidOid, false);
-	else
-		dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	if (!dbentry)
-		return;
-
-	/* Set the reset timestamp for the whole database */
-	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-}
-
-/* ----------
- * pgstat_recv_resetslrucounter() -
- *
- *	Reset some SLRU statistics of the cluster.
- * ----------
- */
-static void
-pgstat_recv_resetslrucounter(PgStat_MsgResetslrucounter *msg, int len)
-{
-	int			i;
-	TimestampTz ts = GetCurrentTimestamp();
-
-	for (i = 0; i < SLRU_NUM_ELEMENTS; i++)
-	{
-		/* reset entry with the given index, or all entries (index is -1) */
-		if ((msg->m_index == -1) || (msg->m_index == i))
-		{
-			memset(&slruStats[i], 0, sizeof(slruStats[i]));
-			slruStats[i].stat_reset_timestamp = ts;
-		}
-	}
-}
-
-/* ----------
- * pgstat_recv_resetreplslotcounter() -
- *
- *	Reset some replication slot statistics of the cluster.
- * ----------
- */
-static void
-pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg,
-								 int len)
-{
-	PgStat_StatReplSlotEntry *slotent;
-	TimestampTz ts;
-
-	/* Return if we don't have replication slot statistics */
-	if (replSlotStatHash == NULL)
-		return;
-
-	ts = GetCurrentTimestamp();
-	if (msg->clearall)
-	{
-		HASH_SEQ_STATUS sstat;
-
-		hash_seq_init(&sstat, replSlotStatHash);
-		while ((slotent = (PgStat_StatReplSlotEntry *) hash_seq_search(&sstat)) != NULL)
-			pgstat_reset_replslot(slotent, ts);
-	}
-	else
-	{
-		/* Get the slot statistics to reset */
-		slotent = pgstat_get_replslot_entry(msg->m_slotname, false);
-
-		/*
-		 * Nothing to do if the given slot entry is not found.  This could
-		 * happen when the slot with the given name is removed and the
-		 * corresponding statistics entry is also removed before receiving the
-		 * reset message.
-		 */
-		if (!slotent)
-			return;
-
-		/* Reset the stats for the requested replication slot */
-		pgstat_reset_replslot(slotent, ts);
-	}
-}
-
-
-/* ----------
- * pgstat_recv_autovac() -
- *
- *	Process an autovacuum signaling message.
- * ----------
- */
-static void
-pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Store the last autovacuum time in the database's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->last_autovac_time = msg->m_start_time;
-}
-
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * It is quite possible that a non-aggressive VACUUM ended up skipping
-	 * various pages, however, we'll zero the insert counter here regardless.
-	 * It's currently used only to track when we need to perform an "insert"
-	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
-	 * Zeroing this may just mean we'll not try to vacuum the table again
-	 * until enough tuples have been inserted to trigger another insert
-	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
-	 * stragglers.
-	 */
-	tabentry->inserts_since_vacuum = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * If commanded, reset changes_since_analyze to zero.  This forgets any
-	 * changes that were committed while the ANALYZE was in progress, but we
-	 * have no good way to estimate how many of those there were.
-	 */
-	if (msg->m_resetcounter)
-		tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_archiver() -
- *
- *	Process a ARCHIVER message.
- * ----------
- */
-static void
-pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len)
-{
-	if (msg->m_failed)
-	{
-		/* Failed archival attempt */
-		++archiverStats.failed_count;
-		memcpy(archiverStats.last_failed_wal, msg->m_xlog,
-			   sizeof(archiverStats.last_failed_wal));
-		archiverStats.last_failed_timestamp = msg->m_timestamp;
-	}
-	else
-	{
-		/* Successful archival operation */
-		++archiverStats.archived_count;
-		memcpy(archiverStats.last_archived_wal, msg->m_xlog,
-			   sizeof(archiverStats.last_archived_wal));
-		archiverStats.last_archived_timestamp = msg->m_timestamp;
-	}
-}
-
-/* ----------
- * pgstat_recv_bgwriter() -
- *
- *	Process a BGWRITER message.
- * ----------
- */
-static void
-pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
-{
-	globalStats.bgwriter.buf_written_clean += msg->m_buf_written_clean;
-	globalStats.bgwriter.maxwritten_clean += msg->m_maxwritten_clean;
-	globalStats.bgwriter.buf_alloc += msg->m_buf_alloc;
-}
-
-/* ----------
- * pgstat_recv_checkpointer() -
- *
- *	Process a CHECKPOINTER message.
- * ----------
- */
-static void
-pgstat_recv_checkpointer(PgStat_MsgCheckpointer *msg, int len)
-{
-	globalStats.checkpointer.timed_checkpoints += msg->m_timed_checkpoints;
-	globalStats.checkpointer.requested_checkpoints += msg->m_requested_checkpoints;
-	globalStats.checkpointer.checkpoint_write_time += msg->m_checkpoint_write_time;
-	globalStats.checkpointer.checkpoint_sync_time += msg->m_checkpoint_sync_time;
-	globalStats.checkpointer.buf_written_checkpoints += msg->m_buf_written_checkpoints;
-	globalStats.checkpointer.buf_written_backend += msg->m_buf_written_backend;
-	globalStats.checkpointer.buf_fsync_backend += msg->m_buf_fsync_backend;
-}
-
-/* ----------
- * pgstat_recv_wal() -
- *
- *	Process a WAL message.
- * ----------
- */
-static void
-pgstat_recv_wal(PgStat_MsgWal *msg, int len)
-{
-	walStats.wal_records += msg->m_wal_records;
-	walStats.wal_fpi += msg->m_wal_fpi;
-	walStats.wal_bytes += msg->m_wal_bytes;
-	walStats.wal_buffers_full += msg->m_wal_buffers_full;
-	walStats.wal_write += msg->m_wal_write;
-	walStats.wal_sync += msg->m_wal_sync;
-	walStats.wal_write_time += msg->m_wal_write_time;
-	walStats.wal_sync_time += msg->m_wal_sync_time;
-}
-
-/* ----------
- * pgstat_recv_slru() -
- *
- *	Process a SLRU message.
- * ----------
- */
-static void
-pgstat_recv_slru(PgStat_MsgSLRU *msg, int len)
-{
-	slruStats[msg->m_index].blocks_zeroed += msg->m_blocks_zeroed;
-	slruStats[msg->m_index].blocks_hit += msg->m_blocks_hit;
-	slruStats[msg->m_index].blocks_read += msg->m_blocks_read;
-	slruStats[msg->m_index].blocks_written += msg->m_blocks_written;
-	slruStats[msg->m_index].blocks_exists += msg->m_blocks_exists;
-	slruStats[msg->m_index].flush += msg->m_flush;
-	slruStats[msg->m_index].truncate += msg->m_truncate;
-}
-
-/* ----------
- * pgstat_recv_recoveryconflict() -
- *
- *	Process a RECOVERYCONFLICT message.
- * ----------
- */
-static void
-pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	switch (msg->m_reason)
-	{
-		case PROCSIG_RECOVERY_CONFLICT_DATABASE:
+		entry->found = false;
 
-			/*
-			 * Since we drop the information about the database as soon as it
-			 * replicates, there is no point in counting these conflicts.
-			 */
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
-			dbentry->n_conflict_tablespace++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_LOCK:
-			dbentry->n_conflict_lock++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
-			dbentry->n_conflict_snapshot++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
-			dbentry->n_conflict_bufferpin++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
-			dbentry->n_conflict_startup_deadlock++;
-			break;
-	}
-}
-
-/* ----------
- * pgstat_recv_deadlock() -
- *
- *	Process a DEADLOCK message.
- * ----------
- */
-static void
-pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->n_deadlocks++;
-}
-
-/* ----------
- * pgstat_recv_checksum_failure() -
- *
- *	Process a CHECKSUMFAILURE message.
- * ----------
- */
-static void
-pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->n_checksum_failures += msg->m_failurecount;
-	dbentry->last_checksum_failure = msg->m_failure_time;
-}
+		switch (kind)
+		{
+			case PGSTAT_SNAPSHOT_DB:
+				{
+					PgStat_StatDBEntry *dbentry;
 
-/* ----------
- * pgstat_recv_replslot() -
- *
- *	Process a REPLSLOT message.
- * ----------
- */
-static void
-pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len)
-{
-	if (msg->m_drop)
-	{
-		Assert(!msg->m_create);
-
-		/* Remove the replication slot statistics with the given name */
-		if (replSlotStatHash != NULL)
-			(void) hash_search(replSlotStatHash,
-							   (void *) &(msg->m_slotname),
-							   HASH_REMOVE,
-							   NULL);
-	}
-	else
-	{
-		PgStat_StatReplSlotEntry *slotent;
+					dbentry = dshash_find(pgStatSharedDBHash, &dboid, false);
+					if (dbentry)
+					{
+						memcpy(&entry->data.db, dbentry, sizeof(PgStat_StatDBEntry));
+						dshash_release_lock(pgStatSharedDBHash, dbentry);
+						entry->found = true;
+					}
+					break;
+				}
+			case PGSTAT_SNAPSHOT_TABLE:
+				{
+					PgStat_ObjectKey objkey = {dboid, objoid};
+					PgStatShared_TabEntry *shent;
 
-		slotent = pgstat_get_replslot_entry(msg->m_slotname, true);
-		Assert(slotent);
+					shent = dshash_find(pgStatSharedTabHash, &objkey, false);
+					if (shent)
+					{
+						memcpy(&entry->data.tab, &shent->stats, sizeof(PgStat_StatTabEntry));
+						dshash_release_lock(pgStatSharedTabHash, shent);
+						entry->found = true;
+					}
+					break;
+				}
+			case PGSTAT_SNAPSHOT_FUNCTION:
+				{
+					PgStat_ObjectKey objkey = {dboid, objoid};
+					PgStatShared_FuncEntry *shent;
 
-		if (msg->m_create)
-		{
-			/*
-			 * If the message for dropping the slot with the same name gets
-			 * lost, slotent has stats for the old slot. So we initialize all
-			 * counters at slot creation.
-			 */
-			pgstat_reset_replslot(slotent, 0);
-		}
-		else
-		{
-			/* Update the replication slot statistics */
-			slotent->spill_txns += msg->m_spill_txns;
-			slotent->spill_count += msg->m_spill_count;
-			slotent->spill_bytes += msg->m_spill_bytes;
-			slotent->stream_txns += msg->m_stream_txns;
-			slotent->stream_count += msg->m_stream_count;
-			slotent->stream_bytes += msg->m_stream_bytes;
-			slotent->total_txns += msg->m_total_txns;
-			slotent->total_bytes += msg->m_total_bytes;
+					shent = dshash_find(pgStatSharedFuncHash, &objkey, false);
+					if (shent)
+					{
+						memcpy(&entry->data.func, &shent->stats, sizeof(PgStat_StatFuncEntry));
+						dshash_release_lock(pgStatSharedFuncHash, shent);
+						entry->found = true;
+					}
+					break;
+				}
 		}
 	}
-}
-
-/* ----------
- * pgstat_recv_connect() -
- *
- *	Process a CONNECT message.
- * ----------
- */
-static void
-pgstat_recv_connect(PgStat_MsgConnect *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-	dbentry->n_sessions++;
-}
-
-/* ----------
- * pgstat_recv_disconnect() -
- *
- *	Process a DISCONNECT message.
- * ----------
- */
-static void
-pgstat_recv_disconnect(PgStat_MsgDisconnect *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	switch (msg->m_cause)
-	{
-		case DISCONNECT_NOT_YET:
-		case DISCONNECT_NORMAL:
-			/* we don't collect these */
-			break;
-		case DISCONNECT_CLIENT_EOF:
-			dbentry->n_sessions_abandoned++;
-			break;
-		case DISCONNECT_FATAL:
-			dbentry->n_sessions_fatal++;
-			break;
-		case DISCONNECT_KILLED:
-			dbentry->n_sessions_killed++;
-			break;
-	}
+	return entry->found ? (void *) &entry->data : NULL;
 }
 
-/* ----------
- * pgstat_recv_tempfile() -
- *
- *	Process a TEMPFILE message.
- * ----------
+/*
+ * Take this transaction's snapshot of the bgwriter and checkpointer
+ * statistics, if not done already.
  */
 static void
-pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
+pgstat_snapshot_global(void)
 {
-	PgStat_StatDBEntry *dbentry;
+	if (globalSnapshotValid)
+		return;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	LWLockAcquire(&pgStatShmem->global_lock, LW_SHARED);
+	memcpy(&globalStats.bgwriter, &pgStatShmem->bgwriter,
+		   sizeof(PgStat_BgWriterStats));
+	memcpy(&globalStats.checkpointer, &pgStatShmem->checkpointer,
+		   sizeof(PgStat_CheckpointerStats));
+	LWLockRelease(&pgStatShmem->global_lock);
 
-	dbentry->n_temp_bytes += msg->m_filesize;
-	dbentry->n_temp_files += 1;
+	globalStats.stats_timestamp = GetCurrentTimestamp();
+	globalSnapshotValid = true;
 }
 
 /* ----------
- * pgstat_recv_funcstat() -
+ * pgstat_clear_snapshot() -
  *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
-{
-	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			funcentry->f_numcalls += funcmsg->f_numcalls;
-			funcentry->f_total_time += funcmsg->f_total_time;
-			funcentry->f_self_time += funcmsg->f_self_time;
-		}
-	}
-}
-
-/* ----------
- * pgstat_recv_funcpurge() -
+ *	Discard any data collected in the current transaction.  Any subsequent
+ *	request will cause new snapshots to be taken.
  *
- *	Arrange for dead function removal.
+ *	This is also invoked during transaction commit or abort to discard
+ *	the no-longer-wanted snapshot.
  * ----------
  */
-static void
-pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
+void
+pgstat_clear_snapshot(void)
 {
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
+	pgstat_assert_is_up();
 
-/* ----------
- * pgstat_write_statsfile_needed() -
- *
- *	Do we need to write out any stats files?
- * ----------
- */
-static bool
-pgstat_write_statsfile_needed(void)
-{
-	if (pending_write_requests != NIL)
-		return true;
+	/* Release memory, if any was allocated */
+	if (pgStatLocalContext)
+		MemoryContextDelete(pgStatLocalContext);
 
-	/* Everything was written recently */
-	return false;
-}
+	/* Reset variables */
+	pgStatLocalContext = NULL;
+	pgStatSnapshotHash = NULL;
+	replSlotSnapshot = NULL;
+	archiverSnapshotValid = false;
+	globalSnapshotValid = false;
+	walSnapshotValid = false;
+	slruSnapshotValid = false;
 
-/* ----------
- * pgstat_db_requested() -
- *
- *	Checks whether stats for a particular DB need to be written to a file.
- * ----------
- */
-static bool
-pgstat_db_requested(Oid databaseid)
-{
 	/*
-	 * If any requests are outstanding at all, we should write the stats for
-	 * shared catalogs (the "database" with OID 0).  This ensures that
-	 * backends will see up-to-date stats for shared catalogs, even though
-	 * they send inquiry messages mentioning only their own DB.
+	 * Historically the backend_status.c facilities lived in this file, and
+	 * were reset with the same function. For now keep it that way, and
+	 * forward the reset request.
 	 */
-	if (databaseid == InvalidOid && pending_write_requests != NIL)
-		return true;
-
-	/* Search to see if there's an open request to write this database. */
-	if (list_member_oid(pending_write_requests, databaseid))
-		return true;
-
-	return false;
+	pgstat_clear_backend_activity_snapshot();
 }
 
 /* ----------
- * pgstat_replslot_entry
+ * pgstat_get_replslot_entry
  *
- * Return the entry of replication slot stats with the given name. Return
- * NULL if not found and the caller didn't request to create it.
+ * Return the shared entry of the replication slot with the given name, or
+ * NULL if there is none.  The caller must hold replslot_lock, exclusively
+ * if create is true.
  *
  * create tells whether to create the new slot entry if it is not found.
+ * That fails, returning NULL, only if all the entries are in use.
  * ----------
  */
 static PgStat_StatReplSlotEntry *
-pgstat_get_replslot_entry(NameData name, bool create)
+pgstat_get_replslot_entry(const char *name, bool create)
 {
-	PgStat_StatReplSlotEntry *slotent;
-	bool		found;
+	PgStat_StatReplSlotEntry *freeent = NULL;
+	int			i;
 
-	if (replSlotStatHash == NULL)
+	for (i = 0; i < max_replication_slots; i++)
 	{
-		HASHCTL		hash_ctl;
+		PgStat_StatReplSlotEntry *slotent = &PgStatReplSlots[i];
 
-		/*
-		 * Quick return NULL if the hash table is empty and the caller didn't
-		 * request to create the entry.
-		 */
-		if (!create)
-			return NULL;
-
-		hash_ctl.keysize = sizeof(NameData);
-		hash_ctl.entrysize = sizeof(PgStat_StatReplSlotEntry);
-		replSlotStatHash = hash_create("Replication slots hash",
-									   PGSTAT_REPLSLOT_HASH_SIZE,
-									   &hash_ctl,
-									   HASH_ELEM | HASH_BLOBS);
-	}
+		if (NameStr(slotent->slotname)[0] == '\0')
+		{
+			if (freeent == NULL)
+				freeent = slotent;
+			continue;
+		}
 
-	slotent = (PgStat_StatReplSlotEntry *) hash_search(replSlotStatHash,
-													   (void *) &name,
-													   create ? HASH_ENTER : HASH_FIND,
-													   &found);
+		if (namestrcmp(&slotent->slotname, name) == 0)
+			return slotent;
+	}
 
-	if (!slotent)
-	{
-		/* not found */
-		Assert(!create && !found);
+	if (!create || freeent == NULL)
 		return NULL;
-	}
 
 	/* initialize the entry */
-	if (create && !found)
-	{
-		namestrcpy(&(slotent->slotname), NameStr(name));
-		pgstat_reset_replslot(slotent, 0);
-	}
+	namestrcpy(&freeent->slotname, name);
+	pgstat_reset_replslot(freeent, 0);
 
-	return slotent;
+	return freeent;
 }
 
 /* ----------
@@ -5978,7 +3903,7 @@ pgstat_slru_name(int slru_idx)
  * Returns pointer to entry with counters for given SLRU (based on the name
  * stored in SlruCtl as lwlock tranche name).
  */
-static inline PgStat_MsgSLRU *
+static inline PgStat_SLRUStats *
 slru_entry(int slru_idx)
 {
 	pgstat_assert_is_up();
@@ -5991,7 +3916,7 @@ slru_entry(int slru_idx)
 
 	Assert((slru_idx >= 0) && (slru_idx < SLRU_NUM_ELEMENTS));
 
-	return &SLRUStats[slru_idx];
+	return &pendingSLRUStats[slru_idx];
 }
 
 /*
@@ -6001,41 +3926,41 @@ slru_entry(int slru_idx)
 void
 pgstat_count_slru_page_zeroed(int slru_idx)
 {
-	slru_entry(slru_idx)->m_blocks_zeroed += 1;
+	slru_entry(slru_idx)->blocks_zeroed += 1;
 }
 
 void
 pgstat_count_slru_page_hit(int slru_idx)
 {
-	slru_entry(slru_idx)->m_blocks_hit += 1;
+	slru_entry(slru_idx)->blocks_hit += 1;
 }
 
 void
 pgstat_count_slru_page_exists(int slru_idx)
 {
-	slru_entry(slru_idx)->m_blocks_exists += 1;
+	slru_entry(slru_idx)->blocks_exists += 1;
 }
 
 void
 pgstat_count_slru_page_read(int slru_idx)
 {
-	slru_entry(slru_idx)->m_blocks_read += 1;
+	slru_entry(slru_idx)->blocks_read += 1;
 }
 
 void
 pgstat_count_slru_page_written(int slru_idx)
 {
-	slru_entry(slru_idx)->m_blocks_written += 1;
+	slru_entry(slru_idx)->blocks_written += 1;
 }
 
 void
 pgstat_count_slru_flush(int slru_idx)
 {
-	slru_entry(slru_idx)->m_flush += 1;
+	slru_entry(slru_idx)->flush += 1;
 }
 
 void
 pgstat_count_slru_truncate(int slru_idx)
 {
-	slru_entry(slru_idx)->m_truncate += 1;
+	slru_entry(slru_idx)->truncate += 1;
 }
@@ -257,7 +257,7 @@ WalWriterMain(void)
 		else if (left_till_hibernate > 0)
 			left_till_hibernate--;
 
-		/* Send WAL statistics to the stats collector */
+		/* Flush WAL statistics to shared memory */
 		pgstat_send_wal(false);
 
 		/*
@@ -295,12 +295,12 @@ HandleWalWriterInterrupts(void)
 	if (ShutdownRequestPending)
 	{
 		/*
-		 * Force to send remaining WAL statistics to the stats collector at
+		 * Force to flush remaining WAL statistics to shared memory at
 		 * process exit.
 		 *
 		 * Since pgstat_send_wal is invoked with 'force' is false in main loop
-		 * to avoid overloading to the stats collector, there may exist unsent
-		 * stats counters for the WAL writer.
+		 * to avoid flushing too often, there may exist unflushed stats
+		 * counters for the WAL writer.
 		 */
 		pgstat_send_wal(true);
 
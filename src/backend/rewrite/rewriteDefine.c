@@ -634,6 +634,7 @@ DefineQueryRewrite(const char *rulename,
 		classForm->relpages = 0;
 		classForm->reltuples = -1;
 		classForm->relallvisible = 0;
+		classForm->relallfrozen = 0;
 		classForm->reltoastrelid = InvalidOid;
 		classForm->relhasindex = false;
 		classForm->relkind = RELKIND_VIEW;
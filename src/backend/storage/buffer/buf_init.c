@@ -77,9 +77,12 @@ InitBufferPool(void)
 						NBuffers * sizeof(BufferDescPadded),
 						&foundDescs);
 
+	/* Align buffer pool on I/O boundary, so it can be used for direct I/O */
 	BufferBlocks = (char *)
-		ShmemInitStruct("Buffer Blocks",
-						NBuffers * (Size) BLCKSZ, &foundBufs);
+		TYPEALIGN(PG_IO_ALIGN_SIZE,
+				  ShmemInitStruct("Buffer Blocks",
+								  NBuffers * (Size) BLCKSZ + PG_IO_ALIGN_SIZE,
+								  &foundBufs));
 
 	/* Align condition variables to cacheline boundary. */
 	BufferIOCVArray = (ConditionVariableMinimallyPadded *)
@@ -108,6 +111,18 @@ InitBufferPool(void)
 	{
 		int			i;
 
+		/*
+		 * Every backend touches buffer headers and pages all over the pool,
+		 * so if asked to, spread them evenly over the NUMA nodes before
+		 * anything is faulted in on ours.
+		 */
+		ShmemInterleave("Buffer Descriptors", BufferDescriptors,
+						NBuffers * sizeof(BufferDescPadded));
+		ShmemInterleave("Buffer Blocks", BufferBlocks,
+						NBuffers * (Size) BLCKSZ);
+		ShmemInterleave("Buffer IO Condition Variables", BufferIOCVArray,
+						NBuffers * sizeof(ConditionVariableMinimallyPadded));
+
 		/*
 		 * Initialize all the buffer headers.
 		 */
@@ -162,7 +177,8 @@ BufferShmemSize(void)
 	/* to allow aligning buffer descriptors */
 	size = add_size(size, PG_CACHE_LINE_SIZE);
 
-	/* size of data pages */
+	/* size of data pages, plus alignment padding */
+	size = add_size(size, PG_IO_ALIGN_SIZE);
 	size = add_size(size, mul_size(NBuffers, BLCKSZ));
 
 	/* size of stuff controlled by freelist.c */
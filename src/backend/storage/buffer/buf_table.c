@@ -9,6 +9,22 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * If buffer_mapping_hints is enabled, we also maintain an array of lookup
+ * hints alongside the hash table.  Each slot, selected by the low-order bits
+ * of a tag's hash code, holds the ID of a buffer recently entered into or
+ * found in the table under a tag with that hash code (plus one, so that zero
+ * means empty).  The hints are read without any lock at all, so that the
+ * common case of a buffer hit doesn't have to touch the BufMappingLock.
+ *
+ * Hint slots are not protected by the BufMappingLock either: insertions and
+ * deletions update them under the exclusive partition lock, but lookups
+ * repair them while holding only a shared lock, so several backends can race
+ * to store different values.  Every store is a single atomic write (or
+ * compare-and-swap), so a slot always holds some buffer ID that was valid for
+ * that hash code at some point; which one wins is arbitrary.  Since a hint
+ * can thus be stale or belong to a colliding tag, whoever uses one must pin
+ * the buffer and check its tag before trusting it.
+ *
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,6 +37,7 @@
  */
 #include "postgres.h"
 
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
@@ -33,6 +50,13 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/* GUC variable */
+bool		buffer_mapping_hints = false;
+
+/* Lookup hints, or NULL if disabled; see above */
+static pg_atomic_uint32 *SharedBufHints = NULL;
+static uint32 SharedBufHintMask;
+
 
 /*
  * Estimate space needed for mapping hashtable
@@ -41,7 +65,13 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	Size		sz = hash_estimate_size(size, sizeof(BufferLookupEnt));
+
+	if (buffer_mapping_hints)
+		sz = add_size(sz, mul_size(pg_nextpower2_32(size),
+								   sizeof(pg_atomic_uint32)));
+
+	return sz;
 }
 
 /*
@@ -64,6 +94,23 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	if (buffer_mapping_hints)
+	{
+		uint32		nslots = pg_nextpower2_32(size);
+		bool		found;
+
+		SharedBufHints = (pg_atomic_uint32 *)
+			ShmemInitStruct("Shared Buffer Lookup Hints",
+							nslots * sizeof(pg_atomic_uint32), &found);
+		SharedBufHintMask = nslots - 1;
+
+		if (!found)
+		{
+			for (uint32 i = 0; i < nslots; i++)
+				pg_atomic_init_u32(&SharedBufHints[i], 0);
+		}
+	}
 }
 
 /*
@@ -81,6 +128,22 @@ BufTableHashCode(BufferTag *tagPtr)
 	return get_hash_value(SharedBufHash, (void *) tagPtr);
 }
 
+/*
+ * BufTableLookupHint
+ *		Return the buffer ID that the lookup hints suggest for a tag with the
+ *		given hash code, or -1 if there is none.
+ *
+ * No lock is required, but the result is only a guess; see above.
+ */
+int
+BufTableLookupHint(uint32 hashcode)
+{
+	if (SharedBufHints == NULL)
+		return -1;
+
+	return (int) pg_atomic_read_u32(&SharedBufHints[hashcode & SharedBufHintMask]) - 1;
+}
+
 /*
  * BufTableLookup
  *		Lookup the given BufferTag; return buffer ID, or -1 if not found
@@ -102,6 +165,21 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	if (!result)
 		return -1;
 
+	/*
+	 * If the hint was taken over by a colliding tag, point it back to this
+	 * buffer, which was evidently wanted more recently.  Avoid dirtying the
+	 * cache line if it's already right.  We may hold only a shared lock here,
+	 * so this can race with other lookups and with insertions; that's fine,
+	 * see the comments at the top of the file.
+	 */
+	if (SharedBufHints != NULL)
+	{
+		pg_atomic_uint32 *hint = &SharedBufHints[hashcode & SharedBufHintMask];
+
+		if (pg_atomic_read_u32(hint) != result->id + 1)
+			pg_atomic_write_u32(hint, result->id + 1);
+	}
+
 	return result->id;
 }
 
@@ -136,6 +214,10 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 
 	result->id = buf_id;
 
+	if (SharedBufHints != NULL)
+		pg_atomic_write_u32(&SharedBufHints[hashcode & SharedBufHintMask],
+							buf_id + 1);
+
 	return -1;
 }
 
@@ -159,4 +241,13 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	/* Clear the hint if it points to this entry */
+	if (SharedBufHints != NULL)
+	{
+		uint32		expected = result->id + 1;
+
+		(void) pg_atomic_compare_exchange_u32(&SharedBufHints[hashcode & SharedBufHintMask],
+											  &expected, 0);
+	}
 }
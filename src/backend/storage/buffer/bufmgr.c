@@ -50,6 +50,7 @@
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -157,8 +158,19 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
+/*
+ * Maximum number of blocks WaitReadBuffers() combines into one read; see
+ * io_combine_limit.
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
+/*
+ * local state for StartBufferIO and related functions.  Writes are always
+ * done one buffer at a time, but a combined read has I/O in progress on all
+ * of its buffers at once.
+ */
+static BufferDesc *InProgressBufs[MAX_IO_COMBINE_LIMIT];
+static int	NumInProgressBufs = 0;
 static bool IsForInput;
 
 /* local state for LockBufferForCleanup */
@@ -468,12 +480,21 @@ static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
+static int	CheckpointWriteRun(CkptSortItem *items, int nitems,
+							   WritebackContext *wb_context,
+							   int *num_written);
 static void WaitIO(BufferDesc *buf);
-static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 							  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
 static void local_buffer_write_error_callback(void *arg);
+static void VerifyReadBufferBlock(SMgrRelation smgr, ForkNumber forkNum,
+								  BlockNumber blockNum, Block bufBlock,
+								  ReadBufferMode mode);
+static BufferDesc *BufferAllocOptimistic(BufferTag *tag, uint32 hashcode,
+										 BufferAccessStrategy strategy,
+										 bool *validPtr);
 static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   char relpersistence,
 							   ForkNumber forkNum,
@@ -849,11 +870,20 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	else
 	{
 		/*
-		 * lookup the buffer.  IO_IN_PROGRESS is set if the requested block is
-		 * not currently in memory.
+		 * lookup the buffer, selecting a victim buffer for it if the
+		 * requested block is not currently in memory.
 		 */
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
 							 strategy, &found);
+
+		/*
+		 * If the buffer isn't valid yet, try to obtain the right to read it
+		 * in.  If StartBufferIO returns false, then someone else managed to
+		 * read it before we did.
+		 */
+		if (!found && !StartBufferIO(bufHdr, true, false))
+			found = true;
+
 		if (found)
 			pgBufferUsage.shared_blks_hit++;
 		else if (isExtend)
@@ -950,7 +980,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				Assert(buf_state & BM_VALID);
 				buf_state &= ~BM_VALID;
 				UnlockBufHdr(bufHdr, buf_state);
-			} while (!StartBufferIO(bufHdr, true));
+			} while (!StartBufferIO(bufHdr, true, false));
 		}
 	}
 
@@ -1011,25 +1041,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			}
 
 			/* check for garbage data */
-			if (!PageIsVerifiedExtended((Page) bufBlock, blockNum,
-										PIV_LOG_WARNING | PIV_REPORT_STAT))
-			{
-				if (mode == RBM_ZERO_ON_ERROR || zero_damaged_pages)
-				{
-					ereport(WARNING,
-							(errcode(ERRCODE_DATA_CORRUPTED),
-							 errmsg("invalid page in block %u of relation %s; zeroing out page",
-									blockNum,
-									relpath(smgr->smgr_rnode, forkNum))));
-					MemSet((char *) bufBlock, 0, BLCKSZ);
-				}
-				else
-					ereport(ERROR,
-							(errcode(ERRCODE_DATA_CORRUPTED),
-							 errmsg("invalid page in block %u of relation %s",
-									blockNum,
-									relpath(smgr->smgr_rnode, forkNum))));
-			}
+			VerifyReadBufferBlock(smgr, forkNum, blockNum, bufBlock, mode);
 		}
 	}
 
@@ -1078,6 +1090,285 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	return BufferDescriptorGetBuffer(bufHdr);
 }
 
+/*
+ * VerifyReadBufferBlock -- check a block that was just read in
+ *
+ * Raises an error if the page is corrupt, unless mode is RBM_ZERO_ON_ERROR
+ * or zero_damaged_pages is set, in which case the page is zeroed instead.
+ */
+static void
+VerifyReadBufferBlock(SMgrRelation smgr, ForkNumber forkNum,
+					  BlockNumber blockNum, Block bufBlock,
+					  ReadBufferMode mode)
+{
+	if (PageIsVerifiedExtended((Page) bufBlock, blockNum,
+							   PIV_LOG_WARNING | PIV_REPORT_STAT))
+		return;
+
+	if (mode == RBM_ZERO_ON_ERROR || zero_damaged_pages)
+	{
+		ereport(WARNING,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid page in block %u of relation %s; zeroing out page",
+						blockNum,
+						relpath(smgr->smgr_rnode, forkNum))));
+		MemSet((char *) bufBlock, 0, BLCKSZ);
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid page in block %u of relation %s",
+						blockNum,
+						relpath(smgr->smgr_rnode, forkNum))));
+}
+
+/*
+ * StartReadBuffers -- begin reading a range of consecutive blocks
+ *
+ * Pins buffers for the nblocks blocks starting at blockNum, in the relation
+ * and fork described by *operation, and stores them in buffers[].  Buffers
+ * that already held valid contents can be used right away.  The others are
+ * pinned and tagged, but their contents are not valid yet.  If flags
+ * includes READ_BUFFERS_ISSUE_ADVICE, the kernel is asked to start reading
+ * those blocks in the background, so that the eventual read doesn't have to
+ * wait for the disk.
+ *
+ * Returns true if WaitReadBuffers() must be called before the buffers are
+ * used, or false if they were all hits.  The buffers[] array must stay valid
+ * until then.
+ *
+ * No I/O is in progress on a pinned-but-invalid buffer between the two
+ * calls, so other backends wanting the same block are not blocked: whoever
+ * gets to StartBufferIO() first reads it in, and everyone else just finds it
+ * valid.  For the same reason, a caller that loses interest in some of the
+ * blocks may simply release their pins without calling WaitReadBuffers().
+ */
+bool
+StartReadBuffers(ReadBuffersOperation *operation, Buffer *buffers,
+				 BlockNumber blockNum, int nblocks, int flags)
+{
+	Relation	rel = operation->rel;
+	SMgrRelation smgr;
+	bool		need_wait = false;
+
+	Assert(nblocks > 0);
+
+	/* see comments in ReadBufferExtended */
+	if (RELATION_IS_OTHER_TEMP(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	operation->buffers = buffers;
+	operation->blocknum = blockNum;
+	operation->flags = flags;
+	operation->nblocks = nblocks;
+
+	/*
+	 * Nobody else can see our local buffers, so there is nothing to be
+	 * gained by splitting the read in two.  Just read them in now.
+	 */
+	if (RelationUsesLocalBuffers(rel))
+	{
+		for (int i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(rel, operation->forknum,
+											blockNum + i, RBM_NORMAL,
+											operation->strategy);
+		return false;
+	}
+
+	smgr = RelationGetSmgr(rel);
+
+	for (int i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		pgstat_count_buffer_read(rel);
+		bufHdr = BufferAlloc(smgr, rel->rd_rel->relpersistence,
+							 operation->forknum, blockNum + i,
+							 operation->strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+
+		if (found)
+		{
+			pgstat_count_buffer_hit(rel);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+		}
+		else
+		{
+			need_wait = true;
+#ifdef USE_PREFETCH
+			if (flags & READ_BUFFERS_ISSUE_ADVICE)
+				smgrprefetch(smgr, operation->forknum, blockNum + i);
+#endif
+		}
+	}
+
+	return need_wait;
+}
+
+/*
+ * WaitReadBuffers -- finish a read begun with StartReadBuffers
+ *
+ * On return, all of the operation's buffers are valid.  Blocks that some
+ * other backend read in since StartReadBuffers() are not read again.
+ */
+void
+WaitReadBuffers(ReadBuffersOperation *operation)
+{
+	Relation	rel = operation->rel;
+	ForkNumber	forknum = operation->forknum;
+	SMgrRelation smgr;
+
+	/* Local buffers were read in by StartReadBuffers() already */
+	if (RelationUsesLocalBuffers(rel))
+		return;
+
+	/* The smgr reference may have been closed by an invalidation since */
+	smgr = RelationGetSmgr(rel);
+
+	for (int i = 0; i < operation->nblocks;)
+	{
+		BufferDesc *bufHdrs[MAX_IO_COMBINE_LIMIT];
+		void	   *bufBlocks[MAX_IO_COMBINE_LIMIT];
+		BlockNumber io_first_block = operation->blocknum + i;
+		int			io_buffers_len;
+		instr_time	io_start,
+					io_time;
+
+		/*
+		 * This waits for any read of the block that another backend has in
+		 * progress, and returns false if the buffer is valid by now.
+		 */
+		bufHdrs[0] = GetBufferDescriptor(operation->buffers[i] - 1);
+		if (!StartBufferIO(bufHdrs[0], true, false))
+		{
+			i++;
+			continue;
+		}
+		bufBlocks[0] = BufHdrGetBlock(bufHdrs[0]);
+		io_buffers_len = 1;
+
+		/*
+		 * Extend the read over as many of the following blocks as we can
+		 * start I/O on without waiting.  A block that is valid already, or
+		 * that another backend is busy reading, ends the run; the next
+		 * iteration of the outer loop deals with it.
+		 */
+		while (i + io_buffers_len < operation->nblocks &&
+			   io_buffers_len < io_combine_limit)
+		{
+			BufferDesc *nextHdr;
+
+			nextHdr = GetBufferDescriptor(operation->buffers[i + io_buffers_len] - 1);
+			if (!StartBufferIO(nextHdr, true, true))
+				break;
+			bufHdrs[io_buffers_len] = nextHdr;
+			bufBlocks[io_buffers_len] = BufHdrGetBlock(nextHdr);
+			io_buffers_len++;
+		}
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+
+		smgrreadv(smgr, forknum, io_first_block, bufBlocks, io_buffers_len);
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+			INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+		}
+		pgBufferUsage.shared_blks_read += io_buffers_len;
+
+		for (int j = 0; j < io_buffers_len; j++)
+		{
+			/* check for garbage data */
+			VerifyReadBufferBlock(smgr, forknum, io_first_block + j,
+								  bufBlocks[j], RBM_NORMAL);
+
+			/* Set BM_VALID, terminate IO, and wake up any waiters */
+			TerminateBufferIO(bufHdrs[j], false, BM_VALID);
+		}
+
+		VacuumPageMiss += io_buffers_len;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss * io_buffers_len;
+
+		i += io_buffers_len;
+	}
+}
+
+/*
+ * GetPinLimit -- how many buffers a backend may reasonably pin at once
+ *
+ * Code that pins buffers ahead of their use, rather than one at a time,
+ * should stay below this, so that all backends together can't run the
+ * buffer pool out of unpinned buffers.
+ */
+uint32
+GetPinLimit(void)
+{
+	return Max(NBuffers / (MaxBackends + NUM_AUXILIARY_PROCS), 1);
+}
+
+/*
+ * BufferAllocOptimistic -- look up a buffer using the mapping hints
+ *
+ * If buffer_mapping_hints is enabled, the hints suggest a buffer that
+ * probably holds the given tag.  We pin that buffer, which keeps its tag from
+ * changing under us, and then check that it really holds the block we want;
+ * a buffer's tag is only ever set or cleared with its header spinlock held
+ * and nobody else holding a pin.  So if the pinned buffer has BM_TAG_VALID
+ * set and the right tag, it is the same buffer a locked lookup in the
+ * mapping table would have returned.
+ *
+ * On success, returns the pinned buffer, and sets *validPtr as PinBuffer()
+ * does.  Returns NULL if there was no usable hint, in which case the caller
+ * must fall back to a regular lookup.
+ */
+static BufferDesc *
+BufferAllocOptimistic(BufferTag *tag, uint32 hashcode,
+					  BufferAccessStrategy strategy, bool *validPtr)
+{
+	BufferDesc *buf;
+	int			buf_id;
+
+	buf_id = BufTableLookupHint(hashcode);
+	if (buf_id < 0)
+		return NULL;
+
+	buf = GetBufferDescriptor(buf_id);
+
+	/*
+	 * Peek at the tag before pinning, so that we don't bother pinning an
+	 * unrelated buffer when the hint belongs to a colliding tag.  Without a
+	 * pin or the spinlock this is only a heuristic, we recheck below.
+	 */
+	if (!BUFFERTAGS_EQUAL(buf->tag, *tag))
+		return NULL;
+
+	*validPtr = PinBuffer(buf, strategy);
+
+	/* PinBuffer() acts as a memory barrier, so this reads the current tag */
+	if ((pg_atomic_read_u32(&buf->state) & BM_TAG_VALID) &&
+		BUFFERTAGS_EQUAL(buf->tag, *tag))
+		return buf;
+
+	/* The buffer was recycled since the hint was set; undo */
+	UnpinBuffer(buf, true);
+	return NULL;
+}
+
 /*
  * BufferAlloc -- subroutine for ReadBuffer.  Handles lookup of a shared
  *		buffer.  If no buffer exists already, selects a replacement
@@ -1088,9 +1379,12 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * using the default strategy, but otherwise possibly not (see PinBuffer).
  *
  * The returned buffer is pinned and is already marked as holding the
- * desired page.  If it already did have the desired page, *foundPtr is
- * set true.  Otherwise, *foundPtr is set false and the buffer is marked
- * as IO_IN_PROGRESS; ReadBuffer will now need to do I/O to fill it.
+ * desired page.  If it already did have valid contents for the desired
+ * page, *foundPtr is set true.  Otherwise, *foundPtr is set false and the
+ * caller must call StartBufferIO() to obtain the right to fill it; that may
+ * find that some other backend has done the I/O in the meantime.  Because
+ * no I/O is started here, a caller is free to leave a buffer pinned in this
+ * state for a while (see StartReadBuffers()), or to simply release it.
  *
  * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
  * we keep it for simplicity in ReadBuffer.
@@ -1114,6 +1408,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *buf;
 	bool		valid;
 	uint32		buf_state;
+	uint32		usage_count;
 
 	/* create a tag so we can lookup the buffer */
 	INIT_BUFFERTAG(newTag, smgr->smgr_rnode.node, forkNum, blockNum);
@@ -1122,6 +1417,14 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/* first try to find the buffer without taking the mapping lock */
+	buf = BufferAllocOptimistic(&newTag, newHash, strategy, &valid);
+	if (buf != NULL)
+	{
+		*foundPtr = valid;
+		return buf;
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1139,26 +1442,12 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
 
-		*foundPtr = true;
-
-		if (!valid)
-		{
-			/*
-			 * We can only get here if (a) someone else is still reading in
-			 * the page, or (b) a previous read attempt failed.  We have to
-			 * wait for any active read attempt to finish, and then set up our
-			 * own read attempt if the page is still not BM_VALID.
-			 * StartBufferIO does it all.
-			 */
-			if (StartBufferIO(buf, true))
-			{
-				/*
-				 * If we get here, previous attempts to read the buffer must
-				 * have failed ... but we shall bravely try again.
-				 */
-				*foundPtr = false;
-			}
-		}
+		/*
+		 * If the buffer isn't valid, either someone else is still reading in
+		 * the page, or a previous read attempt failed.  It's up to the
+		 * caller to sort that out with StartBufferIO().
+		 */
+		*foundPtr = valid;
 
 		return buf;
 	}
@@ -1169,6 +1458,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 */
 	LWLockRelease(newPartitionLock);
 
+	/* Ask the replacement policy how much credit the new page starts with */
+	usage_count = StrategyInitialUsageCount(newHash);
+
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
@@ -1351,26 +1643,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Can release the mapping lock as soon as we've pinned it */
 			LWLockRelease(newPartitionLock);
 
-			*foundPtr = true;
-
-			if (!valid)
-			{
-				/*
-				 * We can only get here if (a) someone else is still reading
-				 * in the page, or (b) a previous read attempt failed.  We
-				 * have to wait for any active read attempt to finish, and
-				 * then set up our own read attempt if the page is still not
-				 * BM_VALID.  StartBufferIO does it all.
-				 */
-				if (StartBufferIO(buf, true))
-				{
-					/*
-					 * If we get here, previous attempts to read the buffer
-					 * must have failed ... but we shall bravely try again.
-					 */
-					*foundPtr = false;
-				}
-			}
+			*foundPtr = valid;
 
 			return buf;
 		}
@@ -1404,8 +1677,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 *
 	 * Clearing BM_VALID here is necessary, clearing the dirtybits is just
 	 * paranoia.  We also reset the usage_count since any recency of use of
-	 * the old content is no longer relevant.  (The usage_count starts out at
-	 * 1 so that the buffer can survive one clock-sweep pass.)
+	 * the old content is no longer relevant.  (The usage_count normally
+	 * starts out at 1 so that the buffer can survive one clock-sweep pass,
+	 * but see StrategyInitialUsageCount() for the 2q policy.)
 	 *
 	 * Make sure BM_PERMANENT is set for buffers that must be written at every
 	 * checkpoint.  Unlogged buffers only need to be written at shutdown
@@ -1417,15 +1691,17 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				   BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT |
 				   BUF_USAGECOUNT_MASK);
 	if (relpersistence == RELPERSISTENCE_PERMANENT || forkNum == INIT_FORKNUM)
-		buf_state |= BM_TAG_VALID | BM_PERMANENT | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID | BM_PERMANENT;
 	else
-		buf_state |= BM_TAG_VALID | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID;
+	buf_state += usage_count * BUF_USAGECOUNT_ONE;
 
 	UnlockBufHdr(buf, buf_state);
 
 	if (oldPartitionLock != NULL)
 	{
 		BufTableDelete(&oldTag, oldHash);
+		StrategyNoteEviction(oldHash);
 		if (oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
 	}
@@ -1433,15 +1709,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	LWLockRelease(newPartitionLock);
 
 	/*
-	 * Buffer contents are currently invalid.  Try to obtain the right to
-	 * start I/O.  If StartBufferIO returns false, then someone else managed
-	 * to read it before we did, so there's nothing left for BufferAlloc() to
-	 * do.
+	 * Buffer contents are currently invalid.  The caller must obtain the
+	 * right to start I/O with StartBufferIO() before reading it in.
 	 */
-	if (StartBufferIO(buf, true))
-		*foundPtr = false;
-	else
-		*foundPtr = true;
+	*foundPtr = false;
 
 	return buf;
 }
@@ -1660,6 +1931,84 @@ ReleaseAndReadBuffer(Buffer buffer,
 	return ReadBuffer(relation, blockNum);
 }
 
+/*
+ * ReadBufferCached -- like ReleaseAndReadBuffer(), but keep a few pins
+ *
+ * Index scans often return tuples from a handful of heap pages in turn, for
+ * example when the index order is only loosely correlated with the heap
+ * order.  ReleaseAndReadBuffer() drops and retakes a pin every time the scan
+ * moves between such pages, costing a mapping table lookup and two atomic
+ * operations on the buffer header.  A BufferPinCache instead keeps the most
+ * recently used few buffers pinned, so that returning to one of them costs
+ * only a scan of the cache.
+ *
+ * All blocks read through one cache must belong to the main fork of the same
+ * relation.  *newly_pinned is set to true if the block was not in the cache
+ * already.  The pins remain owned by the cache; the caller must release them
+ * with ReleaseBufferPinCache() and not with ReleaseBuffer().  The cache must
+ * be zeroed before first use.
+ */
+Buffer
+ReadBufferCached(BufferPinCache *cache, Relation relation,
+				 BlockNumber blockNum, bool *newly_pinned)
+{
+	Buffer		victim = InvalidBuffer;
+	Buffer		buffer;
+	int			i;
+
+	/* The cache is kept in order of use, most recent first */
+	for (i = 0; i < cache->nbuffers; i++)
+	{
+		if (cache->blocks[i] == blockNum)
+		{
+			buffer = cache->buffers[i];
+			memmove(&cache->buffers[1], &cache->buffers[0], sizeof(Buffer) * i);
+			memmove(&cache->blocks[1], &cache->blocks[0], sizeof(BlockNumber) * i);
+			cache->buffers[0] = buffer;
+			cache->blocks[0] = blockNum;
+			*newly_pinned = false;
+			return buffer;
+		}
+	}
+
+	/* Miss; make room at the front, giving up the least recently used pin */
+	if (cache->nbuffers == BUFFER_PIN_CACHE_SIZE)
+		victim = cache->buffers[BUFFER_PIN_CACHE_SIZE - 1];
+	else
+		cache->nbuffers++;
+	memmove(&cache->buffers[1], &cache->buffers[0],
+			sizeof(Buffer) * (cache->nbuffers - 1));
+	memmove(&cache->blocks[1], &cache->blocks[0],
+			sizeof(BlockNumber) * (cache->nbuffers - 1));
+
+	/* Don't leave a stale entry behind if the read fails */
+	cache->buffers[0] = InvalidBuffer;
+	cache->blocks[0] = InvalidBlockNumber;
+
+	buffer = ReleaseAndReadBuffer(victim, relation, blockNum);
+	cache->buffers[0] = buffer;
+	cache->blocks[0] = blockNum;
+	*newly_pinned = true;
+
+	return buffer;
+}
+
+/*
+ * ReleaseBufferPinCache -- release all pins held by a BufferPinCache
+ *
+ * The cache is left empty and can be used again.
+ */
+void
+ReleaseBufferPinCache(BufferPinCache *cache)
+{
+	for (int i = 0; i < cache->nbuffers; i++)
+	{
+		if (BufferIsValid(cache->buffers[i]))
+			ReleaseBuffer(cache->buffers[i]);
+	}
+	cache->nbuffers = 0;
+}
+
 /*
  * PinBuffer -- make buffer unavailable for replacement.
  *
@@ -1945,9 +2294,6 @@ BufferSync(int flags)
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
 
-	/* Make sure we can handle the pin inside SyncOneBuffer */
-	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
-
 	/*
 	 * Unless this is a shutdown checkpoint or we have been explicitly told,
 	 * we write only permanent, dirty buffers.  But at shutdown or end of
@@ -2113,6 +2459,10 @@ BufferSync(int flags)
 	 * marked with BM_CHECKPOINT_NEEDED. The writes are balanced between
 	 * tablespaces; otherwise the sorting would lead to only one tablespace
 	 * receiving writes at a time, making inefficient use of the hardware.
+	 *
+	 * Thanks to the sort, consecutive blocks of a relation are adjacent in
+	 * each tablespace's part of CkptBufferIds, so CheckpointWriteRun can
+	 * combine them into a single write.
 	 */
 	num_processed = 0;
 	num_written = 0;
@@ -2121,43 +2471,47 @@ BufferSync(int flags)
 		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 		DatumGetPointer(binaryheap_first(ts_heap));
+		int			num_items = 1;
 
 		buf_id = CkptBufferIds[ts_stat->index].buf_id;
 		Assert(buf_id != -1);
 
 		bufHdr = GetBufferDescriptor(buf_id);
 
-		num_processed++;
-
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
 		 * at a single bit. It's possible that someone else writes the buffer
 		 * and clears the flag right after we check, but that doesn't matter
-		 * since SyncOneBuffer will then do nothing.  However, there is a
-		 * further race condition: it's conceivable that between the time we
-		 * examine the bit here and the time SyncOneBuffer acquires the lock,
-		 * someone else not only wrote the buffer but replaced it with another
-		 * page and dirtied it.  In that improbable case, SyncOneBuffer will
-		 * write the buffer though we didn't need to.  It doesn't seem worth
-		 * guarding against this, though.
+		 * since CheckpointWriteRun will then do nothing.  However, there is
+		 * a further race condition: it's conceivable that between the time
+		 * we examine the bit here and the time CheckpointWriteRun acquires
+		 * the lock, someone else not only wrote the buffer but replaced it
+		 * with another page and dirtied it.  In that improbable case,
+		 * CheckpointWriteRun will write the buffer though we didn't need to.
+		 * It doesn't seem worth guarding against this, though.
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
-			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				PendingCheckpointerStats.m_buf_written_checkpoints++;
-				num_written++;
-			}
+			int			run_written;
+
+			num_items = CheckpointWriteRun(&CkptBufferIds[ts_stat->index],
+										   ts_stat->num_to_scan - ts_stat->num_scanned,
+										   &wb_context, &run_written);
+			for (i = 0; i < run_written; i++)
+				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(CkptBufferIds[ts_stat->index + i].buf_id);
+			PendingCheckpointerStats.buf_written_checkpoints += run_written;
+			num_written += run_written;
 		}
 
+		num_processed += num_items;
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * num_items;
+		ts_stat->num_scanned += num_items;
+		ts_stat->index += num_items;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2256,7 +2610,7 @@ BgBufferSync(WritebackContext *wb_context)
 	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
 
 	/* Report buffer alloc counts to pgstat */
-	PendingBgWriterStats.m_buf_alloc += recent_alloc;
+	PendingBgWriterStats.buf_alloc += recent_alloc;
 
 	/*
 	 * If we're not running the LRU scan, just stop after doing the stats
@@ -2446,7 +2800,7 @@ BgBufferSync(WritebackContext *wb_context)
 			reusable_buffers++;
 			if (++num_written >= bgwriter_lru_maxpages)
 			{
-				PendingBgWriterStats.m_maxwritten_clean++;
+				PendingBgWriterStats.maxwritten_clean++;
 				break;
 			}
 		}
@@ -2454,7 +2808,7 @@ BgBufferSync(WritebackContext *wb_context)
 			reusable_buffers++;
 	}
 
-	PendingBgWriterStats.m_buf_written_clean += num_written;
+	PendingBgWriterStats.buf_written_clean += num_written;
 
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
@@ -2568,6 +2922,231 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * CheckpointWriteRun -- write out a run of buffers during a checkpoint.
+ *
+ * items[0] is the next entry of CkptBufferIds to process, and is followed by
+ * nitems - 1 more entries for the same tablespace.  The first buffer is
+ * written much as SyncOneBuffer would.  As long as the following entries
+ * hold the next consecutive blocks of the same relation fork, and still need
+ * to be written for this checkpoint, they are added to the run, up to
+ * io_combine_limit buffers, and the whole run is written out with a single
+ * smgrwritev() call.
+ *
+ * We already hold the content locks of the earlier buffers in the run while
+ * adding another one, so we only add buffers whose lock can be acquired
+ * without waiting; anything else ends the run.
+ *
+ * Returns the number of entries consumed, which is at least one.  The number
+ * of buffers actually written is returned in *num_written.
+ */
+static int
+CheckpointWriteRun(CkptSortItem *items, int nitems,
+				   WritebackContext *wb_context, int *num_written)
+{
+	static char *checksum_copies = NULL;
+	BufferDesc *bufHdrs[MAX_IO_COMBINE_LIMIT];
+	const void *blocks[MAX_IO_COMBINE_LIMIT];
+	BufferDesc *bufHdr;
+	BufferTag	first_tag;
+	SMgrRelation reln;
+	XLogRecPtr	max_recptr = InvalidXLogRecPtr;
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+	uint32		buf_state;
+	int			max_bufs;
+	int			nbufs;
+
+	*num_written = 0;
+	max_bufs = Min(nitems, io_combine_limit);
+
+	/*
+	 * Pin and share-lock the first buffer, and claim the right to write it,
+	 * if it is still dirty.
+	 */
+	bufHdr = GetBufferDescriptor(items[0].buf_id);
+
+	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+	ReservePrivateRefCountEntry();
+
+	buf_state = LockBufHdr(bufHdr);
+	if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+	{
+		/* It's clean, so nothing to do */
+		UnlockBufHdr(bufHdr, buf_state);
+		return 1;
+	}
+	PinBuffer_Locked(bufHdr);
+	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+
+	if (!StartBufferIO(bufHdr, false, false))
+	{
+		/* someone else flushed the buffer before we could */
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr, true);
+		return 1;
+	}
+
+	/* The buffer is pinned, so its tag can't change */
+	first_tag = bufHdr->tag;
+	bufHdrs[0] = bufHdr;
+	nbufs = 1;
+
+	/* Extend the run over the following blocks, as far as we can */
+	while (nbufs < max_bufs)
+	{
+		CkptSortItem *item = &items[nbufs];
+
+		/* Cheap checks first, on the sort key we saved earlier */
+		if (item->relNode != first_tag.rnode.relNode ||
+			item->forkNum != first_tag.forkNum ||
+			item->blockNum != first_tag.blockNum + nbufs)
+			break;
+
+		bufHdr = GetBufferDescriptor(item->buf_id);
+
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		/* Recheck now that we have the header locked */
+		buf_state = LockBufHdr(bufHdr);
+		if (!RelFileNodeEquals(bufHdr->tag.rnode, first_tag.rnode) ||
+			bufHdr->tag.forkNum != first_tag.forkNum ||
+			bufHdr->tag.blockNum != first_tag.blockNum + nbufs ||
+			(buf_state & (BM_VALID | BM_DIRTY | BM_CHECKPOINT_NEEDED)) !=
+			(BM_VALID | BM_DIRTY | BM_CHECKPOINT_NEEDED))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			break;
+		}
+		PinBuffer_Locked(bufHdr);
+
+		if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+									  LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+		if (!StartBufferIO(bufHdr, false, true))
+		{
+			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		bufHdrs[nbufs++] = bufHdr;
+	}
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) bufHdrs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(first_tag.rnode, InvalidBackendId);
+
+	/*
+	 * As in FlushBuffer, fetch each page's LSN while holding the header
+	 * lock, and make sure that WAL is flushed up to the highest one of the
+	 * permanent buffers before writing any of them.
+	 */
+	for (int i = 0; i < nbufs; i++)
+	{
+		XLogRecPtr	recptr;
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(first_tag.forkNum,
+											first_tag.blockNum + i,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode);
+
+		buf_state = LockBufHdr(bufHdrs[i]);
+		recptr = BufferGetLSN(bufHdrs[i]);
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(bufHdrs[i], buf_state);
+
+		if ((buf_state & BM_PERMANENT) && recptr > max_recptr)
+			max_recptr = recptr;
+	}
+	if (max_recptr != InvalidXLogRecPtr)
+		XLogFlush(max_recptr);
+
+	/*
+	 * Set the page checksums if desired.  As in FlushBuffer, we have only a
+	 * shared lock, so we must checksum private copies of the pages.  We need
+	 * one copy per buffer in the run.
+	 */
+	for (int i = 0; i < nbufs; i++)
+	{
+		Page		page = (Page) BufHdrGetBlock(bufHdrs[i]);
+		char	   *copy;
+
+		if (PageIsNew(page) || !DataChecksumsEnabled())
+		{
+			blocks[i] = page;
+			continue;
+		}
+
+		if (checksum_copies == NULL)
+			checksum_copies = (char *)
+				TYPEALIGN(PG_IO_ALIGN_SIZE,
+						  MemoryContextAlloc(TopMemoryContext,
+											 MAX_IO_COMBINE_LIMIT * BLCKSZ +
+											 PG_IO_ALIGN_SIZE));
+		copy = checksum_copies + i * BLCKSZ;
+		memcpy(copy, page, BLCKSZ);
+		PageSetChecksumInplace((Page) copy, first_tag.blockNum + i);
+		blocks[i] = copy;
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrwritev(reln, first_tag.forkNum, first_tag.blockNum, blocks, nbufs,
+			   false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += nbufs;
+
+	/*
+	 * Mark the buffers as clean (unless BM_JUST_DIRTIED has become set) and
+	 * end the BM_IO_IN_PROGRESS state.
+	 */
+	for (int i = 0; i < nbufs; i++)
+	{
+		TerminateBufferIO(bufHdrs[i], true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(first_tag.forkNum,
+										   first_tag.blockNum + i,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferTag	tag = bufHdrs[i]->tag;
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdrs[i]));
+		UnpinBuffer(bufHdrs[i], true);
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+	}
+
+	*num_written = nbufs;
+	return nbufs;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2820,7 +3399,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	 * someone else flushed the buffer before we could, so we need not do
 	 * anything.
 	 */
-	if (!StartBufferIO(buf, false))
+	if (!StartBufferIO(buf, false, false))
 		return;
 
 	/* Setup error traceback support for ereport() */
@@ -4375,13 +4954,15 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing IO in the other direction on no buffer, and
+ *	in the same direction on no more than MAX_IO_COMBINE_LIMIT - 1 buffers
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
  * could attempt the same I/O operation concurrently.  If someone else
  * has already started I/O on this buffer then we will block on the
- * I/O condition variable until he's done.
+ * I/O condition variable until he's done, unless nowait is true, in which
+ * case we just return false.
  *
  * Input operations are only attempted on buffers that are not BM_VALID,
  * and output operations only on buffers that are BM_VALID and BM_DIRTY,
@@ -4391,11 +4972,12 @@ WaitIO(BufferDesc *buf)
  * false if someone else already did the work.
  */
 static bool
-StartBufferIO(BufferDesc *buf, bool forInput)
+StartBufferIO(BufferDesc *buf, bool forInput, bool nowait)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IO_COMBINE_LIMIT);
+	Assert(NumInProgressBufs == 0 || forInput == IsForInput);
 
 	for (;;)
 	{
@@ -4404,6 +4986,8 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 		if (!(buf_state & BM_IO_IN_PROGRESS))
 			break;
 		UnlockBufHdr(buf, buf_state);
+		if (nowait)
+			return false;
 		WaitIO(buf);
 	}
 
@@ -4419,7 +5003,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
+	InProgressBufs[NumInProgressBufs++] = buf;
 	IsForInput = forInput;
 
 	return true;
@@ -4445,8 +5029,16 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	/* Forget the buffer; it's usually the most recently started I/O */
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
+	InProgressBufs[i] = InProgressBufs[--NumInProgressBufs];
 
 	buf_state = LockBufHdr(buf);
 
@@ -4459,8 +5051,6 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
-
 	ConditionVariableBroadcast(BufferDescriptorGetIOCV(buf));
 }
 
@@ -4468,7 +5058,7 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -4476,10 +5066,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		buf_state = LockBufHdr(buf);
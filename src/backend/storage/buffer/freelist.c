@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
@@ -58,11 +59,33 @@ typedef struct
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/*
+	 * Replacement policy statistics, see pg_stat_get_buffer_replacement().
+	 * These are cumulative since server start.
+	 */
+	pg_atomic_uint64 numColdAdmissions; /* pages admitted on probation */
+	pg_atomic_uint64 numHotAdmissions;	/* pages re-admitted as hot */
+	pg_atomic_uint64 numEvictions;	/* valid pages evicted */
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Hash codes of recently evicted pages, used by the 2q replacement policy to
+ * recognize pages that come back soon after being evicted.  This plays the
+ * role of the "A1out" ghost queue of the 2Q algorithm: it holds no data, only
+ * buffer tag hash codes, and each slot simply remembers the last eviction
+ * that hashed to it.  Lookups are therefore approximate, but a false
+ * positive merely gives one page a slightly longer life in the pool.
+ */
+static pg_atomic_uint32 *StrategyGhosts = NULL;
+static uint32 StrategyGhostMask = 0;
+
+/* GUC variable */
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -98,6 +121,7 @@ typedef struct BufferAccessStrategyData
 
 
 /* Prototypes for internal functions */
+static uint32 StrategyGhostSlots(void);
 static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 									 uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
@@ -461,6 +485,10 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the ghost table used by the 2q policy */
+	size = add_size(size, mul_size(StrategyGhostSlots(),
+								   sizeof(pg_atomic_uint32)));
+
 	return size;
 }
 
@@ -521,9 +549,102 @@ StrategyInitialize(bool init)
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
+
+		pg_atomic_init_u64(&StrategyControl->numColdAdmissions, 0);
+		pg_atomic_init_u64(&StrategyControl->numHotAdmissions, 0);
+		pg_atomic_init_u64(&StrategyControl->numEvictions, 0);
 	}
 	else
 		Assert(!init);
+
+	/*
+	 * The ghost table is always allocated, so that the policy can be changed
+	 * with a reload.
+	 */
+	StrategyGhosts = (pg_atomic_uint32 *)
+		ShmemInitStruct("Buffer Strategy Ghosts",
+						StrategyGhostSlots() * sizeof(pg_atomic_uint32),
+						&found);
+	StrategyGhostMask = StrategyGhostSlots() - 1;
+
+	if (!found)
+	{
+		for (uint32 i = 0; i < StrategyGhostSlots(); i++)
+			pg_atomic_init_u32(&StrategyGhosts[i], 0);
+	}
+}
+
+/*
+ * StrategyGhostSlots -- number of entries in the ghost table
+ *
+ * The 2Q paper recommends remembering about half as many evicted pages as
+ * the buffer pool holds.  We round up to a power of 2 so that a hash code
+ * can be mapped to a slot with a mask.
+ */
+static uint32
+StrategyGhostSlots(void)
+{
+	return pg_nextpower2_32(Max(NBuffers / 2, 1));
+}
+
+/*
+ * StrategyInitialUsageCount -- usage count for a buffer that is about to be
+ *		assigned to the page whose buffer tag has the given hash code
+ *
+ * With the clock policy, every newly read page starts out with a usage count
+ * of 1, so that it survives at least one pass of the clock sweep.  That lets
+ * a large scan push out pages that are used over and over, because each page
+ * of the scan looks just as valuable as they do until the sweep comes round.
+ *
+ * The 2q policy instead admits new pages on probation, with a usage count of
+ * 0, so that a page which is read once and never touched again is the first
+ * thing the clock sweep evicts.  A page that is accessed again while it is
+ * still in the pool earns usage counts the normal way.  A page that was
+ * evicted recently and is now being read back is evidently part of a working
+ * set that didn't quite fit, so it is admitted as hot, with a usage count of
+ * 2.
+ */
+uint32
+StrategyInitialUsageCount(uint32 hashcode)
+{
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_CLOCK)
+		return 1;
+
+	if (hashcode != 0 &&
+		pg_atomic_read_u32(&StrategyGhosts[hashcode & StrategyGhostMask]) == hashcode)
+	{
+		pg_atomic_fetch_add_u64(&StrategyControl->numHotAdmissions, 1);
+		return 2;
+	}
+
+	pg_atomic_fetch_add_u64(&StrategyControl->numColdAdmissions, 1);
+	return 0;
+}
+
+/*
+ * StrategyNoteEviction -- note that the page whose buffer tag has the given
+ *		hash code has been evicted from the buffer pool
+ */
+void
+StrategyNoteEviction(uint32 hashcode)
+{
+	pg_atomic_fetch_add_u64(&StrategyControl->numEvictions, 1);
+
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+		pg_atomic_write_u32(&StrategyGhosts[hashcode & StrategyGhostMask],
+							hashcode);
+}
+
+/*
+ * StrategyReplacementStats -- report replacement policy statistics
+ */
+void
+StrategyReplacementStats(uint64 *cold_admissions, uint64 *hot_admissions,
+						 uint64 *evictions)
+{
+	*cold_admissions = pg_atomic_read_u64(&StrategyControl->numColdAdmissions);
+	*hot_admissions = pg_atomic_read_u64(&StrategyControl->numHotAdmissions);
+	*evictions = pg_atomic_read_u64(&StrategyControl->numEvictions);
 }
 
 
@@ -587,6 +708,22 @@ GetAccessStrategy(BufferAccessStrategyType btype)
 	return strategy;
 }
 
+/*
+ * GetAccessStrategyBufferCount -- number of buffers in a strategy's ring
+ *
+ * Returns 0 for the "default" strategy, which has no ring.  Callers that pin
+ * several buffers ahead of use (see read_stream.c) use this to avoid pinning
+ * more buffers than the ring can hold, which would defeat its purpose.
+ */
+int
+GetAccessStrategyBufferCount(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return 0;
+
+	return strategy->ring_size;
+}
+
 /*
  * FreeAccessStrategy -- release a BufferAccessStrategy object
  *
@@ -0,0 +1,379 @@
+/*-------------------------------------------------------------------------
+ *
+ * read_stream.c
+ *	  Mechanism for accessing buffered relation data with look-ahead
+ *
+ * Code that needs to access relation data typically pins one buffer at a
+ * time, which means that each cache miss stalls until a single BLCKSZ read
+ * completes.  A ReadStream instead asks a callback for the block numbers the
+ * caller will want next, and keeps a window of buffers pinned ahead of the
+ * consumer using StartReadBuffers().  Misses are handed to the kernel with
+ * smgrprefetch() as soon as they are pinned, and are only waited for with
+ * WaitReadBuffers() when the consumer actually reaches them.  Runs of
+ * consecutive block numbers, up to io_combine_limit blocks long, are combined
+ * into a single read operation, which bufmgr.c turns into one vectored read.
+ *
+ * The look-ahead distance adapts to what the stream finds: it starts at one
+ * block, doubles every time a read misses, and decays by one for every read
+ * that was satisfied from the buffer pool.  A fully cached scan therefore
+ * behaves much like a series of ReadBuffer() calls, while a scan that has to
+ * go to disk quickly ramps up to the maximum distance.  The maximum is
+ * derived from effective_io_concurrency (or the tablespace's setting), and
+ * is clamped so that we never pin more buffers than a BufferAccessStrategy
+ * ring can hold, or more than our fair share of shared buffers.
+ *
+ * Buffers are returned to the consumer in the same order the callback
+ * produced their block numbers; each returned buffer is pinned, and it is
+ * the caller's responsibility to release it.
+ *
+ * Note that this is look-ahead, not asynchronous I/O: every read is still
+ * performed synchronously by the backend itself, in WaitReadBuffers(), and
+ * there is no I/O worker process to hand it to.  What the stream buys is
+ * kernel read-ahead for the blocks it can see coming, and fewer, larger
+ * reads.  Callbacks are called when the stream wants another block, which can
+ * be well before the consumer gets to it, so any state that should follow
+ * the consumer's progress must be maintained on the consumer's side.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/read_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/read_stream.h"
+#include "utils/rel.h"
+#include "utils/spccache.h"
+
+/*
+ * A read that StartReadBuffers() reported has to be waited for, and the
+ * position in the buffer queue of its first buffer.
+ */
+typedef struct InProgressIO
+{
+	int16		buffer_index;
+	ReadBuffersOperation op;
+} InProgressIO;
+
+struct ReadStream
+{
+	int16		max_ios;
+	int16		ios_in_progress;
+	int16		queue_size;
+	int16		max_pinned_buffers;
+	int16		pinned_buffers;
+	int16		distance;		/* 0 means the callback has run dry */
+	int16		io_combine_limit;
+	bool		advice_enabled;
+
+	/*
+	 * Consecutive blocks that the callback has returned, but that we haven't
+	 * started reading yet.
+	 */
+	BlockNumber pending_read_blocknum;
+	int16		pending_read_nblocks;
+
+	/* The block following the last read we started, to detect sequential I/O */
+	BlockNumber seq_blocknum;
+
+	ReadStreamBlockNumberCB callback;
+	void	   *callback_private_data;
+
+	/* Circular queue of in-progress reads */
+	int16		oldest_io_index;
+	int16		next_io_index;
+	InProgressIO *ios;
+
+	/*
+	 * Circular queue of pinned buffers.  The array has room for
+	 * io_combine_limit - 1 extra entries after queue_size, because a
+	 * read is handed a contiguous slice of the array even when it wraps
+	 * around; the overflowing entries are then copied to the start.
+	 */
+	int16		oldest_buffer_index;
+	int16		next_buffer_index;
+	Buffer		buffers[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * Start reading the pending blocks.
+ */
+static void
+read_stream_start_pending_read(ReadStream *stream)
+{
+	int16		buffer_index = stream->next_buffer_index;
+	int16		io_index = stream->next_io_index;
+	int16		nblocks = stream->pending_read_nblocks;
+	int			flags = 0;
+	bool		need_wait;
+
+	Assert(nblocks > 0 && nblocks <= stream->io_combine_limit);
+	Assert(stream->ios_in_progress < stream->max_ios);
+	Assert(stream->pinned_buffers + nblocks <= stream->max_pinned_buffers);
+
+	/*
+	 * Advice is only useful if the consumer won't need these blocks
+	 * immediately, and the kernel's own read-ahead takes care of sequential
+	 * access patterns by itself.
+	 */
+	if (stream->advice_enabled &&
+		stream->pinned_buffers > 0 &&
+		stream->pending_read_blocknum != stream->seq_blocknum)
+		flags |= READ_BUFFERS_ISSUE_ADVICE;
+
+	need_wait = StartReadBuffers(&stream->ios[io_index].op,
+								 &stream->buffers[buffer_index],
+								 stream->pending_read_blocknum,
+								 nblocks,
+								 flags);
+	stream->pinned_buffers += nblocks;
+
+	if (need_wait)
+	{
+		/* Remember to call WaitReadBuffers() when we get to it */
+		stream->ios[io_index].buffer_index = buffer_index;
+		if (++stream->next_io_index == stream->max_ios)
+			stream->next_io_index = 0;
+		stream->ios_in_progress++;
+
+		/* Misses are expensive, so look further ahead */
+		stream->distance = Min(stream->distance * 2,
+							   stream->max_pinned_buffers);
+	}
+	else if (stream->distance > 1)
+	{
+		/* All hits; there's less point in looking far ahead */
+		stream->distance--;
+	}
+
+	/* Move any overflowing entries to the start of the queue */
+	if (buffer_index + nblocks > stream->queue_size)
+		memcpy(&stream->buffers[0],
+			   &stream->buffers[stream->queue_size],
+			   sizeof(Buffer) * (buffer_index + nblocks - stream->queue_size));
+
+	stream->next_buffer_index = (buffer_index + nblocks) % stream->queue_size;
+	stream->seq_blocknum = stream->pending_read_blocknum + nblocks;
+	stream->pending_read_nblocks = 0;
+}
+
+/*
+ * Pull block numbers from the callback and start reads until we are as far
+ * ahead of the consumer as the current distance allows.
+ */
+static void
+read_stream_look_ahead(ReadStream *stream)
+{
+	while (stream->ios_in_progress < stream->max_ios &&
+		   stream->pinned_buffers + stream->pending_read_nblocks < stream->distance)
+	{
+		BlockNumber blocknum;
+
+		/* If the pending read is as big as it can get, start it first */
+		if (stream->pending_read_nblocks == stream->io_combine_limit)
+		{
+			read_stream_start_pending_read(stream);
+			continue;
+		}
+
+		blocknum = stream->callback(stream, stream->callback_private_data);
+		if (blocknum == InvalidBlockNumber)
+		{
+			/* End of stream */
+			stream->distance = 0;
+			break;
+		}
+
+		/* Can we merge it with the pending read? */
+		if (stream->pending_read_nblocks > 0 &&
+			stream->pending_read_blocknum + stream->pending_read_nblocks == blocknum)
+		{
+			stream->pending_read_nblocks++;
+			continue;
+		}
+
+		/* We have to start the pending read before we can build another */
+		if (stream->pending_read_nblocks > 0)
+			read_stream_start_pending_read(stream);
+
+		stream->pending_read_blocknum = blocknum;
+		stream->pending_read_nblocks = 1;
+	}
+
+	/*
+	 * We can't grow the pending read any further, either because we're as
+	 * far ahead as we want to be or because the stream has ended, so start
+	 * it if we have a free I/O slot.  If we don't, one of the reads in
+	 * progress holds a pin, so the consumer will be back here after waiting
+	 * for it.
+	 */
+	if (stream->pending_read_nblocks > 0 &&
+		stream->ios_in_progress < stream->max_ios)
+		read_stream_start_pending_read(stream);
+}
+
+/*
+ * Create a new read stream for reading a fork of a relation.  The callback
+ * is called to obtain each block number to read, and returns
+ * InvalidBlockNumber at the end of the stream.
+ */
+ReadStream *
+read_stream_begin_relation(BufferAccessStrategy strategy,
+						   Relation rel,
+						   ForkNumber forknum,
+						   ReadStreamBlockNumberCB callback,
+						   void *callback_private_data)
+{
+	ReadStream *stream;
+	int			max_ios;
+	uint32		max_pinned_buffers;
+	int			strategy_buffers;
+	int16		queue_size;
+
+	/*
+	 * Decide how many reads we may have in progress at once.  Without any
+	 * I/O concurrency we still combine consecutive blocks, but only ever
+	 * work on one read at a time.
+	 */
+	max_ios = get_tablespace_io_concurrency(rel->rd_rel->reltablespace);
+
+	/*
+	 * Allow enough pinned buffers to keep that many reads going with a bit
+	 * of room to spare, but no more than a strategy ring can hold (or we'd
+	 * end up evicting our own buffers), and no more than our fair share of
+	 * the buffer pool.
+	 */
+	max_pinned_buffers = Max(max_ios * 4, io_combine_limit);
+	strategy_buffers = GetAccessStrategyBufferCount(strategy);
+	if (strategy_buffers > 0)
+		max_pinned_buffers = Min(max_pinned_buffers, strategy_buffers / 2);
+	max_pinned_buffers = Min(max_pinned_buffers, GetPinLimit());
+	max_pinned_buffers = Min(max_pinned_buffers, PG_INT16_MAX - MAX_IO_COMBINE_LIMIT);
+	max_pinned_buffers = Max(max_pinned_buffers, 1);
+
+	max_ios = Max(max_ios, 1);
+	max_ios = Min(max_ios, max_pinned_buffers);
+	queue_size = max_pinned_buffers + 1;
+
+	stream = (ReadStream *)
+		palloc0(offsetof(ReadStream, buffers) +
+				sizeof(Buffer) * (queue_size + io_combine_limit - 1));
+	stream->ios = (InProgressIO *) palloc0(sizeof(InProgressIO) * max_ios);
+
+#ifdef USE_PREFETCH
+	stream->advice_enabled =
+		get_tablespace_io_concurrency(rel->rd_rel->reltablespace) > 0;
+#endif
+
+	stream->max_ios = max_ios;
+	stream->io_combine_limit = io_combine_limit;
+	stream->queue_size = queue_size;
+	stream->max_pinned_buffers = max_pinned_buffers;
+	stream->distance = 1;
+	stream->seq_blocknum = InvalidBlockNumber;
+	stream->callback = callback;
+	stream->callback_private_data = callback_private_data;
+
+	for (int i = 0; i < max_ios; i++)
+	{
+		stream->ios[i].op.rel = rel;
+		stream->ios[i].op.forknum = forknum;
+		stream->ios[i].op.strategy = strategy;
+	}
+
+	return stream;
+}
+
+/*
+ * Return the next pinned buffer in the stream, or InvalidBuffer at its end.
+ * The caller is responsible for releasing the pin.
+ */
+Buffer
+read_stream_next_buffer(ReadStream *stream)
+{
+	Buffer		buffer;
+	int16		oldest_buffer_index;
+
+	if (stream->pinned_buffers == 0)
+	{
+		/* First call, or we've consumed everything we looked ahead at */
+		read_stream_look_ahead(stream);
+
+		if (stream->pinned_buffers == 0)
+		{
+			Assert(stream->distance == 0);
+			Assert(stream->pending_read_nblocks == 0);
+			return InvalidBuffer;
+		}
+	}
+
+	oldest_buffer_index = stream->oldest_buffer_index;
+
+	/* Do we have to finish the read that this buffer belongs to? */
+	if (stream->ios_in_progress > 0 &&
+		stream->ios[stream->oldest_io_index].buffer_index == oldest_buffer_index)
+	{
+		WaitReadBuffers(&stream->ios[stream->oldest_io_index].op);
+
+		if (++stream->oldest_io_index == stream->max_ios)
+			stream->oldest_io_index = 0;
+		stream->ios_in_progress--;
+	}
+
+	buffer = stream->buffers[oldest_buffer_index];
+	Assert(BufferIsValid(buffer));
+
+	/* Ownership of the pin passes to the caller */
+	stream->buffers[oldest_buffer_index] = InvalidBuffer;
+	stream->pinned_buffers--;
+	if (++stream->oldest_buffer_index == stream->queue_size)
+		stream->oldest_buffer_index = 0;
+
+	/* Keep the window of look-ahead buffers topped up */
+	read_stream_look_ahead(stream);
+
+	return buffer;
+}
+
+/*
+ * Release any buffers the stream has pinned ahead of the consumer, and begin
+ * again from the callback's current position with a minimal look-ahead
+ * distance.  Reads that were started but never waited for don't need to be
+ * finished: whoever wants those blocks next will read them in.
+ */
+void
+read_stream_reset(ReadStream *stream)
+{
+	while (stream->pinned_buffers > 0)
+	{
+		ReleaseBuffer(stream->buffers[stream->oldest_buffer_index]);
+		stream->buffers[stream->oldest_buffer_index] = InvalidBuffer;
+		stream->pinned_buffers--;
+		if (++stream->oldest_buffer_index == stream->queue_size)
+			stream->oldest_buffer_index = 0;
+	}
+
+	stream->oldest_buffer_index = stream->next_buffer_index = 0;
+	stream->oldest_io_index = stream->next_io_index = 0;
+	stream->ios_in_progress = 0;
+	stream->pending_read_nblocks = 0;
+	stream->seq_blocknum = InvalidBlockNumber;
+	stream->distance = 1;
+}
+
+/*
+ * Release resources held by a read stream, and free it.
+ */
+void
+read_stream_end(ReadStream *stream)
+{
+	read_stream_reset(stream);
+	pfree(stream->ios);
+	pfree(stream);
+}
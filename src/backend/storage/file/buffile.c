@@ -778,6 +778,85 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- initiate asynchronous read of blocks
+ *
+ * Asks the kernel to start reading the nblocks BLCKSZ-sized blocks starting
+ * at the n'th block of the file, so that reading them later is less likely
+ * to block.  This is only a hint: blocks past the end of the file are
+ * ignored, and so are errors.  The logical position is not moved.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum, int nblocks)
+{
+#ifdef USE_PREFETCH
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblock = blknum % BUFFILE_SEG_SIZE;
+		int			nthisfile;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		nthisfile = (int) Min(nblocks, BUFFILE_SEG_SIZE - segblock);
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblock * BLCKSZ,
+							nthisfile * BLCKSZ,
+							WAIT_EVENT_BUFFILE_PREFETCH);
+		blknum += nthisfile;
+		nblocks -= nthisfile;
+	}
+#endif
+}
+
+/*
+ * BufFileReadBlockPart --- read part of a block, bypassing the buffer
+ *
+ * Reads 'size' bytes starting 'offset' bytes into block 'blknum' straight
+ * into 'ptr'.  This is for callers that store less than a full block in some
+ * blocks, such as logtape.c when it compresses them, and don't want a whole
+ * bufferload to be read from the file for each of them.  The range must lie
+ * within the block.  Afterwards the position is just past the bytes read.
+ *
+ * Returns the number of bytes read, which is less than 'size' only at the
+ * end of the file.
+ */
+size_t
+BufFileReadBlockPart(BufFile *file, long blknum, int offset, void *ptr,
+					 size_t size)
+{
+	int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+	File		thisfile;
+	int			nread;
+
+	Assert(offset >= 0 && offset + size <= BLCKSZ);
+
+	/* Write out any dirty data, and forget whatever the buffer holds */
+	BufFileFlush(file);
+	if (fileno >= file->numFiles)
+		return 0;
+	file->curFile = fileno;
+	file->curOffset = (off_t) (blknum % BUFFILE_SEG_SIZE) * BLCKSZ + offset;
+	file->pos = 0;
+	file->nbytes = 0;
+
+	thisfile = file->files[fileno];
+	nread = FileRead(thisfile, ptr, size, file->curOffset,
+					 WAIT_EVENT_BUFFILE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(thisfile))));
+	file->curOffset += nread;
+
+	if (nread > 0)
+		pgBufferUsage.temp_blks_read++;
+
+	return nread;
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
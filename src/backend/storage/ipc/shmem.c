@@ -69,6 +69,7 @@
 #include "fmgr.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "port/pg_numa.h"
 #include "storage/lwlock.h"
 #include "storage/pg_shmem.h"
 #include "storage/shmem.h"
@@ -495,6 +496,52 @@ ShmemInitStruct(const char *name, Size size, bool *foundPtr)
 }
 
 
+/*
+ * ShmemInterleave -- spread a shared data structure across NUMA nodes.
+ *
+ *		When shared_memory_numa = interleave, the creator of a large structure
+ *		that is accessed evenly by all backends calls this before it first
+ *		touches the memory, so that its pages are placed round-robin on all
+ *		nodes instead of on the node of the process that happens to
+ *		initialize it.  Only whole pages within the range are affected.
+ *
+ *	Failure is not fatal: the structure just keeps the default placement.
+ */
+void
+ShmemInterleave(const char *name, void *ptr, Size size)
+{
+	Size		pagesize;
+	char	   *start;
+	char	   *end;
+
+	if (shared_memory_numa != SHMEM_NUMA_INTERLEAVE)
+		return;
+
+	/*
+	 * The kernel insists on ranges aligned to the page size of the mapping.
+	 * We don't know whether huge pages were actually obtained, but aligning
+	 * to the huge page size is harmless either way.
+	 */
+	pagesize = sysconf(_SC_PAGESIZE);
+	if (huge_pages != HUGE_PAGES_OFF)
+	{
+		Size		hugepagesize;
+
+		GetHugePageSize(&hugepagesize, NULL);
+		pagesize = Max(pagesize, hugepagesize);
+	}
+
+	start = (char *) TYPEALIGN(pagesize, ptr);
+	end = (char *) TYPEALIGN_DOWN(pagesize, (char *) ptr + size);
+	if (end <= start)
+		return;
+
+	if (pg_numa_interleave_memory(start, end - start) != 0)
+		ereport(WARNING,
+				(errmsg("could not interleave shared memory for \"%s\" across NUMA nodes: %m",
+						name)));
+}
+
 /*
  * Add two Size values, checking for overflow
  */
@@ -609,3 +656,151 @@ pg_get_shmem_allocations(PG_FUNCTION_ARGS)
 
 	return (Datum) 0;
 }
+
+/* number of pages to ask the kernel about at a time */
+#define SHMEM_NUMA_QUERY_PAGES	1024
+
+/*
+ * SQL SRF showing how allocated shared memory is spread across NUMA nodes
+ *
+ * For each named allocation, one row is returned per node that holds some of
+ * its pages, with sizes rounded out to whole pages.  The kernel only reports
+ * the node of pages that are mapped into the calling process, so we touch
+ * each page first; otherwise the result would depend on which parts of
+ * shared memory this particular backend happened to have used.  Pages whose
+ * node still can't be determined are reported with a NULL node number, as is
+ * every allocation if the platform doesn't support NUMA memory policies.
+ */
+Datum
+pg_get_shmem_allocations_numa(PG_FUNCTION_ARGS)
+{
+#define PG_GET_SHMEM_NUMA_COLS 3
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS hstat;
+	ShmemIndexEnt *ent;
+	int			max_node;
+	Size		os_page_size;
+	uint64	   *node_pages = NULL;
+	void	  **pages = NULL;
+	int		   *status = NULL;
+	Datum		values[PG_GET_SHMEM_NUMA_COLS];
+	bool		nulls[PG_GET_SHMEM_NUMA_COLS];
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	max_node = pg_numa_get_max_node();
+	os_page_size = sysconf(_SC_PAGESIZE);
+	if (max_node >= 0)
+	{
+		/* the extra element counts pages that have no node */
+		node_pages = palloc(sizeof(uint64) * (max_node + 2));
+		pages = palloc(sizeof(void *) * SHMEM_NUMA_QUERY_PAGES);
+		status = palloc(sizeof(int) * SHMEM_NUMA_QUERY_PAGES);
+	}
+
+	LWLockAcquire(ShmemIndexLock, LW_SHARED);
+
+	hash_seq_init(&hstat, ShmemIndex);
+
+	memset(nulls, 0, sizeof(nulls));
+	while ((ent = (ShmemIndexEnt *) hash_seq_search(&hstat)) != NULL)
+	{
+		char	   *startptr;
+		char	   *endptr;
+		uint64		npages;
+
+		values[0] = CStringGetTextDatum(ent->key);
+
+		if (max_node < 0)
+		{
+			values[1] = (Datum) 0;
+			nulls[1] = true;
+			values[2] = Int64GetDatum(ent->allocated_size);
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			continue;
+		}
+
+		startptr = (char *) TYPEALIGN_DOWN(os_page_size, ent->location);
+		endptr = (char *) TYPEALIGN(os_page_size,
+									(char *) ent->location + ent->allocated_size);
+		npages = (endptr - startptr) / os_page_size;
+
+		memset(node_pages, 0, sizeof(uint64) * (max_node + 2));
+		for (uint64 i = 0; i < npages; i += SHMEM_NUMA_QUERY_PAGES)
+		{
+			int			count = Min(npages - i, SHMEM_NUMA_QUERY_PAGES);
+
+			CHECK_FOR_INTERRUPTS();
+
+			for (int j = 0; j < count; j++)
+			{
+				pages[j] = startptr + (i + j) * os_page_size;
+
+				/* fault the page in, see above */
+				(void) *(volatile char *) pages[j];
+			}
+
+			if (pg_numa_query_pages(count, pages, status) != 0)
+				ereport(ERROR,
+						(errmsg("could not determine NUMA node of shared memory pages: %m")));
+
+			for (int j = 0; j < count; j++)
+			{
+				if (status[j] >= 0 && status[j] <= max_node)
+					node_pages[status[j]]++;
+				else
+					node_pages[max_node + 1]++;
+			}
+		}
+
+		for (int node = 0; node <= max_node + 1; node++)
+		{
+			if (node_pages[node] == 0)
+				continue;
+			if (node <= max_node)
+			{
+				values[1] = Int32GetDatum(node);
+				nulls[1] = false;
+			}
+			else
+			{
+				values[1] = (Datum) 0;
+				nulls[1] = true;
+			}
+			values[2] = Int64GetDatum(node_pages[node] * os_page_size);
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	LWLockRelease(ShmemIndexLock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
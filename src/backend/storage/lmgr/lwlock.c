@@ -176,7 +176,17 @@ static const char *const BuiltinTrancheNames[] = {
 	/* LWTRANCHE_PARALLEL_APPEND: */
 	"ParallelAppend",
 	/* LWTRANCHE_PER_XACT_PREDICATE_LIST: */
-	"PerXactPredicateList"
+	"PerXactPredicateList",
+	/* LWTRANCHE_SHARED_TIDSTORE: */
+	"SharedTidStore",
+	/* LWTRANCHE_VACUUM_DSA: */
+	"VacuumDSA",
+	/* LWTRANCHE_PGSTATS_DSA: */
+	"PgStatsDSA",
+	/* LWTRANCHE_PGSTATS_HASH: */
+	"PgStatsHash",
+	/* LWTRANCHE_PGSTATS_DATA: */
+	"PgStatsData"
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -87,6 +88,20 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/* GUC variable: open relation segments with O_DIRECT? */
+bool		data_direct_io = false;
+
+/*
+ * With data_direct_io, the kernel transfers data directly between the file
+ * and our buffers, and insists that the buffers be suitably aligned.  The
+ * buffer pools are, but some callers read or write pages in palloc'd or
+ * stack memory.  Such pages are copied through a bounce buffer instead.
+ */
+#define MD_NEEDS_BOUNCE(buffer) \
+	(data_direct_io && (uintptr_t) (buffer) % PG_IO_ALIGN_SIZE != 0)
+
+static char *md_bounce_buffer = NULL;
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rnode,xx_forknum,xx_segno) \
@@ -118,6 +133,20 @@ static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 #define EXTENSION_DONT_CHECK_SIZE	(1 << 4)
 
 
+/*
+ * Flags used to open relation segment files.
+ */
+static inline int
+_mdfd_open_flags(void)
+{
+	int			flags = O_RDWR | PG_BINARY;
+
+	if (data_direct_io)
+		flags |= PG_O_DIRECT;
+
+	return flags;
+}
+
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
 						 bool isRedo);
@@ -137,6 +166,8 @@ static MdfdVec *_mdfd_openseg(SMgrRelation reln, ForkNumber forkno,
 							  BlockNumber segno, int oflags);
 static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 							 BlockNumber blkno, bool skipFsync, int behavior);
+static char *_mdbouncebuffer(void);
+static int	_mdfd_skip_iovec(struct iovec *iov, int iovcnt, size_t nbytes);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
 
@@ -201,14 +232,14 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags() | O_CREAT | O_EXCL);
 
 	if (fd < 0)
 	{
 		int			save_errno = errno;
 
 		if (isRedo)
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+			fd = PathNameOpenFile(path, _mdfd_open_flags());
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -442,6 +473,9 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if (MD_NEEDS_BOUNCE(buffer))
+		buffer = memcpy(_mdbouncebuffer(), buffer, BLCKSZ);
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -488,7 +522,7 @@ mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags());
 
 	if (fd < 0)
 	{
@@ -568,7 +602,9 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ, WAIT_EVENT_DATA_FILE_PREFETCH);
+	/* Read-ahead into the kernel's page cache is of no use to direct I/O */
+	if (!data_direct_io)
+		(void) FilePrefetch(v->mdfd_vfd, seekpos, BLCKSZ, WAIT_EVENT_DATA_FILE_PREFETCH);
 #endif							/* USE_PREFETCH */
 
 	return true;
@@ -650,7 +686,15 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+	if (MD_NEEDS_BOUNCE(buffer))
+	{
+		nbytes = FileRead(v->mdfd_vfd, _mdbouncebuffer(), BLCKSZ, seekpos,
+						  WAIT_EVENT_DATA_FILE_READ);
+		if (nbytes > 0)
+			memcpy(buffer, md_bounce_buffer, nbytes);
+	}
+	else
+		nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -687,6 +731,131 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read the specified range of consecutive blocks from a
+ *				 relation.
+ *
+ *		The range may cross segment boundaries, in which case a separate
+ *		vectored read is issued for each segment.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		void **buffers, BlockNumber nblocks)
+{
+	/* Fall back to reading block by block if we need to bounce any of them */
+	if (data_direct_io)
+	{
+		for (BlockNumber i = 0; i < nblocks; i++)
+		{
+			if (MD_NEEDS_BOUNCE(buffers[i]))
+			{
+				for (i = 0; i < nblocks; i++)
+					mdread(reln, forknum, blocknum + i, buffers[i]);
+				return;
+			}
+		}
+	}
+
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		ssize_t		nbytes;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+		size_t		size_this_segment;
+		size_t		transferred_this_segment;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, lengthof(iov));
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
+
+		/* Keep reading until we have the whole range, or hit EOF */
+		for (;;)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend);
+
+			nbytes = FileReadV(v->mdfd_vfd, iov, iovcnt,
+							   seekpos + transferred_this_segment,
+							   WAIT_EVENT_DATA_FILE_READ);
+
+			TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
+											   reln->smgr_rnode.node.spcNode,
+											   reln->smgr_rnode.node.dbNode,
+											   reln->smgr_rnode.node.relNode,
+											   reln->smgr_rnode.backend,
+											   nbytes,
+											   size_this_segment - transferred_this_segment);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			if (nbytes == 0)
+			{
+				BlockNumber first_short;
+
+				/*
+				 * We are at or past EOF.  As in mdread(), this is an error
+				 * unless zero_damaged_pages is ON or we are InRecovery, in
+				 * which case the missing blocks (including any partially
+				 * read one) read as zeroes.
+				 */
+				if (!(zero_damaged_pages || InRecovery))
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("could not read blocks %u..%u in file \"%s\": read only %zu of %zu bytes",
+									blocknum,
+									blocknum + nblocks_this_segment - 1,
+									FilePathName(v->mdfd_vfd),
+									transferred_this_segment,
+									size_this_segment)));
+
+				first_short = transferred_this_segment / BLCKSZ;
+				for (BlockNumber i = first_short; i < nblocks_this_segment; i++)
+					MemSet(buffers[i], 0, BLCKSZ);
+				break;
+			}
+
+			transferred_this_segment += nbytes;
+			if (transferred_this_segment == size_this_segment)
+				break;
+
+			/* Short read; skip over the part of the iovec we've filled */
+			iovcnt = _mdfd_skip_iovec(iov, iovcnt, nbytes);
+		}
+
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -720,6 +889,9 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
+	if (MD_NEEDS_BOUNCE(buffer))
+		buffer = memcpy(_mdbouncebuffer(), buffer, BLCKSZ);
+
 	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
@@ -751,6 +923,129 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwritev() -- Write the supplied range of consecutive blocks at the
+ *				  appropriate location.
+ *
+ *		As with mdwrite(), the blocks must already exist.  The range may
+ *		cross segment boundaries, in which case a separate vectored write is
+ *		issued for each segment.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 const void **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	/* Fall back to writing block by block if we need to bounce any of them */
+	if (data_direct_io)
+	{
+		for (BlockNumber i = 0; i < nblocks; i++)
+		{
+			if (MD_NEEDS_BOUNCE(buffers[i]))
+			{
+				for (i = 0; i < nblocks; i++)
+					mdwrite(reln, forknum, blocknum + i,
+							(char *) buffers[i], skipFsync);
+				return;
+			}
+		}
+	}
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum + nblocks <= mdnblocks(reln, forknum));
+#endif
+
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		ssize_t		nbytes;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+		size_t		size_this_segment;
+		size_t		transferred_this_segment;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, lengthof(iov));
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			iov[iovcnt].iov_base = unconstify(void *, buffers[iovcnt]);
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+		size_this_segment = (size_t) nblocks_this_segment * BLCKSZ;
+		transferred_this_segment = 0;
+
+		/* Keep writing until the whole range is written */
+		for (;;)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum,
+												 reln->smgr_rnode.node.spcNode,
+												 reln->smgr_rnode.node.dbNode,
+												 reln->smgr_rnode.node.relNode,
+												 reln->smgr_rnode.backend);
+
+			nbytes = FileWriteV(v->mdfd_vfd, iov, iovcnt,
+								seekpos + transferred_this_segment,
+								WAIT_EVENT_DATA_FILE_WRITE);
+
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend,
+												nbytes,
+												size_this_segment - transferred_this_segment);
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write blocks %u..%u in file \"%s\": %m",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			if (nbytes == 0)
+			{
+				/* short write with no progress: complain appropriately */
+				ereport(ERROR,
+						(errcode(ERRCODE_DISK_FULL),
+						 errmsg("could not write blocks %u..%u in file \"%s\": wrote only %zu of %zu bytes",
+								blocknum,
+								blocknum + nblocks_this_segment - 1,
+								FilePathName(v->mdfd_vfd),
+								transferred_this_segment,
+								size_this_segment),
+						 errhint("Check free disk space.")));
+			}
+
+			transferred_this_segment += nbytes;
+			if (transferred_this_segment == size_this_segment)
+				break;
+
+			/* Short write; skip over the part of the iovec we've written */
+			iovcnt = _mdfd_skip_iovec(iov, iovcnt, nbytes);
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		nblocks -= nblocks_this_segment;
+		buffers += nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -1112,6 +1407,43 @@ _fdvec_resize(SMgrRelation reln,
 	reln->md_num_open_segs[forknum] = nseg;
 }
 
+/*
+ * Return the bounce buffer used for direct I/O on unaligned pages,
+ * allocating it on first use.
+ */
+static char *
+_mdbouncebuffer(void)
+{
+	if (md_bounce_buffer == NULL)
+		md_bounce_buffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 BLCKSZ + PG_IO_ALIGN_SIZE));
+	return md_bounce_buffer;
+}
+
+/*
+ * Advance an iovec array past the first nbytes bytes, after a partial read
+ * or write.  Returns the new number of entries.
+ */
+static int
+_mdfd_skip_iovec(struct iovec *iov, int iovcnt, size_t nbytes)
+{
+	while (iovcnt > 0 && nbytes >= iov[0].iov_len)
+	{
+		nbytes -= iov[0].iov_len;
+		memmove(&iov[0], &iov[1], sizeof(struct iovec) * --iovcnt);
+	}
+	if (nbytes > 0)
+	{
+		Assert(iovcnt > 0);
+		iov[0].iov_base = (char *) iov[0].iov_base + nbytes;
+		iov[0].iov_len -= nbytes;
+	}
+
+	return iovcnt;
+}
+
 /*
  * Return the filename for the specified segment of the relation. The
  * returned string is palloc'd.
@@ -1150,7 +1482,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags);
+	fd = PathNameOpenFile(fullpath, _mdfd_open_flags() | oflags);
 
 	pfree(fullpath);
 
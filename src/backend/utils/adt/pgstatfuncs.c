@@ -1,7 +1,7 @@
 /*-------------------------------------------------------------------------
  *
  * pgstatfuncs.c
- *	  Functions for accessing the statistics collector data
+ *	  Functions for accessing the cumulative statistics
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -25,6 +25,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
+#include "storage/bufmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
@@ -1796,6 +1797,61 @@ pg_stat_get_buf_alloc(PG_FUNCTION_ARGS)
 	PG_RETURN_INT64(pgstat_fetch_stat_bgwriter()->buf_alloc);
 }
 
+/*
+ * Returns the shared buffer replacement policy in effect, and how many pages
+ * it has admitted and evicted since server start.
+ */
+Datum
+pg_stat_get_buffer_replacement(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BUFFER_REPLACEMENT_COLS	4
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_BUFFER_REPLACEMENT_COLS];
+	bool		nulls[PG_STAT_GET_BUFFER_REPLACEMENT_COLS];
+	const char *policy;
+	uint64		cold_admissions;
+	uint64		hot_admissions;
+	uint64		evictions;
+
+	/* Initialise values and NULL flags arrays */
+	MemSet(values, 0, sizeof(values));
+	MemSet(nulls, 0, sizeof(nulls));
+
+	/* Initialise attributes information in the tuple descriptor */
+	tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_BUFFER_REPLACEMENT_COLS);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "policy",
+					   TEXTOID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "cold_admissions",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "hot_admissions",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "evictions",
+					   INT8OID, -1, 0);
+
+	BlessTupleDesc(tupdesc);
+
+	switch (buffer_replacement_policy)
+	{
+		case BUFFER_REPLACEMENT_2Q:
+			policy = "2q";
+			break;
+		default:
+			policy = "clock";
+			break;
+	}
+
+	StrategyReplacementStats(&cold_admissions, &hot_admissions, &evictions);
+
+	/* Fill values and NULLs */
+	values[0] = CStringGetTextDatum(policy);
+	values[1] = Int64GetDatum(cold_admissions);
+	values[2] = Int64GetDatum(hot_admissions);
+	values[3] = Int64GetDatum(evictions);
+
+	/* Returns the record as Datum */
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * Returns statistics of WAL activity
  */
@@ -649,6 +649,13 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 		/* Reset CurrentResourceOwner to nothing for the moment */
 		CurrentResourceOwner = NULL;
 
+		/*
+		 * Write out the statistics at exit, like the checkpointer does under
+		 * a postmaster.  This is registered first so that it runs after the
+		 * shutdown checkpoint.
+		 */
+		before_shmem_exit(pgstat_before_server_shutdown, 0);
+
 		/*
 		 * Use before_shmem_exit() so that ShutdownXLOG() can rely on DSM
 		 * segments etc to work (which in turn is required for pgstats).
@@ -46,7 +46,19 @@
  *
  * To further make the I/Os more sequential, we can use a larger buffer
  * when reading, and read multiple blocks from the same tape in one go,
- * whenever the buffer becomes empty.
+ * whenever the buffer becomes empty.  After each such refill, we ask the
+ * kernel to start reading the blocks that the next refill is likely to want,
+ * so that merging many tapes doesn't stall on one synchronous read after
+ * another.
+ *
+ * If temp_file_compression is set, each block is compressed before it is
+ * written.  A compressed block still occupies a BLCKSZ slot of the
+ * underlying file, so block numbers and space recycling work just as before,
+ * but only the compressed bytes are written, and they are read back with
+ * BufFileReadBlockPart() rather than through the BufFile's own buffer, which
+ * would read the whole slot.  The file doesn't get any smaller (except where
+ * the filesystem doesn't allocate the unwritten rest of each slot), but the
+ * amount of data written and read can be reduced considerably.
  *
  * To support the above policy of writing to the lowest free block, the
  * freelist is a min heap.
@@ -79,12 +91,20 @@
 
 #include <fcntl.h>
 
+#include "common/pg_lzcompress.h"
 #include "storage/buffile.h"
 #include "utils/builtins.h"
 #include "utils/logtape.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+/* GUC variable */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_NONE;
+
 /*
  * A TapeBlockTrailer is stored at the end of each BLCKSZ block.
  *
@@ -111,6 +131,25 @@ typedef struct TapeBlockTrailer
 #define TapeBlockSetNBytes(buf, nbytes) \
 	(TapeBlockGetTrailer(buf)->next = -(nbytes))
 
+/*
+ * In a tape set that compresses its blocks, a block is stored in its slot of
+ * the underlying file either compressed, following a TapeBlockCompressHeader,
+ * or, if compression didn't make it any smaller, uncompressed but with its
+ * trailer moved to the front.  The two are told apart by the first field,
+ * since a trailer's 'prev' is never less than -1.  The rest of the slot is
+ * neither written nor read.
+ */
+typedef struct TapeBlockCompressHeader
+{
+	long		method;			/* TAPE_BLOCK_PGLZ or TAPE_BLOCK_LZ4 */
+	long		len;			/* # of compressed bytes that follow */
+} TapeBlockCompressHeader;
+
+#define TAPE_BLOCK_PGLZ		(-2L)
+#define TAPE_BLOCK_LZ4		(-3L)
+
+#define TapeBlockMaxCompressedSize (BLCKSZ - sizeof(TapeBlockCompressHeader))
+
 /*
  * When multiple tapes are being written to concurrently (as in HashAgg),
  * avoid excessive fragmentation by preallocating block numbers to individual
@@ -217,11 +256,34 @@ struct LogicalTapeSet
 	long		nFreeBlocks;	/* # of currently free blocks */
 	Size		freeBlocksLen;	/* current allocated length of freeBlocks[] */
 	bool		enable_prealloc;	/* preallocate write blocks? */
+
+	/*
+	 * Compression of the blocks in the underlying file, and a scratch buffer
+	 * to compress them into and decompress them from.  This is fixed when the
+	 * tape set is created; a leader importing worker tapes relies on the
+	 * workers having used the same temp_file_compression setting, which
+	 * parallel workers always do.
+	 */
+	int			compression;	/* a TempFileCompression value */
+	char	   *compressbuf;
+
+	/*
+	 * For each block we wrote with compression, the number of bytes stored
+	 * in its slot, so that reading it back takes a single read of just those
+	 * bytes.  Zero means unknown, as for blocks imported from workers; then
+	 * we have to read the block's header first.
+	 */
+	uint16	   *storedLens;
+	long		storedLensLen;	/* allocated length of storedLens[] */
 };
 
 static LogicalTape *ltsCreateTape(LogicalTapeSet *lts);
 static void ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
+static void ltsWriteCompressedBlock(LogicalTapeSet *lts, long blocknum,
+									void *buffer);
 static void ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer);
+static void ltsReadCompressedBlock(LogicalTapeSet *lts, long blocknum,
+								   void *buffer);
 static long ltsGetBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
 static long ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt);
@@ -265,13 +327,87 @@ ltsWriteBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 				(errcode_for_file_access(),
 				 errmsg("could not seek to block %ld of temporary file",
 						blocknum)));
-	BufFileWrite(lts->pfile, buffer, BLCKSZ);
+	if (lts->compression == TEMP_FILE_COMPRESSION_NONE)
+		BufFileWrite(lts->pfile, buffer, BLCKSZ);
+	else
+		ltsWriteCompressedBlock(lts, blocknum, buffer);
 
 	/* Update nBlocksWritten, if we extended the file */
 	if (blocknum == lts->nBlocksWritten)
 		lts->nBlocksWritten++;
 }
 
+/*
+ * Compress a block-sized buffer and write it at the current position of the
+ * underlying file, which is the start of the given block, or write it
+ * uncompressed if that doesn't save space.
+ */
+static void
+ltsWriteCompressedBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
+{
+	TapeBlockCompressHeader *hdr = (TapeBlockCompressHeader *) lts->compressbuf;
+	char	   *dest = lts->compressbuf + sizeof(TapeBlockCompressHeader);
+	int32		len = -1;
+
+	switch ((TempFileCompression) lts->compression)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			len = pglz_compress(buffer, BLCKSZ, dest, PGLZ_strategy_default);
+			hdr->method = TAPE_BLOCK_PGLZ;
+			break;
+
+		case TEMP_FILE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(buffer, dest, BLCKSZ,
+									   TapeBlockMaxCompressedSize);
+			if (len <= 0)
+				len = -1;		/* failure */
+			hdr->method = TAPE_BLOCK_LZ4;
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case TEMP_FILE_COMPRESSION_NONE:
+			Assert(false);		/* cannot happen */
+			break;
+			/* no default case, so that compiler will warn */
+	}
+
+	if (len >= 0 && len <= TapeBlockMaxCompressedSize)
+	{
+		hdr->len = len;
+		len += sizeof(TapeBlockCompressHeader);
+		BufFileWrite(lts->pfile, lts->compressbuf, len);
+	}
+	else
+	{
+		BufFileWrite(lts->pfile, TapeBlockGetTrailer(buffer),
+					 sizeof(TapeBlockTrailer));
+		BufFileWrite(lts->pfile, buffer, TapeBlockPayloadSize);
+		len = BLCKSZ;
+	}
+
+	/* Remember how much to read back */
+	if (blocknum >= lts->storedLensLen)
+	{
+		long		newlen = Max(lts->storedLensLen * 2, blocknum + 1);
+
+		newlen = Max(newlen, 64);
+		if (lts->storedLens == NULL)
+			lts->storedLens = palloc0(newlen * sizeof(uint16));
+		else
+		{
+			lts->storedLens = repalloc(lts->storedLens,
+									   newlen * sizeof(uint16));
+			memset(lts->storedLens + lts->storedLensLen, 0,
+				   (newlen - lts->storedLensLen) * sizeof(uint16));
+		}
+		lts->storedLensLen = newlen;
+	}
+	lts->storedLens[blocknum] = (uint16) len;
+}
+
 /*
  * Read a block-sized buffer from the specified block of the underlying file.
  *
@@ -283,6 +419,12 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 {
 	size_t		nread;
 
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+	{
+		ltsReadCompressedBlock(lts, blocknum, buffer);
+		return;
+	}
+
 	if (BufFileSeekBlock(lts->pfile, blocknum) != 0)
 		ereport(ERROR,
 				(errcode_for_file_access(),
@@ -296,6 +438,103 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 						blocknum, nread, (size_t) BLCKSZ)));
 }
 
+/*
+ * Read a block written by ltsWriteCompressedBlock(), and decompress it into
+ * a block-sized buffer.  Only the bytes stored in the block's slot are read.
+ */
+static void
+ltsReadCompressedBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
+{
+	TapeBlockCompressHeader *hdr = (TapeBlockCompressHeader *) lts->compressbuf;
+	size_t		hdrlen = sizeof(TapeBlockCompressHeader);
+	size_t		stored = 0;
+	size_t		nread;
+	size_t		len;
+	int32		rawlen = -1;
+
+	StaticAssertStmt(sizeof(TapeBlockCompressHeader) == sizeof(TapeBlockTrailer),
+					 "compressed block header must be the size of a block trailer");
+
+	if (blocknum < lts->storedLensLen)
+		stored = lts->storedLens[blocknum];
+
+	/* If we don't know how much is stored, the header tells us */
+	if (stored == 0)
+	{
+		nread = BufFileReadBlockPart(lts->pfile, blocknum, 0, hdr, hdrlen);
+		if (nread != hdrlen)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read block %ld of temporary file: read only %zu of %zu bytes",
+							blocknum, nread, hdrlen)));
+		if (hdr->method >= -1L)
+			stored = BLCKSZ;
+		else if (hdr->len >= 0 && hdr->len <= TapeBlockMaxCompressedSize)
+			stored = hdrlen + hdr->len;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("invalid compressed length %ld in block %ld of temporary file",
+									 hdr->len, blocknum)));
+		nread = hdrlen;
+	}
+	else
+		nread = 0;
+
+	len = stored - nread;
+	if (BufFileReadBlockPart(lts->pfile, blocknum, (int) nread,
+							 lts->compressbuf + nread, len) != len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read block %ld of temporary file: read only part of %zu bytes",
+						blocknum, stored)));
+
+	if (hdr->method >= -1L)
+	{
+		/* stored uncompressed, trailer first */
+		if (stored != BLCKSZ)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("invalid uncompressed block %ld in temporary file",
+									 blocknum)));
+		memcpy(TapeBlockGetTrailer(buffer), lts->compressbuf,
+			   sizeof(TapeBlockTrailer));
+		memcpy(buffer, lts->compressbuf + sizeof(TapeBlockTrailer),
+			   TapeBlockPayloadSize);
+		return;
+	}
+
+	len = stored - hdrlen;
+	if (hdr->len != (long) len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("invalid compressed length %ld in block %ld of temporary file",
+								 hdr->len, blocknum)));
+
+	switch (hdr->method)
+	{
+		case TAPE_BLOCK_PGLZ:
+			rawlen = pglz_decompress(lts->compressbuf + hdrlen, (int32) len,
+									 buffer, BLCKSZ, true);
+			break;
+
+		case TAPE_BLOCK_LZ4:
+#ifdef USE_LZ4
+			rawlen = LZ4_decompress_safe(lts->compressbuf + hdrlen, buffer,
+										 (int) len, BLCKSZ);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+	}
+
+	if (rawlen != BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress block %ld of temporary file",
+								 blocknum)));
+}
+
 /*
  * Read as many blocks as we can into the per-tape buffer.
  *
@@ -304,6 +543,8 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 static bool
 ltsReadFillBuffer(LogicalTape *lt)
 {
+	bool		consecutive = true;
+
 	lt->pos = 0;
 	lt->nbytes = 0;
 
@@ -334,9 +575,24 @@ ltsReadFillBuffer(LogicalTape *lt)
 		else
 			lt->nextBlockNumber = TapeBlockGetTrailer(thisbuf)->next;
 
+		if (lt->nextBlockNumber != lt->curBlockNumber + 1)
+			consecutive = false;
+
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/*
+	 * Start reading ahead for the next refill while the caller consumes this
+	 * one.  We only know for sure where the next block is, but tapes are
+	 * mostly written to runs of consecutive blocks, so if that's what we just
+	 * read, guess that a whole buffer's worth of blocks follows.  Frozen tapes
+	 * are read a block at a time, often randomly, so don't bother for them.
+	 */
+	if (!lt->frozen && lt->nextBlockNumber != -1L)
+		BufFilePrefetchBlock(lt->tapeSet->pfile,
+							 lt->nextBlockNumber + lt->offsetBlockNumber,
+							 consecutive ? lt->buffer_size / BLCKSZ : 1);
+
 	return (lt->nbytes > 0);
 }
 
@@ -578,6 +834,14 @@ LogicalTapeSetCreate(bool preallocate, SharedFileSet *fileset, int worker)
 	lts->freeBlocks = (long *) palloc(lts->freeBlocksLen * sizeof(long));
 	lts->nFreeBlocks = 0;
 	lts->enable_prealloc = preallocate;
+	lts->compression = temp_file_compression;
+	if (lts->compression != TEMP_FILE_COMPRESSION_NONE)
+		lts->compressbuf = palloc(sizeof(TapeBlockCompressHeader) +
+								  PGLZ_MAX_OUTPUT(BLCKSZ));
+	else
+		lts->compressbuf = NULL;
+	lts->storedLens = NULL;
+	lts->storedLensLen = 0;
 
 	lts->fileset = fileset;
 	lts->worker = worker;
@@ -647,9 +911,13 @@ LogicalTapeImport(LogicalTapeSet *lts, int worker, TapeShare *shared)
 	{
 		lt->offsetBlockNumber = BufFileAppend(lts->pfile, file);
 	}
-	/* Don't allocate more for read buffer than could possibly help */
-	lt->max_size = Min(MaxAllocSize, filesize);
-	tapeblocks = filesize / BLCKSZ;
+	/*
+	 * The last block of a file with compressed blocks may not fill its slot,
+	 * so round up.  Don't allocate more for read buffer than could possibly
+	 * help.
+	 */
+	tapeblocks = (filesize + BLCKSZ - 1) / BLCKSZ;
+	lt->max_size = Min(MaxAllocSize, tapeblocks * BLCKSZ);
 
 	/*
 	 * Update # of allocated blocks and # blocks written to reflect the
@@ -677,6 +945,10 @@ LogicalTapeSetClose(LogicalTapeSet *lts)
 {
 	BufFileClose(lts->pfile);
 	pfree(lts->freeBlocks);
+	if (lts->compressbuf)
+		pfree(lts->compressbuf);
+	if (lts->storedLens)
+		pfree(lts->storedLens);
 	pfree(lts);
 }
 
@@ -86,6 +86,55 @@ PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup)
 	ssup->comparator = comparison_shim;
 }
 
+/*
+ * Shared comparators for datatypes whose sort order is plain integer order
+ * of the Datum itself.
+ *
+ * Opclasses should use these in preference to private equivalents where they
+ * apply (including as the comparator for abbreviated keys), since tuplesort.c
+ * recognizes them and can then sort by radix rather than by comparisons.
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+
 /*
  * Look up and call sortsupport function to setup SortSupport comparator;
  * or if no such function exists or it declines to set up the appropriate
@@ -109,6 +109,7 @@
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "port/pg_bitutils.h"
 #include "utils/datum.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
@@ -139,6 +140,14 @@
 #define INITIAL_MEMTUPSIZE Max(1024, \
 	ALLOCSET_SEPARATE_THRESHOLD / sizeof(SortTuple) + 1)
 
+/*
+ * Radix sort is only worth its per-pass overhead for larger inputs; below
+ * RADIX_SORT_MIN_TUPLES we don't try it at all, and buckets smaller than
+ * RADIX_SORT_MIN_BUCKET are finished off with quicksort.
+ */
+#define RADIX_SORT_MIN_TUPLES	1024
+#define RADIX_SORT_MIN_BUCKET	64
+
 /* GUC variables */
 #ifdef TRACE_SORT
 bool		trace_sort = false;
@@ -186,6 +195,25 @@ typedef struct
 	int			srctape;		/* source tape number */
 } SortTuple;
 
+/*
+ * How to turn a non-NULL datum1 into an unsigned integer for radix sorting,
+ * chosen according to which of the shared sortsupport.c comparators the
+ * leading key uses.
+ */
+typedef enum
+{
+	RADIX_KEY_UNSIGNED,			/* ssup_datum_unsigned_cmp */
+	RADIX_KEY_SIGNED,			/* ssup_datum_signed_cmp */
+	RADIX_KEY_INT32				/* ssup_datum_int32_cmp */
+} RadixKeyKind;
+
+typedef struct
+{
+	RadixKeyKind kind;
+	bool		reverse;		/* DESC sort, so complement the key? */
+	bool		tiebreak;		/* do equal keys need further comparison? */
+} RadixSortInfo;
+
 /*
  * During merge, we use a pre-allocated set of fixed-size slots to hold
  * tuples.  To avoid palloc/pfree overhead.
@@ -623,6 +651,10 @@ static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static void tuplesort_qsort(Tuplesortstate *state, SortTuple *tuples, int n);
+static bool tuplesort_radix_sort(Tuplesortstate *state);
+static void radix_sort_tuple(Tuplesortstate *state, RadixSortInfo *info,
+							 SortTuple *tuples, int n, int byte);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
@@ -3503,15 +3535,252 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
-		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
-			qsort_ssup(state->memtuples, state->memtupcount,
-					   state->onlyKey);
+		if (!tuplesort_radix_sort(state))
+			tuplesort_qsort(state, state->memtuples, state->memtupcount);
+	}
+}
+
+/*
+ * Sort an array of SortTuples by comparisons.
+ */
+static void
+tuplesort_qsort(Tuplesortstate *state, SortTuple *tuples, int n)
+{
+	/* Can we use the single-key sort function? */
+	if (state->onlyKey != NULL)
+		qsort_ssup(tuples, n, state->onlyKey);
+	else
+		qsort_tuple(tuples, n, state->comparetup, state);
+}
+
+/*
+ * Map the non-NULL datum1 of a SortTuple to an unsigned integer whose
+ * ordering is the sort order of the leading key, reverse sorts included.
+ */
+static inline uint64
+radix_sort_key(RadixSortInfo *info, Datum datum)
+{
+	uint64		key;
+
+	switch (info->kind)
+	{
+		case RADIX_KEY_SIGNED:
+			/* flip the sign bit so that negative values sort first */
+			key = ((uint64) datum) ^ (UINT64CONST(1) << 63);
+			break;
+		case RADIX_KEY_INT32:
+			key = ((uint32) DatumGetInt32(datum)) ^ ((uint32) 1 << 31);
+			break;
+		default:
+			key = (uint64) datum;
+			break;
+	}
+
+	return info->reverse ? ~key : key;
+}
+
+/* the given byte of the radix sort key of a SortTuple */
+#define RADIX_DIGIT(info, stup, byte) \
+	((int) ((radix_sort_key(info, (stup)->datum1) >> ((byte) * BITS_PER_BYTE)) & 0xFF))
+
+/*
+ * Try to sort memtuples by radix sort.  Returns false if the leading key
+ * doesn't allow it, in which case the caller must use a comparison sort.
+ *
+ * This works when the leading key's comparator is one of the shared integer
+ * comparators in sortsupport.c, because then the order of datum1 values is
+ * just the order of integers we can derive from them.  That includes
+ * abbreviated keys (unless abbreviation was aborted, in which case the
+ * comparator has been switched back to the authoritative one).  Tuples whose
+ * datum1 values are equal still have to be compared to each other if there
+ * are further sort keys or datum1 is abbreviated; we do that with the usual
+ * comparison sort, one group of equal leading keys at a time.
+ */
+static bool
+tuplesort_radix_sort(Tuplesortstate *state)
+{
+	SortSupport ssup = state->sortKeys;
+	SortTuple  *memtuples = state->memtuples;
+	int			n = state->memtupcount;
+	RadixSortInfo info;
+	SortTuple  *nonnull;
+	int			nnonnull;
+	int			nnulls;
+	int			nfront;
+	uint64		first;
+	uint64		diff;
+	int			i;
+
+	if (ssup == NULL || n < RADIX_SORT_MIN_TUPLES)
+		return false;
+
+	/*
+	 * CLUSTER doesn't fill in datum1 at all if the leading index column is an
+	 * expression (see copytup_cluster), so there's nothing to sort on.
+	 */
+	if (state->indexInfo != NULL &&
+		state->indexInfo->ii_IndexAttrNumbers[0] == 0)
+		return false;
+
+	if (ssup->comparator == ssup_datum_unsigned_cmp)
+		info.kind = RADIX_KEY_UNSIGNED;
+#if SIZEOF_DATUM >= 8
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+		info.kind = RADIX_KEY_SIGNED;
+#endif
+	else if (ssup->comparator == ssup_datum_int32_cmp)
+		info.kind = RADIX_KEY_INT32;
+	else
+		return false;
+	info.reverse = ssup->ssup_reverse;
+	info.tiebreak = (state->onlyKey == NULL);
+
+	/*
+	 * Move the tuples that sort first, according to whether their leading
+	 * key is NULL, to the front of the array.
+	 */
+	nfront = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (memtuples[i].isnull1 == ssup->ssup_nulls_first)
+		{
+			SortTuple	tmp = memtuples[nfront];
+
+			memtuples[nfront++] = memtuples[i];
+			memtuples[i] = tmp;
+		}
+	}
+	if (ssup->ssup_nulls_first)
+	{
+		nnulls = nfront;
+		nonnull = memtuples + nnulls;
+		nnonnull = n - nnulls;
+	}
+	else
+	{
+		nnulls = n - nfront;
+		nonnull = memtuples;
+		nnonnull = nfront;
+	}
+
+	/* NULLs are all equal as far as the leading key is concerned */
+	if (info.tiebreak && nnulls > 1)
+		tuplesort_qsort(state,
+						ssup->ssup_nulls_first ? memtuples : memtuples + nnonnull,
+						nnulls);
+
+	if (nnonnull < 2)
+		return true;
+
+	/*
+	 * Start at the most significant byte in which the keys differ at all, so
+	 * that (say) int8 keys with small values don't cost us eight passes.
+	 */
+	first = radix_sort_key(&info, nonnull[0].datum1);
+	diff = 0;
+	for (i = 1; i < nnonnull; i++)
+		diff |= radix_sort_key(&info, nonnull[i].datum1) ^ first;
+
+	if (diff == 0)
+	{
+		if (info.tiebreak)
+			tuplesort_qsort(state, nonnull, nnonnull);
+	}
+	else
+		radix_sort_tuple(state, &info, nonnull, nnonnull,
+						 pg_leftmost_one_pos64(diff) / BITS_PER_BYTE);
+
+	return true;
+}
+
+/*
+ * In-place most-significant-digit radix sort ("American flag sort") of
+ * non-NULL SortTuples, which are already known to agree in all bytes of
+ * their keys above "byte".
+ */
+static void
+radix_sort_tuple(Tuplesortstate *state, RadixSortInfo *info,
+				 SortTuple *tuples, int n, int byte)
+{
+	int			counts[256];
+	int			next[256];
+	int			ends[256];
+	int			pos;
+	int			i;
+	int			d;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Count the tuples falling in each bucket, skipping unhelpful bytes */
+	for (;;)
+	{
+		memset(counts, 0, sizeof(counts));
+		for (i = 0; i < n; i++)
+			counts[RADIX_DIGIT(info, &tuples[i], byte)]++;
+
+		if (counts[RADIX_DIGIT(info, &tuples[0], byte)] != n)
+			break;
+
+		/* all in one bucket; if this was the last byte, the keys are equal */
+		if (byte == 0)
+		{
+			if (info->tiebreak)
+				tuplesort_qsort(state, tuples, n);
+			return;
+		}
+		byte--;
+	}
+
+	pos = 0;
+	for (d = 0; d < 256; d++)
+	{
+		next[d] = pos;
+		pos += counts[d];
+		ends[d] = pos;
+	}
+
+	/*
+	 * Move each tuple into its bucket.  next[d] is the first position in
+	 * bucket d that doesn't yet hold a tuple belonging there; we carry the
+	 * tuple found there along to its own bucket, displacing another, until we
+	 * come back around to one that belongs in bucket d.
+	 */
+	for (d = 0; d < 256; d++)
+	{
+		while (next[d] < ends[d])
+		{
+			SortTuple	tmp = tuples[next[d]];
+			int			td = RADIX_DIGIT(info, &tmp, byte);
+
+			while (td != d)
+			{
+				SortTuple	displaced = tuples[next[td]];
+
+				tuples[next[td]++] = tmp;
+				tmp = displaced;
+				td = RADIX_DIGIT(info, &tmp, byte);
+			}
+			tuples[next[d]++] = tmp;
+		}
+	}
+
+	/* Now sort each bucket on the remaining bytes */
+	for (d = 0; d < 256; d++)
+	{
+		SortTuple  *bucket = tuples + ends[d] - counts[d];
+
+		if (counts[d] < 2)
+			continue;
+		if (byte == 0)
+		{
+			/* keys are equal */
+			if (info->tiebreak)
+				tuplesort_qsort(state, bucket, counts[d]);
+		}
+		else if (counts[d] < RADIX_SORT_MIN_BUCKET)
+			tuplesort_qsort(state, bucket, counts[d]);
 		else
-			qsort_tuple(state->memtuples,
-						state->memtupcount,
-						state->comparetup,
-						state);
+			radix_sort_tuple(state, info, bucket, counts[d], byte - 1);
 	}
 }
 
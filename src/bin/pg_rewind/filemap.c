@@ -88,9 +88,9 @@ struct exclude_list_item
 static const char *excludeDirContents[] =
 {
 	/*
-	 * Skip temporary statistics files. PG_STAT_TMP_DIR must be skipped even
-	 * when stats_temp_directory is set because PGSS_TEXT_FILE is always
-	 * created there.
+	 * Skip temporary statistics files.  The core statistics don't use this
+	 * directory anymore, but extensions do, e.g. pg_stat_statements'
+	 * PGSS_TEXT_FILE.
 	 */
 	"pg_stat_tmp",				/* defined as PG_STAT_TMP_DIR */
 
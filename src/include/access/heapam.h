@@ -22,6 +22,7 @@
 #include "access/tableam.h"
 #include "nodes/lockoptions.h"
 #include "nodes/primnodes.h"
+#include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/dsm.h"
 #include "storage/lockdefs.h"
@@ -63,6 +64,13 @@ typedef struct HeapScanDescData
 	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 
+	/*
+	 * Read stream for forward sequential scans, NULL for other kinds of
+	 * scan, and the last block number it was given by the scan.
+	 */
+	struct ReadStream *rs_read_stream;
+	BlockNumber rs_prefetch_block;
+
 	HeapTupleData rs_ctup;		/* current tuple in scan, if any */
 
 	/*
@@ -86,7 +94,8 @@ typedef struct IndexFetchHeapData
 	IndexFetchTableData xs_base;	/* AM independent part of the descriptor */
 
 	Buffer		xs_cbuf;		/* current heap buffer in scan, if any */
-	/* NB: if xs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
+	/* NB: if xs_cbuf is not InvalidBuffer, xs_pincache holds a pin on it */
+	BufferPinCache xs_pincache; /* recently visited heap buffers */
 } IndexFetchHeapData;
 
 /* Result codes for HeapTupleSatisfiesVacuum */
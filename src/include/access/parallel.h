@@ -57,6 +57,7 @@ typedef struct ParallelWorkerContext
 extern volatile bool ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
+extern PGDLLIMPORT bool ParallelWorkerInsertsAllowed;
 
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
@@ -0,0 +1,61 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.h
+ *	  Compact storage for a set of TIDs, in local memory or a DSA area.
+ *
+ * A TidStore remembers the offsets of interesting tuples on each heap block,
+ * in a form that is much smaller than a flat array of ItemPointers when
+ * blocks have more than a couple of entries, and that can optionally be
+ * shared among the processes of a parallel operation.  VACUUM uses one to
+ * remember the TIDs of dead items between the heap scan and index vacuuming.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/tidstore.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TIDSTORE_H
+#define TIDSTORE_H
+
+#include "storage/itemptr.h"
+#include "utils/dsa.h"
+
+/* Actual representations are private to tidstore.c */
+typedef struct TidStore TidStore;
+typedef struct TidStoreIter TidStoreIter;
+
+/* Result struct for TidStoreIterateNext */
+typedef struct TidStoreIterResult
+{
+	BlockNumber blkno;
+	int			num_offsets;
+	OffsetNumber offsets[MaxOffsetNumber];	/* in ascending order */
+} TidStoreIterResult;
+
+extern TidStore *TidStoreCreate(dsa_area *area, BlockNumber nblocks,
+								size_t max_bytes, int tranche_id);
+extern TidStore *TidStoreAttach(dsa_area *area, dsa_pointer handle);
+extern void TidStoreDetach(TidStore *ts);
+extern void TidStoreDestroy(TidStore *ts);
+extern dsa_pointer TidStoreGetHandle(TidStore *ts);
+
+extern void TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno,
+									OffsetNumber *offsets, int num_offsets);
+extern bool TidStoreIsMember(TidStore *ts, ItemPointer tid);
+extern void TidStoreReset(TidStore *ts);
+
+extern int64 TidStoreNumTids(TidStore *ts);
+extern size_t TidStoreMemoryUsage(TidStore *ts);
+extern size_t TidStoreMaxMemory(TidStore *ts);
+extern bool TidStoreIsFull(TidStore *ts);
+
+extern TidStoreIter *TidStoreBeginIterate(TidStore *ts);
+extern TidStoreIter *TidStoreBeginIterateRange(TidStore *ts,
+											   BlockNumber start,
+											   BlockNumber end);
+extern TidStoreIterResult *TidStoreIterateNext(TidStoreIter *iter);
+extern void TidStoreEndIterate(TidStoreIter *iter);
+
+#endif							/* TIDSTORE_H */
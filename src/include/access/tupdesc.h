@@ -75,6 +75,13 @@ typedef struct TupleConstr
  * context and go away when the context is freed.  We set the tdrefcount
  * field of such a descriptor to -1, while reference-counted descriptors
  * always have tdrefcount >= 0.
+ *
+ * tdfixedatts caches the number of leading fixed-width attributes, which
+ * are stored at their attcacheoff in any tuple that has no nulls among
+ * them; the first tddatumatts of those are also pass-by-value and
+ * Datum-sized, and stored back to back.  Both are computed on first use by
+ * slot_deform_heap_tuple(); tdfixedatts is -1 until then.  Code that changes
+ * the attributes of an existing tupdesc must reset it.
  */
 typedef struct TupleDescData
 {
@@ -83,6 +90,9 @@ typedef struct TupleDescData
 	int32		tdtypmod;		/* typmod for tuple type */
 	int			tdrefcount;		/* reference count, or -1 if not counting */
 	TupleConstr *constr;		/* constraints, or NULL if none */
+	int			tdfixedatts;	/* # of leading fixed-width attrs, or -1 if
+								 * not computed yet */
+	int			tddatumatts;	/* # of those that are Datum-sized byval */
 	/* attrs[N] is the description of Attribute Number N+1 */
 	FormData_pg_attribute attrs[FLEXIBLE_ARRAY_MEMBER];
 }			TupleDescData;
@@ -273,6 +273,17 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * Hint to the CPU that the memory at the given address will soon be read, so
+ * that it can start loading it into cache.  This never faults, even for an
+ * invalid address, and does nothing on compilers that can't express it.
+ */
+#if __GNUC__ >= 3
+#define pg_prefetch_mem(a)	__builtin_prefetch(a)
+#else
+#define pg_prefetch_mem(a)	((void) 0)
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
@@ -17,12 +17,24 @@
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 #include "tcop/dest.h"
 
+/*
+ * Compression applied to the body buffers of COPY TO's arrow format.
+ */
+typedef enum CopyCompression
+{
+	COPY_COMPRESSION_NONE,
+	COPY_COMPRESSION_LZ4
+} CopyCompression;
+
 /*
  * A struct to hold COPY options, in a parsed form. All of these are related
- * to formatting, except for 'freeze', which doesn't really belong here, but
- * it's expedient to parse it along with all the other options.
+ * to formatting, except for 'freeze' and 'nworkers', which don't really
+ * belong here, but it's expedient to parse them along with all the other
+ * options.
  */
 typedef struct CopyFormatOptions
 {
@@ -30,7 +42,10 @@ typedef struct CopyFormatOptions
 	int			file_encoding;	/* file or remote side's character encoding,
 								 * -1 if not specified */
 	bool		binary;			/* binary format? */
+	bool		arrow;			/* Arrow IPC stream format? (implies binary) */
+	CopyCompression compression;	/* arrow body compression */
 	bool		freeze;			/* freeze rows on loading? */
+	int			nworkers;		/* number of parallel workers requested */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	bool		header_line;	/* CSV header line? */
 	char	   *null_print;		/* NULL marker string (server encoding!) */
@@ -73,6 +88,8 @@ extern void CopyFromErrorCallback(void *arg);
 
 extern uint64 CopyFrom(CopyFromState cstate);
 
+extern void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
+
 extern DestReceiver *CreateCopyDestReceiver(void);
 
 /*
@@ -75,6 +75,8 @@ typedef struct CopyFromStateData
 	CopyFormatOptions opts;
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
+	List	   *attnamelist;	/* column names, as given to BeginCopyFrom */
+	List	   *options;		/* options, as given to BeginCopyFrom */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
@@ -164,9 +166,18 @@ typedef struct CopyFromStateData
 #define RAW_BUF_BYTES(cstate) ((cstate)->raw_buf_len - (cstate)->raw_buf_index)
 
 	uint64		bytes_processed;	/* number of bytes processed so far */
+
+	/* in a parallel COPY FROM worker, where the lines come from */
+	struct ParallelCopyWorker *pcworker;
 } CopyFromStateData;
 
 extern void ReceiveCopyBegin(CopyFromState cstate);
 extern void ReceiveCopyBinaryHeader(CopyFromState cstate);
+extern bool NextCopyFromLine(CopyFromState cstate);
+
+/* in copyfromparallel.c */
+extern bool CopyFromParallelOK(CopyFromState cstate);
+extern uint64 ParallelCopyFrom(CopyFromState cstate);
+extern bool ParallelCopyNextLine(CopyFromState cstate);
 
 #endif							/* COPYFROM_INTERNAL_H */
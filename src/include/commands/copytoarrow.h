@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * copytoarrow.h
+ *	  Writing COPY TO output in the Apache Arrow IPC stream format.
+ *
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/commands/copytoarrow.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COPYTOARROW_H
+#define COPYTOARROW_H
+
+#include "access/tupdesc.h"
+#include "executor/tuptable.h"
+#include "lib/stringinfo.h"
+#include "nodes/pg_list.h"
+
+/* This is private in commands/copytoarrow.c */
+typedef struct ArrowWriter ArrowWriter;
+
+extern ArrowWriter *ArrowWriterCreate(TupleDesc tupDesc, List *attnumlist,
+									  bool compress);
+extern void ArrowWriteSchema(ArrowWriter *writer, StringInfo out);
+extern bool ArrowWriterAppend(ArrowWriter *writer, TupleTableSlot *slot,
+							  StringInfo out);
+extern void ArrowWriteBatch(ArrowWriter *writer, StringInfo out);
+extern void ArrowWriteEndOfStream(ArrowWriter *writer, StringInfo out);
+
+#endif							/* COPYTOARROW_H */
@@ -0,0 +1,68 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Column-oriented batches of tuples, for batch execution mode
+ *
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "executor/tuptable.h"
+#include "nodes/bitmapset.h"
+#include "nodes/execnodes.h"
+
+/* Maximum number of rows in a batch */
+#define TUPLE_BATCH_SIZE	1024
+
+/*
+ * A batch of rows from a scan, stored one column at a time.
+ *
+ * Only pass-by-value columns are ever stored, so the vectors don't hold any
+ * pointers into buffers or other memory that might go away.  Columns that
+ * aren't needed have no vector at all.
+ *
+ * The rows that passed the scan's quals are listed, in order, in the
+ * selection vector; rows not listed there must be ignored.  A consumer
+ * working through the batch one row at a time advances "next" over the
+ * selection vector.
+ */
+typedef struct TupleBatch
+{
+	int			nrows;			/* number of rows in the vectors */
+	int			nselected;		/* number of entries in selection */
+	int			next;			/* next selection entry to consume */
+	bool		done;			/* has the scan been exhausted? */
+
+	AttrNumber	natts;			/* length of values and isnull arrays */
+	AttrNumber	maxattno;		/* highest column with a vector */
+	int			ncolumns;		/* number of columns with a vector */
+	AttrNumber *columns;		/* those columns' attribute numbers */
+	Datum	  **values;			/* values[attno - 1][row], or NULL */
+	bool	  **isnull;			/* isnull[attno - 1][row], or NULL */
+	uint16	   *selection;		/* rows that passed the quals */
+
+	/* mapping from the scan's output columns to attribute numbers */
+	int			noutcols;
+	AttrNumber *outcols;
+} TupleBatch;
+
+/* Opaque state for evaluating quals over a batch */
+typedef struct BatchQual BatchQual;
+
+extern TupleBatch *ExecInitTupleBatch(AttrNumber natts, Bitmapset *attnos,
+									  List *targetlist);
+extern void ExecResetTupleBatch(TupleBatch *batch);
+extern void ExecStoreBatchRow(TupleBatch *batch, int row,
+							  TupleTableSlot *slot);
+extern BatchQual *ExecInitBatchQual(List *qual, Bitmapset **attnos);
+extern void ExecBatchQual(BatchQual *bqual, TupleBatch *batch,
+						  ExprContext *econtext);
+
+#endif							/* EXECBATCH_H */
@@ -14,6 +14,7 @@
 #ifndef HASHJOIN_H
 #define HASHJOIN_H
 
+#include "lib/bloomfilter.h"
 #include "nodes/execnodes.h"
 #include "port/atomics.h"
 #include "storage/barrier.h"
@@ -142,6 +143,34 @@ typedef struct HashMemoryChunkData *HashMemoryChunk;
 /* tuples exceeding HASH_CHUNK_THRESHOLD bytes are put in their own chunk */
 #define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
 
+/*
+ * Once the in-memory hash table for a batch is much larger than the CPU's
+ * caches, nearly every probe of the chained buckets costs a cache miss.  In
+ * that case, ExecChooseHashTableSize asks for the table to be split into
+ * radix partitions of about HASH_RADIX_PARTITION_SIZE bytes each, where each
+ * partition covers a contiguous range of buckets and keeps its tuples in
+ * chunks of its own (see ExecHashTableRadixCluster).  The join then buffers
+ * outer tuples and probes them one partition at a time, so that the part of
+ * the table being probed stays in cache.  There is no portable way to find
+ * out the cache size, so we assume a rather small L2 cache.
+ */
+#define HASH_RADIX_PARTITION_SIZE	(256 * 1024L)
+#define HASH_RADIX_MIN_PARTITIONS	4
+#define HASH_RADIX_MAX_PARTITIONS	1024
+/* outer tuples buffered per partition, and limit on the buffer's size */
+#define HASH_RADIX_PROBE_TUPLES		64
+#define HASH_RADIX_PROBE_BUFFER_SIZE	(1024 * 1024L)
+
+/*
+ * When a batch's hash table is bigger than HASH_PREFETCH_MIN_SIZE, whether or
+ * not it is radix-partitioned, the join also reads outer tuples ahead and
+ * probes them in groups of HASH_PREFETCH_GROUP.  The buckets for a whole
+ * group are prefetched before any of them is probed (see
+ * ExecHashPrefetchBuckets), which lets the cache misses overlap.
+ */
+#define HASH_PREFETCH_MIN_SIZE		(1024 * 1024L)
+#define HASH_PREFETCH_GROUP			16
+
 /*
  * For each batch of a Parallel Hash Join, we have a ParallelHashJoinBatch
  * object in shared memory to coordinate access to it.  Since they are
@@ -243,6 +272,7 @@ typedef struct ParallelHashJoinState
 	int			nparticipants;
 	size_t		space_allowed;
 	size_t		total_tuples;	/* total number of inner tuples */
+	dsa_pointer bloom;			/* bloom_filter of inner hash values */
 	LWLock		lock;			/* lock protecting the above */
 
 	Barrier		build_barrier;	/* synchronization for the build phases */
@@ -344,6 +374,14 @@ typedef struct HashJoinTableData
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
 	Size		spaceAllowedSkew;	/* upper limit for skew hashtable */
+	Size		spaceBloom;		/* space set aside for the runtime filter */
+
+	/*
+	 * Bloom filter of the hash values of all inner tuples, or NULL if there
+	 * is no runtime filter.  For Parallel Hash this points into shared
+	 * memory, and is complete only once the build phase is finished.
+	 */
+	bloom_filter *bloom;
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
@@ -351,6 +389,11 @@ typedef struct HashJoinTableData
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
 
+	/* radix partitioning of each batch's table (not for Parallel Hash) */
+	int			nradix;			/* number of partitions, 1 if none */
+	int			log2_nradix;	/* its log2 */
+	Size		radixPartitionPeak; /* size of the largest partition */
+
 	/* Shared and private state for Parallel Hash. */
 	HashMemoryChunk current_chunk;	/* this backend's current chunk */
 	dsa_area   *area;			/* DSA area to allocate memory from */
@@ -359,4 +402,43 @@ typedef struct HashJoinTableData
 	dsa_pointer current_chunk_shared;
 }			HashJoinTableData;
 
+/*
+ * Outer tuples read ahead by a hash join, so that their buckets can be
+ * prefetched a group at a time and, if the hash table is radix-partitioned,
+ * so that they can be handed to the join in partition order.  The tuples,
+ * their hash values and bucket numbers are stored in arrival order, and
+ * order[] lists them by partition.
+ */
+typedef struct HashJoinProbeBuffer
+{
+	MemoryContext tupcxt;		/* holds the buffered tuples */
+	int			maxtuples;		/* capacity of the arrays */
+	int			ntuples;		/* number of tuples buffered */
+	int			next;			/* next position in order[] to return */
+	MinimalTuple *tuples;
+	uint32	   *hashvalues;
+	int		   *bucketnos;		/* each tuple's bucket in the current batch */
+	int		   *order;			/* tuple indexes, sorted by partition */
+	int		   *counts;			/* workspace for sorting, one per partition */
+} HashJoinProbeBuffer;
+
+/*
+ * A runtime filter pushed down by a hash join into its outer scan, so that
+ * outer tuples whose hash value is certainly absent from the inner side can
+ * be discarded before they ever reach the join.  The scan consults the
+ * filter only while hashtable is set, which is from the end of the build
+ * until the hash table goes away.
+ */
+typedef struct HashJoinRuntimeFilter
+{
+	HashJoinTable hashtable;	/* the join's hash table, or NULL */
+	List	   *outer_hashkeys; /* the join's outer hash key expressions */
+	ExprContext *econtext;		/* for evaluating outer_hashkeys */
+	uint64		ntested;		/* tuples tested in the current window */
+	uint64		nrejected;		/* ... and how many of them were rejected */
+	bool		disabled;		/* not selective enough to be worth it? */
+	bool		have_hashvalue; /* hashvalue belongs to the tuple last passed? */
+	uint32		hashvalue;		/* ... its hash value, for the join to reuse */
+} HashJoinRuntimeFilter;
+
 #endif							/* HASHJOIN_H */
@@ -1389,6 +1389,11 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	/* these are used only in batch mode, see ExecSeqScanInitBatch: */
+	struct TupleBatch *batch;	/* current batch of rows */
+	struct BatchQual *batchqual;	/* scan quals, for batch evaluation */
+	/* filter pushed down by a parent hash join, or NULL: */
+	struct HashJoinRuntimeFilter *runtime_filter;
 } SeqScanState;
 
 /* ----------------
@@ -1619,6 +1624,11 @@ typedef struct ParallelBitmapHeapState
  *		prefetch_pages	   # pages prefetch iterator is ahead of current
  *		prefetch_target    current target prefetch distance
  *		prefetch_maximum   maximum value for prefetch_target
+ *		prefetch_reads	   ring of reads started ahead of current page
+ *		prefetch_read_buffers buffers pinned by those reads
+ *		prefetch_reads_head oldest entry in the ring
+ *		prefetch_reads_count # of entries in the ring
+ *		prefetch_reads_size allocated size of the ring
  *		pscan_len		   size of the shared memory for parallel bitmap
  *		initialized		   is node is ready to iterate
  *		shared_tbmiterator	   shared iterator
@@ -1643,6 +1653,11 @@ typedef struct BitmapHeapScanState
 	int			prefetch_pages;
 	int			prefetch_target;
 	int			prefetch_maximum;
+	struct ReadBuffersOperation *prefetch_reads;
+	Buffer	   *prefetch_read_buffers;
+	int			prefetch_reads_head;
+	int			prefetch_reads_count;
+	int			prefetch_reads_size;
 	Size		pscan_len;
 	bool		initialized;
 	TBMSharedIterator *shared_tbmiterator;
@@ -2022,6 +2037,8 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	struct HashJoinRuntimeFilter *hj_RuntimeFilter; /* pushed into outer scan */
+	struct HashJoinProbeBuffer *hj_ProbeBuffer; /* read-ahead of outer tuples */
 } HashJoinState;
 
 
@@ -2154,6 +2171,14 @@ typedef struct SortState
 	bool		am_worker;		/* are we a worker? */
 	bool		datumSort;		/* Datum sort instead of tuple sort? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+
+	/* these fields are used only in a parallel-aware Sort: */
+	struct ParallelSortState *psort_state;	/* shared state, if parallel */
+	struct SharedTuplestoreAccessor **psort_stores; /* input, sample and
+													 * partitions */
+	SortSupport psort_keys;		/* for sampling and partitioning */
+	TupleTableSlot *psort_slot; /* for tuples read back from the stores */
+	TupleTableSlot *psort_slot2;	/* for comparing samples */
 } SortState;
 
 /* ----------------
@@ -2347,6 +2372,18 @@ typedef struct AggState
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
 	SharedAggInfo *shared_info; /* one entry per worker */
+
+	/* these fields are used only in batch mode: */
+	struct TupleBatch *batch;	/* outer SeqScan's current batch, or NULL */
+	TupleTableSlot *batch_slot; /* one row of the batch */
+	struct AggBatchTransData *batch_trans;	/* per-trans batch inputs, if
+											 * transitions can be run
+											 * directly over batches */
+
+	/* these fields are used only in a parallel-aware hashed Agg: */
+	struct ParallelAggState *pagg_state;	/* shared state, if parallel */
+	struct SharedTuplestoreAccessor **pagg_batches; /* shared batches */
+	bool		pagg_attached;	/* attached to the shared barrier? */
 } AggState;
 
 /* ----------------
@@ -2516,6 +2553,8 @@ typedef struct HashInstrumentation
 	int			nbatch;			/* number of batches at end of execution */
 	int			nbatch_original;	/* planned number of batches */
 	Size		space_peak;		/* peak memory usage in bytes */
+	int			nradix;			/* number of radix partitions */
+	Size		radix_partition_peak;	/* largest radix partition, in bytes */
 } HashInstrumentation;
 
 /* ----------------
@@ -2555,6 +2594,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Build a Bloom filter of inner hash values?  (set by parent HashJoin) */
+	bool		runtime_filter;
 } HashState;
 
 /* ----------------
@@ -1559,6 +1559,7 @@ typedef struct GatherPath
 	Path		path;
 	Path	   *subpath;		/* path for each worker */
 	bool		single_copy;	/* don't execute path more than once */
+	bool		ordered;		/* return each worker's output in turn? */
 	int			num_workers;	/* number of workers sought to help */
 } GatherPath;
 
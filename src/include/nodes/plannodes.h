@@ -772,6 +772,9 @@ typedef struct HashJoin
 	 * perform lookups in the hashtable over the inner plan.
 	 */
 	List	   *hashkeys;
+
+	/* push a Bloom filter of the inner hash values into the outer scan? */
+	bool		runtime_filter;
 } HashJoin;
 
 /* ----------------
@@ -872,6 +875,7 @@ typedef struct Agg
 	/* Note: planner provides numGroups & aggParams only in HASHED/MIXED case */
 	List	   *groupingSets;	/* grouping sets to use */
 	List	   *chain;			/* chained Agg/Sort nodes */
+	bool		batched;		/* consume the input SeqScan in batches? */
 } Agg;
 
 /* ----------------
@@ -931,6 +935,7 @@ typedef struct Gather
 	int			num_workers;	/* planned number of worker processes */
 	int			rescan_param;	/* ID of Param that signals a rescan, or -1 */
 	bool		single_copy;	/* don't execute plan more than once */
+	bool		ordered;		/* return each worker's output in turn? */
 	bool		invisible;		/* suppress EXPLAIN display (for testing)? */
 	Bitmapset  *initParam;		/* param id's of initplans which are referred
 								 * at gather or one of it's child node */
@@ -94,6 +94,10 @@ extern UniquePath *create_unique_path(PlannerInfo *root, RelOptInfo *rel,
 extern GatherPath *create_gather_path(PlannerInfo *root,
 									  RelOptInfo *rel, Path *subpath, PathTarget *target,
 									  Relids required_outer, double *rows);
+extern GatherPath *create_ordered_gather_path(PlannerInfo *root,
+											  RelOptInfo *rel, Path *subpath,
+											  PathTarget *target,
+											  double *rows);
 extern GatherMergePath *create_gather_merge_path(PlannerInfo *root,
 												 RelOptInfo *rel,
 												 Path *subpath,
@@ -199,6 +203,11 @@ extern SortPath *create_sort_path(PlannerInfo *root,
 								  Path *subpath,
 								  List *pathkeys,
 								  double limit_tuples);
+extern SortPath *create_parallel_sort_path(PlannerInfo *root,
+										   RelOptInfo *rel,
+										   Path *subpath,
+										   List *pathkeys,
+										   double limit_tuples);
 extern IncrementalSortPath *create_incremental_sort_path(PlannerInfo *root,
 														 RelOptInfo *rel,
 														 Path *subpath,
@@ -226,6 +235,14 @@ extern AggPath *create_agg_path(PlannerInfo *root,
 								List *qual,
 								const AggClauseCosts *aggcosts,
 								double numGroups);
+extern AggPath *create_parallel_hashagg_path(PlannerInfo *root,
+											 RelOptInfo *rel,
+											 Path *subpath,
+											 PathTarget *target,
+											 List *groupClause,
+											 List *qual,
+											 const AggClauseCosts *aggcosts,
+											 double numGroups);
 extern GroupingSetsPath *create_groupingsets_path(PlannerInfo *root,
 												  RelOptInfo *rel,
 												  Path *subpath,
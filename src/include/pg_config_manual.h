@@ -122,6 +122,13 @@
  */
 #define ALIGNOF_BUFFER	32
 
+/*
+ * Alignment required for buffers used with direct I/O (see data_direct_io).
+ * 4096 satisfies the logical block size of all common storage devices and
+ * file systems, and is also the usual memory page size.
+ */
+#define PG_IO_ALIGN_SIZE	4096
+
 /*
  * If EXEC_BACKEND is defined, the postmaster uses an alternative method for
  * starting subprocesses: Instead of simply using fork(), as is standard on
@@ -0,0 +1,20 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.h
+ *	  Minimal interface to the operating system's NUMA memory policies.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/pg_numa.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_NUMA_H
+#define PG_NUMA_H
+
+extern int	pg_numa_get_max_node(void);
+extern int	pg_numa_interleave_memory(void *ptr, size_t size);
+extern int	pg_numa_query_pages(unsigned long count, void **pages, int *status);
+
+#endif							/* PG_NUMA_H */
@@ -55,6 +55,47 @@ typedef struct PrefetchBufferResult
 	bool		initiated_io;	/* If true, a miss resulting in async I/O */
 } PrefetchBufferResult;
 
+/*
+ * State of a read of one or more consecutive blocks begun with
+ * StartReadBuffers() and completed with WaitReadBuffers().
+ */
+typedef struct ReadBuffersOperation
+{
+	/* The following members should be set by the caller. */
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+
+	/* The following private members are set by StartReadBuffers(). */
+	Buffer	   *buffers;
+	BlockNumber blocknum;
+	int			flags;
+	int16		nblocks;
+} ReadBuffersOperation;
+
+/*
+ * A few buffers kept pinned across calls of ReadBufferCached(), most
+ * recently used first.  Zero it before first use.
+ */
+#define BUFFER_PIN_CACHE_SIZE	4
+
+typedef struct BufferPinCache
+{
+	int			nbuffers;
+	Buffer		buffers[BUFFER_PIN_CACHE_SIZE];
+	BlockNumber blocks[BUFFER_PIN_CACHE_SIZE];
+} BufferPinCache;
+
+/* Flags for StartReadBuffers() */
+#define READ_BUFFERS_ISSUE_ADVICE	(1 << 0)	/* call smgrprefetch() on misses */
+
+/* Possible values for buffer_replacement_policy */
+typedef enum BufferReplacementPolicy
+{
+	BUFFER_REPLACEMENT_CLOCK,	/* plain clock sweep */
+	BUFFER_REPLACEMENT_2Q		/* probationary admission, see freelist.c */
+} BufferReplacementPolicy;
+
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
@@ -71,6 +112,7 @@ extern double bgwriter_lru_multiplier;
 extern bool track_io_timing;
 extern int	effective_io_concurrency;
 extern int	maintenance_io_concurrency;
+extern int	io_combine_limit;
 
 extern int	checkpoint_flush_after;
 extern int	backend_flush_after;
@@ -79,6 +121,12 @@ extern int	bgwriter_flush_after;
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
 
+/* in buf_table.c */
+extern bool buffer_mapping_hints;
+
+/* in freelist.c */
+extern int	buffer_replacement_policy;
+
 /* in localbuf.c */
 extern PGDLLIMPORT int NLocBuffer;
 extern PGDLLIMPORT Block *LocalBufferBlockPointers;
@@ -87,6 +135,10 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /* upper limit for effective_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
+/* upper limit and default for io_combine_limit, in blocks */
+#define MAX_IO_COMBINE_LIMIT 32
+#define DEFAULT_IO_COMBINE_LIMIT Min(MAX_IO_COMBINE_LIMIT, (128 * 1024) / BLCKSZ)
+
 /* special block number for ReadBuffer() */
 #define P_NEW	InvalidBlockNumber	/* grow the file to get a new page */
 
@@ -185,10 +237,18 @@ extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 										ForkNumber forkNum, BlockNumber blockNum,
 										ReadBufferMode mode, BufferAccessStrategy strategy);
+extern bool StartReadBuffers(ReadBuffersOperation *operation,
+							 Buffer *buffers, BlockNumber blockNum,
+							 int nblocks, int flags);
+extern void WaitReadBuffers(ReadBuffersOperation *operation);
+extern uint32 GetPinLimit(void);
 extern void ReleaseBuffer(Buffer buffer);
 extern void UnlockReleaseBuffer(Buffer buffer);
 extern void MarkBufferDirty(Buffer buffer);
 extern void IncrBufferRefCount(Buffer buffer);
+extern Buffer ReadBufferCached(BufferPinCache *cache, Relation relation,
+							   BlockNumber blockNum, bool *newly_pinned);
+extern void ReleaseBufferPinCache(BufferPinCache *cache);
 extern Buffer ReleaseAndReadBuffer(Buffer buffer, Relation relation,
 								   BlockNumber blockNum);
 
@@ -243,7 +303,11 @@ extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
+extern int	GetAccessStrategyBufferCount(BufferAccessStrategy strategy);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
+extern void StrategyReplacementStats(uint64 *cold_admissions,
+									 uint64 *hot_admissions,
+									 uint64 *evictions);
 
 
 /* inline functions */
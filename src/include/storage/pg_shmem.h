@@ -45,6 +45,7 @@ typedef struct PGShmemHeader	/* standard header for all Postgres shmem */
 extern int	shared_memory_type;
 extern int	huge_pages;
 extern int	huge_page_size;
+extern int	shared_memory_numa;
 
 /* Possible values for huge_pages */
 typedef enum
@@ -54,6 +55,13 @@ typedef enum
 	HUGE_PAGES_TRY
 }			HugePagesType;
 
+/* Possible values for shared_memory_numa */
+typedef enum
+{
+	SHMEM_NUMA_OFF,
+	SHMEM_NUMA_INTERLEAVE
+}			ShmemNumaType;
+
 /* Possible values for shared_memory_type */
 typedef enum
 {
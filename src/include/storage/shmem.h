@@ -42,6 +42,7 @@ extern void InitShmemIndex(void);
 extern HTAB *ShmemInitHash(const char *name, long init_size, long max_size,
 						   HASHCTL *infoP, int hash_flags);
 extern void *ShmemInitStruct(const char *name, Size size, bool *foundPtr);
+extern void ShmemInterleave(const char *name, void *ptr, Size size);
 extern Size add_size(Size s1, Size s2);
 extern Size mul_size(Size s1, Size s2);
 
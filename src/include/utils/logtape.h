@@ -25,6 +25,17 @@
 typedef struct LogicalTapeSet LogicalTapeSet;
 typedef struct LogicalTape LogicalTape;
 
+/* Possible values for temp_file_compression */
+typedef enum TempFileCompression
+{
+	TEMP_FILE_COMPRESSION_NONE,
+	TEMP_FILE_COMPRESSION_PGLZ,
+	TEMP_FILE_COMPRESSION_LZ4
+} TempFileCompression;
+
+/* GUC variable */
+extern int	temp_file_compression;
+
 
 /*
  * The approach tuplesort.c takes to parallel external sorts is that workers,
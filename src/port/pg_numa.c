@@ -0,0 +1,168 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_numa.c
+ *	  Minimal interface to the operating system's NUMA memory policies.
+ *
+ * On Linux, we issue the mbind() and move_pages() system calls directly, so
+ * that no NUMA support library is needed to build or run the server.  On
+ * other platforms, or kernels built without NUMA support, every function
+ * fails with ENOSYS and callers are expected to carry on without placement
+ * control.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_numa.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#include "port/pg_numa.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(SYS_mbind) && defined(SYS_move_pages) && defined(SYS_get_mempolicy)
+#define PG_HAVE_NUMA_SYSCALLS 1
+#endif
+
+#ifdef PG_HAVE_NUMA_SYSCALLS
+
+/* We don't support machines with more nodes than this */
+#define PG_NUMA_MAX_NODES		1024
+#define PG_NUMA_MASK_WORDS		(PG_NUMA_MAX_NODES / (8 * sizeof(unsigned long)))
+
+/*
+ * Parse a node list as found in /sys/devices/system/node, such as "0-3,8",
+ * into a bitmask.  Returns the highest node number found, or -1 if the file
+ * can't be read.
+ */
+static int
+pg_numa_read_nodelist(const char *path, unsigned long *mask)
+{
+	FILE	   *fp;
+	char		buf[1024];
+	char	   *p;
+	int			max_node = -1;
+
+	memset(mask, 0, sizeof(unsigned long) * PG_NUMA_MASK_WORDS);
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return -1;
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+	{
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	p = buf;
+	while (*p >= '0' && *p <= '9')
+	{
+		long		first = strtol(p, &p, 10);
+		long		last = first;
+
+		if (*p == '-')
+			last = strtol(p + 1, &p, 10);
+		for (long node = first; node <= last && node < PG_NUMA_MAX_NODES; node++)
+		{
+			mask[node / (8 * sizeof(unsigned long))] |=
+				1UL << (node % (8 * sizeof(unsigned long)));
+			max_node = Max(max_node, (int) node);
+		}
+		if (*p == ',')
+			p++;
+	}
+
+	return max_node;
+}
+
+/*
+ * Return the highest NUMA node number on this machine, or -1 if NUMA memory
+ * policies are not supported.  A machine without NUMA hardware still has
+ * node 0.
+ */
+int
+pg_numa_get_max_node(void)
+{
+	unsigned long mask[PG_NUMA_MASK_WORDS];
+	int			max_node;
+
+	/* Fails with ENOSYS if the kernel was built without NUMA support */
+	if (syscall(SYS_get_mempolicy, NULL, NULL, 0, NULL, 0) != 0)
+		return -1;
+
+	max_node = pg_numa_read_nodelist("/sys/devices/system/node/possible", mask);
+	return Max(max_node, 0);
+}
+
+/*
+ * Ask the kernel to spread the pages of the given memory range round-robin
+ * over all online nodes, moving any pages that are already present.  The
+ * range must be aligned to the page size of the mapping.
+ *
+ * Returns 0 on success, or -1 with errno set.
+ */
+int
+pg_numa_interleave_memory(void *ptr, size_t size)
+{
+	unsigned long mask[PG_NUMA_MASK_WORDS];
+
+	if (pg_numa_read_nodelist("/sys/devices/system/node/online", mask) < 0)
+	{
+		/* Without sysfs, node 0 is the only one we know about */
+		mask[0] = 1;
+	}
+
+	/*
+	 * The kernel ignores the last bit of the mask it is told about, hence
+	 * the +1.
+	 */
+	return syscall(SYS_mbind, ptr, (unsigned long) size, MPOL_INTERLEAVE,
+				   mask, (unsigned long) (PG_NUMA_MAX_NODES + 1),
+				   MPOL_MF_MOVE);
+}
+
+/*
+ * Find out which node each of the given pages resides on.  On return,
+ * status[i] is the node of pages[i], or a negative errno value such as
+ * -ENOENT if the page is not currently present in memory.
+ *
+ * Returns 0 on success, or -1 with errno set.
+ */
+int
+pg_numa_query_pages(unsigned long count, void **pages, int *status)
+{
+	return syscall(SYS_move_pages, 0, count, pages, NULL, status, 0);
+}
+
+#else							/* !PG_HAVE_NUMA_SYSCALLS */
+
+int
+pg_numa_get_max_node(void)
+{
+	return -1;
+}
+
+int
+pg_numa_interleave_memory(void *ptr, size_t size)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+int
+pg_numa_query_pages(unsigned long count, void **pages, int *status)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+#endif							/* PG_HAVE_NUMA_SYSCALLS */
@@ -0,0 +1,119 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Check that COPY TO in arrow format produces a stream that an independent
+# Arrow reader accepts, with the right values, and that record batches are
+# split before their body grows too large.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# We use pyarrow as the reader
+my $python = $ENV{PYTHON} || 'python3';
+if (!run_log([ $python, '-c', 'import pyarrow.ipc' ]))
+{
+	plan skip_all => 'pyarrow is not available';
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->start;
+
+my $tempdir = PostgreSQL::Test::Utils::tempdir;
+
+# Read an arrow stream and print the number of batches, the number of rows,
+# the size of the largest batch body, and the rows themselves if asked to.
+my $reader = <<'PY';
+import sys
+import pyarrow as pa
+import pyarrow.ipc as ipc
+
+with open(sys.argv[1], 'rb') as f:
+    batches = list(ipc.open_stream(f))
+table = pa.Table.from_batches(batches)
+body = max(sum(b.size for c in batch.columns for b in c.buffers() if b)
+           for batch in batches)
+print('batches=%d rows=%d' % (len(batches), table.num_rows))
+print('body_ok=%s' % (body <= 64 * 1024 * 1024))
+if sys.argv[2] == 'rows':
+    print(','.join('%s:%s' % (f.name, f.type) for f in table.schema))
+    for row in table.to_pylist():
+        print('|'.join('\\x' + v.hex() if isinstance(v, bytes) else str(v)
+                       for v in row.values()))
+elif sys.argv[2] == 'lengths':
+    for row in table.to_pylist():
+        print('|'.join(str(len(v)) if v is not None else 'None'
+                       for v in row.values()))
+PY
+
+sub read_arrow
+{
+	my ($file, $mode) = @_;
+	my ($stdout, $stderr) = run_command([ $python, '-c', $reader, $file, $mode ]);
+	is($stderr, '', "reading $file produces no errors");
+	return $stdout;
+}
+
+# Values of all the column kinds, including nulls
+$node->safe_psql(
+	'postgres', q{
+	CREATE TABLE kinds (b bool, i2 int2, i4 int4, i8 int8, f4 float4,
+		f8 float8, d date, ts timestamp, tstz timestamptz, t text, n name,
+		by bytea, nu numeric);
+	INSERT INTO kinds VALUES
+		(true, 1, 2, 3, 1.5, 2.25, '2021-10-01', '2021-10-01 12:34:56',
+		 '2021-10-01 12:34:56+00', 'hello', 'nm', '\x00ff', 12.5),
+		(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		 NULL, NULL),
+		(false, -1, -2, -3, -1.5, -2.25, '1969-12-31', '1969-12-31 23:59:59',
+		 '1969-12-31 23:59:59+00', '', '', '', -1);
+});
+
+my @formats = ('none');
+push @formats, 'lz4' if check_pg_config("#define USE_LZ4 1");
+
+foreach my $compression (@formats)
+{
+	my $file = "$tempdir/kinds_$compression.arrow";
+
+	$node->safe_psql('postgres',
+		"COPY kinds TO '$file' (FORMAT arrow, COMPRESSION $compression)");
+	is( read_arrow($file, 'rows'),
+		q{batches=1 rows=3
+body_ok=True
+b:bool,i2:int16,i4:int32,i8:int64,f4:float,f8:double,d:date32[day],ts:timestamp[us],tstz:timestamp[us, tz=UTC],t:string,n:string,by:binary,nu:string
+True|1|2|3|1.5|2.25|2021-10-01|2021-10-01 12:34:56|2021-10-01 12:34:56+00:00|hello|nm|\x00ff|12.5
+None|None|None|None|None|None|None|None|None|None|None|None|None
+False|-1|-2|-3|-1.5|-2.25|1969-12-31|1969-12-31 23:59:59|1969-12-31 23:59:59+00:00|||\x|-1
+},
+		"all column kinds read back, compression $compression");
+}
+
+# Batches are limited to 65536 rows
+my $file = "$tempdir/many.arrow";
+$node->safe_psql('postgres',
+	"COPY (SELECT g FROM generate_series(1, 100000) g) TO '$file' (FORMAT arrow)"
+);
+is(read_arrow($file, 'count'), "batches=2 rows=100000\nbody_ok=True\n",
+	'long output is split into batches of 65536 rows');
+
+# Several wide columns, none of which reaches 64MB in a batch on its own but
+# which do together, must still be split into batches of at most 64MB.
+$file = "$tempdir/wide.arrow";
+$node->safe_psql(
+	'postgres', qq{
+	COPY (SELECT repeat('a', 2000000) a, repeat('b', 2000000) b,
+			  repeat('c', 2000000) c, repeat('d', 2000000) d
+		  FROM generate_series(1, 20))
+	  TO '$file' (FORMAT arrow)});
+like(
+	read_arrow($file, 'lengths'),
+	qr/^batches=[3-9] rows=20\nbody_ok=True\n(2000000\|2000000\|2000000\|2000000\n){20}$/,
+	'wide rows are split into batches of at most 64MB');
+
+$node->stop;
+
+done_testing();
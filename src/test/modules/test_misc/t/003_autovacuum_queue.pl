@@ -0,0 +1,84 @@
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Check that an autovacuum worker processes the tables it finds in order of
+# urgency, and that pg_stat_autovacuum_queue shows them in that order.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More tests => 2;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+
+# A single, very slow worker, so that the queue stays populated while we
+# look at it.  Autovacuum starts out disabled while we set up the tables.
+$node->append_conf(
+	'postgresql.conf', qq[
+autovacuum = off
+autovacuum_naptime = 1s
+autovacuum_max_workers = 1
+autovacuum_vacuum_cost_delay = 100ms
+autovacuum_vacuum_cost_limit = 1
+]);
+$node->start;
+
+# Three tables that need vacuuming only because of their dead tuples, each
+# ten times further past its threshold than the previous one.  Create the
+# least urgent one first, so that pg_class order is the wrong order.
+foreach my $t ([ 'av_small', 60 ], [ 'av_medium', 600 ], [ 'av_big', 6000 ])
+{
+	my ($name, $ndead) = @$t;
+	my $nrows = $ndead * 2;
+
+	$node->safe_psql(
+		'postgres', qq[
+CREATE TABLE $name (a int, b text)
+  WITH (autovacuum_vacuum_threshold = 10,
+        autovacuum_vacuum_scale_factor = 0,
+        autovacuum_vacuum_insert_threshold = -1,
+        autovacuum_analyze_threshold = 1000000000);
+INSERT INTO $name SELECT g, repeat('x', 100) FROM generate_series(1, $nrows) g;
+DELETE FROM $name WHERE a <= $ndead;
+]);
+}
+
+$node->safe_psql('postgres',
+	'ALTER SYSTEM SET autovacuum = on; SELECT pg_reload_conf();');
+
+# Wait for the worker to claim the most urgent table
+$node->poll_query_until(
+	'postgres', qq[
+SELECT q.pid IS NOT NULL
+FROM pg_stat_autovacuum_queue q JOIN pg_class c ON c.oid = q.relid
+WHERE c.relname = 'av_big'])
+  or die "timed out waiting for av_big to be claimed";
+
+# The other two must still be waiting, ranked by score
+my $queue = $node->safe_psql(
+	'postgres', qq[
+SELECT string_agg(c.relname || ':' || (q.pid IS NOT NULL), ','
+                  ORDER BY q.priority)
+FROM pg_stat_autovacuum_queue q JOIN pg_class c ON c.oid = q.relid
+WHERE c.relname IN ('av_small', 'av_medium', 'av_big')]);
+is( $queue,
+	'av_big:true,av_medium:false,av_small:false',
+	'most urgent table is claimed first, the others queue by score');
+
+# Let the worker finish, and check the order it vacuumed the tables in
+$node->poll_query_until(
+	'postgres', qq[
+SELECT count(*) = 3 FROM pg_stat_user_tables
+WHERE relname IN ('av_small', 'av_medium', 'av_big')
+  AND last_autovacuum IS NOT NULL])
+  or die "timed out waiting for the tables to be vacuumed";
+
+my $order = $node->safe_psql(
+	'postgres', qq[
+SELECT string_agg(relname, ',' ORDER BY last_autovacuum)
+FROM pg_stat_user_tables
+WHERE relname IN ('av_small', 'av_medium', 'av_big')]);
+is($order, 'av_big,av_medium,av_small', 'tables vacuumed by urgency');
+
+$node->stop;
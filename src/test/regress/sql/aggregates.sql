@@ -1245,3 +1245,25 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+-- Test batch execution of aggregates over a sequential scan
+create temp table batch_t as
+  select g as a, g % 3 as b, g::text as c from generate_series(1, 3000) g;
+insert into batch_t values (null, null, null);
+set enable_batch_execution = on;
+explain (costs off)
+select count(*), count(b), sum(a), min(b), max(a) from batch_t
+  where a > 100 and b <> 1;
+select count(*), count(b), sum(a), min(b), max(a) from batch_t
+  where a > 100 and b <> 1;
+select count(*), count(a) from batch_t;
+-- aggregates that can't run over whole batches get one row at a time
+explain (costs off)
+select avg(a), count(*) from batch_t where 1500 > a;
+select avg(a), count(*) from batch_t where 1500 > a;
+select b, count(*), sum(a) from batch_t where a <= 2000 group by b order by b;
+-- columns of pass-by-reference types prevent batch mode
+explain (costs off)
+select count(c) from batch_t;
+reset enable_batch_execution;
+drop table batch_t;
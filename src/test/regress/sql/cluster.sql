@@ -263,6 +263,20 @@ EXPLAIN (COSTS OFF) SELECT * FROM clstr_expression WHERE -a = -3 ORDER BY -a, b;
 SELECT * FROM clstr_expression WHERE -a = -3 ORDER BY -a, b;
 COMMIT;
 
+-- CLUSTER by sorting on an index whose leading column is an expression,
+-- with enough rows that the in-memory sort would consider a radix sort
+CREATE TABLE clstr_expression_sort (a int, b int);
+INSERT INTO clstr_expression_sort
+  SELECT (g.i * 7919) % 500, g.i FROM generate_series(1, 2000) g(i);
+CREATE INDEX clstr_expression_sort_idx ON clstr_expression_sort ((-a), b);
+SET enable_indexscan = off;
+CLUSTER clstr_expression_sort USING clstr_expression_sort_idx;
+RESET enable_indexscan;
+SELECT * FROM
+(SELECT -a AS ma, lag(-a) OVER () AS lma, b, lag(b) OVER () AS lb
+   FROM clstr_expression_sort) ss
+WHERE row(ma, b) <= row(lma, lb);
+
 -- clean up
 DROP TABLE clustertest;
 DROP TABLE clstr_1;
@@ -270,5 +284,6 @@ DROP TABLE clstr_2;
 DROP TABLE clstr_3;
 DROP TABLE clstr_4;
 DROP TABLE clstr_expression;
+DROP TABLE clstr_expression_sort;
 
 DROP USER regress_clstr_user;
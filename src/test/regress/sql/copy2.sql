@@ -454,6 +454,67 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- Test parallel COPY FROM.  The results are the same whether or not any
+-- workers could be launched.
+COPY x from stdin (parallel 1, parallel 2);
+COPY x from stdin (parallel -1);
+COPY x to stdout (parallel 2);
+CREATE TABLE parallel_copy_tbl (a int PRIMARY KEY, b text, c int DEFAULT 42 CHECK (c > 0));
+COPY parallel_copy_tbl (a, b) FROM stdin WITH (parallel 2);
+1	one
+2	two
+3	\N
+\.
+COPY parallel_copy_tbl FROM stdin WITH (FORMAT csv, HEADER, PARALLEL 2);
+a,b,c
+4,"four
+lines",4
+5,,5
+\.
+COPY parallel_copy_tbl FROM stdin WITH (parallel 2) WHERE a > 7;
+6	six	6
+7	seven	7
+8	eight	8
+\.
+SELECT a, b IS NULL AS b_null, length(b) AS b_len, c FROM parallel_copy_tbl ORDER BY a;
+\set VERBOSITY terse
+COPY parallel_copy_tbl (a, b) FROM stdin WITH (parallel 2);
+9	nine
+9	nine again
+\.
+COPY parallel_copy_tbl FROM stdin WITH (parallel 2);
+10	ten	0
+\.
+\set VERBOSITY default
+SELECT count(*) FROM parallel_copy_tbl;
+DROP TABLE parallel_copy_tbl;
+
+-- Test long fields with special characters at various positions, which
+-- the parsing code skips over a vector at a time
+CREATE TEMP TABLE longfields (a text, b text);
+COPY longfields FROM stdin;
+abcdefghijklmnopqrstuvwxyz0123456789	abcdefghijklmnop\tqrstuvwxyz
+abcdefghijklmnopqrstuvwxyz\\0123456789	\N
+abcdefghijklmno\npqrstuvwxyz	abcdefghijklmnopqrstuvwxyz0123456789\\
+\.
+COPY longfields FROM stdin (FORMAT csv);
+abcdefghijklmnopqrstuvwxyz0123456789,"abcdefghijklmnop,qrstuvwxyz"
+"abcdefghijklmnopqrstuvwxyz""0123456789",
+"abcdefghijklmno
+pqrstuvwxyz",abcdefghijklmnopqrstuvwxyz0123456789\
+\.
+SELECT length(a) AS alen, replace(a, E'\n', '<nl>') AS a,
+       length(b) AS blen, replace(replace(b, E'\n', '<nl>'), E'\t', '<tab>') AS b
+  FROM longfields;
+DROP TABLE longfields;
+
+-- Test option checks for the arrow format
+COPY x from stdin (format arrow);
+COPY x to stdout (format binary, compression lz4);
+COPY x to stdout (format arrow, compression zstd);
+COPY x to stdout (format arrow, compression none, compression none);
+COPY x to stdout (format arrow, delimiter ',');
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -52,6 +52,21 @@ begin
   end loop;
 end;
 $$;
+-- Extract the number of radix partitions from an explain analyze plan.
+create or replace function hash_join_radix_partitions(query text)
+returns int language plpgsql
+as
+$$
+declare
+  whole_plan json;
+begin
+  for whole_plan in
+    execute 'explain (analyze, format ''json'') ' || query
+  loop
+    return find_hash(json_extract_path(whole_plan, '0', 'Plan'))->>'Radix Partitions';
+  end loop;
+end;
+$$;
 
 -- Make a simple relation with well distributed keys and correctly
 -- estimated size.
@@ -105,6 +120,32 @@ $$
 $$);
 rollback to settings;
 
+-- A hash table much larger than the CPU cache is split into radix
+-- partitions, and the outer tuples are probed one partition at a time
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '4MB';
+select count(*) from simple r join simple s using (id);
+select hash_join_radix_partitions(
+$$
+  select count(*) from simple r join simple s using (id);
+$$);
+select count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+-- also when there are several batches, each of them partitioned
+set local work_mem = '1MB';
+select count(*) from simple r join simple s using (id);
+select hash_join_radix_partitions(
+$$
+  select count(*) from simple r join simple s using (id);
+$$);
+select original > 1 as initially_multibatch
+  from hash_join_batches(
+$$
+  select count(*) from simple r join simple s using (id);
+$$);
+select count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+rollback to settings;
+
 -- parallel with parallel-oblivious hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
@@ -467,6 +508,50 @@ $$
 $$);
 rollback to settings;
 
+-- runtime filter: an inner hash join hands a Bloom filter of the inner hash
+-- values down to its outer sequential scan, which then discards rows that
+-- can't have a match
+create or replace function runtime_filter_removed(query text)
+returns json language plpgsql
+as
+$$
+declare
+  whole_plan json;
+begin
+  for whole_plan in
+    execute 'explain (analyze, format ''json'') ' || query
+  loop
+    return json_extract_path(whole_plan, '0', 'Plan', 'Plans', '0', 'Plans', '0',
+                             'Rows Removed by Runtime Filter');
+  end loop;
+end;
+$$;
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+explain (costs off)
+  select count(*) from simple r join generate_series(1, 100) s(id) using (id);
+select count(*) from simple r join generate_series(1, 100) s(id) using (id);
+select runtime_filter_removed(
+$$
+  select count(*) from simple r join generate_series(1, 100) s(id) using (id);
+$$);
+-- outer joins must keep the unmatched rows, so they don't get a filter
+select runtime_filter_removed(
+$$
+  select count(*) from simple r left join generate_series(1, 100) s(id) using (id);
+$$);
+-- nor do joins that aren't expected to discard most of their outer rows
+select runtime_filter_removed(
+$$
+  select count(*) from simple r join simple s using (id);
+$$);
+set local enable_hashjoin_runtime_filter = off;
+select runtime_filter_removed(
+$$
+  select count(*) from simple r join generate_series(1, 100) s(id) using (id);
+$$);
+rollback to settings;
+
 rollback;
 
 
@@ -92,6 +92,24 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test parallel-aware hash aggregation, which doesn't need the aggregates
+-- to have combine functions; it only pays off when gathering isn't free
+set parallel_tuple_cost=0.1;
+explain (costs off)
+	select ten, cardinality(array_agg(unique1)) from tenk1 group by ten;
+select ten, cardinality(array_agg(unique1)) from tenk1 group by ten order by ten;
+set parallel_tuple_cost=0;
+
+-- test parallel-aware sort, whose workers' outputs are returned in turn
+set enable_parallel_sort=on;
+set enable_gathermerge=off;
+explain (costs off)
+	select unique1 from tenk1 order by two, unique1;
+select md5(string_agg(unique1::text, ','))
+  from (select unique1 from tenk1 order by two, unique1) ss;
+reset enable_gathermerge;
+reset enable_parallel_sort;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)
@@ -151,7 +151,7 @@ RESET enable_bitmapscan;
 -- then send its stats before dying.
 \c -
 
--- wait for stats collector to update
+-- wait for the stats to be flushed
 SELECT wait_for_stats();
 
 -- check effects
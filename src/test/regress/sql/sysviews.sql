@@ -37,12 +37,22 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- Every named allocation has at least one row, whether NUMA is supported or not
+select count(*) > 0 as ok from pg_shmem_allocations_numa;
+
+-- The autovacuum work queue may or may not be empty, but priorities are dense
+select count(*) = coalesce(max(priority), 0) as ok from pg_stat_autovacuum_queue;
+
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
 -- We expect no walreceiver running in this test
 select count(*) = 0 as ok from pg_stat_wal_receiver;
 
+-- The default replacement policy is plain clock sweep
+select policy, cold_admissions >= 0 and hot_admissions >= 0 and evictions >= 0 as ok
+  from pg_stat_get_buffer_replacement();
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
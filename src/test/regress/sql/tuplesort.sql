@@ -146,6 +146,32 @@ FROM abbrev_abort_uuids
 ORDER BY ctid DESC LIMIT 5;
 ROLLBACK;
 
+----
+-- Check radix sorting of integer leading keys, including NULLs, descending
+-- order and ties that need further comparisons
+----
+
+CREATE TEMP TABLE radix_sort_ints AS
+    SELECT ((g.i * 7919) % 10007 - 5000)::int4 AS i4,
+           ((g.i * 7919) % 10007 - 5000)::int8 * 1000000007 AS i8,
+           g.i % 3 AS g
+    FROM generate_series(1, 10006) g(i);
+INSERT INTO radix_sort_ints VALUES (NULL, NULL, 0), (NULL, NULL, 1), (7, 7000000049, 2), (7, 7000000049, 0);
+
+-- single sort key, so equal keys need no further comparison
+SELECT md5(string_agg(coalesce(i4::text, 'NULL'), ',')) FROM (SELECT i4 FROM radix_sort_ints ORDER BY i4) s;
+SELECT md5(string_agg(coalesce(i4::text, 'NULL'), ',')) FROM (SELECT i4 FROM radix_sort_ints ORDER BY i4 DESC) s;
+
+-- ties on the leading key broken by the second one
+SELECT md5(string_agg(coalesce(i8::text, 'NULL') || ':' || g, ',')) FROM (SELECT i8, g FROM radix_sort_ints ORDER BY i8 NULLS FIRST, g DESC) s;
+SELECT md5(string_agg(coalesce(i4::text, 'NULL') || ':' || g, ',')) FROM (SELECT i4, g FROM radix_sort_ints ORDER BY g, i4 DESC NULLS LAST) s;
+
+-- Datum sort
+SELECT md5(array_agg(i8 ORDER BY i8 DESC)::text) FROM radix_sort_ints;
+
+-- index builds must still notice duplicates
+CREATE UNIQUE INDEX radix_sort_ints_i4_idx ON radix_sort_ints (i4);
+
 ----
 -- test forward and backward scans for in-memory and disk based tuplesort
 ----
@@ -259,6 +285,27 @@ FROM (
 
 ROLLBACK;
 
+-- disk based, with compressed temporary files
+BEGIN;
+SET LOCAL work_mem = '100kB';
+SET LOCAL temp_file_compression = pglz;
+
+SELECT
+    (array_agg(id ORDER BY id DESC NULLS FIRST))[0:5],
+    (array_agg(abort_increasing ORDER BY abort_increasing DESC NULLS LAST))[0:5],
+    (array_agg(id::text ORDER BY id::text DESC NULLS LAST))[0:5],
+    percentile_disc(0.99) WITHIN GROUP (ORDER BY id),
+    percentile_disc(0.01) WITHIN GROUP (ORDER BY id),
+    percentile_disc(0.8) WITHIN GROUP (ORDER BY abort_increasing),
+    percentile_disc(0.2) WITHIN GROUP (ORDER BY id::text),
+    rank('00000000-0000-0000-0000-000000000000', '2', '2') WITHIN GROUP (ORDER BY noabort_increasing, id, id::text)
+FROM (
+    SELECT * FROM abbrev_abort_uuids
+    UNION ALL
+    SELECT NULL, NULL, NULL, NULL, NULL) s;
+
+ROLLBACK;
+
 
 ----
 -- test tuplesort mark/restore
@@ -75,6 +75,39 @@ VACUUM FULL vactst;
 
 VACUUM (DISABLE_PAGE_SKIPPING) vaccluster;
 
+-- Dead tuple store, with pages having many and few dead items.  Stale index
+-- entries pointing at reused line pointers would give wrong answers below.
+CREATE TABLE vac_tidstore (i int PRIMARY KEY, t text) WITH (autovacuum_enabled = off);
+INSERT INTO vac_tidstore SELECT i, 'x' FROM generate_series(1, 10000) i;
+DELETE FROM vac_tidstore WHERE i <= 2000 AND i % 2 = 0;
+DELETE FROM vac_tidstore WHERE i > 2000 AND i % 97 = 0;
+VACUUM vac_tidstore;
+INSERT INTO vac_tidstore SELECT i, 'y' FROM generate_series(10001, 12000) i;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM vac_tidstore WHERE i <= 2000;
+SELECT count(*), count(*) FILTER (WHERE t = 'y') FROM vac_tidstore WHERE i > 0;
+-- Same again, with the store shared by parallel vacuum workers
+CREATE INDEX vac_tidstore_t ON vac_tidstore (t);
+SET min_parallel_index_scan_size TO 0;
+DELETE FROM vac_tidstore WHERE i % 3 = 0;
+VACUUM (PARALLEL 2) vac_tidstore;
+INSERT INTO vac_tidstore SELECT i, 'z' FROM generate_series(12001, 13000) i;
+SELECT count(*) FROM vac_tidstore WHERE i <= 2000;
+SELECT count(*) FROM vac_tidstore WHERE t = 'z';
+-- And with the heap passes divided among parallel vacuum workers
+SET min_parallel_table_scan_size TO 0;
+DELETE FROM vac_tidstore WHERE i % 5 = 0;
+VACUUM (PARALLEL 2) vac_tidstore;
+INSERT INTO vac_tidstore SELECT i, 'w' FROM generate_series(13001, 14000) i;
+SELECT count(*) FROM vac_tidstore WHERE i <= 2000;
+SELECT count(*) FROM vac_tidstore WHERE t = 'w';
+RESET min_parallel_table_scan_size;
+RESET min_parallel_index_scan_size;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE vac_tidstore;
+
 -- PARALLEL option
 CREATE TABLE pvactst (i INT, a INT[], p POINT) with (autovacuum_enabled = off);
 INSERT INTO pvactst SELECT i, array[1,2,3], point(i, i+1) FROM generate_series(1,1000) i;